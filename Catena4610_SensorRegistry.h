@@ -0,0 +1,186 @@
+/*
+
+Module: Catena4610_SensorRegistry.h
+
+Function:
+    Compile-time table of the sensors in this build.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_SensorRegistry_h_
+# define _Catena4610_SensorRegistry_h_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+
+Name:   CATENA4610_SENSOR_BME280, CATENA4610_SENSOR_SI1133,
+        CATENA4610_SENSOR_COMPOST
+
+Function:
+    Select the sensors built into the firmware.
+
+Description:
+    Each defaults to 1. Defining one as 0 builds a variant without that
+    sensor: every use of its driver is behind a test of the descriptor's
+    kEnabled, which the compiler folds away, so the driver code isn't
+    linked in and there's no run-time cost. The BME280 driver object,
+    which cMeasurementLoop owns, is left out with #if.
+
+*/
+
+#ifndef CATENA4610_SENSOR_BME280
+# define CATENA4610_SENSOR_BME280 1
+#endif
+
+#ifndef CATENA4610_SENSOR_SI1133
+# define CATENA4610_SENSOR_SI1133 1
+#endif
+
+#ifndef CATENA4610_SENSOR_COMPOST
+# define CATENA4610_SENSOR_COMPOST 1
+#endif
+
+namespace McciCatena4610 {
+namespace Sensors {
+
+// how a sensor is powered.
+enum class Rail : std::uint8_t
+    {
+    kAlwaysOn,      // powered whenever the board is
+    kVout2,         // V_OUT2, switched by D11; boosted by D14 if Vbat is low
+    };
+
+/****************************************************************************\
+|
+|   Sensor descriptors
+|
+\****************************************************************************/
+
+// Each descriptor gives:
+//  kEnabled        true if the sensor is built in
+//  kWarmupMs       time from power-on until the sensor can be used
+//  kRail           power rail
+//  kField          format 0x15 bitmap bit of the field it fills
+//  kUplinkBytes    size of that field
+// The BME280 and compost timeouts follow the conversion time of their
+// profile or resolution; the Si1133, whose time is fixed, also gives
+//  kLatencyMs      worst-case time for one measurement
+
+// BME280 temperature, pressure and humidity; forced mode.
+struct Bme280
+    {
+    static constexpr bool           kEnabled = CATENA4610_SENSOR_BME280;
+    static constexpr std::uint32_t  kWarmupMs = 2;
+    static constexpr Rail           kRail = Rail::kAlwaysOn;
+    static constexpr std::uint8_t   kField = 1 << 3;
+    static constexpr std::uint8_t   kUplinkBytes = 5;
+    };
+
+// Si1133 ambient light; one-time measurement.
+struct Si1133
+    {
+    static constexpr bool           kEnabled = CATENA4610_SENSOR_SI1133;
+    static constexpr std::uint32_t  kWarmupMs = 25;
+    static constexpr std::uint32_t  kLatencyMs = 1000;
+    static constexpr Rail           kRail = Rail::kAlwaysOn;
+    static constexpr std::uint8_t   kField = 1 << 4;
+    static constexpr std::uint8_t   kUplinkBytes = 2;
+    };
+
+// DS18B20 OneWire compost probes. The warmup is the rail settling time
+// without the boost regulator; kBoostWarmupMs applies when it's on.
+struct Compost
+    {
+    static constexpr bool           kEnabled = CATENA4610_SENSOR_COMPOST;
+    static constexpr std::uint32_t  kWarmupMs = 10;
+    static constexpr std::uint32_t  kBoostWarmupMs = 90;
+    static constexpr Rail           kRail = Rail::kVout2;
+    static constexpr std::uint8_t   kField = 1 << 5;
+    static constexpr std::uint8_t   kUplinkBytes = 2;
+    };
+
+/****************************************************************************\
+|
+|   The registry
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::Sensors::cRegistry<...>
+
+Function:
+    Summarize a list of sensor descriptors at compile time.
+
+Description:
+    Only enabled sensors count. Everything is constexpr, so the results
+    can size buffers, be checked by static_assert, and mask fields out
+    of the code that encodes them (see fillTxBuffer()).
+
+*/
+
+template <typename... TSensors>
+struct cRegistry;
+
+template <>
+struct cRegistry<>
+    {
+    static constexpr std::uint8_t getFieldMask() { return 0; }
+    static constexpr std::uint32_t getMaxWarmupMs(Rail, std::uint8_t = 0xFF) { return 0; }
+    static constexpr std::size_t getUplinkBytes() { return 0; }
+    };
+
+template <typename TFirst, typename... TRest>
+struct cRegistry<TFirst, TRest...>
+    {
+private:
+    using Rest = cRegistry<TRest...>;
+
+    static constexpr std::uint32_t max(std::uint32_t a, std::uint32_t b)
+        {
+        return a > b ? a : b;
+        }
+
+public:
+    // the bitmap bits that this build can send.
+    static constexpr std::uint8_t getFieldMask()
+        {
+        return (TFirst::kEnabled ? TFirst::kField : 0) | Rest::getFieldMask();
+        }
+
+    // the longest warmup of the sensors on a rail; only those whose
+    // field is in fieldMask, if given, so that sensors that are absent
+    // or turned off aren't waited for.
+    static constexpr std::uint32_t getMaxWarmupMs(Rail rail, std::uint8_t fieldMask = 0xFF)
+        {
+        return max(
+            (TFirst::kEnabled && TFirst::kRail == rail && (TFirst::kField & fieldMask) != 0)
+                ? TFirst::kWarmupMs : 0,
+            Rest::getMaxWarmupMs(rail, fieldMask)
+            );
+        }
+
+    // the uplink bytes of the fields filled by sensors.
+    static constexpr std::size_t getUplinkBytes()
+        {
+        return (TFirst::kEnabled ? TFirst::kUplinkBytes : 0) + Rest::getUplinkBytes();
+        }
+    };
+
+// the sensors of this application.
+using Registry = cRegistry<Bme280, Si1133, Compost>;
+
+} // namespace Sensors
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_SensorRegistry_h_ */
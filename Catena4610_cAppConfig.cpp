@@ -0,0 +1,101 @@
+/*
+
+Module: Catena4610_cAppConfig.cpp
+
+Function:
+    Application settings kept in FRAM.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cAppConfig.h"
+#include "Catena4610_hal.h"
+
+using namespace McciCatena4610;
+
+void
+cAppConfig::setDefaults(
+    void
+    )
+    {
+    this->m_Data = Data {};
+    this->m_Data.Version = kVersion;
+
+    // full resolution, as the probes come from the factory.
+    for (auto &bits : this->m_Data.CompostResolution)
+        bits = kResolutionMax;
+
+    this->m_Data.Bme280 = kBme280Auto;
+
+    // 10 uplinks 30 seconds apart, then every 8 hours; no batching.
+    this->m_Data.FastCount = 10;
+    this->m_Data.TxCycleSec = 8 * 60 * 60;
+    this->m_Data.BatchDepth = 0;
+    this->m_Data.BatchSampleSec = 15 * 60;
+    }
+
+/*
+
+Name:   McciCatena4610::cAppConfig::load()
+
+Function:
+    Read the settings from FRAM.
+
+Definition:
+    bool McciCatena4610::cAppConfig::load(
+            void
+            );
+
+Description:
+    The stored settings are used only if they have the current version
+    and every value is in range; otherwise the defaults are used, and
+    are written back on the next save().
+
+Returns:
+    true if the stored settings were used.
+
+*/
+
+bool
+cAppConfig::load(
+    void
+    )
+    {
+    Data data;
+
+    if (Hal::readAppConfig(reinterpret_cast<std::uint8_t *>(&data), sizeof(data)) &&
+        data.Version == kVersion)
+        {
+        bool fValid = true;
+
+        for (auto bits : data.CompostResolution)
+            fValid = fValid && isValidResolution(bits);
+        fValid = fValid && data.Bme280 < kBme280NumProfiles;
+        fValid = fValid && data.TxCycleSec != 0 && data.BatchSampleSec != 0;
+
+        if (fValid)
+            {
+            this->m_Data = data;
+            return true;
+            }
+        }
+
+    this->setDefaults();
+    return false;
+    }
+
+bool
+cAppConfig::save(
+    void
+    ) const
+    {
+    return Hal::writeAppConfig(
+                reinterpret_cast<const std::uint8_t *>(&this->m_Data),
+                sizeof(this->m_Data)
+                );
+    }
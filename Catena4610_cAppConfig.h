@@ -0,0 +1,154 @@
+/*
+
+Module: Catena4610_cAppConfig.h
+
+Function:
+    Application settings kept in FRAM.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_cAppConfig_h_
+# define _Catena4610_cAppConfig_h_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatena4610 {
+
+/*
+
+Name:   McciCatena4610::cAppConfig
+
+Function:
+    Load and save the application settings.
+
+Description:
+    The settings are a small POD structure, stored in the platform's
+    FRAM under the application configuration key (see
+    Hal::readAppConfig()), so they survive resets and power loss.
+
+    The structure starts with a version byte. If the stored version
+    doesn't match, or nothing is stored, the defaults are used; bump
+    kVersion whenever the layout of Data changes.
+
+*/
+
+class cAppConfig
+    {
+public:
+    static constexpr std::uint8_t kVersion = 3;
+
+    // must match cMeasurementFormat::kMaxCompostProbes.
+    static constexpr std::uint8_t kMaxCompostProbes = 4;
+
+    // OneWire probe resolution: 9..12 bits, or automatic.
+    static constexpr std::uint8_t kResolutionAuto = 0;
+    static constexpr std::uint8_t kResolutionMin = 9;
+    static constexpr std::uint8_t kResolutionMax = 12;
+
+    // BME280 oversampling and filter profile; automatic uses the low
+    // power profile on battery and high resolution on USB power.
+    enum Bme280Profile : std::uint8_t
+        {
+        kBme280Auto,
+        kBme280LowPower,
+        kBme280Standard,
+        kBme280HighRes,
+        kBme280NumProfiles
+        };
+
+    // bits of Data::Options; each turns something off, so zero is the
+    // default.
+    enum Option : std::uint8_t
+        {
+        kOptionLightOff         = 1 << 0,   // skip ambient light
+        kOptionEnvOff           = 1 << 1,   // skip temperature/pressure/humidity
+        kOptionPowerProfilesOff = 1 << 2,   // ignore the power level
+        kOptionLinkPolicyOff    = 1 << 3,   // don't confirm by link quality
+        };
+
+    struct Data
+        {
+        // kVersion
+        std::uint8_t        Version;
+        // resolution of each OneWire probe, by search order
+        std::uint8_t        CompostResolution[kMaxCompostProbes];
+        // BME280 profile (Bme280Profile)
+        std::uint8_t        Bme280;
+        // Option bits
+        std::uint8_t        Options;
+        // fast uplinks after boot
+        std::uint8_t        FastCount;
+        // batch depth; 0 or 1 for no batching
+        std::uint8_t        BatchDepth;
+        // uplink interval in seconds, after the fast uplinks
+        std::uint32_t       TxCycleSec;
+        // sampling interval in seconds when batching
+        std::uint32_t       BatchSampleSec;
+        };
+
+    cAppConfig()
+        {
+        this->setDefaults();
+        }
+
+    void setDefaults();
+
+    // read the settings from FRAM; returns false, and uses the
+    // defaults, if they're missing or from another version.
+    bool load();
+
+    // write the settings to FRAM.
+    bool save() const;
+
+    Data const &get() const
+        {
+        return this->m_Data;
+        }
+    Data &edit()
+        {
+        return this->m_Data;
+        }
+
+    bool isOption(Option option) const
+        {
+        return (this->m_Data.Options & option) != 0;
+        }
+    void setOption(Option option, bool fSet)
+        {
+        if (fSet)
+            this->m_Data.Options |= option;
+        else
+            this->m_Data.Options &= ~option;
+        }
+
+    static constexpr bool isValidResolution(std::uint8_t bits)
+        {
+        return bits == kResolutionAuto ||
+               (kResolutionMin <= bits && bits <= kResolutionMax);
+        }
+
+    static constexpr const char *getBme280ProfileName(std::uint8_t profile)
+        {
+        return  profile == kBme280Auto      ? "auto" :
+                profile == kBme280LowPower  ? "lowpower" :
+                profile == kBme280Standard  ? "standard" :
+                profile == kBme280HighRes   ? "hires" :
+                                              "<<unknown>>";
+        }
+
+private:
+    Data                m_Data;
+    };
+
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_cAppConfig_h_ */
@@ -0,0 +1,400 @@
+/*
+
+Module: Catena4610_cBme280.cpp
+
+Function:
+    Minimal non-blocking driver for the Bosch BME280.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cBme280.h"
+#include "Catena4610_hal.h"
+
+#include <cmath>
+
+using namespace McciCatena4610;
+
+/****************************************************************************\
+|
+|   Registers
+|
+\****************************************************************************/
+
+namespace {
+
+constexpr std::uint8_t kRegCalib00 = 0x88;     // T1..P9, 24 bytes
+constexpr std::uint8_t kRegCalibH1 = 0xA1;
+constexpr std::uint8_t kRegChipId = 0xD0;
+constexpr std::uint8_t kRegReset = 0xE0;
+constexpr std::uint8_t kRegCalib26 = 0xE1;     // H2..H6, 7 bytes
+constexpr std::uint8_t kRegCtrlHum = 0xF2;
+constexpr std::uint8_t kRegStatus = 0xF3;
+constexpr std::uint8_t kRegCtrlMeas = 0xF4;
+constexpr std::uint8_t kRegConfig = 0xF5;
+constexpr std::uint8_t kRegData = 0xF7;        // press, temp, hum; 8 bytes
+
+constexpr std::uint8_t kChipId = 0x60;
+constexpr std::uint8_t kResetCommand = 0xB6;
+
+constexpr std::uint8_t kStatusMeasuring = 1u << 3;
+constexpr std::uint8_t kStatusImUpdate = 1u << 0;
+constexpr std::uint8_t kModeMask = 0x03;
+constexpr std::uint8_t kModeForced = 0x01;
+
+// the value read back for a measurement that was skipped.
+constexpr std::int32_t kSkipped20 = 0x80000;
+constexpr std::int32_t kSkipped16 = 0x8000;
+
+inline std::uint16_t getU16Le(const std::uint8_t *p)
+    {
+    return std::uint16_t(p[0] | (p[1] << 8));
+    }
+
+inline std::int16_t getS16Le(const std::uint8_t *p)
+    {
+    return std::int16_t(getU16Le(p));
+    }
+
+unsigned getOversamplingCount(cBme280::Oversampling o)
+    {
+    auto const v = unsigned(o);
+
+    return v == 0 ? 0 : 1u << (v - 1);
+    }
+
+} // namespace
+
+/****************************************************************************\
+|
+|   Bus access
+|
+\****************************************************************************/
+
+bool
+cBme280::readRegisters(
+    std::uint8_t reg,
+    std::uint8_t *pBuf,
+    std::uint8_t nBuf
+    )
+    {
+    return Hal::i2cReadRegisters(this->m_Address, reg, pBuf, nBuf);
+    }
+
+bool
+cBme280::writeRegister(
+    std::uint8_t reg,
+    std::uint8_t value
+    )
+    {
+    return Hal::i2cWriteRegister(this->m_Address, reg, value);
+    }
+
+/****************************************************************************\
+|
+|   Setup
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cBme280::begin()
+
+Function:
+    Find the sensor, reset it, and read its calibration.
+
+Definition:
+    bool McciCatena4610::cBme280::begin(
+            std::uint8_t address
+            );
+
+Description:
+    After a soft reset the sensor is in sleep mode with all measurements
+    skipped, so configure() must be called before startForced(). This
+    waits a few milliseconds for the calibration to be copied out of the
+    sensor's NVM; it's only called at startup.
+
+Returns:
+    true if a BME280 answered at address.
+
+*/
+
+bool
+cBme280::begin(
+    std::uint8_t address
+    )
+    {
+    std::uint8_t id;
+
+    this->m_Address = address;
+    this->m_fPresent = false;
+
+    if (! this->readRegisters(kRegChipId, &id, 1) || id != kChipId)
+        return false;
+
+    if (! this->writeRegister(kRegReset, kResetCommand))
+        return false;
+
+    // the datasheet gives 2 ms for startup; allow a little more.
+    for (unsigned nTries = 0;; ++nTries)
+        {
+        std::uint8_t status;
+
+        Hal::delay(2);
+        if (this->readRegisters(kRegStatus, &status, 1) &&
+            (status & kStatusImUpdate) == 0)
+            break;
+        if (nTries >= 5)
+            return false;
+        }
+
+    if (! this->readCalibration())
+        return false;
+
+    this->m_fPresent = true;
+    return true;
+    }
+
+bool
+cBme280::readCalibration(
+    void
+    )
+    {
+    std::uint8_t b[24];
+    auto &c = this->m_Cal;
+
+    if (! this->readRegisters(kRegCalib00, b, 24))
+        return false;
+
+    c.T1 = getU16Le(b + 0);
+    c.T2 = getS16Le(b + 2);
+    c.T3 = getS16Le(b + 4);
+    c.P1 = getU16Le(b + 6);
+    c.P2 = getS16Le(b + 8);
+    c.P3 = getS16Le(b + 10);
+    c.P4 = getS16Le(b + 12);
+    c.P5 = getS16Le(b + 14);
+    c.P6 = getS16Le(b + 16);
+    c.P7 = getS16Le(b + 18);
+    c.P8 = getS16Le(b + 20);
+    c.P9 = getS16Le(b + 22);
+
+    if (! this->readRegisters(kRegCalibH1, &c.H1, 1))
+        return false;
+
+    if (! this->readRegisters(kRegCalib26, b, 7))
+        return false;
+
+    // H4 and H5 are 12-bit values that share register 0xE5.
+    c.H2 = getS16Le(b + 0);
+    c.H3 = b[2];
+    c.H4 = std::int16_t((std::int16_t(std::int8_t(b[3])) << 4) | (b[4] & 0x0F));
+    c.H5 = std::int16_t((std::int16_t(std::int8_t(b[5])) << 4) | (b[4] >> 4));
+    c.H6 = std::int8_t(b[6]);
+
+    return true;
+    }
+
+bool
+cBme280::configure(
+    Settings const &settings
+    )
+    {
+    if (! this->m_fPresent)
+        return false;
+
+    // ctrl_hum only takes effect after the next write to ctrl_meas,
+    // which startForced() does.
+    if (! this->writeRegister(kRegCtrlHum, std::uint8_t(settings.H)))
+        return false;
+    if (! this->writeRegister(kRegConfig, std::uint8_t(std::uint8_t(settings.filter) << 2)))
+        return false;
+
+    this->m_CtrlMeas = std::uint8_t(
+        (std::uint8_t(settings.T) << 5) | (std::uint8_t(settings.P) << 2)
+        );
+    return true;
+    }
+
+/****************************************************************************\
+|
+|   Measurement
+|
+\****************************************************************************/
+
+bool
+cBme280::startForced(
+    void
+    )
+    {
+    if (! this->m_fPresent)
+        return false;
+
+    return this->writeRegister(kRegCtrlMeas, this->m_CtrlMeas | kModeForced);
+    }
+
+// the sensor drops back to sleep mode when a forced conversion is done.
+bool
+cBme280::isBusy(
+    void
+    )
+    {
+    std::uint8_t b[2];
+
+    if (! this->readRegisters(kRegStatus, b, 2))
+        return false;
+
+    return (b[0] & kStatusMeasuring) != 0 || (b[1] & kModeMask) != 0;
+    }
+
+/*
+
+Name:   McciCatena4610::cBme280::read()
+
+Function:
+    Read and compensate the result of the last conversion.
+
+Definition:
+    bool McciCatena4610::cBme280::read(
+            Measurements &m
+            );
+
+Description:
+    The three results are read in one burst, so that they all come from
+    the same conversion. Pressure and humidity that were skipped by the
+    configured oversampling are returned as NAN.
+
+Returns:
+    false if the sensor didn't answer, or temperature was skipped.
+
+*/
+
+bool
+cBme280::read(
+    Measurements &m
+    )
+    {
+    std::uint8_t b[8];
+
+    m.Temperature = m.Pressure = m.Humidity = NAN;
+
+    if (! this->m_fPresent || ! this->readRegisters(kRegData, b, 8))
+        return false;
+
+    std::int32_t const adcP = (std::int32_t(b[0]) << 12) | (std::int32_t(b[1]) << 4) | (b[2] >> 4);
+    std::int32_t const adcT = (std::int32_t(b[3]) << 12) | (std::int32_t(b[4]) << 4) | (b[5] >> 4);
+    std::int32_t const adcH = (std::int32_t(b[6]) << 8) | b[7];
+    std::int32_t tFine;
+
+    if (adcT == kSkipped20)
+        return false;
+
+    m.Temperature = this->compensateT(adcT, tFine) / 100.0f;
+    if (adcP != kSkipped20)
+        m.Pressure = this->compensateP(adcP, tFine) / 256.0f;
+    if (adcH != kSkipped16)
+        m.Humidity = this->compensateH(adcH, tFine) / 1024.0f;
+
+    return true;
+    }
+
+std::uint32_t
+cBme280::getMaxConversionMs(
+    Settings const &settings
+    )
+    {
+    unsigned const nT = getOversamplingCount(settings.T);
+    unsigned const nP = getOversamplingCount(settings.P);
+    unsigned const nH = getOversamplingCount(settings.H);
+    std::uint32_t us = 1250 + 2300 * nT;
+
+    if (nP != 0)
+        us += 2300 * nP + 575;
+    if (nH != 0)
+        us += 2300 * nH + 575;
+
+    return (us + 999) / 1000;
+    }
+
+/****************************************************************************\
+|
+|   Compensation (BME280 datasheet, section 4.2.3)
+|
+\****************************************************************************/
+
+// returns degrees C * 100.
+std::int32_t
+cBme280::compensateT(
+    std::int32_t adcT,
+    std::int32_t &tFine
+    ) const
+    {
+    auto const &c = this->m_Cal;
+    std::int32_t const dT = (adcT >> 4) - std::int32_t(c.T1);
+    std::int32_t const var1 =
+        (((adcT >> 3) - (std::int32_t(c.T1) << 1)) * std::int32_t(c.T2)) >> 11;
+    std::int32_t const var2 =
+        (((dT * dT) >> 12) * std::int32_t(c.T3)) >> 14;
+
+    tFine = var1 + var2;
+    return (tFine * 5 + 128) >> 8;
+    }
+
+// returns Pa in Q24.8.
+std::uint32_t
+cBme280::compensateP(
+    std::int32_t adcP,
+    std::int32_t tFine
+    ) const
+    {
+    auto const &c = this->m_Cal;
+    std::int64_t var1 = std::int64_t(tFine) - 128000;
+    std::int64_t var2 = var1 * var1 * std::int64_t(c.P6);
+    std::int64_t p;
+
+    var2 = var2 + ((var1 * std::int64_t(c.P5)) << 17);
+    var2 = var2 + (std::int64_t(c.P4) << 35);
+    var1 = ((var1 * var1 * std::int64_t(c.P3)) >> 8) + ((var1 * std::int64_t(c.P2)) << 12);
+    var1 = ((std::int64_t(1) << 47) + var1) * std::int64_t(c.P1) >> 33;
+
+    // avoid dividing by zero if the calibration is bad
+    if (var1 == 0)
+        return 0;
+
+    p = 1048576 - adcP;
+    p = (((p << 31) - var2) * 3125) / var1;
+    var1 = (std::int64_t(c.P9) * (p >> 13) * (p >> 13)) >> 25;
+    var2 = (std::int64_t(c.P8) * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + (std::int64_t(c.P7) << 4);
+
+    return std::uint32_t(p);
+    }
+
+// returns percent RH in Q22.10.
+std::uint32_t
+cBme280::compensateH(
+    std::int32_t adcH,
+    std::int32_t tFine
+    ) const
+    {
+    auto const &c = this->m_Cal;
+    std::int32_t v = tFine - 76800;
+
+    v = (((((adcH << 14) - (std::int32_t(c.H4) << 20) - (std::int32_t(c.H5) * v)) +
+           16384) >> 15) *
+         (((((((v * std::int32_t(c.H6)) >> 10) *
+              (((v * std::int32_t(c.H3)) >> 11) + 32768)) >> 10) +
+            2097152) * std::int32_t(c.H2) + 8192) >> 14));
+    v = v - (((((v >> 15) * (v >> 15)) >> 7) * std::int32_t(c.H1)) >> 4);
+    if (v < 0)
+        v = 0;
+    if (v > 419430400)
+        v = 419430400;
+
+    return std::uint32_t(v >> 12);
+    }
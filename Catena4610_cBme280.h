@@ -0,0 +1,131 @@
+/*
+
+Module: Catena4610_cBme280.h
+
+Function:
+    Minimal non-blocking driver for the Bosch BME280.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_cBme280_h_
+# define _Catena4610_cBme280_h_
+
+#pragma once
+
+#include <cstdint>
+
+namespace McciCatena4610 {
+
+/*
+
+Name:   McciCatena4610::cBme280
+
+Function:
+    Forced-mode measurements from a BME280, without blocking.
+
+Description:
+    The sensor sleeps between measurements. startForced() starts one
+    conversion with the configured oversampling and filter, and returns
+    at once; isBusy() reports when it's done, and read() fetches and
+    compensates the result. getMaxConversionMs() gives the datasheet
+    maximum conversion time for a setting (BME280 datasheet, appendix
+    9), so callers can schedule the read and set a timeout.
+
+    The compensation is the fixed-point code from the datasheet
+    (section 4.2.3), using the calibration read by begin().
+
+*/
+
+class cBme280
+    {
+public:
+    static constexpr std::uint8_t kAddress = 0x77;
+
+    enum class Oversampling : std::uint8_t
+        {
+        kSkip, kX1, kX2, kX4, kX8, kX16
+        };
+
+    enum class Filter : std::uint8_t
+        {
+        kOff, kX2, kX4, kX8, kX16
+        };
+
+    struct Settings
+        {
+        Oversampling    T;
+        Oversampling    P;
+        Oversampling    H;
+        Filter          filter;
+        };
+
+    struct Measurements
+        {
+        float           Temperature;    // degrees C
+        float           Pressure;       // Pa
+        float           Humidity;       // percent RH
+        };
+
+    cBme280()
+        : m_Address(kAddress)
+        , m_CtrlMeas(0)
+        , m_fPresent(false)
+        {}
+
+    // check the chip ID, reset, and read the calibration. The sensor is
+    // left asleep.
+    bool begin(std::uint8_t address = kAddress);
+
+    // set the oversampling and filter; the sensor must be asleep.
+    bool configure(Settings const &settings);
+
+    // start one forced-mode conversion.
+    bool startForced();
+
+    // true while a conversion is running.
+    bool isBusy();
+
+    // read the last conversion. Values that were skipped are NAN.
+    bool read(Measurements &m);
+
+    // the longest a conversion can take, in milliseconds.
+    static std::uint32_t getMaxConversionMs(Settings const &settings);
+
+private:
+    struct Calibration
+        {
+        std::uint16_t   T1;
+        std::int16_t    T2, T3;
+        std::uint16_t   P1;
+        std::int16_t    P2, P3, P4, P5, P6, P7, P8, P9;
+        std::uint8_t    H1;
+        std::int16_t    H2;
+        std::uint8_t    H3;
+        std::int16_t    H4, H5;
+        std::int8_t     H6;
+        };
+
+    bool readRegisters(std::uint8_t reg, std::uint8_t *pBuf, std::uint8_t nBuf);
+    bool writeRegister(std::uint8_t reg, std::uint8_t value);
+    bool readCalibration();
+
+    std::int32_t compensateT(std::int32_t adcT, std::int32_t &tFine) const;
+    std::uint32_t compensateP(std::int32_t adcP, std::int32_t tFine) const;
+    std::uint32_t compensateH(std::int32_t adcH, std::int32_t tFine) const;
+
+    Calibration         m_Cal;
+    std::uint8_t        m_Address;
+    // ctrl_meas for a forced conversion, without the mode bits
+    std::uint8_t        m_CtrlMeas;
+    bool                m_fPresent;
+    };
+
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_cBme280_h_ */
@@ -0,0 +1,224 @@
+/*
+
+Module: Catena4610_cEventTrace.h
+
+Function:
+    Recording of measurement loop events for replay and comparison.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_cEventTrace_h_
+# define _Catena4610_cEventTrace_h_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+
+Name:   CATENA4610_EVENT_TRACE_EVENTS
+
+Function:
+    The number of events cEventTrace keeps.
+
+Description:
+    Defaults to 64, which is about three fast uplink cycles. The host
+    build sets it larger, so a simulation can keep a whole run.
+
+*/
+
+#ifndef CATENA4610_EVENT_TRACE_EVENTS
+# define CATENA4610_EVENT_TRACE_EVENTS 64
+#endif
+
+namespace McciCatena4610 {
+
+/*
+
+Name:   McciCatena4610::cEventTrace
+
+Function:
+    Keep the most recent measurement loop events in RAM.
+
+Description:
+    The measurement loop records each state it enters; the outcome and
+    latency of each sensor task; the values it reads (supply voltages,
+    boot count, T/P/RH, light and each compost probe); each uplink it
+    starts (port, length, confirmed, and a hash of the bytes) and each
+    uplink completion; each change of power source or level; and each
+    change of IsProvisioned(). Only the last kMaxEvents are kept.
+
+    The "trace" command prints the events, one per line, in the form
+    that host/traceReplay reads (see formatTraceEvent()). Given a trace
+    that starts at boot, traceReplay runs the loop in the host
+    simulation build: the values, Si1133 latencies, radio completions,
+    power changes and provisioning changes are fed to the simulator
+    when the device saw them, and the states, sensor results, uplink
+    hashes and completions the loop records in the simulation are
+    checked against the trace, event by event.
+
+*/
+
+class cEventTrace
+    {
+public:
+    static constexpr std::uint16_t kMaxEvents = CATENA4610_EVENT_TRACE_EVENTS;
+
+    enum class Type : std::uint8_t
+        {
+        kState,         // a: state
+        kSensor,        // a: task, b: 1 if it succeeded, c: latency in ms
+        kTxStart,       // a: port, b: length, bit 15 if confirmed, c: hash
+        kTxDone,        // a: 1 if it succeeded
+        kPower,         // a: power level, b: Vbat in mV, c: 1 if on USB
+        kValue,         // a: Value, b: probe index, c: the float's bits
+        kProvisioned,   // a: 1 if provisioned
+        };
+
+    // the values recorded by kValue events.
+    enum class Value : std::uint8_t
+        {
+        kVbat,
+        kVbus,
+        kBootCount,
+        kTemperature,   // BME280, deg C
+        kPressure,      // BME280, Pa
+        kHumidity,      // BME280, %RH
+        kLux,           // Si1133
+        kCompostTemp,   // OneWire probe b, deg C
+        kNumValues
+        };
+
+    static constexpr const char *getValueName(std::uint8_t i)
+        {
+        return  i == std::uint8_t(Value::kVbat)         ? "vbat" :
+                i == std::uint8_t(Value::kVbus)         ? "vbus" :
+                i == std::uint8_t(Value::kBootCount)    ? "boot" :
+                i == std::uint8_t(Value::kTemperature)  ? "t" :
+                i == std::uint8_t(Value::kPressure)     ? "p" :
+                i == std::uint8_t(Value::kHumidity)     ? "rh" :
+                i == std::uint8_t(Value::kLux)          ? "lux" :
+                i == std::uint8_t(Value::kCompostTemp)  ? "compost" :
+                                                          "<<unknown>>";
+        }
+
+    struct Event
+        {
+        std::uint32_t   t;      // Hal::millis()
+        Type            type;
+        std::uint8_t    a;
+        std::uint16_t   b;
+        std::uint32_t   c;
+        };
+
+    cEventTrace()
+        : m_iNext(0)
+        , m_n(0)
+        , m_nLost(0)
+        , m_fEnabled(true)
+        {}
+
+    void setEnabled(bool fEnable)
+        {
+        this->m_fEnabled = fEnable;
+        }
+    bool isEnabled() const
+        {
+        return this->m_fEnabled;
+        }
+
+    void clear()
+        {
+        this->m_iNext = 0;
+        this->m_n = 0;
+        this->m_nLost = 0;
+        }
+
+    void record(
+        std::uint32_t t,
+        Type type,
+        std::uint8_t a,
+        std::uint16_t b = 0,
+        std::uint32_t c = 0
+        )
+        {
+        if (! this->m_fEnabled)
+            return;
+
+        this->m_Events[this->m_iNext] = Event { t, type, a, b, c };
+        this->m_iNext = (this->m_iNext + 1) % kMaxEvents;
+        if (this->m_n < kMaxEvents)
+            ++this->m_n;
+        else
+            ++this->m_nLost;
+        }
+
+    // record a value exactly, so a replay can feed back the same bits.
+    void recordValue(
+        std::uint32_t t,
+        Value value,
+        float v,
+        std::uint16_t index = 0
+        )
+        {
+        std::uint32_t bits;
+
+        static_assert(sizeof(bits) == sizeof(v), "float must be 32 bits");
+        std::memcpy(&bits, &v, sizeof(bits));
+        this->record(t, Type::kValue, std::uint8_t(value), index, bits);
+        }
+
+    // the value of a kValue event.
+    static float getValue(Event const &e)
+        {
+        float v;
+
+        std::memcpy(&v, &e.c, sizeof(v));
+        return v;
+        }
+
+    // number of events held, and the i'th oldest.
+    std::uint16_t getn() const
+        {
+        return this->m_n;
+        }
+    Event const &get(std::uint16_t i) const
+        {
+        return this->m_Events[(this->m_iNext + kMaxEvents - this->m_n + i) % kMaxEvents];
+        }
+    // events overwritten since the last clear().
+    std::uint32_t getnLost() const
+        {
+        return this->m_nLost;
+        }
+
+    // 32-bit FNV-1a hash, used to compare frames without keeping them.
+    static std::uint32_t hash(std::uint8_t const *pData, std::size_t nData)
+        {
+        std::uint32_t h = 2166136261u;
+
+        for (std::size_t i = 0; i < nData; ++i)
+            h = (h ^ pData[i]) * 16777619u;
+
+        return h;
+        }
+
+private:
+    Event               m_Events[kMaxEvents];
+    std::uint16_t       m_iNext;
+    std::uint16_t       m_n;
+    std::uint32_t       m_nLost;
+    bool                m_fEnabled;
+    };
+
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_cEventTrace_h_ */
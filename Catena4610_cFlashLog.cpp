@@ -0,0 +1,445 @@
+/*
+
+Module: Catena4610_cFlashLog.cpp
+
+Function:
+    cFlashLog: append-only measurement log in SPI flash.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cFlashLog.h"
+
+#include <cstring>
+
+using namespace McciCatena4610;
+using namespace McciCatena;
+
+/****************************************************************************\
+|
+|   Helpers
+|
+\****************************************************************************/
+
+// CRC-16/CCITT, bitwise; records are small and written rarely.
+std::uint16_t
+cFlashLog::crc16(
+    std::uint16_t crc,
+    const void *pData,
+    std::size_t nData
+    )
+    {
+    auto p = static_cast<const std::uint8_t *>(pData);
+
+    for (; nData > 0; --nData)
+        {
+        crc ^= std::uint16_t(*p++) << 8;
+        for (unsigned i = 0; i < 8; ++i)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+
+    return crc;
+    }
+
+bool
+cFlashLog::readHeader(
+    std::uint32_t slot,
+    cFlashLog::SlotHeader &h
+    )
+    {
+    return this->m_pFlash->read(
+                slotAddress(slot),
+                reinterpret_cast<std::uint8_t *>(&h),
+                sizeof(h)
+                );
+    }
+
+// return true if the slot holds a committed record with a good CRC.
+bool
+cFlashLog::isValid(
+    std::uint32_t slot,
+    cFlashLog::SlotHeader const &h
+    )
+    {
+    std::uint8_t payload[kMaxPayload];
+
+    if (h.Commit != 0 || h.Length > kMaxPayload)
+        return false;
+
+    if (! this->m_pFlash->read(slotAddress(slot) + sizeof(h), payload, h.Length))
+        return false;
+
+    std::uint16_t crc = 0xFFFF;
+    crc = crc16(crc, &h.Seq, sizeof(h.Seq));
+    crc = crc16(crc, &h.Length, sizeof(h.Length));
+    crc = crc16(crc, payload, h.Length);
+
+    return crc == h.Crc;
+    }
+
+// return true if the slot holds a record in our layout waiting to be sent.
+bool
+cFlashLog::isUnsent(
+    std::uint32_t slot,
+    cFlashLog::SlotHeader const &h
+    )
+    {
+    return h.Seq != UINT32_MAX &&
+           h.Sent != 0 &&
+           h.Layout == this->m_Layout &&
+           this->isValid(slot, h);
+    }
+
+/****************************************************************************\
+|
+|   Setup
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cFlashLog::begin()
+
+Function:
+    Attach the log to the flash, and recover its state.
+
+Definition:
+    bool McciCatena4610::cFlashLog::begin(
+            McciCatena::Catena_Mx25v8035f *pFlash,
+            std::uint8_t layout
+            );
+
+Description:
+    All slot headers are read. The record with the highest sequence
+    number marks the end of the log; the next blank slot after it becomes
+    the write position. The oldest committed record with the given
+    layout tag that hasn't been sent is remembered for backfill. The
+    flash is left powered down.
+
+Returns:
+    true if the log is usable.
+
+*/
+
+bool
+cFlashLog::begin(
+    McciCatena::Catena_Mx25v8035f *pFlash,
+    std::uint8_t layout
+    )
+    {
+    if (pFlash == nullptr)
+        return false;
+
+    this->m_pFlash = pFlash;
+    this->m_Layout = layout;
+    this->m_pFlash->powerUp();
+
+    std::uint32_t lastSlot = kNoSlot;
+    std::uint32_t lastSeq = 0;
+    std::uint32_t oldestUnsentSeq = UINT32_MAX;
+
+    this->m_OldestUnsent = kNoSlot;
+
+    for (std::uint32_t slot = 0; slot < kNumSlots; ++slot)
+        {
+        SlotHeader h;
+
+        if (! this->readHeader(slot, h))
+            {
+            this->m_pFlash->powerDown();
+            this->m_pFlash = nullptr;
+            return false;
+            }
+
+        if (h.Seq == UINT32_MAX || ! this->isValid(slot, h))
+            continue;
+
+        if (lastSlot == kNoSlot || h.Seq > lastSeq)
+            {
+            lastSlot = slot;
+            lastSeq = h.Seq;
+            }
+
+        if (h.Sent != 0 && h.Layout == layout && h.Seq < oldestUnsentSeq)
+            {
+            oldestUnsentSeq = h.Seq;
+            this->m_OldestUnsent = slot;
+            }
+        }
+
+    if (lastSlot == kNoSlot)
+        {
+        this->m_Head = 0;
+        this->m_NextSeq = 0;
+        }
+    else
+        {
+        // append() skips any torn slots after this one.
+        this->m_Head = nextSlot(lastSlot);
+        this->m_NextSeq = lastSeq + 1;
+        }
+
+    this->m_pFlash->powerDown();
+    return true;
+    }
+
+void
+cFlashLog::end()
+    {
+    this->m_pFlash = nullptr;
+    }
+
+/****************************************************************************\
+|
+|   Writing
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cFlashLog::append()
+
+Function:
+    Append a record to the log.
+
+Definition:
+    bool McciCatena4610::cFlashLog::append(
+            const void *pData,
+            std::size_t nData,
+            std::uint32_t &slot,
+            std::uint32_t &seq
+            );
+
+Description:
+    If the write position is at the start of a sector, the sector is
+    erased first, discarding the oldest records. Otherwise, slots that
+    aren't blank (left by a power failure) are skipped. The record is
+    then programmed, and committed with a second program of its Commit
+    byte.
+
+Returns:
+    true if the record was written; slot and seq identify it.
+
+*/
+
+bool
+cFlashLog::append(
+    const void *pData,
+    std::size_t nData,
+    std::uint32_t &slot,
+    std::uint32_t &seq
+    )
+    {
+    if (this->m_pFlash == nullptr || nData > kMaxPayload)
+        return false;
+
+    this->m_pFlash->powerUp();
+
+    // find a blank slot.
+    for (std::uint32_t nTries = 0; ; ++nTries)
+        {
+        SlotHeader h;
+        std::uint32_t const head = this->m_Head;
+
+        if (nTries > kSlotsPerSector)
+            {
+            this->m_pFlash->powerDown();
+            return false;
+            }
+
+        if (head % kSlotsPerSector == 0)
+            {
+            std::uint32_t const sectorFirst = head;
+            std::uint32_t const sectorEnd = head + kSlotsPerSector;
+
+            if (! this->m_pFlash->eraseSector(slotAddress(head)))
+                {
+                this->m_pFlash->powerDown();
+                return false;
+                }
+
+            // if we just erased the oldest unsent record, move on.
+            if (this->m_OldestUnsent != kNoSlot &&
+                sectorFirst <= this->m_OldestUnsent &&
+                this->m_OldestUnsent < sectorEnd)
+                {
+                this->findUnsentFrom(sectorEnd % kNumSlots);
+                }
+            break;
+            }
+
+        if (! this->readHeader(head, h))
+            {
+            this->m_pFlash->powerDown();
+            return false;
+            }
+
+        if (h.Seq == UINT32_MAX && h.Commit == 0xFF)
+            break;
+
+        this->m_Head = nextSlot(head);
+        }
+
+    // build the slot image.
+    std::uint8_t buffer[kSlotSize];
+    SlotHeader h;
+
+    std::memset(&h, 0xFF, sizeof(h));
+    h.Seq = this->m_NextSeq;
+    h.Length = std::uint16_t(nData);
+    h.Layout = this->m_Layout;
+
+    std::uint16_t crc = 0xFFFF;
+    crc = crc16(crc, &h.Seq, sizeof(h.Seq));
+    crc = crc16(crc, &h.Length, sizeof(h.Length));
+    crc = crc16(crc, pData, nData);
+    h.Crc = crc;
+
+    std::memcpy(buffer, &h, sizeof(h));
+    std::memcpy(buffer + sizeof(h), pData, nData);
+
+    std::uint32_t const thisSlot = this->m_Head;
+    std::uint32_t const addr = slotAddress(thisSlot);
+    bool fResult;
+
+    // the slot is consumed even if programming fails.
+    this->m_Head = nextSlot(thisSlot);
+    ++this->m_NextSeq;
+
+    fResult = this->m_pFlash->program(addr, buffer, sizeof(h) + nData);
+    if (fResult)
+        {
+        std::uint8_t const commit = 0;
+
+        fResult = this->m_pFlash->program(
+                    addr + offsetof(SlotHeader, Commit),
+                    &commit,
+                    sizeof(commit)
+                    );
+        }
+
+    this->m_pFlash->powerDown();
+
+    if (! fResult)
+        return false;
+
+    if (this->m_OldestUnsent == kNoSlot)
+        this->m_OldestUnsent = thisSlot;
+
+    slot = thisSlot;
+    seq = h.Seq;
+    return true;
+    }
+
+/*
+
+Name:   McciCatena4610::cFlashLog::markSent()
+
+Function:
+    Record that a log entry has been uplinked.
+
+Definition:
+    bool McciCatena4610::cFlashLog::markSent(
+            std::uint32_t slot
+            );
+
+Description:
+    The Sent byte of the slot is programmed to zero. If this was the
+    oldest unsent record, the log is searched forward for the next one.
+
+Returns:
+    true if the flash was updated.
+
+*/
+
+bool
+cFlashLog::markSent(
+    std::uint32_t slot
+    )
+    {
+    if (this->m_pFlash == nullptr || slot >= kNumSlots)
+        return false;
+
+    std::uint8_t const sent = 0;
+
+    this->m_pFlash->powerUp();
+    bool const fResult = this->m_pFlash->program(
+                            slotAddress(slot) + offsetof(SlotHeader, Sent),
+                            &sent,
+                            sizeof(sent)
+                            );
+
+    if (slot == this->m_OldestUnsent)
+        this->findUnsentFrom(nextSlot(slot));
+
+    this->m_pFlash->powerDown();
+    return fResult;
+    }
+
+/****************************************************************************\
+|
+|   Reading
+|
+\****************************************************************************/
+
+bool
+cFlashLog::getOldestUnsent(
+    std::uint32_t &slot,
+    std::uint32_t &seq,
+    void *pData,
+    std::size_t nData
+    )
+    {
+    if (this->m_pFlash == nullptr || this->m_OldestUnsent == kNoSlot)
+        return false;
+
+    SlotHeader h;
+    std::uint32_t const thisSlot = this->m_OldestUnsent;
+    bool fResult;
+
+    this->m_pFlash->powerUp();
+    fResult = this->readHeader(thisSlot, h) && h.Length <= nData;
+    if (fResult)
+        fResult = this->m_pFlash->read(
+                    slotAddress(thisSlot) + sizeof(h),
+                    static_cast<std::uint8_t *>(pData),
+                    h.Length
+                    );
+    this->m_pFlash->powerDown();
+
+    if (! fResult)
+        return false;
+
+    slot = thisSlot;
+    seq = h.Seq;
+    return true;
+    }
+
+// scan forward from slot to the write position for an unsent record.
+// the flash must be powered up.
+void
+cFlashLog::findUnsentFrom(
+    std::uint32_t slot
+    )
+    {
+    this->m_OldestUnsent = kNoSlot;
+
+    for (; slot != this->m_Head; slot = nextSlot(slot))
+        {
+        SlotHeader h;
+
+        if (! this->readHeader(slot, h))
+            return;
+
+        if (this->isUnsent(slot, h))
+            {
+            this->m_OldestUnsent = slot;
+            return;
+            }
+        }
+    }
@@ -0,0 +1,193 @@
+/*
+
+Module: Catena4610_cFlashLog.h
+
+Function:
+    cFlashLog: append-only measurement log in SPI flash.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_cFlashLog_h_
+# define _Catena4610_cFlashLog_h_
+
+#pragma once
+
+#include <Catena_Mx25v8035f.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatena4610 {
+
+/****************************************************************************\
+|
+|   The flash log
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cFlashLog
+
+Function:
+    A power-fail-safe ring of fixed-size records in the MX25V8035F.
+
+Description:
+    The log occupies the upper half of the flash, which is otherwise
+    unused by this application. It is divided into 128-byte slots, so
+    that a slot never crosses a 256-byte program page and can be written
+    with a single program operation.
+
+    Records are written in ascending slot order, wrapping around at the
+    end of the region. A sector is erased just before the first slot in
+    it is written, so each sector is erased once per trip around the
+    ring; this spreads the wear evenly across the whole region.
+
+    Flash bits can only be programmed from 1 to 0 without an erase. Each
+    slot header has two status bytes that start as 0xFF:
+
+    - Commit is programmed to 0 after the header and payload have been
+      written. A slot whose Commit byte is still 0xFF was torn by a
+      power failure and is ignored.
+
+    - Sent is programmed to 0 once the record has been uplinked.
+
+    A CRC over the header and payload catches partly-erased sectors.
+
+    Each slot header also carries a layout tag, given to begin() by the
+    client and bumped whenever the record format changes. Records with
+    a different tag, including those written before tags were added
+    (0xFF), still count for sequence numbering but are never returned
+    for backfill; they are discarded as the ring wraps.
+
+    begin() scans the slot headers to find where to append next, the
+    next sequence number and the oldest record not yet sent.
+
+*/
+
+class cFlashLog
+    {
+public:
+    // the log region in flash
+    static constexpr std::uint32_t kBase = 0x80000;
+    static constexpr std::uint32_t kSize = 0x80000;
+    static constexpr std::uint32_t kSectorSize = 4 * 1024;
+    static constexpr std::uint32_t kSlotSize = 128;
+    static constexpr std::uint32_t kSlotsPerSector = kSectorSize / kSlotSize;
+    static constexpr std::uint32_t kNumSlots = kSize / kSlotSize;
+
+    // returned when there is no slot.
+    static constexpr std::uint32_t kNoSlot = UINT32_MAX;
+
+    // the header at the front of each slot
+    struct SlotHeader
+        {
+        std::uint32_t           Seq;        // record sequence number
+        std::uint16_t           Length;     // payload length
+        std::uint16_t           Crc;        // CRC-16 over Seq, Length, payload
+        std::uint8_t            Commit;     // 0 once written
+        std::uint8_t            Sent;       // 0 once uplinked
+        std::uint8_t            Layout;     // record layout tag
+        std::uint8_t            Reserved;
+        };
+
+    // the layout tag of slots written before tags were added.
+    static constexpr std::uint8_t kLayoutUnknown = 0xFF;
+
+    static constexpr std::size_t kMaxPayload = kSlotSize - sizeof(SlotHeader);
+
+    cFlashLog()
+        : m_pFlash(nullptr)
+        , m_Head(0)
+        , m_NextSeq(0)
+        , m_OldestUnsent(kNoSlot)
+        , m_Layout(kLayoutUnknown)
+        {}
+
+    // neither copyable nor movable
+    cFlashLog(const cFlashLog&) = delete;
+    cFlashLog& operator=(const cFlashLog&) = delete;
+    cFlashLog(const cFlashLog&&) = delete;
+    cFlashLog& operator=(const cFlashLog&&) = delete;
+
+    // attach to the flash and recover the log state. Only records
+    // with the given layout tag are written and read back.
+    bool begin(McciCatena::Catena_Mx25v8035f *pFlash, std::uint8_t layout);
+    void end();
+
+    bool isActive() const
+        {
+        return this->m_pFlash != nullptr;
+        }
+
+    // append a record; returns the slot and sequence number used.
+    bool append(
+        const void *pData,
+        std::size_t nData,
+        std::uint32_t &slot,
+        std::uint32_t &seq
+        );
+
+    // true if there's at least one committed record not yet sent.
+    bool hasUnsent() const
+        {
+        return this->m_OldestUnsent != kNoSlot;
+        }
+
+    // get the oldest record not yet sent.
+    bool getOldestUnsent(
+        std::uint32_t &slot,
+        std::uint32_t &seq,
+        void *pData,
+        std::size_t nData
+        );
+
+    // mark a record as uplinked.
+    bool markSent(std::uint32_t slot);
+
+    std::uint32_t getNextSeq() const
+        {
+        return this->m_NextSeq;
+        }
+
+private:
+    static std::uint32_t slotAddress(std::uint32_t slot)
+        {
+        return kBase + slot * kSlotSize;
+        }
+    static std::uint32_t nextSlot(std::uint32_t slot)
+        {
+        return (slot + 1) % kNumSlots;
+        }
+    static std::uint16_t crc16(
+        std::uint16_t crc,
+        const void *pData,
+        std::size_t nData
+        );
+
+    bool readHeader(std::uint32_t slot, SlotHeader &h);
+    bool isValid(std::uint32_t slot, SlotHeader const &h);
+    bool isUnsent(std::uint32_t slot, SlotHeader const &h);
+    void findUnsentFrom(std::uint32_t slot);
+
+    McciCatena::Catena_Mx25v8035f   *m_pFlash;
+
+    // next slot to write
+    std::uint32_t                   m_Head;
+    // next sequence number
+    std::uint32_t                   m_NextSeq;
+    // oldest unsent slot, or kNoSlot
+    std::uint32_t                   m_OldestUnsent;
+    // layout tag of the records we write and read
+    std::uint8_t                    m_Layout;
+    };
+
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_cFlashLog_h_ */
@@ -0,0 +1,146 @@
+/*
+
+Module: Catena4610_cLinkPolicy.cpp
+
+Function:
+    Link quality tracking and confirmed-uplink policy.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cLinkPolicy.h"
+
+using namespace McciCatena4610;
+
+cLinkPolicy::Quality
+cLinkPolicy::getQuality(
+    void
+    ) const
+    {
+    if (this->m_nHistory == 0)
+        return Quality::kUnknown;
+    else if (this->m_nMissed >= this->m_Config.maxMissed)
+        return Quality::kLost;
+    else if (this->m_nMissed != 0 ||
+             (this->m_fHaveSignal &&
+              (this->m_RssiAvg < this->m_Config.rssiMarginal ||
+               this->m_SnrAvg < this->m_Config.snrMarginal)))
+        return Quality::kMarginal;
+    else
+        return Quality::kGood;
+    }
+
+bool
+cLinkPolicy::shouldConfirm(
+    void
+    ) const
+    {
+    auto const quality = this->getQuality();
+    std::uint8_t every = this->m_Config.confirmEvery;
+
+    if (quality == Quality::kUnknown)
+        return true;
+    if (quality == Quality::kMarginal)
+        every = (every + 1) / 2;
+
+    return this->m_nSinceConfirmed + 1u >= every;
+    }
+
+/*
+
+Name:   McciCatena4610::cLinkPolicy::recordUplink()
+
+Function:
+    Add the outcome of an uplink to the history.
+
+Definition:
+    bool McciCatena4610::cLinkPolicy::recordUplink(
+            bool fConfirmed,
+            bool fSuccess
+            );
+
+Description:
+    Unconfirmed uplinks only count towards the next confirmed one; their
+    success says nothing about the link. Confirmed uplinks go into the
+    ACK history.
+
+Returns:
+    true if Config::maxMissed more ACKs in a row have been missed, and
+    the caller should try a slower data rate.
+
+*/
+
+bool
+cLinkPolicy::recordUplink(
+    bool fConfirmed,
+    bool fSuccess
+    )
+    {
+    if (! fConfirmed)
+        {
+        if (this->m_nSinceConfirmed < UINT8_MAX)
+            ++this->m_nSinceConfirmed;
+        return false;
+        }
+
+    this->m_nSinceConfirmed = 0;
+    this->m_AckHistory = std::uint16_t((this->m_AckHistory << 1) | (fSuccess ? 1 : 0));
+    if (this->m_nHistory < kHistorySize)
+        ++this->m_nHistory;
+
+    if (fSuccess)
+        {
+        this->m_nMissed = 0;
+        this->m_nMissedSinceStep = 0;
+        return false;
+        }
+
+    if (this->m_nMissed < UINT8_MAX)
+        ++this->m_nMissed;
+
+    if (++this->m_nMissedSinceStep < this->m_Config.maxMissed)
+        return false;
+
+    this->m_nMissedSinceStep = 0;
+    return true;
+    }
+
+// average over roughly the last four downlinks.
+void
+cLinkPolicy::recordDownlink(
+    std::int16_t rssi,
+    float snr
+    )
+    {
+    if (! this->m_fHaveSignal)
+        {
+        this->m_RssiAvg = rssi;
+        this->m_SnrAvg = snr;
+        this->m_fHaveSignal = true;
+        }
+    else
+        {
+        this->m_RssiAvg += (rssi - this->m_RssiAvg) / 4;
+        this->m_SnrAvg += (snr - this->m_SnrAvg) / 4;
+        }
+    }
+
+std::uint8_t
+cLinkPolicy::getnAcked(
+    void
+    ) const
+    {
+    std::uint8_t n = 0;
+
+    for (std::uint8_t i = 0; i < this->m_nHistory; ++i)
+        {
+        if (this->m_AckHistory & (1u << i))
+            ++n;
+        }
+    return n;
+    }
@@ -0,0 +1,176 @@
+/*
+
+Module: Catena4610_cLinkPolicy.h
+
+Function:
+    Link quality tracking and confirmed-uplink policy.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_cLinkPolicy_h_
+# define _Catena4610_cLinkPolicy_h_
+
+#pragma once
+
+#include <cstdint>
+
+namespace McciCatena4610 {
+
+/*
+
+Name:   McciCatena4610::cLinkPolicy
+
+Function:
+    Decide which uplinks to confirm, from what's known about the link.
+
+Description:
+    Confirmed uplinks are the only way the device learns that the
+    network can hear it, but each one costs a downlink from the gateway
+    and, if the ACK is missed, retransmissions. The policy confirms one
+    uplink in Config::confirmEvery, and keeps a history of the results
+    and of the signal of every downlink heard.
+
+    The link is rated:
+
+    - kUnknown until the first confirmed uplink completes; the next
+      uplink is confirmed.
+    - kLost after Config::maxMissed confirmed uplinks in a row weren't
+      acknowledged.
+    - kMarginal if the last ACK was missed, or the average downlink
+      RSSI or SNR is below its threshold. Uplinks are confirmed twice
+      as often.
+    - kGood otherwise.
+
+    recordUplink() asks for a slower data rate each time another
+    Config::maxMissed ACKs in a row are missed; this is the device side
+    of LoRaWAN ADR backoff, and the network's ADR raises the rate again
+    once it hears the device.
+
+*/
+
+class cLinkPolicy
+    {
+public:
+    struct Config
+        {
+        std::uint8_t    confirmEvery;   // confirm one uplink in this many
+        std::uint8_t    maxMissed;      // missed ACKs in a row for kLost
+        std::int16_t    rssiMarginal;   // dBm
+        std::int8_t     snrMarginal;    // dB
+        };
+
+    enum class Quality : std::uint8_t
+        {
+        kUnknown,
+        kGood,
+        kMarginal,
+        kLost,
+        };
+
+    static constexpr const char *getQualityName(Quality q)
+        {
+        return  q == Quality::kUnknown  ? "unknown" :
+                q == Quality::kGood     ? "good" :
+                q == Quality::kMarginal ? "marginal" :
+                q == Quality::kLost     ? "lost" :
+                                          "<<unknown>>";
+        }
+
+    // number of confirmed uplinks remembered in the ACK history
+    static constexpr std::uint8_t kHistorySize = 16;
+
+    cLinkPolicy()
+        : m_Config { 8, 3, -118, -12 }
+        {
+        this->reset();
+        }
+
+    Config const &getConfig() const
+        {
+        return this->m_Config;
+        }
+    void setConfig(Config const &config)
+        {
+        this->m_Config = config;
+        if (this->m_Config.confirmEvery == 0)
+            this->m_Config.confirmEvery = 1;
+        if (this->m_Config.maxMissed == 0)
+            this->m_Config.maxMissed = 1;
+        }
+
+    // forget the history.
+    void reset()
+        {
+        this->m_AckHistory = 0;
+        this->m_nHistory = 0;
+        this->m_nMissed = 0;
+        this->m_nMissedSinceStep = 0;
+        this->m_nSinceConfirmed = 0;
+        this->m_RssiAvg = 0;
+        this->m_SnrAvg = 0;
+        this->m_fHaveSignal = false;
+        }
+
+    // true if the next uplink should be confirmed.
+    bool shouldConfirm() const;
+
+    // record the outcome of an uplink. For a confirmed uplink, fSuccess
+    // means it was acknowledged. Returns true if the data rate should
+    // be lowered.
+    bool recordUplink(bool fConfirmed, bool fSuccess);
+
+    // record the signal of a downlink; SNR is in dB.
+    void recordDownlink(std::int16_t rssi, float snr);
+
+    Quality getQuality() const;
+
+    // the confirmed uplinks in the history, and how many were
+    // acknowledged.
+    std::uint8_t getnHistory() const
+        {
+        return this->m_nHistory;
+        }
+    std::uint8_t getnAcked() const;
+
+    // smoothed downlink signal; only valid if hasSignal().
+    bool hasSignal() const
+        {
+        return this->m_fHaveSignal;
+        }
+    float getRssi() const
+        {
+        return this->m_RssiAvg;
+        }
+    float getSnr() const
+        {
+        return this->m_SnrAvg;
+        }
+
+private:
+    Config              m_Config;
+
+    // one bit per confirmed uplink, newest in bit 0; set if acked.
+    std::uint16_t       m_AckHistory;
+    std::uint8_t        m_nHistory;
+    // confirmed uplinks missed in a row, and since the data rate was
+    // last lowered
+    std::uint8_t        m_nMissed;
+    std::uint8_t        m_nMissedSinceStep;
+    // unconfirmed uplinks since the last confirmed one
+    std::uint8_t        m_nSinceConfirmed;
+
+    // exponential averages of the downlink signal
+    float               m_RssiAvg;
+    float               m_SnrAvg;
+    bool                m_fHaveSignal;
+    };
+
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_cLinkPolicy_h_ */
@@ -14,20 +14,13 @@ Author:
 */
 
 #include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_hal.h"
 
-#include <arduino_lmic.h>
-#include <ThermoSense-Lorawan.h>
-#include <OneWire.h>
-#include <DallasTemperature.h>
-#include <Catena_Si1133.h>
+#include <cstring>
 
 using namespace McciCatena4610;
 using namespace McciCatena;
 
-extern OneWire oneWire;
-extern DallasTemperature sensor_CompostTemp;
-extern cMeasurementLoop gMeasurementLoop;
-
 /****************************************************************************\
 |
 |   An object to represent the uplink activity
@@ -36,57 +29,74 @@ extern cMeasurementLoop gMeasurementLoop;
 
 void cMeasurementLoop::begin()
     {
+    // where a replay of the event trace starts.
+    this->m_fProvisioned = Hal::isProvisioned();
+    this->m_EventTrace.record(
+        Hal::millis(), cEventTrace::Type::kProvisioned, this->m_fProvisioned
+        );
+
     // register for polling.
     if (! this->m_registered)
         {
         this->m_registered = true;
 
-        gCatena.registerObject(this);
+        Hal::registerPollable(this);
 
         this->m_UplinkTimer.begin(this->m_txCycleSec * 1000);
+        this->initProfiler();
         }
 
-    Wire.begin();
-    if (this->m_BME280.begin(BME280_ADDRESS, Adafruit_BME280::OPERATING_MODE::Sleep))
+    // the sensors were powered no later than this.
+    this->m_tSensorBegin = Hal::millis();
+
+    // settings kept in FRAM; the defaults if there are none yet.
+    if (! this->m_AppConfig.load())
+        Hal::safePrintf("no saved settings: using defaults\n");
+    this->applyAppConfig();
+
+    // sensors that aren't in the registry for this build are never
+    // started, and their drivers are compiled out.
+    Hal::beginI2c();
+#if CATENA4610_SENSOR_BME280
+    if (this->m_BME280.begin(cBme280::kAddress))
         {
         this->m_fBme280 = true;
-        gCatena.SafePrintf("BME280 found\n");
+        Hal::safePrintf("BME280 found\n");
         }
     else
         {
         this->m_fBme280 = false;
-        gCatena.SafePrintf("No BME280 found: check wiring\n");
+        Hal::safePrintf("No BME280 found: check wiring\n");
         }
+#else
+    this->m_fBme280 = false;
+#endif
 
-    if (this->m_si1133.begin())
+    if (! Sensors::Si1133::kEnabled)
+        this->m_fSi1133 = false;
+    else if (Hal::si1133Begin())
         {
         this->m_fSi1133 = true;
-
-        auto const measConfig =	Catena_Si1133::ChannelConfiguration_t()
-            .setAdcMux(Catena_Si1133::InputLed_t::LargeWhite)
-            .setSwGainCode(0)
-            .setHwGainCode(0)
-            .setPostShift(1)
-            .set24bit(false);
-
-        this->m_si1133.configure(0, measConfig, 0);
-        gCatena.SafePrintf("Si1133 found\n");
+        Hal::safePrintf("Si1133 found\n");
         }
     else
         {
         this->m_fSi1133 = false;
-        gCatena.SafePrintf("No Si1133 found: check hardware\n");
+        Hal::safePrintf("No Si1133 found: check hardware\n");
         }
 
-    bool fCompostTemp = this->checkCompostSensorPresent();
-
-    if(!fCompostTemp)
-        {
-        gCatena.SafePrintf("No one-wire temperature sensor detected\n");
-        }
-    else
+    if (Sensors::Compost::kEnabled)
         {
-        gCatena.SafePrintf("One-wire temperature sensor detected\n");
+        bool fCompostTemp = this->checkCompostSensorPresent();
+
+        if(!fCompostTemp)
+            {
+            Hal::safePrintf("No one-wire temperature sensor detected\n");
+            }
+        else
+            {
+            Hal::safePrintf("One-wire temperature sensor detected\n");
+            }
         }
 
     // start (or restart) the FSM.
@@ -97,19 +107,6 @@ void cMeasurementLoop::begin()
         }
     }
 
-// return true if the compost sensor is attached.
-bool cMeasurementLoop::checkCompostSensorPresent(void)
-    {
-    /* set D11 high so V_OUT2 is going to be high for onewire sensor */
-    pinMode(D11, OUTPUT);
-    digitalWrite(D11, HIGH);
-
-    delay(10);
-
-    sensor_CompostTemp.begin();
-    return sensor_CompostTemp.getDeviceCount() != 0;
-    }
-
 void cMeasurementLoop::end()
     {
     if (this->m_running)
@@ -137,9 +134,20 @@ cMeasurementLoop::fsmDispatch(
     {
     State newState = State::stNoChange;
 
+    if (fEntry)
+        {
+        // a measurement cycle runs from one stMeasure to the next.
+        this->m_Profiler.enterState(std::uint8_t(currentState));
+        this->m_EventTrace.record(
+            Hal::millis(), cEventTrace::Type::kState, std::uint8_t(currentState)
+            );
+        if (currentState == State::stMeasure)
+            this->m_Profiler.startCycle();
+        }
+
     if (fEntry && this->isTraceEnabled(this->DebugFlags::kTrace))
         {
-        gCatena.SafePrintf("cMeasurementLoop::fsmDispatch: enter %s\n",
+        Hal::safePrintf("cMeasurementLoop::fsmDispatch: enter %s\n",
                 this->getStateName(currentState)
                 );
         }
@@ -171,7 +179,7 @@ cMeasurementLoop::fsmDispatch(
         if (fEntry)
             {
             // set the LEDs to flash accordingly.
-            gLed.Set(McciCatena::LedPattern::Sleeping);
+            Hal::setLed(Hal::LedPattern::Sleeping);
             }
 
         if (this->m_rqInactive)
@@ -182,60 +190,130 @@ cMeasurementLoop::fsmDispatch(
             }
         else if (this->m_UplinkTimer.isready())
             newState = State::stMeasure;
-        else if (this->m_UplinkTimer.getRemaining() > 1500)
+        else if (this->isRetryDue())
+            newState = State::stRetry;
+        else if (this->getSleepDeadlineMs() >= kMinDeepSleepMs)
             this->sleep();
         break;
 
-      // get some data. This is only called while booting up.
-	     case State::stWarmup:
-	         if (fEntry)
-	             {
-	             //start the timer
-	             this->setTimer(5 * 1000);
-	             }
-	         if (this->timedOut())
-	             newState = State::stMeasure;
-	         break;
+    // wait until every sensor is ready. This is only called when going
+    // active.
+    case State::stWarmup:
+        if (fEntry)
+            {
+            // power the OneWire probes now, so they settle while we
+            // wait; Vbat decides whether the boost regulator is needed.
+            if (Sensors::Compost::kEnabled && Hal::hasCompostProbe())
+                {
+                this->m_data.Vbat = Hal::readVbat();
+                this->m_EventTrace.recordValue(
+                    Hal::millis(), cEventTrace::Value::kVbat, this->m_data.Vbat
+                    );
+                this->powerUpCompostSensor();
+                }
 
+            std::uint32_t const remaining = this->getSensorWarmupRemaining();
 
-    // fill in the measurement
+            if (remaining == 0)
+                newState = State::stMeasure;
+            else
+                this->setTimer(remaining);
+            }
+        else if (this->timedOut())
+            newState = State::stMeasure;
+        break;
+
+
+    // start the sensors, then collect them as each finishes.
     case State::stMeasure:
-			if (fEntry)
+        if (fEntry)
             {
-            // start SI1133 measurement (one-time)
-            this->m_si1133.start(true);
-            this->updateSynchronousMeasurements();
-            this->setTimer(1000);
+            // an intermediate sample only reads the compost temperature.
+            bool const fIntermediate = this->startOversample();
+
+            this->updatePowerMeasurements();
+            this->startSensorTasks();
+            if (! fIntermediate)
+                this->updateDiagMeasurement();
             }
 
-        if (this->m_si1133.isOneTimeReady())
-            {
-            this->updateLightMeasurements();
+        if (this->pollSensorTasks())
             newState = State::stTransmit;
+
+        // an intermediate sample has gone into the compost summary.
+        if (newState == State::stTransmit && this->m_fIntermediateSample)
+            {
+            this->m_fIntermediateSample = false;
+            this->resetMeasurements();
+            newState = State::stSleeping;
             }
-        else if (this->timedOut())
+
+        // when batching, the measurement goes to the batch first.
+        else if (newState == State::stTransmit && this->isBatching())
+            newState = State::stBatch;
+
+        // when reporting on change, drop measurements that don't matter.
+        else if (newState == State::stTransmit &&
+                 this->isReportPolicyActive() &&
+                 ! this->checkReportPolicy(this->m_data))
             {
-            this->m_si1133.stop();
-            newState = State::stTransmit;
-            if (this->isTraceEnabled(this->DebugFlags::kError))
-                gCatena.SafePrintf("S1133 timed out\n");
+            this->resetMeasurements();
+            newState = State::stSleeping;
             }
         break;
 
-    case State::stTransmit:
+    // add the measurement to the batch; transmit if it's full.
+    case State::stBatch:
         if (fEntry)
             {
-            TxBuffer_t b;
-            this->fillTxBuffer(b, this->m_data);
+            // format 0x16 has no extension fields.
+            this->m_CompostStats.reset();
 
-            this->m_FileTxBuffer.begin();
-            for (auto i = 0; i < b.getn(); ++i)
-                this->m_FileTxBuffer.put(b.getbase()[i]);
+            this->logMeasurement(this->m_data);
+            if (this->addBatchSample(this->m_data, this->m_LogSlot))
+                newState = State::stTransmit;
+            else
+                newState = State::stSleeping;
 
             this->resetMeasurements();
-            this->startTransmission(b);
             }
-        if (! gLoRaWAN.IsProvisioned())
+        break;
+
+    case State::stTransmit:
+        if (fEntry)
+            {
+            if (this->m_pBatchFrame != nullptr)
+                {
+                // stBatch has already encoded the frame.
+                auto const pFrame = this->m_pBatchFrame;
+
+                this->m_pBatchFrame = nullptr;
+                this->startTransmission(pFrame, kUplinkPort);
+                }
+            else
+                {
+                // encode straight into the frame that will be sent.
+                auto const pFrame = this->m_TxFrames.acquire();
+
+                this->updateCompostStatsMeasurement();
+
+                this->m_fDeltaPending = this->m_fDeltaUplink && pFrame != nullptr;
+                if (pFrame == nullptr)
+                    {
+                    if (this->isTraceEnabled(DebugFlags::kError))
+                        Hal::safePrintf("no free uplink frame\n");
+                    }
+                else if (this->m_fDeltaPending)
+                    this->fillDeltaTxBuffer(*pFrame, this->m_data);
+                else
+                    this->fillTxBuffer(*pFrame, this->m_data);
+
+                this->logMeasurement(this->m_data);
+                this->resetMeasurements();
+                this->startTransmission(pFrame, kUplinkPort);
+                }
+            }
+        if (! this->isProvisioned())
             {
             newState = State::stFinal;
             }
@@ -243,11 +321,104 @@ cMeasurementLoop::fsmDispatch(
             {
             newState = State::stSleeping;
 
+            // if the network is reachable, catch up on anything that
+            // wasn't sent earlier: queued retries first, then the log.
+            if (! this->m_txerr)
+                {
+                this->releaseTxFrame();
+
+                if (this->m_nBatchInFrame != 0)
+                    this->markBatchSent();
+                else
+                    this->markLogSent(this->m_LogSlot);
+
+                if (! this->m_RetryQueue.isEmpty())
+                    {
+                    this->m_RetryQueue.expedite(Hal::millis());
+                    newState = State::stRetry;
+                    }
+                else if (this->m_pFlashLog && this->m_pFlashLog->hasUnsent())
+                    newState = State::stBackfill;
+                }
+
+            // otherwise keep the frame to retry. A batch is only kept if
+            // there's no flash log; if there is, backfill will send it.
+            else if (this->m_nBatchInFrame == 0)
+                this->queueRetry(this->m_LogSlot, RetryQueue_t::kPriorityNormal);
+            else if (this->m_pFlashLog == nullptr)
+                this->queueRetry(cFlashLog::kNoSlot, RetryQueue_t::kPriorityHigh);
+            else
+                this->releaseTxFrame();
+
+            // drop the batched samples; if they didn't go, they're
+            // still in the flash log.
+            this->finishBatchFrame();
+
+            // a delta frame becomes the reference once it's gone.
+            if (this->m_fDeltaPending)
+                {
+                this->m_DeltaEncoder.acknowledge(! this->m_txerr);
+                this->m_fDeltaPending = false;
+                }
+
+            // move the report-on-change baseline.
+            this->finishReport(! this->m_txerr);
+
             // calculate the new sleep interval.
             this->updateTxCycleTime();
             }
         break;
 
+    // send logged measurements that didn't get through.
+    case State::stBackfill:
+        if (fEntry)
+            {
+            this->m_nBackfill = 0;
+            if (! this->startBackfill())
+                newState = State::stSleeping;
+            }
+        else if (this->txComplete())
+            {
+            newState = State::stSleeping;
+            this->releaseTxFrame();
+
+            if (! this->m_txerr)
+                {
+                this->markLogSent(this->m_BackfillSlot);
+
+                if (++this->m_nBackfill < kMaxBackfillPerCycle &&
+                    this->startBackfill())
+                    newState = State::stNoChange;
+                }
+            }
+        break;
+
+    // send uplinks that failed earlier, as they come due.
+    case State::stRetry:
+        if (fEntry)
+            {
+            if (! this->startRetry())
+                newState = State::stSleeping;
+            }
+        else if (this->txComplete())
+            {
+            bool const fSuccess = ! this->m_txerr;
+
+            this->finishRetry(fSuccess);
+            newState = State::stSleeping;
+
+            // once the queue is empty, catch up from the log.
+            if (fSuccess)
+                {
+                if (this->startRetry())
+                    newState = State::stNoChange;
+                else if (this->m_RetryQueue.isEmpty() &&
+                         this->m_pFlashLog && this->m_pFlashLog->hasUnsent())
+                    newState = State::stBackfill;
+                }
+            }
+        break;
+
     case State::stFinal:
         break;
 
@@ -266,80 +437,102 @@ cMeasurementLoop::fsmDispatch(
 
 void cMeasurementLoop::resetMeasurements()
     {
-    memset((void *) &this->m_data, 0, sizeof(this->m_data));
+    std::memset((void *) &this->m_data, 0, sizeof(this->m_data));
     this->m_data.flags = Flags(0);
     }
 
-void cMeasurementLoop::updateSynchronousMeasurements()
-    {
-    this->m_data.Vbat = gCatena.ReadVbat();
-    this->m_data.flags |= Flags::FlagVbat;
+/*
 
-    this->m_data.Vbus = gCatena.ReadVbus();
-    this->m_data.flags |= Flags::FlagVcc;
+Name:   McciCatena4610::cMeasurementLoop::getSensorWarmupRemaining()
 
-    if (gCatena.getBootCount(this->m_data.BootCount))
-        {
-        this->m_data.flags |= Flags::FlagBoot;
-        }
+Function:
+    Return how long until every sensor present is ready.
 
-    if (this->m_fBme280)
-        {
-        auto m = this->m_BME280.readTemperaturePressureHumidity();
-        this->m_data.env.Temperature = m.Temperature;
-        this->m_data.env.Pressure = m.Pressure;
-        this->m_data.env.Humidity = m.Humidity;
-        this->m_data.flags |= Flags::FlagTPH;
-        }
+Definition:
+    std::uint32_t
+    McciCatena4610::cMeasurementLoop::getSensorWarmupRemaining(
+            void
+            ) const;
 
-    // SI1133 is handled separately
+Description:
+    The sensors on the always-on rail (the BME280 and Si1133) are
+    powered from boot; they must have had their datasheet start-up time,
+    from the sensor registry, since the start of begin(). If the
+    OneWire probes are powered, their rails must have settled. Sensors
+    that aren't present or are turned off aren't waited for.
 
-    /*
-    || Measure and transmit the compost temperature (OneWire)
-    || tranducer value. This is complicated because we want
-    || to support plug/unplug and the sw interface is not
-    || really hot-pluggable.
-    */
+Returns:
+    Milliseconds still to wait; zero if everything is ready.
 
-    // enable boost regulator if no USB power and VBat is less than 3.1V
-    if (!m_fUsbPower && (this->m_data.Vbat < 3.10f))
-        {
-        pinMode(D14, OUTPUT);
-        digitalWrite(D14, HIGH);
-        delay(90);
-        }
+*/
 
-    bool fCompostTemp = checkCompostSensorPresent();
+std::uint32_t cMeasurementLoop::getSensorWarmupRemaining() const
+    {
+    std::uint32_t const tNow = Hal::millis();
+    std::uint32_t remaining = 0;
 
-    if (fCompostTemp)
+    auto const waitFor = [tNow, &remaining](std::uint32_t tStart, std::uint32_t ms)
         {
-        sensor_CompostTemp.requestTemperatures();
-        float compostTempC = sensor_CompostTemp.getTempCByIndex(0);
-        this->m_data.compost.TempC = compostTempC;
-        this->m_data.flags |= Flags::FlagWater;
-        }
-    else if (fHasCompostTemp)
-        {
-        gCatena.SafePrintf("No compost temperature\n");
-        }
-    else if(!fCompostTemp)
-        {
-        gCatena.SafePrintf("Compost sensor not detected\n");
-        }
+        std::uint32_t const tElapsed = tNow - tStart;
+
+        if (tElapsed < ms && ms - tElapsed > remaining)
+            remaining = ms - tElapsed;
+        };
 
-    /* set D11 low to turn off after measuring */
-    pinMode(D11, INPUT);
-    pinMode(D14, INPUT);
+    std::uint8_t const active =
+        (this->isEnvActive() ? Sensors::Bme280::kField : 0) |
+        (this->isLightActive() ? Sensors::Si1133::kField : 0);
+
+    waitFor(
+        this->m_tSensorBegin,
+        Sensors::Registry::getMaxWarmupMs(Sensors::Rail::kAlwaysOn, active)
+        );
+    if (this->m_fCompostPowered)
+        waitFor(this->m_tCompostPowerOn, this->m_CompostSettleMs);
+
+    return remaining;
     }
 
-void cMeasurementLoop::updateLightMeasurements()
+// the power supply readings; these are needed before the OneWire probes
+// can be powered.
+void cMeasurementLoop::updatePowerMeasurements()
     {
-    uint32_t data[1];
+    std::uint32_t const tStart = Hal::micros();
 
-    this->m_si1133.readMultiChannelData(data, 1);
-    this->m_si1133.stop();
+    this->m_data.Vbat = Hal::readVbat();
+    this->m_data.flags |= Flags::FlagVbat;
+    this->m_EventTrace.recordValue(
+        Hal::millis(), cEventTrace::Value::kVbat, this->m_data.Vbat
+        );
+
+    this->m_data.Vbus = Hal::readVbus();
+    this->m_data.flags |= Flags::FlagVcc;
+    this->m_EventTrace.recordValue(
+        Hal::millis(), cEventTrace::Value::kVbus, this->m_data.Vbus
+        );
+    this->setVbus(this->m_data.Vbus);
+
+    this->m_VbatLast = this->m_data.Vbat;
+    this->updatePowerLevel();
 
-    this->m_data.light.White = (float) data[0];
+    this->m_Profiler.addSensor(kProfileAdc, Hal::micros() - tStart);
+
+    if (Hal::getBootCount(this->m_data.BootCount))
+        {
+        this->m_data.flags |= Flags::FlagBoot;
+        this->m_EventTrace.recordValue(
+            Hal::millis(), cEventTrace::Value::kBootCount, float(this->m_data.BootCount)
+            );
+        }
+    }
+
+void cMeasurementLoop::updateLightMeasurements()
+    {
+    this->m_data.light.White = (float) Hal::si1133Read();
+    this->m_data.flags |= Flags::FlagLux;
+    this->m_EventTrace.recordValue(
+        Hal::millis(), cEventTrace::Value::kLux, this->m_data.light.White
+        );
     }
 /****************************************************************************\
 |
@@ -347,46 +540,109 @@ void cMeasurementLoop::updateLightMeasurements()
 |
 \****************************************************************************/
 
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::startTransmission()
+
+Function:
+    Send a frame from the pool.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::startTransmission(
+            TxBuffer_t *pFrame,
+            std::uint8_t port
+            );
+
+Description:
+    The radio is given a pointer to the frame, not a copy. The loop
+    owns the frame from here until the send completes; then the state
+    that started the send either returns it to the pool or, if it
+    failed, hands it to the retry queue. A null frame (the pool was
+    empty) is treated as a send that failed to start.
+
+Returns:
+    No explicit result.
+
+*/
+
 void cMeasurementLoop::startTransmission(
-    cMeasurementLoop::TxBuffer_t &b
+    TxBuffer_t *pFrame,
+    std::uint8_t port
     )
     {
-    auto const savedLed = gLed.Set(McciCatena::LedPattern::Off);
-    gLed.Set(McciCatena::LedPattern::Sending);
+    Hal::setLed(Hal::LedPattern::Sending);
 
     // by using a lambda, we can access the private contents
     auto sendBufferDoneCb =
         [](void *pClientData, bool fSuccess)
             {
             auto const pThis = (cMeasurementLoop *)pClientData;
-            pThis->m_txpending = false;
-            pThis->m_txcomplete = true;
-            pThis->m_txerr = ! fSuccess;
-            pThis->m_fsm.eval();
+            pThis->updateLinkQuality(fSuccess);
+            pThis->sendBufferDone(fSuccess);
             };
 
     bool fConfirmed = false;
-    if (gCatena.GetOperatingFlags() &
-        static_cast<uint32_t>(gCatena.OPERATING_FLAGS::fConfirmedUplink))
+    if (Hal::getOperatingFlags() &
+        static_cast<uint32_t>(OPERATING_FLAGS::fConfirmedUplink))
+        {
+        Hal::safePrintf("requesting confirmed tx\n");
+        fConfirmed = true;
+        }
+    else if (this->getOperatingProfile().fConfirmed)
+        {
+        fConfirmed = true;
+        }
+    else if (this->getLinkPolicy() && this->m_LinkPolicy.shouldConfirm())
         {
-        gCatena.SafePrintf("requesting confirmed tx\n");
         fConfirmed = true;
         }
 
+    this->m_fTxConfirmed = fConfirmed;
+    if (pFrame != nullptr)
+        this->m_EventTrace.record(
+            Hal::millis(),
+            cEventTrace::Type::kTxStart,
+            port,
+            std::uint16_t(pFrame->getn() | (fConfirmed ? 0x8000 : 0)),
+            cEventTrace::hash(pFrame->getbase(), pFrame->getn())
+            );
+
+    this->m_pTxFrame = pFrame;
     this->m_txpending = true;
     this->m_txcomplete = this->m_txerr = false;
 
-    if (! gLoRaWAN.SendBuffer(b.getbase(), b.getn(), sendBufferDoneCb, (void *)this, fConfirmed))
+    if (pFrame == nullptr ||
+        ! Hal::sendBuffer(
+            pFrame->getbase(), pFrame->getn(),
+            sendBufferDoneCb, (void *)this, fConfirmed, port
+            ))
         {
         // uplink wasn't launched.
-        this->m_txcomplete = true;
-        this->m_txerr = true;
-        this->m_fsm.eval();
+        this->sendBufferDone(false);
+        }
+    }
+
+// Hal::isProvisioned(), noting changes in the event trace: a replay
+// needs to know when the device was joined or forgot its keys.
+bool cMeasurementLoop::isProvisioned()
+    {
+    bool const fProvisioned = Hal::isProvisioned();
+
+    if (fProvisioned != this->m_fProvisioned)
+        {
+        this->m_fProvisioned = fProvisioned;
+        this->m_EventTrace.record(
+            Hal::millis(), cEventTrace::Type::kProvisioned, fProvisioned
+            );
         }
+
+    return fProvisioned;
     }
 
 void cMeasurementLoop::sendBufferDone(bool fSuccess)
     {
+    this->m_EventTrace.record(Hal::millis(), cEventTrace::Type::kTxDone, fSuccess);
+
     this->m_txpending = false;
     this->m_txcomplete = true;
     this->m_txerr = ! fSuccess;
@@ -418,7 +674,7 @@ void cMeasurementLoop::poll()
 
 	   if (this->m_fTimerActive)
 	        {
-	        if ((millis() - this->m_timer_start) >= this->m_timer_delay)
+	        if ((Hal::millis() - this->m_timer_start) >= this->m_timer_delay)
 	            {
 	            this->m_fTimerActive = false;
 	            this->m_fTimerEvent = true;
@@ -426,17 +682,62 @@ void cMeasurementLoop::poll()
 	            }
         }
 
+    // sensor tasks are running; poll for completion.
+    if (this->isSensorTaskBusy())
+        {
+        fEvent = true;
+        }
+
     // check the transmit time.
     if (this->m_UplinkTimer.peekTicks() != 0)
         {
         fEvent = true;
         }
 
+    // a failed uplink can be sent again.
+    if (this->isRetryDue())
+        {
+        fEvent = true;
+        }
+
     if (fEvent)
         this->m_fsm.eval();
 
-    this->m_data.Vbus = gCatena.ReadVbus();
-    setVbus(this->m_data.Vbus);
+    this->pollVbus();
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::pollVbus()
+
+Function:
+    Rate-limited USB power detection.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::pollVbus(
+            void
+            );
+
+Description:
+    Vbus is read by an ADC conversion, so it's not read on every pass
+    through loop(). Each measurement reads Vbus and updates the USB
+    power state (see setVbus()); in between, it's sampled here at most
+    every m_VbusSampleMs, and right away after a deep sleep.
+
+Returns:
+    No explicit result.
+
+*/
+
+void cMeasurementLoop::pollVbus()
+    {
+    if (this->m_fVbusSampled &&
+        (this->m_VbusSampleMs == 0 ||
+         std::uint32_t(Hal::millis() - this->m_tVbusSample) < this->m_VbusSampleMs))
+        return;
+
+    this->setVbus(Hal::readVbus());
+    this->updatePowerLevel();
     }
 
 /****************************************************************************\
@@ -458,9 +759,11 @@ void cMeasurementLoop::updateTxCycleTime()
     else if (txCycleCount == 1)
             {
             // it's now one (otherwise we couldn't be here.)
-            gCatena.SafePrintf("resetting tx cycle to default: %u\n", this->m_txCycleSec_Permanent);
+            std::uint32_t const txCycleSec = this->getPermanentCycleSec();
 
-            this->setTxCycleTime(this->m_txCycleSec_Permanent, 0);
+            Hal::safePrintf("resetting tx cycle to default: %u\n", txCycleSec);
+
+            this->setTxCycleTime(txCycleSec, 0);
             }
     else
             {
@@ -485,35 +788,81 @@ void cMeasurementLoop::sleep()
             this->doDeepSleep();
     }
 
-// for now, we simply don't allow deep sleep. In the future might want to
-// use interrupts on activity to wake us up; then go back to sleep when we've
-// seen nothing for a while.
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::getSleepDeadlineMs()
+
+Function:
+    Work out how long we can sleep before something needs attention.
+
+Definition:
+    std::uint32_t McciCatena4610::cMeasurementLoop::getSleepDeadlineMs(
+            void
+            ) const;
+
+Description:
+    The deadline is the time left on the uplink timer, or until the
+    next retry can be sent if that's sooner, unless other work is
+    pending: an uplink in progress, a OneWire conversion, an FSM
+    timeout, or an LMIC job due before the deadline.
+
+Returns:
+    Milliseconds until the next wakeup is needed; zero if we must stay
+    awake.
+
+*/
+
+std::uint32_t cMeasurementLoop::getSleepDeadlineMs() const
+    {
+    if (this->m_txpending || this->isSensorTaskBusy() || this->m_fTimerActive)
+        return 0;
+
+    std::uint32_t ms = this->m_UplinkTimer.getRemaining();
+    std::uint32_t const retryMs = this->getRetryWaitMs();
+
+    if (retryMs < ms)
+        ms = retryMs;
+
+    if (Hal::isRadioBusyWithin(ms))
+        return 0;
+
+    return ms;
+    }
+
+// deep sleep whenever the deadline allows, unless something needs USB
+// to stay up. The serial-port check only applies in interactive mode;
+// unattended devices don't wait for a terminal.
 bool cMeasurementLoop::checkDeepSleep()
     {
-    bool const fDeepSleepTest = gCatena.GetOperatingFlags() &
-                    static_cast<uint32_t>(gCatena.OPERATING_FLAGS::fDeepSleepTest);
+    std::uint32_t const operatingFlags = Hal::getOperatingFlags();
+    bool const fDeepSleepTest = operatingFlags &
+                    static_cast<uint32_t>(OPERATING_FLAGS::fDeepSleepTest);
+    bool const fInteractive = operatingFlags &
+                    static_cast<uint32_t>(OPERATING_FLAGS::fInteractiveSleep);
     bool fDeepSleep;
-    std::uint32_t const sleepInterval = this->m_UplinkTimer.getRemaining() / 1000;
 
-    if (sleepInterval < 2)
+    if (this->getSleepDeadlineMs() < kMinDeepSleepMs)
         fDeepSleep = false;
     else if (fDeepSleepTest)
         {
         fDeepSleep = true;
         }
-#ifdef USBCON
-    else if (Serial.dtr())
+    else if (fInteractive && Hal::isConsoleConnected())
         {
         fDeepSleep = false;
         }
-#endif
-    else if (gCatena.GetOperatingFlags() &
-                static_cast<uint32_t>(gCatena.OPERATING_FLAGS::fDisableDeepSleep))
+    else if (operatingFlags &
+                static_cast<uint32_t>(OPERATING_FLAGS::fDisableDeepSleep))
+        {
+        fDeepSleep = false;
+        }
+    else if (this->m_fUsbPower)
         {
+        // there's no battery to save, and deep sleep drops USB.
         fDeepSleep = false;
         }
-    else if ((gCatena.GetOperatingFlags() &
-                static_cast<uint32_t>(gCatena.OPERATING_FLAGS::fUnattended)) != 0)
+    else if ((operatingFlags &
+                static_cast<uint32_t>(OPERATING_FLAGS::fUnattended)) != 0)
         {
         fDeepSleep = true;
         }
@@ -529,91 +878,98 @@ void cMeasurementLoop::doSleepAlert(bool fDeepSleep)
     {
     this->m_fPrintedSleeping = true;
 
-    if (fDeepSleep)
+    // without the interactive flag, sleep at once.
+    bool const fInteractive = Hal::getOperatingFlags() &
+                static_cast<uint32_t>(OPERATING_FLAGS::fInteractiveSleep);
+
+    if (fDeepSleep && ! fInteractive)
+        {
+        Hal::safePrintf("using deep sleep\n");
+        }
+    else if (fDeepSleep)
         {
         bool const fDeepSleepTest =
-                gCatena.GetOperatingFlags() &
-                    static_cast<uint32_t>(gCatena.OPERATING_FLAGS::fDeepSleepTest);
+                Hal::getOperatingFlags() &
+                    static_cast<uint32_t>(OPERATING_FLAGS::fDeepSleepTest);
         const uint32_t deepSleepDelay = fDeepSleepTest ? 10 : 30;
 
-        gCatena.SafePrintf("using deep sleep in %u secs"
+        Hal::safePrintf("using deep sleep in %u secs"
 #ifdef USBCON
-                            " (USB will disconnect while asleep)"
+                        " (USB will disconnect while asleep)"
 #endif
-                            ": ",
-                            deepSleepDelay
-                            );
+                        ": ",
+                        unsigned(deepSleepDelay)
+                        );
 
         // sleep and print
-        gLed.Set(McciCatena::LedPattern::TwoShort);
+        Hal::setLed(Hal::LedPattern::TwoShort);
 
         for (auto n = deepSleepDelay; n > 0; --n)
             {
-            uint32_t tNow = millis();
+            uint32_t tNow = Hal::millis();
 
-            while (uint32_t(millis() - tNow) < 1000)
+            while (uint32_t(Hal::millis() - tNow) < 1000)
                 {
-                gCatena.poll();
-                yield();
+                Hal::pollPlatform();
                 }
-            gCatena.SafePrintf(".");
+            Hal::safePrintf(".");
             }
-        gCatena.SafePrintf("\nStarting deep sleep.\n");
-        uint32_t tNow = millis();
-        while (uint32_t(millis() - tNow) < 100)
+        Hal::safePrintf("\nStarting deep sleep.\n");
+        uint32_t tNow = Hal::millis();
+        while (uint32_t(Hal::millis() - tNow) < 100)
             {
-            gCatena.poll();
-            yield();
+            Hal::pollPlatform();
             }
         }
     else
-        gCatena.SafePrintf("using light sleep\n");
+        Hal::safePrintf("using light sleep\n");
     }
 
 void cMeasurementLoop::doDeepSleep()
     {
-    // bool const fDeepSleepTest = gCatena.GetOperatingFlags() &
-    //                         static_cast<uint32_t>(gCatena.OPERATING_FLAGS::fDeepSleepTest);
-    std::uint32_t const sleepInterval = this->m_UplinkTimer.getRemaining() / 1000;
+    // bool const fDeepSleepTest = Hal::getOperatingFlags() &
+    //                         static_cast<uint32_t>(OPERATING_FLAGS::fDeepSleepTest);
+    std::uint32_t const sleepInterval = this->getSleepDeadlineMs() / 1000;
 
     if (sleepInterval == 0)
         return;
 
     /* ok... now it's time for a deep sleep */
-    gLed.Set(McciCatena::LedPattern::Off);
+    Hal::setLed(Hal::LedPattern::Off);
     this->deepSleepPrepare();
 
     /* sleep */
-    gCatena.Sleep(sleepInterval);
+    this->m_Profiler.beginDeepSleep();
+    Hal::deepSleep(sleepInterval);
+    this->m_Profiler.endDeepSleep(sleepInterval * 1000);
 
     /* recover from sleep */
     this->deepSleepRecovery();
 
+    /* USB may have come or gone while we slept */
+    this->m_fVbusSampled = false;
+
     /* and now... we're awake again. trigger another measurement */
     this->m_fsm.eval();
     }
 
 void cMeasurementLoop::deepSleepPrepare(void)
     {
-    Serial.end();
-    Wire.end();
-    SPI.end();
+    Hal::suspendBuses();
     if (this->m_pSPI2 && this->m_fSpi2Active)
         {
-        this->m_pSPI2->end();
+        Hal::endSpi(this->m_pSPI2);
         this->m_fSpi2Active = false;
         }
-    pinMode(D11, INPUT);
+    Hal::pinMode(Hal::kPinVout2, Hal::kPinModeInput);
     }
 
 void cMeasurementLoop::deepSleepRecovery(void)
     {
-    pinMode(D11, OUTPUT);
-    digitalWrite(D11, HIGH);
+    Hal::pinMode(Hal::kPinVout2, Hal::kPinModeOutput);
+    Hal::digitalWrite(Hal::kPinVout2, Hal::kPinHigh);
 
-    Serial.begin();
-    Wire.begin();
-    SPI.begin();
+    Hal::resumeBuses();
     //if (this->m_pSPI2)
     //    this->m_pSPI2->begin();
     }
@@ -627,7 +983,7 @@ void cMeasurementLoop::deepSleepRecovery(void)
 // set the timer
 void cMeasurementLoop::setTimer(std::uint32_t ms)
     {
-    this->m_timer_start = millis();
+    this->m_timer_start = Hal::millis();
     this->m_timer_delay = ms;
     this->m_fTimerActive = true;
     this->m_fTimerEvent = false;
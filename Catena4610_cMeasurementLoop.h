@@ -18,27 +18,29 @@ Author:
 
 #pragma once
 
-#include <Arduino.h>
-#include <Wire.h>
-#include <Adafruit_BME280.h>
 #include <Catena_FSM.h>
-#include <Catena_Led.h>
-#include <Catena_Log.h>
-#include <Catena_Mx25v8035f.h>
 #include <Catena_PollableInterface.h>
-#include <Catena_Si1133.h>
 #include <Catena_Timer.h>
 #include <Catena_TxBuffer.h>
 #include <Catena.h>
-#include <mcciadk_baselib.h>
+#include "Catena4610_cAppConfig.h"
+#include "Catena4610_cBme280.h"
+#include "Catena4610_cEventTrace.h"
+#include "Catena4610_cFlashLog.h"
+#include "Catena4610_cLinkPolicy.h"
+#include "Catena4610_cPayloadEncoder.h"
+#include "Catena4610_cReportPolicy.h"
+#include "Catena4610_cRetryQueue.h"
+#include "Catena4610_cRunningStats.h"
+#include "Catena4610_cStateProfiler.h"
+#include "Catena4610_cTxFramePool.h"
+#include "Catena4610_hal.h"
+#include "Catena4610_SensorRegistry.h"
 #include <stdlib.h>
 
+#include <cmath>
 #include <cstdint>
 
-extern McciCatena::Catena gCatena;
-extern McciCatena::Catena::LoRaWAN gLoRaWAN;
-extern McciCatena::StatusLed gLed;
-
 namespace McciCatena4610 {
 
 /****************************************************************************\
@@ -56,7 +58,44 @@ class cMeasurementFormat : public cMeasurementBase
     {
 public:
     // buffer size for uplink data
-    static constexpr size_t kTxBufferSize = 18;
+    static constexpr size_t kTxBufferSize = 48;
+
+    // maximum number of OneWire compost probes
+    static constexpr std::uint8_t kMaxCompostProbes = 4;
+
+    // format code for batched messages
+    static constexpr std::uint8_t kBatchMessageFormat = 0x16;
+    // the most samples in one batched message
+    static constexpr std::uint8_t kMaxBatchSamples = 32;
+    // byte 1 of a batched message: the sample count, and a flag set
+    // when the newest sample was taken one interval before the send
+    static constexpr std::uint8_t kBatchCountMask = 0x7F;
+    static constexpr std::uint8_t kBatchHeldBack = 0x80;
+    // the largest LoRaWAN application payload in any region
+    static constexpr size_t kBatchTxBufferSize = 242;
+
+    // bit 7 of the bitmap: an extension bitmap and extension fields follow
+    static constexpr McciCatena::FlagsSensor3 FlagExtended =
+        McciCatena::FlagsSensor3(1 << 7);
+
+    // the bitmap bits this build sends: Vbat, Vbus and boot count, the
+    // fields of the sensors in the registry, and the extension. The
+    // encoders test fields against this, so the code for the fields of
+    // absent sensors is compiled out.
+    static constexpr std::uint8_t kSendFieldMask =
+        std::uint8_t(McciCatena::FlagsSensor3::FlagVbat) |
+        std::uint8_t(McciCatena::FlagsSensor3::FlagVcc) |
+        std::uint8_t(McciCatena::FlagsSensor3::FlagBoot) |
+        Sensors::Registry::getFieldMask() |
+        std::uint8_t(FlagExtended);
+
+    // the extension bitmap
+    enum ExtFlags : std::uint8_t
+        {
+        kExtCompostProbes = 1 << 0,     // probes after the first
+        kExtDiagnostics = 1 << 1,       // awake time and charge
+        kExtCompostStats = 1 << 2,      // compost temperature summary
+        };
 
     // the structure of a measurement
     struct Measurement
@@ -85,8 +124,35 @@ public:
         // compost temperature
         struct CompostTemp
             {
-            // compost temperature (in degrees C)
-            float                 TempC;
+            // number of probes read, including failed reads
+            std::uint8_t            nProbes;
+            // compost temperature of each probe (in degrees C), NAN if
+            // the probe didn't answer. TempC[0] is sent in field 5.
+            float                   TempC[kMaxCompostProbes];
+            };
+
+        // diagnostics for the previous measurement cycle; saturating.
+        struct Diag
+            {
+            // awake time (in ms)
+            std::uint16_t           AwakeMs;
+            // estimated charge (in units of 10 microcoulombs)
+            std::uint16_t           Charge;
+            // time spent transmitting (in ms)
+            std::uint16_t           TransmitMs;
+            };
+
+        // summary of the compost temperature samples (probe 0) taken
+        // since the last uplink.
+        struct CompostStats
+            {
+            // number of samples, saturating
+            std::uint8_t            n;
+            // minimum, maximum, mean and standard deviation (degrees C)
+            float                   Min;
+            float                   Max;
+            float                   Mean;
+            float                   StdDev;
             };
 
         //---------------------------
@@ -95,6 +161,8 @@ public:
 
         // flags of entries that are valid.
         McciCatena::FlagsSensor3	flags;
+        // extended flags; only meaningful if flags has FlagExtended.
+        std::uint8_t                extFlags;
         // measured battery voltage, in volts
         float                       Vbat;
         // measured system Vdd voltage, in volts
@@ -109,6 +177,10 @@ public:
         Light                       light;
         // compost temperature
         CompostTemp                 compost;
+        // diagnostics
+        Diag                        diag;
+        // compost temperature summary
+        CompostStats                compostStats;
         };
     };
 
@@ -131,6 +203,151 @@ public:
         fDisableDeepSleep = 1 << 17,
         fQuickLightSleep = 1 << 18,
         fDeepSleepTest = 1 << 19,
+        fInteractiveSleep = 1 << 20,
+        };
+
+    // the shortest deep sleep worth taking
+    static constexpr std::uint32_t kMinDeepSleepMs = 2000;
+
+    // sensor timing comes from the sensor registry; the warmup of the
+    // sensors that are always powered is in getSensorWarmupRemaining().
+    // D11 (V_OUT2) settling time before talking to the OneWire bus
+    static constexpr std::uint32_t kCompostPowerSettleMs =
+        Sensors::Registry::getMaxWarmupMs(Sensors::Rail::kVout2);
+    // D14 boost regulator settling time
+    static constexpr std::uint32_t kBoostSettleMs = Sensors::Compost::kBoostWarmupMs;
+    // extra time allowed beyond the datasheet conversion time
+    static constexpr std::uint32_t kCompostTimeoutMarginMs = 50;
+    // extra time allowed beyond the BME280 maximum conversion time
+    static constexpr std::uint32_t kBme280TimeoutMarginMs = 10;
+    // the sensors that are read asynchronously
+    enum SensorTask : std::uint8_t
+        {
+        kTaskEnv,           // BME280 forced conversion
+        kTaskLight,         // Si1133 one-time measurement
+        kTaskCompost,       // OneWire power settling, conversion and read
+        kNumSensorTasks
+        };
+    static constexpr const char *getSensorTaskName(std::uint8_t iTask)
+        {
+        return  iTask == kTaskEnv     ? "env" :
+                iTask == kTaskLight   ? "light" :
+                iTask == kTaskCompost ? "compost" :
+                                        "<<unknown>>";
+        }
+
+    // time allowed for the Si1133 one-time measurement
+    static constexpr std::uint32_t kLightTimeoutMs = Sensors::Si1133::kLatencyMs;
+
+    // sensors timed by the profiler
+    enum ProfileSensor : std::uint8_t
+        {
+        kProfileAdc,        // Vbat and Vbus
+        kProfileBme280,
+        kProfileSi1133,
+        kProfileCompost,    // OneWire conversion and read
+        kProfileFlash,      // flash log append
+        kProfileNumSensors
+        };
+
+    static constexpr const char *getProfileSensorName(std::uint8_t i)
+        {
+        return  i == kProfileAdc     ? "adc" :
+                i == kProfileBme280  ? "bme280" :
+                i == kProfileSi1133  ? "si1133" :
+                i == kProfileCompost ? "compost" :
+                i == kProfileFlash   ? "flash" :
+                                       "<<unknown>>";
+        }
+
+    // USB power thresholds. There is reverse voltage in Vbus (~3.5V)
+    // while powered from battery in 4610, so switch around 4.0V with
+    // some hysteresis.
+    static constexpr float kVbusOnThreshold = 4.2f;
+    static constexpr float kVbusOffThreshold = 3.8f;
+    // default time between Vbus samples while idle
+    static constexpr std::uint32_t kVbusSampleMs = 5000;
+
+    // battery thresholds for the operating profiles. A level is left
+    // when Vbat drops below its threshold, and only re-entered when
+    // Vbat is kVbatHysteresis above it.
+    static constexpr float kVbatLowThreshold = 3.6f;
+    static constexpr float kVbatCriticalThreshold = 3.4f;
+    static constexpr float kVbatHysteresis = 0.1f;
+    // operating profiles never make the uplink interval shorter than this
+    static constexpr std::uint32_t kMinProfileCycleSec = 60;
+
+    // the power source and battery state, best first.
+    enum PowerLevel : std::uint8_t
+        {
+        kPowerUsb,          // USB power
+        kPowerBattery,      // battery, normal
+        kPowerBatteryLow,   // battery, below kVbatLowThreshold
+        kPowerBatteryCritical, // battery, below kVbatCriticalThreshold
+        kNumPowerLevels
+        };
+
+    static constexpr const char *getPowerLevelName(std::uint8_t i)
+        {
+        return  i == kPowerUsb              ? "usb" :
+                i == kPowerBattery          ? "battery" :
+                i == kPowerBatteryLow       ? "low" :
+                i == kPowerBatteryCritical  ? "critical" :
+                                              "<<unknown>>";
+        }
+
+    // what the measurement loop does differently at each power level.
+    struct OperatingProfile
+        {
+        // the uplink interval is multiplied by 2^cycleShift
+        std::int8_t                 cycleShift;
+        // upper limit on the OneWire probe resolution, in bits
+        std::uint8_t                maxCompostBits;
+        // measure ambient light, and temperature/pressure/humidity
+        bool                        fLight;
+        bool                        fEnv;
+        // request confirmed uplinks
+        bool                        fConfirmed;
+        };
+    // maximum number of OneWire probes we keep track of
+    static constexpr std::uint8_t kMaxCompostProbes = MeasurementFormat::kMaxCompostProbes;
+
+    // automatic OneWire resolution: when readings are stable, step down
+    // a bit after this many samples; step up a bit if a reading moves
+    // more than kCompostAutoStableC, and go to full resolution if it
+    // moves kCompostAutoRapidC or more.
+    static constexpr std::uint8_t kCompostAutoStableSamples = 6;
+    static constexpr float kCompostAutoStableC = 0.5f;
+    static constexpr float kCompostAutoRapidC = 1.0f;
+
+    // the automatic resolution state of a probe.
+    struct CompostAutoResolution
+        {
+        // the last reading (degrees C)
+        float                       PrevC;
+        // the resolution chosen, in bits; 0 until there's a reading
+        std::uint8_t                Bits;
+        // stable readings at this resolution
+        std::uint8_t                nStable;
+        };
+
+    // cached result of the last OneWire bus search.
+    struct CompostProbeCache
+        {
+        static constexpr std::uint32_t kMagic = 0x43505332; // 'CPS2'
+
+        // kMagic if the rest of the structure is valid.
+        std::uint32_t               Magic;
+        // measurement cycles since the last full search
+        std::uint16_t               nCyclesSinceSearch;
+        // number of valid entries
+        std::uint8_t                nProbes;
+        // resolution of each probe now, in bits
+        std::uint8_t                Resolution[kMaxCompostProbes];
+        // resolution each probe loads from its EEPROM at power-on
+        std::uint8_t                PowerOnResolution[kMaxCompostProbes];
+        // ROM code of each probe
+        std::uint8_t                Rom[kMaxCompostProbes][8];
         };
 
     enum DebugFlags : std::uint32_t
@@ -145,8 +362,19 @@ public:
     cMeasurementLoop(
             )
         : m_txCycleSec_Permanent(8 * 60 * 60) // default uplink interval
-        , m_txCycleSec(30)                    // initial uplink interval
+        , m_txCycleSec(kFastCycleSec)         // initial uplink interval
         , m_txCycleCount(10)                   // initial count of fast uplinks
+        , m_CompostSearchInterval(24)          // full OneWire search at least daily
+        , m_BatchDepth(0)                      // batching is off
+        , m_BatchSampleSec(15 * 60)            // sample interval when batching
+        , m_VbusSampleMs(kVbusSampleMs)        // USB power detection period
+        , m_CompostOversample(1)               // one compost sample per uplink
+        , m_Bme280Configured(cAppConfig::kBme280NumProfiles) // not configured yet
+        , m_pTxFrame(nullptr)
+        , m_pBatchFrame(nullptr)
+        , m_pRetry(nullptr)
+        , m_PowerLevel(kPowerBattery)          // until Vbat is measured
+        , m_VbatLast(NAN)
         , m_DebugFlags(DebugFlags(kError | kTrace))
         {};
 
@@ -165,6 +393,9 @@ public:
         stWarmup,       // transition from inactive to measure, get some data.
         stMeasure,      // take measurents
         stTransmit,     // transmit data
+        stBackfill,     // transmit logged data that wasn't sent
+        stRetry,        // retransmit uplinks that failed
+        stBatch,        // add measurement to the batch
         stFinal,        // this name must be present, it's the terminal state.
         };
 
@@ -179,13 +410,76 @@ public:
             case State::stWarmup:   return "stWarmup";
             case State::stMeasure:  return "stMeasure";
             case State::stTransmit: return "stTransmit";
+            case State::stBackfill: return "stBackfill";
+            case State::stRetry:    return "stRetry";
+            case State::stBatch:    return "stBatch";
             case State::stFinal:    return "stFinal";
             default:                return "<<unknown>>";
             }
         }
 
-    // concrete type for uplink data buffer
-    using TxBuffer_t = McciCatena::AbstractTxBuffer_t<MeasurementFormat::kTxBufferSize>;
+    // failed uplinks waiting to be retried
+    static constexpr std::uint8_t kRetryQueueSize = 2;
+
+    // uplink frames: big enough for any message (a batch is the largest),
+    // and enough of them for a batch to be held while another is sent,
+    // and for each queued retry.
+    static constexpr std::uint8_t kNumTxFrames = kRetryQueueSize + 2;
+    using TxFramePool_t = cTxFramePool<MeasurementFormat::kBatchTxBufferSize, kNumTxFrames>;
+    using TxBuffer_t = TxFramePool_t::Frame_t;
+    using RetryQueue_t = cRetryQueue<TxBuffer_t, kRetryQueueSize>;
+
+    // LoRaWAN ports
+    static constexpr std::uint8_t kUplinkPort = 1;
+    static constexpr std::uint8_t kBackfillPort = 2;
+    // downlink port for configuration commands
+    static constexpr std::uint8_t kConfigPort = 3;
+
+    // configuration downlink command codes; see processConfigDownlink().
+    enum ConfigCommand : std::uint8_t
+        {
+        kConfigTxCycle = 0x01,      // uint32 seconds
+        kConfigFastCount = 0x02,    // uint8 count
+        kConfigSensors = 0x03,      // uint8 bitmap: bit 0 light, bit 1 env
+        kConfigResolution = 0x04,   // uint8 probe, uint8 bits
+        kConfigBme280 = 0x05,       // uint8 profile
+        kConfigBatch = 0x06,        // uint32 seconds, uint8 depth
+        kConfigPowerProfiles = 0x07, // uint8 0 or 1
+        };
+    // the shortest uplink interval that can be configured
+    static constexpr std::uint32_t kMinConfigCycleSec = 60;
+    // time between the fast uplinks after boot
+    static constexpr std::uint32_t kFastCycleSec = 30;
+
+    // backfill messages: sequence number and age, then a port 1 message.
+    static constexpr size_t kBackfillHeaderSize = 6;
+    // the longest single-measurement uplink, which the link policy keeps
+    // the data rate high enough to send.
+    static constexpr size_t kMaxMeasurementUplinkSize =
+        MeasurementFormat::kTxBufferSize + kBackfillHeaderSize;
+
+    // the most logged records to backfill after one live uplink
+    static constexpr std::uint8_t kMaxBackfillPerCycle = 4;
+
+    // retry backoff: the first wait, the longest wait, and the most
+    // attempts (counting the first send) before a frame is dropped.
+    static constexpr std::uint32_t kRetryBaseMs = 30 * 1000;
+    static constexpr std::uint32_t kRetryMaxBackoffMs = 30 * 60 * 1000;
+    static constexpr std::uint8_t kRetryMaxTries = 6;
+
+    // the flash log layout tag of LogRecord. Change this whenever
+    // LogRecord or Measurement changes, so that records written by other
+    // firmware aren't backfilled as garbage.
+    static constexpr std::uint8_t kLogRecordLayout = 1;
+
+    // what we keep in the flash log for each measurement
+    struct LogRecord
+        {
+        // Hal::millis() when the measurement was taken
+        std::uint32_t               tSample;
+        // the measurement
+        Measurement                 m;
+        };
 
     // initialize measurement FSM.
     void begin();
@@ -206,16 +500,240 @@ public:
         {
         return this->m_txCycleSec;
         }
+    // set the uplink interval after the fast uplinks, in seconds; saved
+    // in FRAM.
+    bool setPermanentCycleTime(std::uint32_t txCycleSec);
+    std::uint32_t getPermanentCycleTime() const
+        {
+        return this->m_txCycleSec_Permanent;
+        }
+    // set the number of fast uplinks after boot, saved in FRAM; also
+    // starts that many now (or stops them, if zero).
+    void setFastUplinks(std::uint8_t nUplinks);
+
+    // apply a configuration downlink; see processConfigDownlink().
+    bool processConfigDownlink(const std::uint8_t *pBuffer, std::size_t nBuffer);
+
+    // sample every sampleSec, and send up to depth samples per uplink.
+    // depth of 0 or 1 turns batching off.
+    void setBatching(std::uint32_t sampleSec, std::uint8_t depth);
+    std::uint8_t getBatchDepth() const
+        {
+        return this->m_BatchDepth;
+        }
+    std::uint32_t getBatchSampleTime() const
+        {
+        return this->m_BatchSampleSec;
+        }
+
+    // report on change: sample often, but only send when the policy
+    // says so. Ignored while batching.
+    void setReportPolicy(bool fEnable);
+    bool getReportPolicy() const
+        {
+        return this->m_fReportPolicy;
+        }
+    void setReportPolicyConfig(cReportPolicy::Config const &config);
+    cReportPolicy::Config const &getReportPolicyConfig() const
+        {
+        return this->m_ReportPolicy.getConfig();
+        }
+
+    // awake time and charge accounting; see cStateProfiler.
+    cStateProfiler const &getProfiler() const
+        {
+        return this->m_Profiler;
+        }
+    void resetProfiler()
+        {
+        this->m_Profiler.reset();
+        }
+    // payload encode/decode benchmark; see runPayloadBenchmark().
+    struct BenchResult
+        {
+        const char      *pName;
+        // size of the frame encoded, or of the frames decoded
+        std::uint16_t   nBytes;
+        // time for all the iterations, and CPU cycles (Hal::getCycleCount())
+        std::uint32_t   totalUs;
+        std::uint32_t   totalCycles;
+        // the first result matched the test vector
+        bool            fOk;
+        };
+    static constexpr std::uint8_t kNumBenchCases = 9;
+    void runPayloadBenchmark(BenchResult (&results)[kNumBenchCases], std::uint32_t nIterations);
+
+    // recent loop events, for replay; see cEventTrace.
+    cEventTrace const &getEventTrace() const
+        {
+        return this->m_EventTrace;
+        }
+    cEventTrace &getEventTrace()
+        {
+        return this->m_EventTrace;
+        }
+    // one line of the "trace" command's output, without the newline.
+    static std::size_t formatTraceEvent(
+        char *pBuf, std::size_t nBuf, cEventTrace::Event const &e
+        );
+
+    // number of failed uplinks waiting to be retried.
+    std::uint8_t getRetryCount() const
+        {
+        return this->m_RetryQueue.getn();
+        }
+    // append the diagnostic extension field to format 0x15 uplinks.
+    void setDiagUplink(bool fEnable)
+        {
+        this->m_fDiagUplink = fEnable;
+        }
+    bool getDiagUplink() const
+        {
+        return this->m_fDiagUplink;
+        }
+    // sample ambient light each cycle; turning this off skips the Si1133
+    // one-time measurement entirely. Saved in FRAM.
+    void setLightSampling(bool fEnable);
+    bool getLightSampling() const
+        {
+        return ! this->m_AppConfig.isOption(cAppConfig::kOptionLightOff);
+        }
+    // the same for temperature, pressure and humidity (the BME280).
+    void setEnvSampling(bool fEnable);
+    bool getEnvSampling() const
+        {
+        return ! this->m_AppConfig.isOption(cAppConfig::kOptionEnvOff);
+        }
+
+    // take nSamples compost temperature samples per uplink interval,
+    // and send their summary with the last; 0 or 1 turns this off.
+    void setCompostOversample(std::uint8_t nSamples);
+    std::uint8_t getCompostOversample() const
+        {
+        return this->m_CompostOversample;
+        }
+    // the compost temperature samples since the last uplink.
+    cRunningStats const &getCompostStats() const
+        {
+        return this->m_CompostStats;
+        }
+
+    // the settings kept in FRAM.
+    cAppConfig const &getAppConfig() const
+        {
+        return this->m_AppConfig;
+        }
+    // set the resolution of one OneWire probe (by search order), or of
+    // all of them if iProbe is kMaxCompostProbes; bits is 9..12, or
+    // cAppConfig::kResolutionAuto. The setting is saved in FRAM.
+    bool setCompostResolution(std::uint8_t iProbe, std::uint8_t bits);
+    // set the BME280 profile, one of cAppConfig::Bme280Profile. The
+    // setting is saved in FRAM.
+    bool setBme280Profile(std::uint8_t profile);
+    // the BME280 profile setting, and the profile it selects now.
+    std::uint8_t getBme280Profile() const
+        {
+        return this->m_AppConfig.get().Bme280;
+        }
+    std::uint8_t getBme280ActiveProfile() const;
+    // the longest a BME280 conversion takes with a profile, in ms.
+    static std::uint32_t getBme280ConversionMs(std::uint8_t profile)
+        {
+        return cBme280::getMaxConversionMs(getBme280Settings(profile));
+        }
+
+    // the resolution a probe is using now, in bits; 0 if not present.
+    std::uint8_t getCompostResolution(std::uint8_t iProbe) const
+        {
+        return iProbe < this->m_CompostProbes.nProbes
+                    ? this->m_CompostProbes.Resolution[iProbe]
+                    : 0;
+        }
+
+    // select the operating profile from the power level; when off, the
+    // battery profile is always used. Saved in FRAM.
+    void setPowerProfiles(bool fEnable);
+    bool getPowerProfiles() const
+        {
+        return ! this->m_AppConfig.isOption(cAppConfig::kOptionPowerProfilesOff);
+        }
+    PowerLevel getPowerLevel() const
+        {
+        return this->m_PowerLevel;
+        }
+    static OperatingProfile const &getOperatingProfile(std::uint8_t level);
+    // the profile in use now.
+    OperatingProfile const &getOperatingProfile() const
+        {
+        return getOperatingProfile(
+                    this->getPowerProfiles() ? this->m_PowerLevel : kPowerBattery
+                    );
+        }
+
+    // confirm uplinks according to the link quality (see cLinkPolicy);
+    // when off, only the operating flag and profile confirm. Saved in
+    // FRAM.
+    void setLinkPolicy(bool fEnable);
+    bool getLinkPolicy() const
+        {
+        return ! this->m_AppConfig.isOption(cAppConfig::kOptionLinkPolicyOff);
+        }
+    // confirm one uplink in nFrames while the link is good.
+    void setLinkConfirmInterval(std::uint8_t nFrames);
+    cLinkPolicy const &getLinkState() const
+        {
+        return this->m_LinkPolicy;
+        }
+
+    // send single measurements as format 0x17 (delta) instead of 0x15,
+    // with a keyframe at least every keyframeInterval messages.
+    void setDeltaUplink(bool fEnable, std::uint8_t keyframeInterval)
+        {
+        this->m_fDeltaUplink = fEnable;
+        this->m_DeltaEncoder.setKeyframeInterval(keyframeInterval);
+        this->m_DeltaEncoder.reset();
+        }
+    bool getDeltaUplink() const
+        {
+        return this->m_fDeltaUplink;
+        }
+    std::uint8_t getKeyframeInterval() const
+        {
+        return this->m_DeltaEncoder.getKeyframeInterval();
+        }
     virtual void poll() override;
+    // set the number of cycles between full OneWire searches; 0 means
+    // only search when presence changes.
+    void setCompostSearchInterval(std::uint16_t nCycles)
+        {
+        this->m_CompostSearchInterval = nCycles;
+        }
     void setBme280(bool fEnable)
         {
         this->m_fBme280 = fEnable;
         }
     void setVbus(float Vbus)
         {
-        // set threshold value as 4.0V as there is reverse voltage
-        // in vbus(~3.5V) while powered from battery in 4610.
-        this->m_fUsbPower = (Vbus > 4.0f) ? true : false;
+        if (Vbus > kVbusOnThreshold)
+            this->m_fUsbPower = true;
+        else if (Vbus < kVbusOffThreshold)
+            this->m_fUsbPower = false;
+
+        this->m_tVbusSample = Hal::millis();
+        this->m_fVbusSampled = true;
+        }
+    bool isUsbPowered() const
+        {
+        return this->m_fUsbPower;
+        }
+    // set how often poll() samples Vbus; 0 means only when measuring.
+    void setVbusSamplePeriod(std::uint32_t ms)
+        {
+        this->m_VbusSampleMs = ms;
+        }
+    std::uint32_t getVbusSamplePeriod() const
+        {
+        return this->m_VbusSampleMs;
         }
 
     // request that the measurement loop be active/inactive
@@ -232,6 +750,14 @@ public:
     void registerSecondSpi(SPIClass *pSpi)
         {
         this->m_pSPI2 = pSpi;
+        this->m_fSpi2Active = true;
+        }
+
+    // register the flash log for store-and-forward.
+    // can be called before begin().
+    void registerFlashLog(cFlashLog *pFlashLog)
+        {
+        this->m_pFlashLog = pFlashLog;
         }
 private:
     // sleep handling
@@ -239,24 +765,186 @@ private:
     bool checkDeepSleep();
     void doSleepAlert(bool fDeepSleep);
     void doDeepSleep();
+    std::uint32_t getSleepDeadlineMs() const;
     void deepSleepPrepare();
     void deepSleepRecovery();
 
+    // USB power detection
+    void pollVbus();
+    // power source and battery state
+    void updatePowerLevel();
+
+    // settings kept in FRAM
+    void applyAppConfig();
+    void saveAppConfig();
+    std::uint32_t applyOperatingProfile(std::uint32_t cycleSec) const;
+
+    // profiling
+    void initProfiler();
+    void updateDiagMeasurement();
+
     // read data
-    void updateSynchronousMeasurements();
+    std::uint32_t getSensorWarmupRemaining() const;
+    void updatePowerMeasurements();
+
+    // asynchronous sensor tasks, run side by side in stMeasure.
+    void startSensorTasks();
+    bool pollSensorTasks();
+    void startSensorTask(SensorTask iTask, std::uint32_t timeoutMs);
+    void finishSensorTask(SensorTask iTask, bool fSuccess)
+        {
+        this->m_SensorTaskBusy &= ~(1u << iTask);
+        this->m_EventTrace.record(
+            Hal::millis(),
+            cEventTrace::Type::kSensor,
+            iTask,
+            fSuccess,
+            Hal::millis() - this->m_tSensorTaskStart[iTask]
+            );
+        }
+    bool isSensorTaskBusy(SensorTask iTask) const
+        {
+        return (this->m_SensorTaskBusy & (1u << iTask)) != 0;
+        }
+    bool isSensorTaskBusy() const
+        {
+        return this->m_SensorTaskBusy != 0;
+        }
+    bool isSensorTaskExpired(SensorTask iTask) const
+        {
+        return Hal::millis() - this->m_tSensorTaskStart[iTask] >=
+                    this->m_SensorTaskTimeoutMs[iTask];
+        }
+    // true if the Si1133 is built in, present, and light sampling is on
+    // and allowed by the operating profile.
+    bool isLightActive() const
+        {
+        return Sensors::Si1133::kEnabled && this->m_fSi1133 && this->getLightSampling() &&
+               this->getOperatingProfile().fLight;
+        }
+    // the same for the BME280.
+    bool isEnvActive() const
+        {
+        return Sensors::Bme280::kEnabled && this->m_fBme280 && this->getEnvSampling() &&
+               this->getOperatingProfile().fEnv;
+        }
     void updateLightMeasurements();
     void resetMeasurements();
 
+    // BME280 measurement
+    static cBme280::Settings getBme280Settings(std::uint8_t profile);
+    bool startBme280Conversion();
+    void finishBme280Measurement(bool fSuccess);
+
+    // compost (OneWire) measurement
+    bool refreshCompostProbes(bool fForceSearch);
+    void invalidateCompostProbes();
+    void powerUpCompostSensor();
+    bool isCompostSensorSettled() const;
+    bool startCompostConversion();
+    bool isCompostMeasurementReady();
+    std::uint32_t getCompostConversionRemaining();
+    void finishCompostMeasurement(bool fSuccess);
+    std::uint8_t getCompostTargetResolution(std::uint8_t iProbe) const;
+    void applyCompostResolution();
+    void updateCompostAutoResolution(std::uint8_t iProbe, float tempC);
+
     // telemetry handling.
     void fillTxBuffer(TxBuffer_t &b, Measurement const & mData);
-    void startTransmission(TxBuffer_t &b);
+    void fillDeltaTxBuffer(TxBuffer_t &b, Measurement const & mData);
+    static cPayloadEncoder::Values makeSampleValues(Measurement const &mData);
+    void startTransmission(TxBuffer_t *pFrame, std::uint8_t port);
+    bool isProvisioned();
+
+    // store and forward.
+    void flashPrepare();
+    void logMeasurement(Measurement const &mData);
+    void markLogSent(std::uint32_t slot);
+    bool startBackfill();
     void sendBufferDone(bool fSuccess);
+    void updateLinkQuality(bool fSuccess);
+    void releaseTxFrame()
+        {
+        this->m_TxFrames.release(this->m_pTxFrame);
+        this->m_pTxFrame = nullptr;
+        }
+
+    // retrying failed uplinks.
+    void queueRetry(std::uint32_t logSlot, std::uint8_t priority);
+    bool startRetry();
+    void finishRetry(bool fSuccess);
+    std::uint32_t getRetryWaitMs() const;
+    bool isRetryDue() const
+        {
+        return ! this->m_txpending && this->getRetryWaitMs() == 0 &&
+               ! Hal::isRadioBusyWithin(0);
+        }
+    static std::uint32_t getRetryBackoffMs(std::uint8_t nTries);
 
     bool txComplete()
         {
         return this->m_txcomplete;
         }
     void updateTxCycleTime();
+    std::uint32_t getPermanentCycleSec() const
+        {
+        if (this->m_BatchDepth > 1)
+            return this->applyOperatingProfile(this->m_BatchSampleSec);
+        else if (this->m_fReportPolicy)
+            return this->applyOperatingProfile(this->m_ReportPolicy.getConfig().sampleSec);
+        else if (this->m_CompostOversample > 1)
+            return this->applyOperatingProfile(getOversampleCycleSec());
+        else
+            return this->applyOperatingProfile(this->m_txCycleSec_Permanent);
+        }
+
+    // batching; only used after the fast uplinks are done.
+    bool isBatching() const
+        {
+        return this->m_BatchDepth > 1 && this->m_txCycleCount == 0;
+        }
+    static std::size_t getMaxAppPayload(std::uint8_t dr);
+    static std::size_t getMaxAppPayload();
+    static std::size_t encodeBatch(
+        cPayloadEncoder::Values const *pSamples,
+        std::uint8_t nSamples,
+        std::uint32_t sampleSec,
+        bool fHeldBack,
+        std::uint8_t *pBuffer,
+        std::size_t nBuffer
+        );
+    bool addBatchSample(Measurement const &mData, std::uint32_t logSlot);
+    bool sendUnbatched(TxBuffer_t &b, Measurement const &mData, std::size_t maxPayload);
+    void markBatchSent();
+    void finishBatchFrame();
+
+    // report on change; only used after the fast uplinks are done.
+    bool isReportPolicyActive() const
+        {
+        return this->m_fReportPolicy &&
+               this->m_txCycleCount == 0 &&
+               this->m_BatchDepth <= 1;
+        }
+    bool checkReportPolicy(Measurement const &mData);
+    void finishReport(bool fSuccess);
+
+    // compost oversampling; only used after the fast uplinks are done,
+    // and when neither batching nor the report policy is in use.
+    bool isOversampling() const
+        {
+        return this->m_CompostOversample > 1 &&
+               this->m_txCycleCount == 0 &&
+               this->m_BatchDepth <= 1 &&
+               ! this->m_fReportPolicy;
+        }
+    std::uint32_t getOversampleCycleSec() const
+        {
+        std::uint32_t const sec = this->m_txCycleSec_Permanent / this->m_CompostOversample;
+
+        return sec != 0 ? sec : 1;
+        }
+    bool startOversample();
+    void updateCompostStatsMeasurement();
 
     // timeout handling
 
@@ -273,8 +961,9 @@ private:
     // evaluate the control FSM.
     State fsmDispatch(State currentState, bool fEntry);
 
-    Adafruit_BME280                 m_BME280;
-    McciCatena::Catena_Si1133       m_si1133;
+#if CATENA4610_SENSOR_BME280
+    cBme280                         m_BME280;
+#endif
 
     // second SPI class
     SPIClass                        *m_pSPI2;
@@ -302,6 +991,8 @@ private:
     bool                            m_fTimerActive : 1;
     // set true if USB power is present.
     bool                            m_fUsbPower : 1;
+    // set true once Vbus has been sampled since boot or deep sleep.
+    bool                            m_fVbusSampled : 1;
     // set true if BME280 is present
     bool                            m_fBme280 : 1;
     // set true if SI1133 is present
@@ -317,6 +1008,25 @@ private:
     bool                            m_fPrintedSleeping : 1;
     // set true when SPI2 is active
     bool                            m_fSpi2Active: 1;
+    // set true to send format 0x17 instead of 0x15
+    bool                            m_fDeltaUplink: 1;
+    // set true while a format 0x17 message is being sent
+    bool                            m_fDeltaPending: 1;
+    // set true when the power level changes during a batch; the batch
+    // is sent with the next sample, and then the interval changes.
+    bool                            m_fBatchEnd: 1;
+    // set true to only send measurements when the report policy says so
+    bool                            m_fReportPolicy: 1;
+    // set true while a measurement chosen by the report policy is being sent
+    bool                            m_fReportPending: 1;
+    // set true to send the diagnostic extension field
+    bool                            m_fDiagUplink: 1;
+    // set true while taking an intermediate (compost only) sample
+    bool                            m_fIntermediateSample: 1;
+    // set true if the uplink being sent is confirmed
+    bool                            m_fTxConfirmed: 1;
+    // the last result of Hal::isProvisioned(), to trace changes
+    bool                            m_fProvisioned: 1;
 
     // uplink time control
     McciCatena::cTimer              m_UplinkTimer;
@@ -324,16 +1034,144 @@ private:
     std::uint32_t                   m_txCycleCount;
     std::uint32_t                   m_txCycleSec_Permanent;
 
+    // USB power detection
+    std::uint32_t                   m_tVbusSample;
+    std::uint32_t                   m_VbusSampleMs;
+
+    // power level, and the last Vbat reading it was based on
+    PowerLevel                      m_PowerLevel;
+    float                           m_VbatLast;
+
     // simple timer for timing-out sensors.
     std::uint32_t                   m_timer_start;
     std::uint32_t                   m_timer_delay;
 
+    // set true while a OneWire compost conversion is running.
+    bool                            m_fCompostPending : 1;
+    // set true while the OneWire probes are powered, and while the
+    // boost regulator is on for them.
+    bool                            m_fCompostPowered : 1;
+    bool                            m_fCompostBoost : 1;
+
+    // sensor tasks: a bit per task that's running, and its deadline.
+    std::uint8_t                    m_SensorTaskBusy;
+    std::uint32_t                   m_tSensorTaskStart[kNumSensorTasks];
+    std::uint32_t                   m_SensorTaskTimeoutMs[kNumSensorTasks];
+
+    // BME280 profile loaded into the sensor, or kBme280NumProfiles if
+    // none; and the conversion time for it.
+    std::uint8_t                    m_Bme280Configured;
+    std::uint32_t                   m_Bme280ConversionMs;
+
+    // when begin() finished with the I2C sensors
+    std::uint32_t                   m_tSensorBegin;
+
+    // compost sensor timing
+    std::uint32_t                   m_tCompostPowerOn;
+    // when the conversion started, in micros
+    std::uint32_t                   m_tCompostStart;
+    std::uint32_t                   m_CompostSettleMs;
+
+    // OneWire probe table, and how often to rebuild it.
+    CompostProbeCache               m_CompostProbes;
+    std::uint16_t                   m_CompostSearchInterval;
+    CompostAutoResolution           m_CompostAuto[kMaxCompostProbes];
+
+    // settings kept in FRAM
+    cAppConfig                      m_AppConfig;
+
     // the current measurement
     Measurement                     m_data;
 
-    TxBuffer_t                      m_FileTxBuffer;
+    // uplink frames, the one being sent, and a batch waiting to be sent
+    TxFramePool_t                   m_TxFrames;
+    TxBuffer_t                      *m_pTxFrame;
+    TxBuffer_t                      *m_pBatchFrame;
+
+    // failed uplinks, and the entry being retried
+    RetryQueue_t                    m_RetryQueue;
+    RetryQueue_t::Entry             *m_pRetry;
+
+    // store and forward
+    cFlashLog                       *m_pFlashLog;
+    // log slot of the measurement being sent live, or cFlashLog::kNoSlot
+    std::uint32_t                   m_LogSlot;
+    // log slot of the record being backfilled
+    std::uint32_t                   m_BackfillSlot;
+    // records backfilled this cycle
+    std::uint8_t                    m_nBackfill;
+
+    // batching
+
+    // samples waiting to be sent, oldest first, and their log slots
+    cPayloadEncoder::Values         m_Batch[MeasurementFormat::kMaxBatchSamples];
+    std::uint32_t                   m_BatchLogSlot[MeasurementFormat::kMaxBatchSamples];
+    // number of samples in m_Batch
+    std::uint8_t                    m_nBatch;
+    // number of samples in the frame being sent; 0 if not sending a batch
+    std::uint8_t                    m_nBatchInFrame;
+    // samples per uplink; 0 or 1 to disable
+    std::uint8_t                    m_BatchDepth;
+    // sampling interval when batching
+    std::uint32_t                   m_BatchSampleSec;
+    // the interval the samples in m_Batch were actually taken at, after
+    // the operating profile is applied
+    std::uint32_t                   m_BatchIntervalSec;
+
+    // delta encoding
+    cDeltaEncoder                   m_DeltaEncoder;
+
+    // report on change
+    cReportPolicy                   m_ReportPolicy;
+
+    // link quality and confirmed uplinks
+    cLinkPolicy                     m_LinkPolicy;
+
+    // compost oversampling: samples per uplink interval, samples taken
+    // so far in this interval, and their summary.
+    std::uint8_t                    m_CompostOversample;
+    std::uint8_t                    m_nOversample;
+    cRunningStats                   m_CompostStats;
+
+    // profiling
+    cStateProfiler                  m_Profiler;
+    cEventTrace                     m_EventTrace;
+    std::uint32_t                   m_tSi1133Start;
     };
 
+// format byte, bitmap, Vbat, Vbus, boot count, the sensor fields, and the
+// extension fields: bitmap, probe count and probes, diagnostics, and
+// compost summary.
+static_assert(
+    2 + 2 + 2 + 1 + Sensors::Registry::getUplinkBytes() +
+        1 + 1 + 2 * (cMeasurementFormat::kMaxCompostProbes - 1) + 6 + 9
+        <= cMeasurementFormat::kTxBufferSize,
+    "kTxBufferSize is too small for the sensors in this build"
+    );
+
+static_assert(
+    cMeasurementFormat::kTxBufferSize + cMeasurementLoop::kBackfillHeaderSize <=
+        cMeasurementFormat::kBatchTxBufferSize,
+    "uplink frames are too small for a backfill message"
+    );
+
+static_assert(
+    Sensors::Bme280::kField == std::uint8_t(McciCatena::FlagsSensor3::FlagTPH) &&
+    Sensors::Si1133::kField == std::uint8_t(McciCatena::FlagsSensor3::FlagLux) &&
+    Sensors::Compost::kField == std::uint8_t(McciCatena::FlagsSensor3::FlagWater),
+    "the sensor registry and format 0x15 disagree on the field bits"
+    );
+
+static_assert(
+    cAppConfig::kMaxCompostProbes == cMeasurementFormat::kMaxCompostProbes,
+    "cAppConfig and cMeasurementFormat disagree on the number of probes"
+    );
+
+static_assert(
+    sizeof(cMeasurementLoop::LogRecord) <= cFlashLog::kMaxPayload,
+    "LogRecord doesn't fit in a flash log slot"
+    );
+
 //
 // operator overloads for ORing structured flags
 //
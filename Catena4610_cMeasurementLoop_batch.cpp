@@ -0,0 +1,419 @@
+/*
+
+Module: Catena4610_cMeasurementLoop_batch.cpp
+
+Function:
+    Batching of several samples into one uplink (format 0x16).
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_cPayloadEncoder.h"
+#include "Catena4610_hal.h"
+
+using namespace McciCatena4610;
+using namespace McciCatena;
+
+/****************************************************************************\
+|
+|   Configuration
+|
+\****************************************************************************/
+
+void
+cMeasurementLoop::setBatching(
+    std::uint32_t sampleSec,
+    std::uint8_t depth
+    )
+    {
+    if (depth > MeasurementFormat::kMaxBatchSamples)
+        depth = MeasurementFormat::kMaxBatchSamples;
+    if (sampleSec == 0)
+        sampleSec = 1;
+
+    this->m_BatchSampleSec = sampleSec;
+    this->m_BatchDepth = depth;
+
+    auto &config = this->m_AppConfig.edit();
+
+    config.BatchSampleSec = sampleSec;
+    config.BatchDepth = depth;
+    this->saveAppConfig();
+
+    // forget unsent samples unless they're on their way; they're
+    // still in the flash log.
+    if (this->m_nBatchInFrame == 0)
+        this->m_nBatch = 0;
+    this->m_fBatchEnd = false;
+
+    // if the fast uplinks are done, switch the timer now.
+    if (this->m_txCycleCount == 0)
+        this->setTxCycleTime(this->getPermanentCycleSec(), 0);
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::getMaxAppPayload()
+
+Function:
+    Return the largest application payload allowed at a data rate.
+
+Definition:
+    static std::size_t McciCatena4610::cMeasurementLoop::getMaxAppPayload(
+            std::uint8_t dr
+            );
+
+    static std::size_t McciCatena4610::cMeasurementLoop::getMaxAppPayload(
+            void
+            );
+
+Description:
+    The values come from the LoRaWAN regional parameters for the
+    configured region, assuming no dwell-time limit and no repeater.
+    Data rates outside the table get the smallest payload. The second
+    form uses the current data rate.
+
+Returns:
+    Maximum number of bytes in the application payload.
+
+*/
+
+std::size_t
+cMeasurementLoop::getMaxAppPayload(
+    std::uint8_t dr
+    )
+    {
+#if defined(CFG_us915)
+    static const std::uint8_t kMaxPayload[] = { 11, 53, 125, 242, 242 };
+#elif defined(CFG_au915)
+    static const std::uint8_t kMaxPayload[] = { 51, 51, 51, 115, 222, 222, 222 };
+#else // EU868 and the plans derived from it
+    static const std::uint8_t kMaxPayload[] = { 51, 51, 51, 115, 222, 222, 222, 222 };
+#endif
+
+    if (dr < sizeof(kMaxPayload))
+        return kMaxPayload[dr];
+    else
+        return kMaxPayload[0];
+    }
+
+std::size_t
+cMeasurementLoop::getMaxAppPayload(
+    void
+    )
+    {
+    return getMaxAppPayload(Hal::getDataRate());
+    }
+
+/****************************************************************************\
+|
+|   Encoding
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::encodeBatch()
+
+Function:
+    Encode samples as a format 0x16 message.
+
+Definition:
+    static std::size_t McciCatena4610::cMeasurementLoop::encodeBatch(
+            cPayloadEncoder::Values const *pSamples,
+            std::uint8_t nSamples,
+            std::uint32_t sampleSec,
+            bool fHeldBack,
+            std::uint8_t *pBuffer,
+            std::size_t nBuffer
+            );
+
+Description:
+    The message is the format byte, the number of samples, the sampling
+    interval in seconds (uint16), and then the samples, oldest first.
+    fHeldBack is set if a newer sample was taken but held back for the
+    next message, so that the newest sample sent is one interval old;
+    it is sent in bit 7 of the count, so that receivers get the ages
+    right.
+    Each sample starts with its own bitmap, as in format 0x15. The first
+    sample's fields are then sent exactly as in format 0x15. Each later
+    sample sends every component of its fields as a zig-zag varint of
+    the difference from the last value sent for that component (see
+    cPayloadEncoder).
+
+    pBuffer may be nullptr, to find out how big the message would be.
+
+Returns:
+    The size of the message, which may be larger than nBuffer.
+
+*/
+
+std::size_t
+cMeasurementLoop::encodeBatch(
+    cPayloadEncoder::Values const *pSamples,
+    std::uint8_t nSamples,
+    std::uint32_t sampleSec,
+    bool fHeldBack,
+    std::uint8_t *pBuffer,
+    std::size_t nBuffer
+    )
+    {
+    cPayloadWriter w(pBuffer, nBuffer);
+    cPayloadEncoder::Values last {};
+
+    w.put(MeasurementFormat::kBatchMessageFormat);
+    w.put(
+        (nSamples & MeasurementFormat::kBatchCountMask) |
+        (fHeldBack ? MeasurementFormat::kBatchHeldBack : 0)
+        );
+    w.put2(sampleSec < 0xFFFF ? sampleSec : 0xFFFF);
+
+    for (std::uint8_t iSample = 0; iSample < nSamples; ++iSample)
+        {
+        auto const &s = pSamples[iSample];
+
+        cPayloadEncoder::encodeFields(w, s, iSample == 0 ? nullptr : &last);
+        cPayloadEncoder::updateReference(last, s);
+        }
+
+    return w.getn();
+    }
+
+/****************************************************************************\
+|
+|   Batch management
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::addBatchSample()
+
+Function:
+    Add a measurement to the batch, and decide whether to send.
+
+Definition:
+    bool McciCatena4610::cMeasurementLoop::addBatchSample(
+            Measurement const &mData,
+            std::uint32_t logSlot
+            );
+
+Description:
+    The batch is sent when it holds m_BatchDepth samples, or when
+    adding the new sample would make the message too big for the
+    current data rate. In the second case the new sample is held back
+    to start the next batch, and the message says so, because its
+    newest sample is then one interval old.
+
+    The message carries the interval the samples were actually taken
+    at, m_BatchIntervalSec, which includes the operating profile. If
+    the power level changed since the last sample (m_fBatchEnd), the
+    batch is also sent now, and the uplink timer is then switched to
+    the new interval, so a batch never mixes two intervals.
+
+    If the message is too big for the current data rate (it may have
+    dropped since the batch was started), it carries only as many of
+    the oldest samples as fit; the rest start the next batch. If not
+    even one sample fits, the batch is not sent: see sendUnbatched().
+
+    If a message is to be sent, it is encoded into a frame from the
+    pool, m_pBatchFrame, and m_nBatchInFrame is set to the number of
+    samples in it.
+
+Returns:
+    true if a batch is ready to send.
+
+*/
+
+bool
+cMeasurementLoop::addBatchSample(
+    Measurement const &mData,
+    std::uint32_t logSlot
+    )
+    {
+    // this only happens if a batch send is still outstanding.
+    if (this->m_nBatch >= MeasurementFormat::kMaxBatchSamples)
+        return false;
+
+    if (this->m_nBatch == 0)
+        this->m_BatchIntervalSec = this->getTxCycleTime();
+
+    this->m_Batch[this->m_nBatch] = makeSampleValues(mData);
+    this->m_BatchLogSlot[this->m_nBatch] = logSlot;
+    ++this->m_nBatch;
+
+    std::uint32_t const intervalSec = this->m_BatchIntervalSec;
+    bool const fEnd = this->m_fBatchEnd;
+
+    if (fEnd)
+        {
+        // this sample was taken at the old interval; later ones won't be.
+        this->m_fBatchEnd = false;
+        this->setTxCycleTime(this->getPermanentCycleSec(), 0);
+        this->m_BatchIntervalSec = this->getTxCycleTime();
+        }
+
+    std::size_t const maxPayload = getMaxAppPayload();
+    std::uint8_t nFrame = this->m_nBatch;
+
+    if (encodeBatch(this->m_Batch, nFrame, intervalSec, false, nullptr, 0) > maxPayload)
+        {
+        // the data rate may have dropped since the last batch; send as
+        // many samples as fit now.
+        do
+            --nFrame;
+        while (nFrame > 0 &&
+               encodeBatch(this->m_Batch, nFrame, intervalSec, true, nullptr, 0) > maxPayload);
+        }
+    else if (nFrame < this->m_BatchDepth && ! fEnd)
+        return false;
+
+    auto const pFrame = this->m_TxFrames.acquire();
+
+    if (pFrame == nullptr)
+        {
+        // try again with the next sample.
+        if (this->isTraceEnabled(DebugFlags::kError))
+            Hal::safePrintf("no free uplink frame\n");
+        return false;
+        }
+
+    if (nFrame == 0)
+        return this->sendUnbatched(*pFrame, mData, maxPayload);
+
+    std::uint8_t frame[MeasurementFormat::kBatchTxBufferSize];
+    std::size_t const nBytes = encodeBatch(
+                                    this->m_Batch, nFrame, intervalSec,
+                                    nFrame < this->m_nBatch,
+                                    frame, sizeof(frame)
+                                    );
+
+    if (nBytes > sizeof(frame))
+        {
+        // can't happen, since maxPayload is no bigger than the frame;
+        // but never send a truncated message.
+        if (this->isTraceEnabled(DebugFlags::kError))
+            Hal::safePrintf("batch: %u bytes don't fit the frame\n", unsigned(nBytes));
+        this->m_TxFrames.release(pFrame);
+        return false;
+        }
+
+    for (std::size_t i = 0; i < nBytes; ++i)
+        pFrame->put(frame[i]);
+
+    this->m_pBatchFrame = pFrame;
+
+    this->m_nBatchInFrame = nFrame;
+
+    if (this->isTraceEnabled(DebugFlags::kTrace))
+        Hal::safePrintf(
+            "batch: %u samples every %u s, %u bytes (max %u)\n",
+            nFrame,
+            unsigned(intervalSec),
+            unsigned(nBytes),
+            unsigned(maxPayload)
+            );
+
+    return true;
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::sendUnbatched()
+
+Function:
+    Send the newest measurement on its own, when not even one batched
+    sample fits the data rate.
+
+Definition:
+    bool McciCatena4610::cMeasurementLoop::sendUnbatched(
+            TxBuffer_t &b,
+            Measurement const &mData,
+            std::size_t maxPayload
+            );
+
+Description:
+    mData is encoded into b as a format 0x15 message, which is set up
+    as m_pBatchFrame with no batched samples, so stTransmit sends it
+    and marks m_LogSlot like any single measurement. The samples
+    collected before it are dropped from the batch; they're still in
+    the flash log, if there is one, and will be backfilled.
+
+    If the 0x15 message doesn't fit either, b is released and nothing
+    is sent.
+
+Returns:
+    true if a message is ready to send.
+
+*/
+
+bool
+cMeasurementLoop::sendUnbatched(
+    TxBuffer_t &b,
+    Measurement const &mData,
+    std::size_t maxPayload
+    )
+    {
+    std::uint8_t const nDropped = this->m_nBatch - 1;
+
+    this->m_nBatch = 0;
+    this->m_nBatchInFrame = 0;
+
+    if (nDropped != 0 && this->m_pFlashLog == nullptr &&
+        this->isTraceEnabled(DebugFlags::kWarning))
+        Hal::safePrintf("batch: dropped %u samples, too big for the data rate\n", nDropped);
+
+    this->fillTxBuffer(b, mData);
+
+    if (b.getn() > maxPayload)
+        {
+        if (this->isTraceEnabled(DebugFlags::kError))
+            Hal::safePrintf(
+                "batch: a %u-byte measurement doesn't fit the data rate (max %u)\n",
+                unsigned(b.getn()),
+                unsigned(maxPayload)
+                );
+        this->m_TxFrames.release(&b);
+        return false;
+        }
+
+    this->m_pBatchFrame = &b;
+    return true;
+    }
+
+// mark all the samples of the current batch frame as sent.
+void
+cMeasurementLoop::markBatchSent(
+    void
+    )
+    {
+    for (std::uint8_t i = 0; i < this->m_nBatchInFrame; ++i)
+        this->markLogSent(this->m_BatchLogSlot[i]);
+    }
+
+// drop the samples of the current batch frame.
+void
+cMeasurementLoop::finishBatchFrame(
+    void
+    )
+    {
+    std::uint8_t const nFrame = this->m_nBatchInFrame;
+
+    if (nFrame == 0)
+        return;
+
+    for (std::uint8_t i = nFrame; i < this->m_nBatch; ++i)
+        {
+        this->m_Batch[i - nFrame] = this->m_Batch[i];
+        this->m_BatchLogSlot[i - nFrame] = this->m_BatchLogSlot[i];
+        }
+
+    this->m_nBatch -= nFrame;
+    this->m_nBatchInFrame = 0;
+    }
@@ -0,0 +1,386 @@
+/*
+
+Module: Catena4610_cMeasurementLoop_bench.cpp
+
+Function:
+    Payload encode/decode benchmark.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_cPayloadDecoder.h"
+#include "Catena4610_hal.h"
+
+#include <cstring>
+
+using namespace McciCatena4610;
+using namespace McciCatena;
+
+/****************************************************************************\
+|
+|   Test vectors
+|
+\****************************************************************************/
+
+namespace {
+
+// the test vectors of extra/thermosense-data-format.md. Field 6 isn't
+// used by this application, so the format 0x15 vector drops it.
+const std::uint8_t kUplinkVector[] =
+    {
+    0x15, 0x3F, 0x43, 0x72, 0x44, 0x60, 0x07, 0x17, 0xA4, 0x5F, 0xCB, 0xA7,
+    0x01, 0xDB, 0x1C, 0x01
+    };
+
+const std::uint8_t kBatchVector[] =
+    {
+    0x16, 0x02, 0x03, 0x84, 0x29, 0x44, 0x60, 0x15, 0x9D, 0x5F, 0xCD, 0xC3,
+    0x1C, 0x11, 0x29, 0x07, 0x0E, 0x09, 0x00, 0x1E
+    };
+
+const std::uint8_t kKeyframeVector[] =
+    {
+    0x17, 0x80, 0x29, 0x44, 0x60, 0x15, 0x9D, 0x5F, 0xCD, 0xC3, 0x1C, 0x11
+    };
+
+const std::uint8_t kDeltaVector[] =
+    {
+    0x17, 0x01, 0x00, 0x29, 0x07, 0x0E, 0x09, 0x00, 0x1E
+    };
+
+constexpr std::uint32_t kBatchVectorSec = 900;
+
+// the vectors have the fields of every sensor. A build that leaves some
+// out (see Catena4610_SensorRegistry.h) encodes the same measurements
+// without them, so it only checks that the encoders and decoders run.
+constexpr bool kCheckVectors =
+    Sensors::Registry::getFieldMask() ==
+        (Sensors::Bme280::kField | Sensors::Si1133::kField | Sensors::Compost::kField);
+
+using Measurement = cMeasurementLoop::Measurement;
+using Flags = cMeasurementLoop::Flags;
+
+// the measurement behind kUplinkVector.
+Measurement makeUplinkMeasurement()
+    {
+    Measurement m {};
+
+    m.flags = Flags(std::uint8_t(Flags::FlagVbat) | std::uint8_t(Flags::FlagVcc) |
+                    std::uint8_t(Flags::FlagBoot) | std::uint8_t(Flags::FlagTPH) |
+                    std::uint8_t(Flags::FlagLux) | std::uint8_t(Flags::FlagWater));
+    m.Vbat = 4.21533203125f;
+    m.Vbus = 4.2734375f;
+    m.BootCount = 7;
+    m.env.Temperature = 23.640625f;
+    m.env.Pressure = 98092.0f;
+    m.env.Humidity = 65.234375f;
+    m.light.White = 475.0f;
+    m.compost.nProbes = 1;
+    m.compost.TempC[0] = 28.00390625f;
+    return m;
+    }
+
+// the same, with every extension field: four probes, diagnostics and
+// a compost summary. This is the largest format 0x15 message.
+Measurement makeExtendedMeasurement()
+    {
+    Measurement m = makeUplinkMeasurement();
+
+    m.flags = Flags(std::uint8_t(m.flags) | std::uint8_t(cMeasurementFormat::FlagExtended));
+    m.extFlags = cMeasurementFormat::kExtCompostProbes |
+                 cMeasurementFormat::kExtDiagnostics |
+                 cMeasurementFormat::kExtCompostStats;
+    m.compost.nProbes = 4;
+    m.compost.TempC[1] = 27.5f;
+    m.compost.TempC[2] = 26.25f;
+    m.compost.TempC[3] = 25.0f;
+    m.diag = Measurement::Diag { 3000, 4000, 2000 };
+    m.compostStats = Measurement::CompostStats { 5, 27.9375f, 28.5f, 28.125f, 0.21875f };
+    return m;
+    }
+
+// the two samples behind kBatchVector and the format 0x17 vectors.
+Measurement makeSample(unsigned i)
+    {
+    Measurement m {};
+
+    m.flags = Flags(std::uint8_t(Flags::FlagVbat) | std::uint8_t(Flags::FlagTPH) |
+                    std::uint8_t(Flags::FlagWater));
+    m.Vbat = i == 0 ? 4.2734375f : 4.2724609375f;
+    m.env.Temperature = i == 0 ? 21.61328125f : 21.640625f;
+    m.env.Pressure = i == 0 ? 98100.0f : 98080.0f;
+    m.env.Humidity = 76.171875f;
+    m.compost.nProbes = 1;
+    m.compost.TempC[0] = i == 0 ? 28.06640625f : 28.125f;
+    return m;
+    }
+
+bool isSame(
+    const std::uint8_t *pData,
+    std::size_t nData,
+    const std::uint8_t *pExpected,
+    std::size_t nExpected
+    )
+    {
+    return nData == nExpected && std::memcmp(pData, pExpected, nData) == 0;
+    }
+
+bool isSame(
+    cPayloadEncoder::Values const &a,
+    cPayloadEncoder::Values const &b
+    )
+    {
+    if ((a.flags & cPayloadEncoder::kFieldMask) != (b.flags & cPayloadEncoder::kFieldMask))
+        return false;
+
+    for (unsigned iComp = 0; iComp < cPayloadEncoder::kNumComp; ++iComp)
+        {
+        if ((a.flags & cPayloadEncoder::getField(iComp)) != 0 && a.v[iComp] != b.v[iComp])
+            return false;
+        }
+    return true;
+    }
+
+} // namespace
+
+/****************************************************************************\
+|
+|   The benchmark
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::runPayloadBenchmark()
+
+Function:
+    Time the payload encoders and decoders.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::runPayloadBenchmark(
+            BenchResult (&results)[kNumBenchCases],
+            std::uint32_t nIterations
+            );
+
+Description:
+    Each case is run nIterations times back to back, timed with
+    Hal::micros() and Hal::getCycleCount(); in the host build, only the
+    cycle count is real (see host/benchPayload.cpp). The encoders are
+    the ones used for uplinks, run on the test vectors of
+    extra/thermosense-data-format.md; in a build with every sensor,
+    each case checks its first output against the vector, so a change
+    in frame size or contents shows up as well as a change in cost. The decoders
+    are cPayloadDecoder, the C++ counterpart of the JavaScript
+    decoders.
+
+    fillTxBuffer() console output is turned off while the benchmark
+    runs, so that the time is spent encoding and not printing. The
+    measurement loop is not polled, so don't run this while an uplink
+    is due.
+
+Returns:
+    No explicit result.
+
+*/
+
+void
+cMeasurementLoop::runPayloadBenchmark(
+    BenchResult (&results)[kNumBenchCases],
+    std::uint32_t nIterations
+    )
+    {
+    auto const savedFlags = this->m_DebugFlags;
+    Measurement const mUplink = makeUplinkMeasurement();
+    Measurement const mExtended = makeExtendedMeasurement();
+    cPayloadEncoder::Values const samples[2] =
+        {
+        makeSampleValues(makeSample(0)),
+        makeSampleValues(makeSample(1))
+        };
+    cPayloadEncoder::Values maxBatch[MeasurementFormat::kMaxBatchSamples];
+    TxBuffer_t frame;
+    std::uint8_t buffer[MeasurementFormat::kBatchTxBufferSize];
+    std::uint8_t iCase = 0;
+
+    if (nIterations == 0)
+        nIterations = 1;
+
+    for (std::uint8_t i = 0; i < MeasurementFormat::kMaxBatchSamples; ++i)
+        maxBatch[i] = samples[i & 1];
+
+    this->m_DebugFlags = DebugFlags(this->m_DebugFlags & ~kTrace);
+
+    // run body nIterations times; fOk is set from the first run.
+    auto const run =
+        [&](const char *pName, auto body)
+            {
+            auto &r = results[iCase++];
+            std::uint32_t const tStart = Hal::micros();
+            std::uint32_t const cStart = Hal::getCycleCount();
+
+            r.pName = pName;
+            r.fOk = true;
+            for (std::uint32_t i = 0; i < nIterations; ++i)
+                body(r, i == 0);
+            r.totalCycles = Hal::getCycleCount() - cStart;
+            r.totalUs = Hal::micros() - tStart;
+            };
+
+    run("enc_0x15",
+        [&](BenchResult &r, bool fFirst)
+            {
+            frame.begin();
+            this->fillTxBuffer(frame, mUplink);
+            if (fFirst)
+                {
+                r.nBytes = frame.getn();
+                r.fOk = ! kCheckVectors || isSame(frame.getbase(), frame.getn(), kUplinkVector, sizeof(kUplinkVector));
+                }
+            });
+
+    run("enc_0x15_ext",
+        [&](BenchResult &r, bool fFirst)
+            {
+            frame.begin();
+            this->fillTxBuffer(frame, mExtended);
+            if (fFirst)
+                {
+                r.nBytes = frame.getn();
+                r.fOk = frame.getn() <= MeasurementFormat::kTxBufferSize;
+                }
+            });
+
+    cDeltaEncoder keyEncoder;
+
+    keyEncoder.setKeyframeInterval(1);
+    run("enc_0x17_key",
+        [&](BenchResult &r, bool fFirst)
+            {
+            std::size_t const n = keyEncoder.encode(
+                                    makeSampleValues(makeSample(0)),
+                                    buffer, sizeof(buffer)
+                                    );
+            if (fFirst)
+                {
+                r.nBytes = n;
+                r.fOk = ! kCheckVectors || isSame(buffer, n, kKeyframeVector, sizeof(kKeyframeVector));
+                }
+            });
+
+    cDeltaEncoder deltaEncoder;
+
+    deltaEncoder.setKeyframeInterval(0);
+    deltaEncoder.encode(samples[0], buffer, sizeof(buffer));
+    deltaEncoder.acknowledge(true);
+    run("enc_0x17_delta",
+        [&](BenchResult &r, bool fFirst)
+            {
+            std::size_t const n = deltaEncoder.encode(
+                                    makeSampleValues(makeSample(1)),
+                                    buffer, sizeof(buffer)
+                                    );
+            deltaEncoder.acknowledge(false);
+            if (fFirst)
+                {
+                r.nBytes = n;
+                r.fOk = ! kCheckVectors || isSame(buffer, n, kDeltaVector, sizeof(kDeltaVector));
+                }
+            });
+
+    run("enc_0x16",
+        [&](BenchResult &r, bool fFirst)
+            {
+            std::size_t const n = encodeBatch(samples, 2, kBatchVectorSec, false, buffer, sizeof(buffer));
+
+            if (fFirst)
+                {
+                r.nBytes = n;
+                r.fOk = ! kCheckVectors || isSame(buffer, n, kBatchVector, sizeof(kBatchVector));
+                }
+            });
+
+    run("enc_0x16_max",
+        [&](BenchResult &r, bool fFirst)
+            {
+            std::size_t const n = encodeBatch(
+                                    maxBatch, MeasurementFormat::kMaxBatchSamples,
+                                    kBatchVectorSec, false, buffer, sizeof(buffer)
+                                    );
+            if (fFirst)
+                {
+                r.nBytes = n;
+                r.fOk = n <= sizeof(buffer);
+                }
+            });
+
+    run("dec_0x15",
+        [&](BenchResult &r, bool fFirst)
+            {
+            cPayloadEncoder::Values v;
+            auto const status = cPayloadDecoder::decodeUplink(
+                                    kUplinkVector, sizeof(kUplinkVector), v
+                                    );
+            if (fFirst)
+                {
+                r.nBytes = sizeof(kUplinkVector);
+                r.fOk = status == cPayloadDecoder::Status::kOk &&
+                        (! kCheckVectors || isSame(v, makeSampleValues(mUplink)));
+                }
+            });
+
+    run("dec_0x16",
+        [&](BenchResult &r, bool fFirst)
+            {
+            cPayloadEncoder::Values v[2];
+            std::uint8_t nSamples;
+            std::uint16_t intervalSec;
+            bool fHeldBack;
+            auto const status = cPayloadDecoder::decodeBatch(
+                                    kBatchVector, sizeof(kBatchVector),
+                                    v, 2, nSamples, intervalSec, fHeldBack
+                                    );
+            if (fFirst)
+                {
+                r.nBytes = sizeof(kBatchVector);
+                r.fOk = status == cPayloadDecoder::Status::kOk &&
+                        nSamples == 2 && intervalSec == kBatchVectorSec && ! fHeldBack &&
+                        (! kCheckVectors ||
+                            (isSame(v[0], samples[0]) && isSame(v[1], samples[1])));
+                }
+            });
+
+    // a keyframe and the delta that refers to it.
+    cPayloadDecoder decoder;
+
+    run("dec_0x17_pair",
+        [&](BenchResult &r, bool fFirst)
+            {
+            cPayloadEncoder::Values v[2];
+            std::uint8_t seq;
+            bool fKeyframe;
+
+            decoder.reset();
+            auto const s0 = decoder.decodeDelta(
+                                kKeyframeVector, sizeof(kKeyframeVector), v[0], seq, fKeyframe
+                                );
+            auto const s1 = decoder.decodeDelta(
+                                kDeltaVector, sizeof(kDeltaVector), v[1], seq, fKeyframe
+                                );
+            if (fFirst)
+                {
+                r.nBytes = sizeof(kKeyframeVector) + sizeof(kDeltaVector);
+                r.fOk = s0 == cPayloadDecoder::Status::kOk &&
+                        s1 == cPayloadDecoder::Status::kOk &&
+                        (! kCheckVectors ||
+                            (isSame(v[0], samples[0]) && isSame(v[1], samples[1])));
+                }
+            });
+
+    this->m_DebugFlags = savedFlags;
+    }
@@ -0,0 +1,207 @@
+/*
+
+Module: Catena4610_cMeasurementLoop_bme280.cpp
+
+Function:
+    BME280 measurement profiles for the measurement loop.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_hal.h"
+
+using namespace McciCatena4610;
+using namespace McciCatena;
+
+/****************************************************************************\
+|
+|   Profiles
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::getBme280Settings()
+
+Function:
+    Return the oversampling and filter settings for a profile.
+
+Definition:
+    static cBme280::Settings
+    McciCatena4610::cMeasurementLoop::getBme280Settings(
+            std::uint8_t profile
+            );
+
+Description:
+    The profiles follow the BME280 datasheet recommendations (section
+    3.5). Low power is the "weather monitoring" setting: one sample of
+    each, no filter, about 9 ms of conversion. Standard oversamples
+    pressure by 4, about 17 ms. High resolution oversamples temperature
+    and humidity by 2 and pressure by 16, with a light IIR filter to
+    take out door slams and gusts, about 49 ms.
+
+    The automatic profile is resolved by getBme280ActiveProfile() before
+    it gets here; if it doesn't, it's treated as low power.
+
+Returns:
+    The settings.
+
+*/
+
+cBme280::Settings
+cMeasurementLoop::getBme280Settings(
+    std::uint8_t profile
+    )
+    {
+    using O = cBme280::Oversampling;
+    using F = cBme280::Filter;
+
+    switch (profile)
+        {
+    case cAppConfig::kBme280Standard:
+        return cBme280::Settings { O::kX1, O::kX4, O::kX1, F::kOff };
+
+    case cAppConfig::kBme280HighRes:
+        return cBme280::Settings { O::kX2, O::kX16, O::kX2, F::kX4 };
+
+    case cAppConfig::kBme280LowPower:
+    default:
+        return cBme280::Settings { O::kX1, O::kX1, O::kX1, F::kOff };
+        }
+    }
+
+// the profile to use for the next conversion.
+std::uint8_t
+cMeasurementLoop::getBme280ActiveProfile(
+    void
+    ) const
+    {
+    std::uint8_t const profile = this->m_AppConfig.get().Bme280;
+
+    if (profile != cAppConfig::kBme280Auto)
+        return profile;
+    else if (this->m_fUsbPower)
+        return cAppConfig::kBme280HighRes;
+    else
+        return cAppConfig::kBme280LowPower;
+    }
+
+bool
+cMeasurementLoop::setBme280Profile(
+    std::uint8_t profile
+    )
+    {
+    if (profile >= cAppConfig::kBme280NumProfiles)
+        return false;
+
+    this->m_AppConfig.edit().Bme280 = profile;
+    this->saveAppConfig();
+
+    return true;
+    }
+
+/****************************************************************************\
+|
+|   Measurement
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::startBme280Conversion()
+
+Function:
+    Start a forced-mode BME280 conversion with the active profile.
+
+Definition:
+    bool McciCatena4610::cMeasurementLoop::startBme280Conversion(
+            void
+            );
+
+Description:
+    The oversampling and filter registers are only written when the
+    active profile changes, which for the automatic profile is when USB
+    power comes or goes. m_Bme280ConversionMs is set to the datasheet
+    maximum conversion time for the profile; the sensor isn't polled
+    before then.
+
+Returns:
+    true if the conversion was started.
+
+*/
+
+bool
+cMeasurementLoop::startBme280Conversion(
+    void
+    )
+    {
+#if CATENA4610_SENSOR_BME280
+    std::uint8_t const profile = this->getBme280ActiveProfile();
+
+    if (profile != this->m_Bme280Configured)
+        {
+        if (! this->m_BME280.configure(getBme280Settings(profile)))
+            return false;
+
+        this->m_Bme280Configured = profile;
+        this->m_Bme280ConversionMs = getBme280ConversionMs(profile);
+
+        if (this->isTraceEnabled(DebugFlags::kTrace))
+            Hal::safePrintf(
+                "BME280: %s profile, %u ms\n",
+                cAppConfig::getBme280ProfileName(profile),
+                unsigned(this->m_Bme280ConversionMs)
+                );
+        }
+
+    return this->m_BME280.startForced();
+#else
+    return false;
+#endif
+    }
+
+void
+cMeasurementLoop::finishBme280Measurement(
+    bool fSuccess
+    )
+    {
+    cBme280::Measurements m;
+
+#if CATENA4610_SENSOR_BME280
+    fSuccess = fSuccess && this->m_BME280.read(m);
+#else
+    fSuccess = false;
+#endif
+
+    if (fSuccess)
+        {
+        this->m_data.env.Temperature = m.Temperature;
+        this->m_data.env.Pressure = m.Pressure;
+        this->m_data.env.Humidity = m.Humidity;
+        this->m_data.flags |= Flags::FlagTPH;
+
+        auto const t = Hal::millis();
+        this->m_EventTrace.recordValue(t, cEventTrace::Value::kTemperature, m.Temperature);
+        this->m_EventTrace.recordValue(t, cEventTrace::Value::kPressure, m.Pressure);
+        this->m_EventTrace.recordValue(t, cEventTrace::Value::kHumidity, m.Humidity);
+        }
+    else
+        {
+        // reprogram the sensor next time, in case it was reset.
+        this->m_Bme280Configured = cAppConfig::kBme280NumProfiles;
+        if (this->isTraceEnabled(DebugFlags::kError))
+            Hal::safePrintf("BME280 read failed\n");
+        }
+
+    // from the start of the conversion to the end of the read.
+    this->m_Profiler.addSensor(
+        kProfileBme280,
+        (Hal::millis() - this->m_tSensorTaskStart[kTaskEnv]) * 1000
+        );
+    }
@@ -0,0 +1,620 @@
+/*
+
+Module: Catena4610_cMeasurementLoop_compost.cpp
+
+Function:
+    Asynchronous measurement of the OneWire compost temperature probe.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_hal.h"
+
+#include <cmath>
+
+using namespace McciCatena4610;
+using namespace McciCatena;
+
+/****************************************************************************\
+|
+|   Probe discovery
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::checkCompostSensorPresent()
+
+Function:
+    Power up the OneWire bus and enumerate the probes on it.
+
+Definition:
+    bool McciCatena4610::cMeasurementLoop::checkCompostSensorPresent(
+            void
+            );
+
+Description:
+    This is used at startup; it always does a full bus search, and
+    refills the probe cache.
+
+Returns:
+    true if at least one probe is attached.
+
+*/
+
+bool
+cMeasurementLoop::checkCompostSensorPresent(
+    void
+    )
+    {
+    /* set D11 high so V_OUT2 is going to be high for onewire sensor */
+    Hal::pinMode(Hal::kPinVout2, Hal::kPinModeOutput);
+    Hal::digitalWrite(Hal::kPinVout2, Hal::kPinHigh);
+
+    Hal::delay(kCompostPowerSettleMs);
+
+    return this->refreshCompostProbes(true);
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::refreshCompostProbes()
+
+Function:
+    Bring the cached OneWire probe table up to date.
+
+Definition:
+    bool McciCatena4610::cMeasurementLoop::refreshCompostProbes(
+            bool fForceSearch
+            );
+
+Description:
+    A full OneWire search takes many bus transactions, so we only do it
+    when something might have changed. Each call issues a bus reset and
+    compares the presence pulse with the cached table. The bus is
+    searched again only if:
+
+    - fForceSearch is true, or the cache is not valid;
+    - presence changed (a probe was plugged or unplugged);
+    - a probe failed to answer on the previous cycle; or
+    - m_CompostSearchInterval cycles have gone by since the last
+      search (zero disables this).
+
+    The table lives in SRAM, which the STM32L0 keeps in the stop mode
+    used by gCatena.Sleep(), so it survives deep sleep. After a reset,
+    the table is invalid and the first call searches.
+
+Returns:
+    true if at least one probe is attached.
+
+*/
+
+bool
+cMeasurementLoop::refreshCompostProbes(
+    bool fForceSearch
+    )
+    {
+    auto &cache = this->m_CompostProbes;
+    bool const fPresent = Hal::compostResetBus();
+    bool fSearch = fForceSearch;
+
+    if (cache.Magic != CompostProbeCache::kMagic)
+        fSearch = true;
+    else if (fPresent != (cache.nProbes != 0))
+        fSearch = true;
+    else if (this->m_CompostSearchInterval != 0 &&
+             cache.nCyclesSinceSearch >= this->m_CompostSearchInterval)
+        fSearch = true;
+
+    if (! fSearch)
+        {
+        ++cache.nCyclesSinceSearch;
+        return cache.nProbes != 0;
+        }
+
+    // full search.
+    auto nProbes = Hal::compostSearch();
+    if (nProbes > kMaxCompostProbes)
+        nProbes = kMaxCompostProbes;
+
+    cache.nProbes = 0;
+    for (std::uint8_t i = 0; i < nProbes; ++i)
+        {
+        auto const pRom = cache.Rom[cache.nProbes];
+
+        if (Hal::compostGetAddress(pRom, i))
+            {
+            // the probes were just powered up, so this is the
+            // resolution in their EEPROM.
+            cache.Resolution[cache.nProbes] =
+                Hal::compostGetResolution(pRom);
+            cache.PowerOnResolution[cache.nProbes] =
+                cache.Resolution[cache.nProbes];
+            ++cache.nProbes;
+            }
+        }
+
+    cache.nCyclesSinceSearch = 0;
+    cache.Magic = CompostProbeCache::kMagic;
+
+    // the probes may have moved; automatic resolution starts over.
+    for (auto &a : this->m_CompostAuto)
+        a.Bits = 0;
+
+    if (this->isTraceEnabled(DebugFlags::kTrace))
+        Hal::safePrintf("OneWire search: %u probe(s)\n", cache.nProbes);
+
+    return cache.nProbes != 0;
+    }
+
+// force a bus search on the next measurement.
+void
+cMeasurementLoop::invalidateCompostProbes(
+    void
+    )
+    {
+    this->m_CompostProbes.Magic = 0;
+    }
+
+/****************************************************************************\
+|
+|   Measurement
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::powerUpCompostSensor()
+
+Function:
+    Turn on the rails that feed the OneWire probe.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::powerUpCompostSensor(
+            void
+            );
+
+Description:
+    D11 drives V_OUT2, which powers the probe. If we're not on USB power
+    and Vbat is low, the D14 boost regulator is also enabled. Nothing
+    waits here; the time of power-on is recorded, and the compost sensor
+    task waits until isCompostSensorSettled() before starting the
+    conversion.
+
+    If the probes are already powered (for example, by stWarmup), the
+    settling time already under way is kept, unless the boost regulator
+    now has to be turned on.
+
+    Vbat must already have been measured.
+
+Returns:
+    No explicit result.
+
+*/
+
+void
+cMeasurementLoop::powerUpCompostSensor(
+    void
+    )
+    {
+    std::uint32_t settleMs = kCompostPowerSettleMs;
+    // enable boost regulator if no USB power and VBat is less than 3.1V
+    bool const fBoost = ! this->m_fUsbPower && (this->m_data.Vbat < 3.10f);
+
+    if (this->m_fCompostPowered && (this->m_fCompostBoost || ! fBoost))
+        return;
+
+    if (fBoost)
+        {
+        Hal::pinMode(Hal::kPinBoost, Hal::kPinModeOutput);
+        Hal::digitalWrite(Hal::kPinBoost, Hal::kPinHigh);
+        settleMs = kBoostSettleMs;
+        }
+
+    /* set D11 high so V_OUT2 is going to be high for onewire sensor */
+    Hal::pinMode(Hal::kPinVout2, Hal::kPinModeOutput);
+    Hal::digitalWrite(Hal::kPinVout2, Hal::kPinHigh);
+
+    this->m_tCompostPowerOn = Hal::millis();
+    this->m_CompostSettleMs = settleMs;
+    this->m_fCompostPowered = true;
+    this->m_fCompostBoost = fBoost;
+    }
+
+// return true if the probe rails have had their settling time.
+bool
+cMeasurementLoop::isCompostSensorSettled(
+    void
+    ) const
+    {
+    return Hal::millis() - this->m_tCompostPowerOn >= this->m_CompostSettleMs;
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::startCompostConversion()
+
+Function:
+    Start a temperature conversion on the OneWire bus.
+
+Definition:
+    bool McciCatena4610::cMeasurementLoop::startCompostConversion(
+            void
+            );
+
+Description:
+    Once the rails have settled, check for the probe and, if present,
+    broadcast a conversion request without waiting for it to finish. The
+    compost sensor task collects the result.
+
+    If no probe is found, the rails are turned off again.
+
+Returns:
+    true if a conversion was started.
+
+*/
+
+bool
+cMeasurementLoop::startCompostConversion(
+    void
+    )
+    {
+    /*
+    || Measure and transmit the compost temperature (OneWire)
+    || tranducer value. This is complicated because we want
+    || to support plug/unplug and the sw interface is not
+    || really hot-pluggable.
+    */
+    bool fCompostTemp = this->refreshCompostProbes(false);
+
+    if (! fCompostTemp)
+        {
+        if (Hal::hasCompostProbe())
+            Hal::safePrintf("No compost temperature\n");
+        else
+            Hal::safePrintf("Compost sensor not detected\n");
+
+        this->finishCompostMeasurement(false);
+        return false;
+        }
+
+    this->applyCompostResolution();
+
+    Hal::compostStartConversion();
+
+    this->m_tCompostStart = Hal::micros();
+    this->m_fCompostPending = true;
+    return true;
+    }
+
+// return true if the pending conversion has finished.
+bool
+cMeasurementLoop::isCompostMeasurementReady(
+    void
+    )
+    {
+    return Hal::compostIsConversionComplete();
+    }
+
+// return the number of millis until the pending conversion must be done.
+std::uint32_t
+cMeasurementLoop::getCompostConversionRemaining(
+    void
+    )
+    {
+    auto const &cache = this->m_CompostProbes;
+    std::uint8_t bits = cAppConfig::kResolutionMin;
+
+    // the broadcast conversion takes as long as the finest probe.
+    for (std::uint8_t i = 0; i < cache.nProbes; ++i)
+        {
+        if (cache.Resolution[i] > bits)
+            bits = cache.Resolution[i];
+        }
+
+    std::uint32_t const tConversion =
+        Hal::compostGetConversionMs(bits);
+    std::uint32_t const tElapsed = (Hal::micros() - this->m_tCompostStart) / 1000;
+
+    return tElapsed < tConversion ? tConversion - tElapsed : 0;
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::finishCompostMeasurement()
+
+Function:
+    Collect the compost temperature and power down the probe.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::finishCompostMeasurement(
+            bool fSuccess
+            );
+
+Description:
+    If fSuccess is true, the scratchpad of each cached probe is read (by
+    ROM address, so that no bus search is needed) into m_data.compost;
+    one conversion request covered all of them. If a probe doesn't
+    answer, its reading is NAN and the probe cache is invalidated so
+    that the next cycle searches the bus again. In all cases, D11 and
+    D14 are returned to inputs, turning the probes and the boost
+    regulator off.
+
+Returns:
+    No explicit result.
+
+*/
+
+void
+cMeasurementLoop::finishCompostMeasurement(
+    bool fSuccess
+    )
+    {
+    auto const &cache = this->m_CompostProbes;
+    auto &compost = this->m_data.compost;
+
+    if (fSuccess && cache.nProbes != 0)
+        {
+        compost.nProbes = cache.nProbes;
+
+        for (std::uint8_t i = 0; i < cache.nProbes; ++i)
+            {
+            float compostTempC = Hal::compostGetTempC(cache.Rom[i]);
+
+            compost.TempC[i] = compostTempC;
+            this->m_EventTrace.recordValue(
+                Hal::millis(), cEventTrace::Value::kCompostTemp, compostTempC, i
+                );
+            if (std::isnan(compostTempC))
+                this->invalidateCompostProbes();
+
+            this->updateCompostAutoResolution(i, compost.TempC[i]);
+            }
+
+        if (! std::isnan(compost.TempC[0]))
+            {
+            this->m_data.flags |= Flags::FlagWater;
+            this->m_CompostStats.add(compost.TempC[0]);
+            }
+
+        if (compost.nProbes > 1)
+            {
+            this->m_data.flags |= MeasurementFormat::FlagExtended;
+            this->m_data.extFlags |= MeasurementFormat::kExtCompostProbes;
+            }
+        }
+
+    // from the start of the conversion to the last read; only if a
+    // conversion was started.
+    if (this->m_fCompostPending)
+        this->m_Profiler.addSensor(
+            kProfileCompost,
+            Hal::micros() - this->m_tCompostStart
+            );
+
+    this->m_fCompostPending = false;
+
+    /* set D11 low to turn off after measuring */
+    Hal::pinMode(Hal::kPinVout2, Hal::kPinModeInput);
+    Hal::pinMode(Hal::kPinBoost, Hal::kPinModeInput);
+    this->m_fCompostPowered = false;
+    this->m_fCompostBoost = false;
+
+    // the resolutions we set are lost with the power.
+    auto &probes = this->m_CompostProbes;
+
+    for (std::uint8_t i = 0; i < probes.nProbes; ++i)
+        probes.Resolution[i] = probes.PowerOnResolution[i];
+    }
+
+/****************************************************************************\
+|
+|   Resolution
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::setCompostResolution()
+
+Function:
+    Configure the resolution of the OneWire probes.
+
+Definition:
+    bool McciCatena4610::cMeasurementLoop::setCompostResolution(
+            std::uint8_t iProbe,
+            std::uint8_t bits
+            );
+
+Description:
+    The DS18B20 converts in 94 ms at 9 bits (0.5 degrees C), doubling
+    with each extra bit to 750 ms at 12 bits (0.0625 degrees C). The
+    new resolution is saved in FRAM, and is written to the probe before
+    its next conversion.
+
+    iProbe counts the probes in OneWire search order; kMaxCompostProbes
+    means all of them. bits is 9..12, or cAppConfig::kResolutionAuto.
+
+Returns:
+    false if a parameter is out of range.
+
+*/
+
+bool
+cMeasurementLoop::setCompostResolution(
+    std::uint8_t iProbe,
+    std::uint8_t bits
+    )
+    {
+    if (iProbe > kMaxCompostProbes || ! cAppConfig::isValidResolution(bits))
+        return false;
+
+    auto &config = this->m_AppConfig.edit();
+
+    for (std::uint8_t i = 0; i < kMaxCompostProbes; ++i)
+        {
+        if (iProbe == kMaxCompostProbes || iProbe == i)
+            {
+            config.CompostResolution[i] = bits;
+            this->m_CompostAuto[i].Bits = 0;
+            }
+        }
+
+    this->saveAppConfig();
+
+    return true;
+    }
+
+// the resolution a probe should use for its next conversion, limited by
+// the operating profile.
+std::uint8_t
+cMeasurementLoop::getCompostTargetResolution(
+    std::uint8_t iProbe
+    ) const
+    {
+    std::uint8_t const maxBits = this->getOperatingProfile().maxCompostBits;
+    std::uint8_t bits = this->m_AppConfig.get().CompostResolution[iProbe];
+
+    if (bits != cAppConfig::kResolutionAuto)
+        ;
+    else if (this->m_CompostAuto[iProbe].Bits != 0)
+        bits = this->m_CompostAuto[iProbe].Bits;
+    else
+        bits = cAppConfig::kResolutionMax;
+
+    return bits < maxBits ? bits : maxBits;
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::applyCompostResolution()
+
+Function:
+    Bring the resolution of each probe up to date.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::applyCompostResolution(
+            void
+            );
+
+Description:
+    The probe cache holds the resolution each probe has now. A probe is
+    only written when its target differs. Only the scratchpad is
+    written, not the EEPROM: that is quick, doesn't block, and doesn't
+    wear the EEPROM, but the setting is lost when the probes are
+    powered off after each measurement. The cache then goes back to the
+    resolution each probe reported at the last bus search, which is
+    what it loads from its EEPROM, so a resolution other than that is
+    written again after each power-up. If a probe does come back at
+    another resolution, its conversion times out, and the bus search
+    that follows rereads the resolution.
+
+Returns:
+    No explicit result.
+
+*/
+
+void
+cMeasurementLoop::applyCompostResolution(
+    void
+    )
+    {
+    auto &cache = this->m_CompostProbes;
+
+    for (std::uint8_t i = 0; i < cache.nProbes; ++i)
+        {
+        std::uint8_t const bits = this->getCompostTargetResolution(i);
+
+        if (cache.Resolution[i] == bits)
+            continue;
+
+        if (Hal::compostSetResolution(cache.Rom[i], bits))
+            {
+            cache.Resolution[i] = bits;
+
+            if (this->isTraceEnabled(DebugFlags::kTrace))
+                Hal::safePrintf("OneWire probe %u: %u bits\n", i, bits);
+            }
+        }
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::updateCompostAutoResolution()
+
+Function:
+    Choose the next resolution of a probe in automatic mode.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::updateCompostAutoResolution(
+            std::uint8_t iProbe,
+            float tempC
+            );
+
+Description:
+    Each reading is compared with the previous one. After
+    kCompostAutoStableSamples readings in a row that moved no more than
+    kCompostAutoStableC (one step at 9 bits), the resolution drops a bit,
+    down to 9. A larger move raises it a bit; a move of
+    kCompostAutoRapidC or more goes straight back to 12 bits, so fast
+    changes are tracked finely. A failed reading (NAN) starts over at
+    12 bits.
+
+Returns:
+    No explicit result.
+
+*/
+
+void
+cMeasurementLoop::updateCompostAutoResolution(
+    std::uint8_t iProbe,
+    float tempC
+    )
+    {
+    auto &a = this->m_CompostAuto[iProbe];
+
+    if (this->m_AppConfig.get().CompostResolution[iProbe] != cAppConfig::kResolutionAuto)
+        return;
+
+    if (std::isnan(tempC))
+        {
+        a.Bits = 0;
+        return;
+        }
+
+    if (a.Bits == 0)
+        {
+        a.Bits = cAppConfig::kResolutionMax;
+        a.nStable = 0;
+        }
+    else
+        {
+        float const delta = std::fabs(tempC - a.PrevC);
+
+        if (delta >= kCompostAutoRapidC)
+            {
+            a.Bits = cAppConfig::kResolutionMax;
+            a.nStable = 0;
+            }
+        else if (delta > kCompostAutoStableC)
+            {
+            if (a.Bits < cAppConfig::kResolutionMax)
+                ++a.Bits;
+            a.nStable = 0;
+            }
+        else if (++a.nStable >= kCompostAutoStableSamples)
+            {
+            if (a.Bits > cAppConfig::kResolutionMin)
+                --a.Bits;
+            a.nStable = 0;
+            }
+        }
+
+    a.PrevC = tempC;
+    }
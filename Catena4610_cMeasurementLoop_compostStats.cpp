@@ -0,0 +1,136 @@
+/*
+
+Module: Catena4610_cMeasurementLoop_compostStats.cpp
+
+Function:
+    Compost temperature oversampling and summary.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cMeasurementLoop.h"
+
+using namespace McciCatena4610;
+using namespace McciCatena;
+
+/****************************************************************************\
+|
+|   Configuration
+|
+\****************************************************************************/
+
+void
+cMeasurementLoop::setCompostOversample(
+    std::uint8_t nSamples
+    )
+    {
+    this->m_CompostOversample = nSamples != 0 ? nSamples : 1;
+    this->m_nOversample = 0;
+
+    // if the fast uplinks are done, switch the timer now.
+    if (this->m_txCycleCount == 0)
+        this->setTxCycleTime(this->getPermanentCycleSec(), 0);
+    }
+
+/****************************************************************************\
+|
+|   Sampling
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::startOversample()
+
+Function:
+    Decide whether the measurement starting now is an intermediate
+    sample.
+
+Definition:
+    bool McciCatena4610::cMeasurementLoop::startOversample(
+            void
+            );
+
+Description:
+    When oversampling, the uplink timer runs m_CompostOversample times
+    per uplink interval. Every measurement but the last in an interval
+    is an intermediate sample: only the supply voltages (needed to power
+    the probes) and the compost temperature are read, and nothing is
+    sent. The compost readings of all the samples go into
+    m_CompostStats.
+
+Returns:
+    true if this is an intermediate sample.
+
+*/
+
+bool
+cMeasurementLoop::startOversample(
+    void
+    )
+    {
+    bool fIntermediate = false;
+
+    if (! this->isOversampling())
+        this->m_nOversample = 0;
+    else if (++this->m_nOversample < this->m_CompostOversample)
+        fIntermediate = true;
+    else
+        this->m_nOversample = 0;
+
+    this->m_fIntermediateSample = fIntermediate;
+    return fIntermediate;
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::updateCompostStatsMeasurement()
+
+Function:
+    Add the compost temperature summary to the current measurement.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::updateCompostStatsMeasurement(
+            void
+            );
+
+Description:
+    If at least two compost temperatures have been read since the last
+    uplink, their count, minimum, maximum, mean and standard deviation
+    are added to m_data as an extension field. A single sample adds
+    nothing to field 5, so it isn't summarized. In either case the
+    summary is then cleared for the next uplink.
+
+Returns:
+    No explicit result.
+
+*/
+
+void
+cMeasurementLoop::updateCompostStatsMeasurement(
+    void
+    )
+    {
+    auto const &stats = this->m_CompostStats;
+
+    if (stats.getCount() >= 2)
+        {
+        auto &s = this->m_data.compostStats;
+
+        s.n = stats.getCount() < UINT8_MAX ? std::uint8_t(stats.getCount()) : UINT8_MAX;
+        s.Min = stats.getMin();
+        s.Max = stats.getMax();
+        s.Mean = stats.getMean();
+        s.StdDev = stats.getStdDev();
+
+        this->m_data.flags |= MeasurementFormat::FlagExtended;
+        this->m_data.extFlags |= MeasurementFormat::kExtCompostStats;
+        }
+
+    this->m_CompostStats.reset();
+    }
@@ -0,0 +1,286 @@
+/*
+
+Module: Catena4610_cMeasurementLoop_config.cpp
+
+Function:
+    Settings kept in FRAM, and configuration downlinks.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_cPayloadEncoder.h"
+#include "Catena4610_hal.h"
+
+using namespace McciCatena4610;
+using namespace McciCatena;
+
+/****************************************************************************\
+|
+|   Settings
+|
+\****************************************************************************/
+
+// copy the settings loaded from FRAM into the loop; called by begin().
+void
+cMeasurementLoop::applyAppConfig(
+    void
+    )
+    {
+    auto const &config = this->m_AppConfig.get();
+
+    this->m_txCycleSec_Permanent = config.TxCycleSec;
+    this->m_BatchSampleSec = config.BatchSampleSec;
+    this->m_BatchDepth = config.BatchDepth < MeasurementFormat::kMaxBatchSamples
+                            ? config.BatchDepth
+                            : MeasurementFormat::kMaxBatchSamples;
+
+    if (config.FastCount != 0)
+        this->setTxCycleTime(kFastCycleSec, config.FastCount);
+    else
+        this->setTxCycleTime(this->getPermanentCycleSec(), 0);
+    }
+
+void
+cMeasurementLoop::saveAppConfig(
+    void
+    )
+    {
+    if (! this->m_AppConfig.save() && this->isTraceEnabled(DebugFlags::kError))
+        Hal::safePrintf("couldn't save the settings in FRAM\n");
+    }
+
+bool
+cMeasurementLoop::setPermanentCycleTime(
+    std::uint32_t txCycleSec
+    )
+    {
+    if (txCycleSec < kMinConfigCycleSec)
+        return false;
+
+    this->m_txCycleSec_Permanent = txCycleSec;
+    this->m_AppConfig.edit().TxCycleSec = txCycleSec;
+    this->saveAppConfig();
+
+    // if the fast uplinks are done, switch the timer now.
+    if (this->m_txCycleCount == 0)
+        this->setTxCycleTime(this->getPermanentCycleSec(), 0);
+
+    return true;
+    }
+
+void
+cMeasurementLoop::setFastUplinks(
+    std::uint8_t nUplinks
+    )
+    {
+    this->m_AppConfig.edit().FastCount = nUplinks;
+    this->saveAppConfig();
+
+    if (nUplinks != 0)
+        this->setTxCycleTime(kFastCycleSec, nUplinks);
+    else if (this->m_txCycleCount != 0)
+        this->setTxCycleTime(this->getPermanentCycleSec(), 0);
+    }
+
+void
+cMeasurementLoop::setLightSampling(
+    bool fEnable
+    )
+    {
+    this->m_AppConfig.setOption(cAppConfig::kOptionLightOff, ! fEnable);
+    this->saveAppConfig();
+    }
+
+void
+cMeasurementLoop::setEnvSampling(
+    bool fEnable
+    )
+    {
+    this->m_AppConfig.setOption(cAppConfig::kOptionEnvOff, ! fEnable);
+    this->saveAppConfig();
+    }
+
+/****************************************************************************\
+|
+|   Configuration downlinks
+|
+\****************************************************************************/
+
+namespace {
+
+// big-endian 32 bits, from two 16-bit halves.
+std::uint32_t get4(cPayloadReader &r)
+    {
+    std::uint32_t const hi = r.get2();
+    return (hi << 16) | r.get2();
+    }
+
+} // namespace
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::processConfigDownlink()
+
+Function:
+    Apply a configuration downlink.
+
+Definition:
+    bool McciCatena4610::cMeasurementLoop::processConfigDownlink(
+            const std::uint8_t *pBuffer,
+            std::size_t nBuffer
+            );
+
+Description:
+    The message, received on kConfigPort, is a sequence of commands.
+    Each is a ConfigCommand byte followed by its arguments; multi-byte
+    values are big-endian, as in the uplinks.
+
+    0x01 {uint32 secs}      uplink interval after the fast uplinks;
+                            at least kMinConfigCycleSec.
+    0x02 {uint8 n}          number of fast uplinks after boot; n
+                            fast uplinks are also started now.
+    0x03 {uint8 bits}       sensors: bit 0 ambient light, bit 1
+                            temperature/pressure/humidity.
+    0x04 {uint8 probe} {uint8 bits}
+                            OneWire resolution; probe 4 means all,
+                            and bits 0 means automatic.
+    0x05 {uint8 profile}    BME280 profile: 0 auto, 1 low power,
+                            2 standard, 3 high resolution.
+    0x06 {uint32 secs} {uint8 depth}
+                            batching; secs at least
+                            kMinConfigCycleSec, depth at most
+                            kMaxBatchSamples; depth 0 or 1 turns
+                            it off.
+    0x07 {uint8 on}         operating profiles on (1) or off (0).
+
+    The whole message is checked before anything is changed, so a
+    message with a bad command changes nothing. The settings are saved
+    in FRAM and take effect at once.
+
+Returns:
+    true if the message was applied.
+
+*/
+
+bool
+cMeasurementLoop::processConfigDownlink(
+    const std::uint8_t *pBuffer,
+    std::size_t nBuffer
+    )
+    {
+    // first check, then apply.
+    for (unsigned iPass = 0; iPass < 2; ++iPass)
+        {
+        bool const fApply = iPass != 0;
+        cPayloadReader r(pBuffer, nBuffer);
+
+        while (r.getRemaining() != 0)
+            {
+            std::uint8_t const cmd = r.get();
+            bool fValid = true;
+
+            switch (cmd)
+                {
+            case kConfigTxCycle:
+                {
+                std::uint32_t const sec = get4(r);
+
+                fValid = sec >= kMinConfigCycleSec;
+                if (fValid && fApply)
+                    this->setPermanentCycleTime(sec);
+                }
+                break;
+
+            case kConfigFastCount:
+                {
+                std::uint8_t const n = r.get();
+
+                if (fApply)
+                    this->setFastUplinks(n);
+                }
+                break;
+
+            case kConfigSensors:
+                {
+                std::uint8_t const bits = r.get();
+
+                if (fApply)
+                    {
+                    this->setLightSampling((bits & (1 << 0)) != 0);
+                    this->setEnvSampling((bits & (1 << 1)) != 0);
+                    }
+                }
+                break;
+
+            case kConfigResolution:
+                {
+                std::uint8_t const iProbe = r.get();
+                std::uint8_t const bits = r.get();
+
+                fValid = iProbe <= kMaxCompostProbes && cAppConfig::isValidResolution(bits);
+                if (fValid && fApply)
+                    this->setCompostResolution(iProbe, bits);
+                }
+                break;
+
+            case kConfigBme280:
+                {
+                std::uint8_t const profile = r.get();
+
+                fValid = profile < cAppConfig::kBme280NumProfiles;
+                if (fValid && fApply)
+                    this->setBme280Profile(profile);
+                }
+                break;
+
+            case kConfigBatch:
+                {
+                std::uint32_t const sec = get4(r);
+                std::uint8_t const depth = r.get();
+
+                fValid = sec >= kMinConfigCycleSec &&
+                         depth <= MeasurementFormat::kMaxBatchSamples;
+                if (fValid && fApply)
+                    this->setBatching(sec, depth);
+                }
+                break;
+
+            case kConfigPowerProfiles:
+                {
+                std::uint8_t const fOn = r.get();
+
+                fValid = fOn <= 1;
+                if (fValid && fApply)
+                    this->setPowerProfiles(fOn != 0);
+                }
+                break;
+
+            default:
+                fValid = false;
+                break;
+                }
+
+            if (! fValid || r.isError())
+                {
+                if (this->isTraceEnabled(DebugFlags::kError))
+                    Hal::safePrintf(
+                        "config downlink: bad command %#04x at byte %u\n",
+                        cmd,
+                        unsigned(r.getIndex())
+                        );
+                return false;
+                }
+            }
+        }
+
+    if (this->isTraceEnabled(DebugFlags::kTrace))
+        Hal::safePrintf("config downlink: %u bytes applied\n", unsigned(nBuffer));
+
+    return true;
+    }
@@ -16,8 +16,10 @@ Author:
 #include <Catena_TxBuffer.h>
 
 #include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_cPayloadEncoder.h"
+#include "Catena4610_hal.h"
 
-#include <arduino_lmic.h>
+#include <cmath>
 
 using namespace McciCatena;
 using namespace McciCatena4610;
@@ -31,12 +33,14 @@ Function:
 
 Definition:
     void McciCatena4610::cMeasurementLoop::fillTxBuffer(
-            cMeasurementLoop::TxBuffer_t& b
+            cMeasurementLoop::TxBuffer_t& b,
+            Measurement const &mData
             );
 
 Description:
-    A format 0x22 message is prepared from the data in the cMeasurementLoop
-    object.
+    A format 0x15 message is prepared from mData. It is appended to b,
+    which is normally a fresh frame from the pool; a backfill header
+    can be put in first (see startBackfill()).
 
 */
 
@@ -45,73 +49,288 @@ cMeasurementLoop::fillTxBuffer(
     cMeasurementLoop::TxBuffer_t& b, Measurement const &mData
     )
     {
-    gLed.Set(McciCatena::LedPattern::Measuring);
+    bool const fTrace = this->isTraceEnabled(DebugFlags::kTrace);
 
-
-    // initialize the message buffer to an empty state
-    b.begin();
+    Hal::setLed(Hal::LedPattern::Measuring);
 
     // insert format byte
     b.put(kMessageFormat);
 
-    // the flags in Measurement correspond to the over-the-air flags.
-    b.put(std::uint8_t(this->m_data.flags));
+    // the flags in Measurement correspond to the over-the-air flags;
+    // fields of sensors that aren't built in are never sent.
+    std::uint8_t const fields = std::uint8_t(mData.flags) & MeasurementFormat::kSendFieldMask;
+
+    b.put(fields);
 
     // send Vbat
-    if ((this->m_data.flags &  Flags::FlagVbat) !=  Flags(0))
+    if ((mData.flags &  Flags::FlagVbat) !=  Flags(0))
         {
         float Vbat = mData.Vbat;
-        gCatena.SafePrintf("Vbat:    %d mV\n", (int) (Vbat * 1000.0f));
+        if (fTrace)
+            Hal::safePrintf("Vbat:    %d mV\n", (int) (Vbat * 1000.0f));
         b.putV(Vbat);
         }
 
     // send Vdd if we can measure it.
 
     // Vbus is sent as 5000 * v
-    if ((this->m_data.flags &  Flags::FlagVcc) !=  Flags(0))
+    if ((mData.flags &  Flags::FlagVcc) !=  Flags(0))
         {
         float Vbus = mData.Vbus;
-        gCatena.SafePrintf("Vbus:    %d mV\n", (int) (Vbus * 1000.0f));
+        if (fTrace)
+            Hal::safePrintf("Vbus:    %d mV\n", (int) (Vbus * 1000.0f));
         b.putV(Vbus);
         }
 
     // send boot count
-    if ((this->m_data.flags &  Flags::FlagBoot) !=  Flags(0))
+    if ((mData.flags &  Flags::FlagBoot) !=  Flags(0))
         {
         b.putBootCountLsb(mData.BootCount);
         }
 
-    if ((this->m_data.flags &  Flags::FlagTPH) !=  Flags(0))
+    if ((fields & Sensors::Bme280::kField) != 0)
         {
-        gCatena.SafePrintf(
-                "BME280:  T: %d P: %d RH: %d\n",
-                (int) mData.env.Temperature,
-                (int) mData.env.Pressure,
-                (int) mData.env.Humidity
-                );
+        if (fTrace)
+            Hal::safePrintf(
+                    "BME280:  T: %d P: %d RH: %d\n",
+                    (int) mData.env.Temperature,
+                    (int) mData.env.Pressure,
+                    (int) mData.env.Humidity
+                    );
         b.putT(mData.env.Temperature);
         b.putP(mData.env.Pressure);
         b.putRH(mData.env.Humidity);
         }
 
-    // put light
-    if ((this->m_data.flags & Flags::FlagLux) != Flags(0))
+    // put light, in lux, as uint16
+    if ((fields & Sensors::Si1133::kField) != 0)
         {
-        gCatena.SafePrintf(
-                "Si1133:  %d White\n",
-                (int) mData.light.White
-                );
+        if (fTrace)
+            Hal::safePrintf(
+                    "Si1133:  %d White\n",
+                    (int) mData.light.White
+                    );
+        b.putLux(
+            std::uint16_t(
+                cPayloadEncoder::scaleAndClamp(mData.light.White, 1.0f, 0, UINT16_MAX)
+                )
+            );
         }
 
     // send compost data
-    if ((this->m_data.flags & Flags::FlagWater) !=  Flags(0))
+    if ((fields & Sensors::Compost::kField) != 0)
+        {
+        if (fTrace)
+            Hal::safePrintf(
+                    "Compost:  T: %d C\n",
+                    (int) mData.compost.TempC[0]
+                    );
+        b.putT(mData.compost.TempC[0]);
+        }
+
+    // field 6 (soil probe) is not used by this application.
+
+    // extension fields
+    if ((fields & std::uint8_t(MeasurementFormat::FlagExtended)) != 0)
+        {
+        b.put(mData.extFlags);
+
+        // compost probes after the first: a count of all probes, then
+        // the temperature of probes 1..n-1.
+        if ((mData.extFlags & MeasurementFormat::kExtCompostProbes) != 0)
+            {
+            auto const nProbes = mData.compost.nProbes;
+
+            b.put(nProbes);
+            for (std::uint8_t i = 1; i < nProbes; ++i)
+                {
+                float const t = mData.compost.TempC[i];
+
+                if (std::isnan(t))
+                    {
+                    // 0x8000 means "no reading".
+                    b.put(0x80);
+                    b.put(0x00);
+                    }
+                else
+                    {
+                    if (fTrace)
+                        Hal::safePrintf(
+                                "Compost%u: T: %d C\n",
+                                i,
+                                (int) t
+                                );
+                    b.putT(t);
+                    }
+                }
+            }
+
+        // diagnostics for the previous cycle: awake ms, charge in
+        // units of 10 uC, and transmit ms.
+        if ((mData.extFlags & MeasurementFormat::kExtDiagnostics) != 0)
+            {
+            if (fTrace)
+                Hal::safePrintf(
+                        "Diag:    awake %u ms, charge %u0 uC, tx %u ms\n",
+                        mData.diag.AwakeMs,
+                        mData.diag.Charge,
+                        mData.diag.TransmitMs
+                        );
+            std::uint16_t const diag[] =
+                {
+                mData.diag.AwakeMs, mData.diag.Charge, mData.diag.TransmitMs
+                };
+
+            for (auto v : diag)
+                {
+                b.put(std::uint8_t(v >> 8));
+                b.put(std::uint8_t(v));
+                }
+            }
+
+        // compost temperature summary since the last uplink: sample
+        // count, then minimum, maximum, mean and standard deviation, in
+        // the same units as field 5.
+        if ((mData.extFlags & MeasurementFormat::kExtCompostStats) != 0)
+            {
+            auto const &stats = mData.compostStats;
+
+            if (fTrace)
+                Hal::safePrintf(
+                        "Stats:   n %u, min %d, max %d, mean %d, sd %d mdegC\n",
+                        stats.n,
+                        (int) (stats.Min * 1000.0f),
+                        (int) (stats.Max * 1000.0f),
+                        (int) (stats.Mean * 1000.0f),
+                        (int) (stats.StdDev * 1000.0f)
+                        );
+            b.put(stats.n);
+            b.putT(stats.Min);
+            b.putT(stats.Max);
+            b.putT(stats.Mean);
+            b.putT(stats.StdDev);
+            }
+        }
+
+    Hal::setLed(Hal::LedPattern::Off);
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::makeSampleValues()
+
+Function:
+    Convert a measurement to over-the-air integers.
+
+Definition:
+    static cPayloadEncoder::Values
+    McciCatena4610::cMeasurementLoop::makeSampleValues(
+            Measurement const &mData
+            );
+
+Description:
+    The scaling matches the fields of format 0x15. Only fields 0..5 are
+    converted, and only those this build sends (see kSendFieldMask);
+    components of fields that are not present are zero.
+
+Returns:
+    The converted values.
+
+*/
+
+cPayloadEncoder::Values
+cMeasurementLoop::makeSampleValues(
+    Measurement const &mData
+    )
+    {
+    cPayloadEncoder::Values s {};
+    auto const clamp = &cPayloadEncoder::scaleAndClamp;
+
+    s.flags = std::uint8_t(mData.flags) & cPayloadEncoder::kFieldMask & MeasurementFormat::kSendFieldMask;
+
+    if (s.flags & std::uint8_t(Flags::FlagVbat))
+        s.v[cPayloadEncoder::kVbat] = clamp(mData.Vbat, 4096.0f, INT16_MIN, INT16_MAX);
+    if (s.flags & std::uint8_t(Flags::FlagVcc))
+        s.v[cPayloadEncoder::kVbus] = clamp(mData.Vbus, 4096.0f, INT16_MIN, INT16_MAX);
+    if (s.flags & std::uint8_t(Flags::FlagBoot))
+        s.v[cPayloadEncoder::kBoot] = std::uint8_t(mData.BootCount);
+    if (s.flags & Sensors::Bme280::kField)
         {
-        gCatena.SafePrintf(
-                "Compost:  T: %d C\n",
-                (int) mData.compost.TempC
+        s.v[cPayloadEncoder::kT] = clamp(mData.env.Temperature, 256.0f, INT16_MIN, INT16_MAX);
+        s.v[cPayloadEncoder::kP] = clamp(mData.env.Pressure, 0.25f, 0, UINT16_MAX);
+        s.v[cPayloadEncoder::kRH] = clamp(mData.env.Humidity, 2.56f, 0, UINT8_MAX);
+        }
+    if (s.flags & Sensors::Si1133::kField)
+        s.v[cPayloadEncoder::kLux] = clamp(mData.light.White, 1.0f, 0, UINT16_MAX);
+    if (s.flags & Sensors::Compost::kField)
+        s.v[cPayloadEncoder::kCompostT] = clamp(mData.compost.TempC[0], 256.0f, INT16_MIN, INT16_MAX);
+
+    return s;
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::fillDeltaTxBuffer()
+
+Function:
+    Prepare a format 0x17 message from a measurement.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::fillDeltaTxBuffer(
+            cMeasurementLoop::TxBuffer_t& b,
+            Measurement const &mData
+            );
+
+Description:
+    The message is either a keyframe or the differences from the last
+    acknowledged message; see cDeltaEncoder. Extension fields are not
+    sent in this format. As with fillTxBuffer(), the message is
+    appended to b.
+
+    If the encoder reports a message larger than the scratch buffer,
+    which can't happen unless kMaxMessageSize is wrong, nothing is
+    sent in format 0x17: the encoder is reset so the next message is a
+    keyframe, and this measurement is sent in format 0x15 instead.
+
+*/
+
+void
+cMeasurementLoop::fillDeltaTxBuffer(
+    cMeasurementLoop::TxBuffer_t& b, Measurement const &mData
+    )
+    {
+    std::uint8_t frame[cDeltaEncoder::kMaxMessageSize];
+
+    Hal::setLed(Hal::LedPattern::Measuring);
+
+    std::size_t const n = this->m_DeltaEncoder.encode(
+                            makeSampleValues(mData),
+                            frame,
+                            sizeof(frame)
+                            );
+
+    if (n > sizeof(frame))
+        {
+        if (this->isTraceEnabled(DebugFlags::kError))
+            Hal::safePrintf(
+                "?fillDeltaTxBuffer: message too big (%u > %u), sending format 0x15\n",
+                unsigned(n),
+                unsigned(sizeof(frame))
                 );
-        b.putT(mData.compost.TempC);
+        this->m_DeltaEncoder.reset();
+        this->fillTxBuffer(b, mData);
+        return;
         }
 
-    gLed.Set(McciCatena::LedPattern::Off);
+    for (std::size_t i = 0; i < n; ++i)
+        b.put(frame[i]);
+
+    if (this->isTraceEnabled(DebugFlags::kTrace))
+        Hal::safePrintf(
+            "delta: %s, %u bytes\n",
+            (frame[1] & cDeltaEncoder::kKeyframe) ? "keyframe" : "delta",
+            unsigned(n)
+            );
+
+    Hal::setLed(Hal::LedPattern::Off);
     }
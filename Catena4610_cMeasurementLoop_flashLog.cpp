@@ -0,0 +1,189 @@
+/*
+
+Module: Catena4610_cMeasurementLoop_flashLog.cpp
+
+Function:
+    Store-and-forward of measurements through the flash log.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_hal.h"
+
+using namespace McciCatena4610;
+using namespace McciCatena;
+
+/****************************************************************************\
+|
+|   Logging
+|
+\****************************************************************************/
+
+// make sure SPI2 is running; it's stopped across deep sleep.
+void
+cMeasurementLoop::flashPrepare(
+    void
+    )
+    {
+    if (this->m_pSPI2 && ! this->m_fSpi2Active)
+        {
+        Hal::beginSpi(this->m_pSPI2);
+        this->m_fSpi2Active = true;
+        }
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::logMeasurement()
+
+Function:
+    Save a measurement in the flash log before it is sent.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::logMeasurement(
+            Measurement const &mData
+            );
+
+Description:
+    Every measurement is logged, and marked as sent when the uplink
+    succeeds. Anything left unsent is sent later from stBackfill.
+    m_LogSlot is set to the slot used, or cFlashLog::kNoSlot if the
+    measurement couldn't be logged.
+
+Returns:
+    No explicit result.
+
+*/
+
+void
+cMeasurementLoop::logMeasurement(
+    Measurement const &mData
+    )
+    {
+    this->m_LogSlot = cFlashLog::kNoSlot;
+
+    if (this->m_pFlashLog == nullptr)
+        return;
+
+    LogRecord record;
+    std::uint32_t slot;
+    std::uint32_t seq;
+
+    record.tSample = Hal::millis();
+    record.m = mData;
+
+    std::uint32_t const tStart = Hal::micros();
+
+    this->flashPrepare();
+    bool const fOk = this->m_pFlashLog->append(&record, sizeof(record), slot, seq);
+
+    this->m_Profiler.addSensor(kProfileFlash, Hal::micros() - tStart);
+    if (fOk)
+        {
+        this->m_LogSlot = slot;
+        if (this->isTraceEnabled(DebugFlags::kTrace))
+            Hal::safePrintf("logged seq %u\n", seq);
+        }
+    else if (this->isTraceEnabled(DebugFlags::kError))
+        {
+        Hal::safePrintf("flash log append failed\n");
+        }
+    }
+
+void
+cMeasurementLoop::markLogSent(
+    std::uint32_t slot
+    )
+    {
+    if (this->m_pFlashLog == nullptr || slot == cFlashLog::kNoSlot)
+        return;
+
+    this->flashPrepare();
+    this->m_pFlashLog->markSent(slot);
+    }
+
+/****************************************************************************\
+|
+|   Backfill
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::startBackfill()
+
+Function:
+    Start sending the oldest unsent record from the flash log.
+
+Definition:
+    bool McciCatena4610::cMeasurementLoop::startBackfill(
+            void
+            );
+
+Description:
+    Backfill messages go to kBackfillPort. Each one is a 4-byte log
+    sequence number, a 2-byte age in minutes, and then the message that
+    would have been sent on port 1. The age is 0xFFFF if it isn't known,
+    because the system has rebooted since the measurement was taken.
+
+Returns:
+    true if a transmission was started.
+
+*/
+
+bool
+cMeasurementLoop::startBackfill(
+    void
+    )
+    {
+    if (this->m_pFlashLog == nullptr)
+        return false;
+
+    LogRecord record;
+    std::uint32_t slot;
+    std::uint32_t seq;
+
+    this->flashPrepare();
+    if (! this->m_pFlashLog->getOldestUnsent(slot, seq, &record, sizeof(record)))
+        return false;
+
+    // work out the age; only possible if we haven't rebooted since.
+    std::uint16_t ageMinutes = 0xFFFF;
+    std::uint32_t bootCount;
+
+    if ((record.m.flags & Flags::FlagBoot) != Flags(0) &&
+        Hal::getBootCount(bootCount) &&
+        bootCount == record.m.BootCount)
+        {
+        std::uint32_t const age = (Hal::millis() - record.tSample) / (60 * 1000);
+
+        ageMinutes = age < 0xFFFF ? std::uint16_t(age) : 0xFFFE;
+        }
+
+    // the header, then the message, built in place.
+    auto const pFrame = this->m_TxFrames.acquire();
+
+    if (pFrame == nullptr)
+        return false;
+
+    pFrame->put(std::uint8_t(seq >> 24));
+    pFrame->put(std::uint8_t(seq >> 16));
+    pFrame->put(std::uint8_t(seq >> 8));
+    pFrame->put(std::uint8_t(seq));
+    pFrame->put(std::uint8_t(ageMinutes >> 8));
+    pFrame->put(std::uint8_t(ageMinutes));
+    this->fillTxBuffer(*pFrame, record.m);
+
+    if (this->isTraceEnabled(DebugFlags::kTrace))
+        Hal::safePrintf("backfill seq %u\n", seq);
+
+    this->m_BackfillSlot = slot;
+    this->startTransmission(pFrame, kBackfillPort);
+    return true;
+    }
@@ -0,0 +1,118 @@
+/*
+
+Module: Catena4610_cMeasurementLoop_link.cpp
+
+Function:
+    Link quality tracking and the confirmed-uplink policy.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_hal.h"
+
+using namespace McciCatena4610;
+using namespace McciCatena;
+
+/****************************************************************************\
+|
+|   Configuration
+|
+\****************************************************************************/
+
+void
+cMeasurementLoop::setLinkPolicy(
+    bool fEnable
+    )
+    {
+    this->m_AppConfig.setOption(cAppConfig::kOptionLinkPolicyOff, ! fEnable);
+    this->saveAppConfig();
+    }
+
+void
+cMeasurementLoop::setLinkConfirmInterval(
+    std::uint8_t nFrames
+    )
+    {
+    auto config = this->m_LinkPolicy.getConfig();
+
+    config.confirmEvery = nFrames;
+    this->m_LinkPolicy.setConfig(config);
+    }
+
+/****************************************************************************\
+|
+|   Uplink results
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::updateLinkQuality()
+
+Function:
+    Record what an uplink told us about the link.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::updateLinkQuality(
+            bool fSuccess
+            );
+
+Description:
+    Called when an uplink that reached the radio completes. The result
+    and the signal of any downlink go to the link policy. If the policy
+    finds that ACKs keep being missed, the next slower data rate is
+    tried, but only if it still allows kMaxMeasurementUplinkSize bytes:
+    a slower rate that can't carry a measurement or backfill message
+    would silence the device, and ADR could then never raise the rate
+    again.
+
+    The history is kept whether or not the policy is on, so that
+    confirmed uplinks requested by the operating flag or profile are
+    counted too.
+
+Returns:
+    No explicit result.
+
+*/
+
+void
+cMeasurementLoop::updateLinkQuality(
+    bool fSuccess
+    )
+    {
+    std::int16_t rssi;
+    float snr;
+
+    if (Hal::getDownlinkSignal(rssi, snr))
+        this->m_LinkPolicy.recordDownlink(rssi, snr);
+
+    if (! this->m_LinkPolicy.recordUplink(this->m_fTxConfirmed, fSuccess) ||
+        ! this->getLinkPolicy())
+        return;
+
+    std::uint8_t const dr = Hal::getDataRate();
+
+    if (dr == 0 || getMaxAppPayload(dr - 1) < kMaxMeasurementUplinkSize)
+        {
+        if (this->isTraceEnabled(DebugFlags::kWarning))
+            Hal::safePrintf(
+                "link: %u ACKs missed, already at the slowest usable data rate\n",
+                this->m_LinkPolicy.getConfig().maxMissed
+                );
+        return;
+        }
+
+    if (this->isTraceEnabled(DebugFlags::kWarning))
+        Hal::safePrintf(
+            "link: %u ACKs missed, lowering data rate\n",
+            this->m_LinkPolicy.getConfig().maxMissed
+            );
+
+    Hal::lowerDataRate();
+    }
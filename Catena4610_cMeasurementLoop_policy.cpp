@@ -0,0 +1,125 @@
+/*
+
+Module: Catena4610_cMeasurementLoop_policy.cpp
+
+Function:
+    Report-on-change uplink scheduling.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_hal.h"
+
+#include <cmath>
+
+using namespace McciCatena4610;
+using namespace McciCatena;
+
+/****************************************************************************\
+|
+|   Configuration
+|
+\****************************************************************************/
+
+void
+cMeasurementLoop::setReportPolicy(
+    bool fEnable
+    )
+    {
+    this->m_fReportPolicy = fEnable;
+    this->m_ReportPolicy.reset();
+
+    // if the fast uplinks are done, switch the timer now.
+    if (this->m_txCycleCount == 0)
+        this->setTxCycleTime(this->getPermanentCycleSec(), 0);
+    }
+
+void
+cMeasurementLoop::setReportPolicyConfig(
+    cReportPolicy::Config const &config
+    )
+    {
+    this->m_ReportPolicy.setConfig(config);
+
+    if (this->m_fReportPolicy && this->m_txCycleCount == 0)
+        this->setTxCycleTime(this->getPermanentCycleSec(), 0);
+    }
+
+/****************************************************************************\
+|
+|   Decisions
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::checkReportPolicy()
+
+Function:
+    Decide whether to send a measurement.
+
+Definition:
+    bool McciCatena4610::cMeasurementLoop::checkReportPolicy(
+            Measurement const &mData
+            );
+
+Description:
+    The measurement is given to the report policy (see cReportPolicy).
+    If it's to be sent, finishReport() must be called when the uplink
+    completes.
+
+    Measurements that aren't sent aren't logged to flash either;
+    otherwise they would be backfilled.
+
+Returns:
+    true if the measurement should be sent.
+
+*/
+
+bool
+cMeasurementLoop::checkReportPolicy(
+    Measurement const &mData
+    )
+    {
+    cReportPolicy::Reading r;
+
+    r.CompostT = (mData.flags & Flags::FlagWater) != Flags(0)
+                    ? mData.compost.TempC[0] : NAN;
+    if ((mData.flags & Flags::FlagTPH) != Flags(0))
+        {
+        r.AirT = mData.env.Temperature;
+        r.RH = mData.env.Humidity;
+        }
+    else
+        r.AirT = r.RH = NAN;
+
+    auto const reason = this->m_ReportPolicy.evaluate(r, Hal::millis());
+
+    if (this->isTraceEnabled(DebugFlags::kTrace))
+        Hal::safePrintf(
+            "report policy: %s\n",
+            cReportPolicy::getReasonName(reason)
+            );
+
+    this->m_fReportPending = (reason != cReportPolicy::Reason::kNone);
+    return this->m_fReportPending;
+    }
+
+// move the baseline if a measurement chosen by the policy was sent.
+void
+cMeasurementLoop::finishReport(
+    bool fSuccess
+    )
+    {
+    if (! this->m_fReportPending)
+        return;
+
+    this->m_ReportPolicy.acknowledge(fSuccess);
+    this->m_fReportPending = false;
+    }
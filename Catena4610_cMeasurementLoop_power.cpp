@@ -0,0 +1,216 @@
+/*
+
+Module: Catena4610_cMeasurementLoop_power.cpp
+
+Function:
+    Operating profiles chosen from the power source and battery state.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_hal.h"
+
+#include <cmath>
+
+using namespace McciCatena4610;
+using namespace McciCatena;
+
+/****************************************************************************\
+|
+|   Profiles
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::getOperatingProfile()
+
+Function:
+    Return the operating profile for a power level.
+
+Definition:
+    static OperatingProfile const &
+    McciCatena4610::cMeasurementLoop::getOperatingProfile(
+            std::uint8_t level
+            );
+
+Description:
+    On USB power there's no battery to save: uplinks are 8 times as
+    frequent, and confirmed. On battery the configured settings are used
+    as they are. As the battery runs down, the interval doubles at each
+    level, the OneWire probes are limited to coarser (faster)
+    conversions, and the sensors that aren't the point of the device are
+    dropped: ambient light first, then temperature/pressure/humidity.
+    The compost temperature is always measured.
+
+    The BME280 oversampling follows the power source separately; see
+    getBme280ActiveProfile().
+
+Returns:
+    The profile; levels out of range get the battery profile.
+
+*/
+
+cMeasurementLoop::OperatingProfile const &
+cMeasurementLoop::getOperatingProfile(
+    std::uint8_t level
+    )
+    {
+    static const OperatingProfile kProfiles[kNumPowerLevels] =
+        {
+        //  cycleShift  maxCompostBits  fLight  fEnv    fConfirmed
+        {   -3,         12,             true,   true,   true    },  // kPowerUsb
+        {   0,          12,             true,   true,   false   },  // kPowerBattery
+        {   1,          11,             false,  true,   false   },  // kPowerBatteryLow
+        {   2,          9,              false,  false,  false   },  // kPowerBatteryCritical
+        };
+
+    return kProfiles[level < kNumPowerLevels ? level : std::uint8_t(kPowerBattery)];
+    }
+
+// scale a sampling interval by the operating profile.
+std::uint32_t
+cMeasurementLoop::applyOperatingProfile(
+    std::uint32_t cycleSec
+    ) const
+    {
+    std::int8_t const shift = this->getOperatingProfile().cycleShift;
+
+    if (shift < 0)
+        {
+        std::uint32_t const sec = cycleSec >> -shift;
+
+        // don't make a short interval shorter still.
+        if (sec >= kMinProfileCycleSec)
+            return sec;
+        else if (cycleSec < kMinProfileCycleSec)
+            return cycleSec;
+        else
+            return kMinProfileCycleSec;
+        }
+    else if (cycleSec > (UINT32_MAX >> shift))
+        return UINT32_MAX;
+    else
+        return cycleSec << shift;
+    }
+
+void
+cMeasurementLoop::setPowerProfiles(
+    bool fEnable
+    )
+    {
+    this->m_AppConfig.setOption(cAppConfig::kOptionPowerProfilesOff, ! fEnable);
+    this->saveAppConfig();
+
+    // if the fast uplinks are done, switch the timer now.
+    if (this->m_txCycleCount == 0)
+        this->setTxCycleTime(this->getPermanentCycleSec(), 0);
+    }
+
+/****************************************************************************\
+|
+|   Power level
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::updatePowerLevel()
+
+Function:
+    Work out the power level from USB power and the last Vbat reading.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::updatePowerLevel(
+            void
+            );
+
+Description:
+    USB power is detected by setVbus(), which has its own hysteresis.
+    On battery, the level only gets worse when Vbat falls below a
+    threshold, and only gets better when Vbat rises kVbatHysteresis
+    above it, so a battery sagging under load or recovering in the sun
+    doesn't flip the profile every cycle. Until Vbat has been measured
+    the battery level is assumed.
+
+    When the level changes after the fast uplinks are done, the uplink
+    timer is restarted with the new interval. If a batch is being
+    collected, the change waits until the next sample ends the batch
+    (see addBatchSample()), so that every sample in a batch is taken at
+    the same interval.
+
+Returns:
+    No explicit result.
+
+*/
+
+void
+cMeasurementLoop::updatePowerLevel(
+    void
+    )
+    {
+    float const vbat = this->m_VbatLast;
+    PowerLevel level = this->m_PowerLevel;
+
+    if (this->m_fUsbPower)
+        level = kPowerUsb;
+    else if (level == kPowerUsb)
+        level = kPowerBattery;
+
+    if (level != kPowerUsb)
+        {
+        if (vbat < kVbatCriticalThreshold)
+            level = kPowerBatteryCritical;
+        else if (vbat < kVbatLowThreshold)
+            {
+            if (level != kPowerBatteryCritical ||
+                vbat >= kVbatCriticalThreshold + kVbatHysteresis)
+                level = kPowerBatteryLow;
+            }
+        else if (level == kPowerBatteryCritical)
+            {
+            if (vbat >= kVbatLowThreshold + kVbatHysteresis)
+                level = kPowerBattery;
+            else if (vbat >= kVbatCriticalThreshold + kVbatHysteresis)
+                level = kPowerBatteryLow;
+            }
+        else if (level == kPowerBatteryLow)
+            {
+            if (vbat >= kVbatLowThreshold + kVbatHysteresis)
+                level = kPowerBattery;
+            }
+        }
+
+    if (level == this->m_PowerLevel)
+        return;
+
+    this->m_PowerLevel = level;
+    this->m_EventTrace.record(
+        Hal::millis(),
+        cEventTrace::Type::kPower,
+        std::uint8_t(level),
+        std::isnan(vbat) ? 0 : std::uint16_t(vbat * 1000.0f),
+        this->m_fUsbPower
+        );
+
+    if (this->isTraceEnabled(DebugFlags::kTrace))
+        Hal::safePrintf(
+            "power: %s (Vbat %d mV)\n",
+            getPowerLevelName(level),
+            std::isnan(vbat) ? 0 : int(vbat * 1000.0f)
+            );
+
+    if (this->getPowerProfiles() && this->m_txCycleCount == 0)
+        {
+        if (this->isBatching() && this->m_nBatch > this->m_nBatchInFrame)
+            this->m_fBatchEnd = true;
+        else
+            this->setTxCycleTime(this->getPermanentCycleSec(), 0);
+        }
+    }
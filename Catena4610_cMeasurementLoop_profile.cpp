@@ -0,0 +1,109 @@
+/*
+
+Module: Catena4610_cMeasurementLoop_profile.cpp
+
+Function:
+    Awake-time and charge instrumentation for the measurement loop.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cMeasurementLoop.h"
+
+using namespace McciCatena4610;
+using namespace McciCatena;
+
+/****************************************************************************\
+|
+|   Current estimates
+|
+\****************************************************************************/
+
+namespace {
+
+struct StateCurrent
+    {
+    cMeasurementLoop::State     state;
+    std::uint32_t               currentUa;
+    bool                        fAwake;
+    };
+
+// rough average board currents in each state, in microamps. These are
+// only good enough to compare one configuration with another; measure
+// the board to get absolute numbers.
+const StateCurrent kStateCurrent[] =
+    {
+    { cMeasurementLoop::State::stInitial,         5000, true },
+    { cMeasurementLoop::State::stInactive,        1500, false },
+    { cMeasurementLoop::State::stSleeping,        1500, false },
+    { cMeasurementLoop::State::stWarmup,          5000, true },
+    { cMeasurementLoop::State::stMeasure,         7500, true },
+    { cMeasurementLoop::State::stTransmit,       30000, true },
+    { cMeasurementLoop::State::stBackfill,       30000, true },
+    { cMeasurementLoop::State::stRetry,          30000, true },
+    { cMeasurementLoop::State::stBatch,           5000, true },
+    { cMeasurementLoop::State::stFinal,           1500, false },
+    };
+
+std::uint16_t saturate16(std::uint32_t v)
+    {
+    return v > UINT16_MAX ? UINT16_MAX : std::uint16_t(v);
+    }
+
+} // namespace
+
+void
+cMeasurementLoop::initProfiler(
+    void
+    )
+    {
+    for (auto const &c : kStateCurrent)
+        this->m_Profiler.setState(std::uint8_t(c.state), c.currentUa, c.fAwake);
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::updateDiagMeasurement()
+
+Function:
+    Add the diagnostic extension field to the current measurement.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::updateDiagMeasurement(
+            void
+            );
+
+Description:
+    If diagnostic uplinks are enabled and a measurement cycle has been
+    completed, the awake time, estimated charge and transmit time of the
+    last complete cycle are added to m_data. The current cycle can't be
+    reported, as it's still going when the message is built.
+
+Returns:
+    No explicit result.
+
+*/
+
+void
+cMeasurementLoop::updateDiagMeasurement(
+    void
+    )
+    {
+    if (! this->m_fDiagUplink || this->m_Profiler.getCycleCount() < 2)
+        return;
+
+    auto const &cycle = this->m_Profiler.getLastCycle();
+    auto const &tx = this->m_Profiler.getState(std::uint8_t(State::stTransmit));
+
+    this->m_data.diag.AwakeMs = saturate16(cycle.awakeUs / 1000);
+    this->m_data.diag.Charge = saturate16(cycle.chargeUc / 10);
+    this->m_data.diag.TransmitMs = saturate16(tx.lastCycleUs / 1000);
+
+    this->m_data.flags |= MeasurementFormat::FlagExtended;
+    this->m_data.extFlags |= MeasurementFormat::kExtDiagnostics;
+    }
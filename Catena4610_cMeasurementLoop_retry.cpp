@@ -0,0 +1,281 @@
+/*
+
+Module: Catena4610_cMeasurementLoop_retry.cpp
+
+Function:
+    Retrying uplinks that failed, with backoff.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_hal.h"
+
+using namespace McciCatena4610;
+using namespace McciCatena;
+
+/****************************************************************************\
+|
+|   Scheduling
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::getRetryBackoffMs()
+
+Function:
+    Return how long to wait before the next attempt at a failed uplink.
+
+Definition:
+    static std::uint32_t McciCatena4610::cMeasurementLoop::getRetryBackoffMs(
+            std::uint8_t nTries
+            );
+
+Description:
+    The wait starts at kRetryBaseMs after the first failure, and doubles
+    with each further failure up to kRetryMaxBackoffMs. Up to a quarter
+    more is added at random, so that devices that lost the network at
+    the same time don't all retry together.
+
+Returns:
+    The wait in milliseconds.
+
+*/
+
+std::uint32_t
+cMeasurementLoop::getRetryBackoffMs(
+    std::uint8_t nTries
+    )
+    {
+    std::uint32_t wait = kRetryBaseMs;
+
+    for (std::uint8_t i = 1; i < nTries && wait < kRetryMaxBackoffMs; ++i)
+        wait *= 2;
+
+    if (wait > kRetryMaxBackoffMs)
+        wait = kRetryMaxBackoffMs;
+
+    return wait + Hal::micros() % (wait / 4 + 1);
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::getRetryWaitMs()
+
+Function:
+    Return how long until a retry can be sent.
+
+Definition:
+    std::uint32_t McciCatena4610::cMeasurementLoop::getRetryWaitMs(
+            void
+            ) const;
+
+Description:
+    A retry can go once the first queued entry is due and the LMIC's
+    duty-cycle limit allows an uplink.
+
+Returns:
+    Milliseconds until then; zero if a retry can go now; UINT32_MAX if
+    nothing is queued.
+
+*/
+
+std::uint32_t
+cMeasurementLoop::getRetryWaitMs(
+    void
+    ) const
+    {
+    if (this->m_RetryQueue.isEmpty())
+        return UINT32_MAX;
+
+    std::uint32_t const queueWait = this->m_RetryQueue.getWaitMs(Hal::millis());
+    std::uint32_t const dutyWait = Hal::getDutyCycleWaitMs();
+
+    return queueWait > dutyWait ? queueWait : dutyWait;
+    }
+
+/****************************************************************************\
+|
+|   Queueing and sending
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::queueRetry()
+
+Function:
+    Keep the frame that just failed, to be sent again later.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::queueRetry(
+            std::uint32_t logSlot,
+            std::uint8_t priority
+            );
+
+Description:
+    The frame in m_pTxFrame moves to the retry queue, to be sent again
+    on port 1 after getRetryBackoffMs(1). logSlot is the flash log slot
+    to mark sent when it gets through, or cFlashLog::kNoSlot.
+
+    If the queue is full, the oldest entry of the lowest priority is
+    dropped to make room; if every entry is of higher priority, the new
+    frame is dropped instead. Either way the measurement is still in
+    the flash log, if there is one, and will be backfilled.
+
+Returns:
+    No explicit result.
+
+*/
+
+void
+cMeasurementLoop::queueRetry(
+    std::uint32_t logSlot,
+    std::uint8_t priority
+    )
+    {
+    if (this->m_pTxFrame == nullptr)
+        return;
+
+    std::uint32_t const tNow = Hal::millis();
+    RetryQueue_t::Entry entry;
+    TxBuffer_t *pDropped;
+
+    entry.pFrame = this->m_pTxFrame;
+    entry.tQueued = tNow;
+    entry.tDue = tNow + getRetryBackoffMs(1);
+    entry.logSlot = logSlot;
+    entry.port = kUplinkPort;
+    entry.priority = priority;
+    entry.nTries = 1;
+
+    this->m_pTxFrame = nullptr;
+    this->m_RetryQueue.push(entry, pDropped);
+
+    if (pDropped != nullptr)
+        {
+        this->m_TxFrames.release(pDropped);
+        if (this->isTraceEnabled(DebugFlags::kWarning))
+            Hal::safePrintf("retry queue full: dropped an uplink\n");
+        }
+
+    if (this->isTraceEnabled(DebugFlags::kTrace))
+        Hal::safePrintf(
+            "retry: %u queued, next in %u ms\n",
+            this->m_RetryQueue.getn(),
+            this->getRetryWaitMs()
+            );
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::startRetry()
+
+Function:
+    Send the next retry that is due.
+
+Definition:
+    bool McciCatena4610::cMeasurementLoop::startRetry(
+            void
+            );
+
+Description:
+    Nothing is sent unless an entry is due, the LMIC is idle, and the
+    duty-cycle limit allows it. Entries too big for the current data
+    rate are dropped. The entry keeps its frame while it's being sent;
+    finishRetry() decides what happens to it.
+
+Returns:
+    true if a transmission was started.
+
+*/
+
+bool
+cMeasurementLoop::startRetry(
+    void
+    )
+    {
+    if (! this->isRetryDue())
+        return false;
+
+    auto pEntry = this->m_RetryQueue.getNext(Hal::millis());
+
+    // a batch made at a faster data rate may no longer fit; the LMIC
+    // would reject it on every attempt.
+    while (pEntry != nullptr && pEntry->pFrame->getn() > getMaxAppPayload())
+        {
+        if (this->isTraceEnabled(DebugFlags::kWarning))
+            Hal::safePrintf(
+                "retry: dropped a %u-byte uplink, too big for the data rate\n",
+                unsigned(pEntry->pFrame->getn())
+                );
+        this->m_TxFrames.release(this->m_RetryQueue.remove(pEntry));
+        pEntry = this->m_RetryQueue.getNext(Hal::millis());
+        }
+
+    if (pEntry == nullptr)
+        return false;
+
+    if (this->isTraceEnabled(DebugFlags::kTrace))
+        Hal::safePrintf("retry: attempt %u\n", pEntry->nTries + 1);
+
+    this->m_pRetry = pEntry;
+    this->startTransmission(pEntry->pFrame, pEntry->port);
+    return true;
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::finishRetry()
+
+Function:
+    Dispose of a retry once its send completes.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::finishRetry(
+            bool fSuccess
+            );
+
+Description:
+    If the send worked, the log slot is marked sent and the frame goes
+    back to the pool. Otherwise the entry is rescheduled with a longer
+    backoff, or dropped after kRetryMaxTries attempts.
+
+Returns:
+    No explicit result.
+
+*/
+
+void
+cMeasurementLoop::finishRetry(
+    bool fSuccess
+    )
+    {
+    auto const pEntry = this->m_pRetry;
+
+    // the entry still owns the frame.
+    this->m_pTxFrame = nullptr;
+    this->m_pRetry = nullptr;
+
+    if (pEntry == nullptr)
+        return;
+
+    if (! fSuccess && ++pEntry->nTries < kRetryMaxTries)
+        {
+        pEntry->tDue = Hal::millis() + getRetryBackoffMs(pEntry->nTries);
+        return;
+        }
+
+    if (fSuccess)
+        this->markLogSent(pEntry->logSlot);
+    else if (this->isTraceEnabled(DebugFlags::kWarning))
+        Hal::safePrintf("retry: giving up after %u attempts\n", pEntry->nTries);
+
+    this->m_TxFrames.release(this->m_RetryQueue.remove(pEntry));
+    }
@@ -0,0 +1,205 @@
+/*
+
+Module: Catena4610_cMeasurementLoop_sensorTasks.cpp
+
+Function:
+    Asynchronous sensor acquisition for the measurement loop.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_hal.h"
+
+using namespace McciCatena4610;
+using namespace McciCatena;
+
+/****************************************************************************\
+|
+|   The sensor tasks
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::startSensorTasks()
+
+Function:
+    Start the sensors that take a while to convert.
+
+Definition:
+    void McciCatena4610::cMeasurementLoop::startSensorTasks(
+            void
+            );
+
+Description:
+    A BME280 forced conversion and the Si1133 one-time measurement are
+    started, and the OneWire probes are powered. Each becomes a task
+    that pollSensorTasks() advances until it finishes or its own timeout
+    expires, so the measurement takes as long as the slowest sensor
+    rather than the sum of them.
+
+    Intermediate samples (see startOversample()) skip the BME280 and the
+    Si1133, and the operating profile may skip either of them (see
+    getOperatingProfile()).
+
+    Vbat and Vbus must already have been measured, as they decide
+    whether the OneWire probes need the boost regulator.
+
+Returns:
+    No explicit result.
+
+*/
+
+void
+cMeasurementLoop::startSensorTasks(
+    void
+    )
+    {
+    this->m_SensorTaskBusy = 0;
+
+    if (this->isEnvActive() && ! this->m_fIntermediateSample)
+        {
+        if (this->startBme280Conversion())
+            this->startSensorTask(
+                kTaskEnv,
+                this->m_Bme280ConversionMs + kBme280TimeoutMarginMs
+                );
+        else if (this->isTraceEnabled(this->DebugFlags::kError))
+            Hal::safePrintf("BME280 didn't start\n");
+        }
+
+    if (this->isLightActive() && ! this->m_fIntermediateSample)
+        {
+        this->m_tSi1133Start = Hal::micros();
+        Hal::si1133Start();
+        this->startSensorTask(kTaskLight, kLightTimeoutMs);
+        }
+
+    // the timeout is set when the conversion starts.
+    if (Sensors::Compost::kEnabled)
+        {
+        this->powerUpCompostSensor();
+        this->startSensorTask(kTaskCompost, 0);
+        }
+    }
+
+void
+cMeasurementLoop::startSensorTask(
+    SensorTask iTask,
+    std::uint32_t timeoutMs
+    )
+    {
+    this->m_tSensorTaskStart[iTask] = Hal::millis();
+    this->m_SensorTaskTimeoutMs[iTask] = timeoutMs;
+    this->m_SensorTaskBusy |= 1u << iTask;
+    }
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::pollSensorTasks()
+
+Function:
+    Advance the running sensor tasks.
+
+Definition:
+    bool McciCatena4610::cMeasurementLoop::pollSensorTasks(
+            void
+            );
+
+Description:
+    Each running task collects its result if it's ready, or gives up if
+    its timeout has expired. The BME280 isn't asked until its maximum
+    conversion time has passed. The compost task first waits for the probe
+    rails to settle, then starts the conversion and sets its timeout
+    from the conversion time.
+
+Returns:
+    true if all the tasks have finished.
+
+*/
+
+bool
+cMeasurementLoop::pollSensorTasks(
+    void
+    )
+    {
+    // testing kEnabled lets the compiler drop absent drivers.
+    if (Sensors::Bme280::kEnabled && this->isSensorTaskBusy(kTaskEnv))
+        {
+        if (Hal::millis() - this->m_tSensorTaskStart[kTaskEnv] < this->m_Bme280ConversionMs)
+            ;
+#if CATENA4610_SENSOR_BME280
+        else if (! this->m_BME280.isBusy())
+            {
+            this->finishBme280Measurement(true);
+            this->finishSensorTask(kTaskEnv, true);
+            }
+#endif
+        else if (this->isSensorTaskExpired(kTaskEnv))
+            {
+            this->finishBme280Measurement(false);
+            this->finishSensorTask(kTaskEnv, false);
+            if (this->isTraceEnabled(this->DebugFlags::kError))
+                Hal::safePrintf("BME280 timed out\n");
+            }
+        }
+
+    if (Sensors::Si1133::kEnabled && this->isSensorTaskBusy(kTaskLight))
+        {
+        if (Hal::si1133IsReady())
+            {
+            this->m_Profiler.addSensor(
+                kProfileSi1133, Hal::micros() - this->m_tSi1133Start
+                );
+            this->updateLightMeasurements();
+            this->finishSensorTask(kTaskLight, true);
+            }
+        else if (this->isSensorTaskExpired(kTaskLight))
+            {
+            Hal::si1133Stop();
+            this->finishSensorTask(kTaskLight, false);
+            if (this->isTraceEnabled(this->DebugFlags::kError))
+                Hal::safePrintf("S1133 timed out\n");
+            }
+        }
+
+    if (Sensors::Compost::kEnabled && this->isSensorTaskBusy(kTaskCompost))
+        {
+        if (! this->m_fCompostPending)
+            {
+            // waiting for the rails to settle.
+            if (! this->isCompostSensorSettled())
+                ;
+            else if (this->startCompostConversion())
+                this->startSensorTask(
+                    kTaskCompost,
+                    this->getCompostConversionRemaining() + kCompostTimeoutMarginMs
+                    );
+            else
+                this->finishSensorTask(kTaskCompost, false);
+            }
+        else if (this->isCompostMeasurementReady())
+            {
+            this->finishCompostMeasurement(true);
+            this->finishSensorTask(kTaskCompost, true);
+            }
+        else if (this->isSensorTaskExpired(kTaskCompost))
+            {
+            // search again next time; this also rereads each probe's
+            // resolution, in case one is slower than we thought.
+            this->invalidateCompostProbes();
+            this->finishCompostMeasurement(false);
+            this->finishSensorTask(kTaskCompost, false);
+            if (this->isTraceEnabled(this->DebugFlags::kError))
+                Hal::safePrintf("Compost sensor timed out\n");
+            }
+        }
+
+    return ! this->isSensorTaskBusy();
+    }
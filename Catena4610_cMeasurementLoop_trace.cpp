@@ -0,0 +1,143 @@
+/*
+
+Module: Catena4610_cMeasurementLoop_trace.cpp
+
+Function:
+    Text form of the measurement loop's event trace.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cMeasurementLoop.h"
+
+#include <cstdio>
+
+using namespace McciCatena4610;
+
+/*
+
+Name:   McciCatena4610::cMeasurementLoop::formatTraceEvent()
+
+Function:
+    Format one event of the trace as a line of text.
+
+Definition:
+    static std::size_t
+    McciCatena4610::cMeasurementLoop::formatTraceEvent(
+            char *pBuf,
+            std::size_t nBuf,
+            cEventTrace::Event const &e
+            );
+
+Description:
+    This is the line the "trace" command prints for e, and what
+    host/traceReplay parses, so the two must change together. Each line
+    starts with the time in ms, then a keyword:
+
+        state <name>
+        sensor <task> ok|failed <latency> ms
+        value <name>[<index>] <value * 1000>/1000 bits <float, in hex>
+        tx port <port> len <n> confirmed|unconfirmed hash <hash>
+        txdone ok|failed
+        power <level> vbat <mV> mV usb 0|1
+        provisioned 0|1
+
+    Values are printed in hex as well, so a replay gets exactly the
+    value the device read.
+
+Returns:
+    The length of the line, as for snprintf().
+
+*/
+
+std::size_t
+cMeasurementLoop::formatTraceEvent(
+    char *pBuf,
+    std::size_t nBuf,
+    cEventTrace::Event const &e
+    )
+    {
+    int n;
+
+    switch (e.type)
+        {
+    case cEventTrace::Type::kState:
+        n = std::snprintf(pBuf, nBuf, "%10u state %s",
+                unsigned(e.t),
+                getStateName(State(e.a))
+                );
+        break;
+
+    case cEventTrace::Type::kSensor:
+        n = std::snprintf(pBuf, nBuf, "%10u sensor %s %s %u ms",
+                unsigned(e.t),
+                getSensorTaskName(e.a),
+                e.b ? "ok" : "failed",
+                unsigned(e.c)
+                );
+        break;
+
+    case cEventTrace::Type::kValue:
+        {
+        float const v = cEventTrace::getValue(e);
+
+        n = std::snprintf(pBuf, nBuf, "%10u value %s[%u] %ld/1000 bits %08x",
+                unsigned(e.t),
+                cEventTrace::getValueName(e.a),
+                unsigned(e.b),
+                std::isnan(v) ? 0l : long(v * 1000.0f),
+                unsigned(e.c)
+                );
+        }
+        break;
+
+    case cEventTrace::Type::kTxStart:
+        n = std::snprintf(pBuf, nBuf, "%10u tx port %u len %u %s hash %08x",
+                unsigned(e.t),
+                unsigned(e.a),
+                unsigned(e.b & 0x7FFF),
+                (e.b & 0x8000) ? "confirmed" : "unconfirmed",
+                unsigned(e.c)
+                );
+        break;
+
+    case cEventTrace::Type::kTxDone:
+        n = std::snprintf(pBuf, nBuf, "%10u txdone %s",
+                unsigned(e.t),
+                e.a ? "ok" : "failed"
+                );
+        break;
+
+    case cEventTrace::Type::kPower:
+        n = std::snprintf(pBuf, nBuf, "%10u power %s vbat %u mV usb %u",
+                unsigned(e.t),
+                getPowerLevelName(e.a),
+                unsigned(e.b),
+                unsigned(e.c)
+                );
+        break;
+
+    case cEventTrace::Type::kProvisioned:
+        n = std::snprintf(pBuf, nBuf, "%10u provisioned %u",
+                unsigned(e.t),
+                unsigned(e.a)
+                );
+        break;
+
+    default:
+        n = std::snprintf(pBuf, nBuf, "%10u <<unknown>> %u %u %u",
+                unsigned(e.t),
+                unsigned(e.a),
+                unsigned(e.b),
+                unsigned(e.c)
+                );
+        break;
+        }
+
+    return n < 0 ? 0 : std::size_t(n);
+    }
@@ -0,0 +1,231 @@
+/*
+
+Module: Catena4610_cPayloadDecoder.cpp
+
+Function:
+    Reference decoder for the uplink formats.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cPayloadDecoder.h"
+
+using namespace McciCatena4610;
+
+/****************************************************************************\
+|
+|   Stateless formats
+|
+\****************************************************************************/
+
+cPayloadDecoder::Status
+cPayloadDecoder::decodeUplink(
+    const std::uint8_t *pBuffer,
+    std::size_t nBuffer,
+    Values &v
+    )
+    {
+    cPayloadReader r(pBuffer, nBuffer);
+
+    if (r.get() != 0x15)
+        return Status::kBadFormat;
+
+    v = Values {};
+    if (! cPayloadEncoder::decodeFields(r, v, nullptr))
+        return Status::kTruncated;
+
+    return Status::kOk;
+    }
+
+/*
+
+Name:   McciCatena4610::cPayloadDecoder::decodeBatch()
+
+Function:
+    Decode a format 0x16 message.
+
+Definition:
+    static cPayloadDecoder::Status
+    McciCatena4610::cPayloadDecoder::decodeBatch(
+            const std::uint8_t *pBuffer,
+            std::size_t nBuffer,
+            Values *pOut,
+            std::uint8_t nOut,
+            std::uint8_t &nSamples,
+            std::uint16_t &intervalSec,
+            bool &fHeldBack
+            );
+
+Description:
+    nSamples is set to the number of samples in the message, and the
+    first nOut of them are stored at pOut. Samples past nOut are still
+    decoded, so that a truncated message is always reported. fHeldBack
+    is set if the newest sample was taken one interval before the
+    message was sent.
+
+Returns:
+    Status::kOk if the whole message was decoded.
+
+*/
+
+cPayloadDecoder::Status
+cPayloadDecoder::decodeBatch(
+    const std::uint8_t *pBuffer,
+    std::size_t nBuffer,
+    Values *pOut,
+    std::uint8_t nOut,
+    std::uint8_t &nSamples,
+    std::uint16_t &intervalSec,
+    bool &fHeldBack
+    )
+    {
+    cPayloadReader r(pBuffer, nBuffer);
+    Values last {};
+
+    if (r.get() != 0x16)
+        return Status::kBadFormat;
+
+    std::uint8_t const count = r.get();
+
+    nSamples = count & 0x7F;
+    fHeldBack = (count & 0x80) != 0;
+    intervalSec = r.get2();
+
+    for (std::uint8_t iSample = 0; iSample < nSamples; ++iSample)
+        {
+        Values s {};
+
+        if (! cPayloadEncoder::decodeFields(r, s, iSample == 0 ? nullptr : &last))
+            return Status::kTruncated;
+
+        cPayloadEncoder::updateReference(last, s);
+        if (iSample < nOut)
+            pOut[iSample] = s;
+        }
+
+    return r.isError() ? Status::kTruncated : Status::kOk;
+    }
+
+/****************************************************************************\
+|
+|   Delta frames
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cPayloadDecoder::decodeDelta()
+
+Function:
+    Decode a format 0x17 message.
+
+Definition:
+    cPayloadDecoder::Status
+    McciCatena4610::cPayloadDecoder::decodeDelta(
+            const std::uint8_t *pBuffer,
+            std::size_t nBuffer,
+            Values &v,
+            std::uint8_t &seq,
+            bool &fKeyframe
+            );
+
+Description:
+    A keyframe is decoded on its own. A delta frame is decoded against
+    the remembered frame with its reference sequence number. Either way,
+    the result is remembered as a possible reference for later frames;
+    like the device, it carries forward components of fields that the
+    frame did not include.
+
+Returns:
+    Status::kOk if the frame was decoded. seq and fKeyframe are set
+    whenever the header could be read.
+
+*/
+
+cPayloadDecoder::Status
+cPayloadDecoder::decodeDelta(
+    const std::uint8_t *pBuffer,
+    std::size_t nBuffer,
+    Values &v,
+    std::uint8_t &seq,
+    bool &fKeyframe
+    )
+    {
+    cPayloadReader r(pBuffer, nBuffer);
+
+    if (r.get() != cDeltaEncoder::kFormat)
+        return Status::kBadFormat;
+
+    std::uint8_t const ctrl = r.get();
+
+    seq = ctrl & cDeltaEncoder::kSeqMask;
+    fKeyframe = (ctrl & cDeltaEncoder::kKeyframe) != 0;
+
+    Values const *pRef = nullptr;
+    Values next {};
+
+    if (! fKeyframe)
+        {
+        auto const pEntry = this->findReference(r.get());
+
+        if (r.isError())
+            return Status::kTruncated;
+        if (pEntry == nullptr)
+            return Status::kNoReference;
+
+        pRef = &pEntry->ref;
+        next = pEntry->ref;
+        }
+
+    v = Values {};
+    if (! cPayloadEncoder::decodeFields(r, v, pRef))
+        return Status::kTruncated;
+
+    cPayloadEncoder::updateReference(next, v);
+    this->remember(seq, next);
+
+    return Status::kOk;
+    }
+
+cPayloadDecoder::HistoryEntry const *
+cPayloadDecoder::findReference(
+    std::uint8_t seq
+    ) const
+    {
+    for (auto const &h : this->m_History)
+        {
+        if (h.fValid && h.seq == seq)
+            return &h;
+        }
+
+    return nullptr;
+    }
+
+void
+cPayloadDecoder::remember(
+    std::uint8_t seq,
+    Values const &ref
+    )
+    {
+    // replace an older frame with the same number, if any.
+    for (auto &h : this->m_History)
+        {
+        if (h.fValid && h.seq == seq)
+            {
+            h.ref = ref;
+            return;
+            }
+        }
+
+    auto &h = this->m_History[this->m_iNext];
+
+    h.fValid = true;
+    h.seq = seq;
+    h.ref = ref;
+    this->m_iNext = (this->m_iNext + 1) % kHistory;
+    }
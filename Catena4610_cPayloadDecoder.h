@@ -0,0 +1,120 @@
+/*
+
+Module: Catena4610_cPayloadDecoder.h
+
+Function:
+    Reference decoder for the uplink formats.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_cPayloadDecoder_h_
+# define _Catena4610_cPayloadDecoder_h_
+
+#pragma once
+
+#include "Catena4610_cPayloadEncoder.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatena4610 {
+
+/*
+
+Name:   McciCatena4610::cPayloadDecoder
+
+Function:
+    Decode formats 0x15, 0x16 and 0x17 back to over-the-air integers.
+
+Description:
+    This is the C++ counterpart of extra/WeRadiate-decoder-*.js. It is
+    used on the device to check the encoders, and can be built on a host
+    to check network-side decoders against it.
+
+    Format 0x17 delta frames need the frame they refer to, so the decoder
+    keeps the last kHistory frames it has decoded, by sequence number.
+    Use one decoder per device.
+
+*/
+
+class cPayloadDecoder
+    {
+public:
+    using Values = cPayloadEncoder::Values;
+
+    // number of 0x17 frames remembered as possible references.
+    static constexpr std::uint8_t kHistory = 8;
+
+    enum class Status : std::uint8_t
+        {
+        kOk,
+        kBadFormat,         // not a format this decoder knows
+        kTruncated,         // message too short, or bad varint
+        kNoReference,       // 0x17 delta frame whose reference is unknown
+        };
+
+    cPayloadDecoder()
+        : m_History {}
+        , m_iNext(0)
+        {}
+
+    // forget all 0x17 references.
+    void reset()
+        {
+        for (auto &h : this->m_History)
+            h.fValid = false;
+        this->m_iNext = 0;
+        }
+
+    // decode fields 0..5 of a format 0x15 message. Extension fields
+    // are not decoded.
+    static Status decodeUplink(
+        const std::uint8_t *pBuffer,
+        std::size_t nBuffer,
+        Values &v
+        );
+
+    // decode a format 0x16 message into up to nOut samples, oldest first.
+    static Status decodeBatch(
+        const std::uint8_t *pBuffer,
+        std::size_t nBuffer,
+        Values *pOut,
+        std::uint8_t nOut,
+        std::uint8_t &nSamples,
+        std::uint16_t &intervalSec,
+        bool &fHeldBack
+        );
+
+    // decode a format 0x17 message.
+    Status decodeDelta(
+        const std::uint8_t *pBuffer,
+        std::size_t nBuffer,
+        Values &v,
+        std::uint8_t &seq,
+        bool &fKeyframe
+        );
+
+private:
+    struct HistoryEntry
+        {
+        bool            fValid;
+        std::uint8_t    seq;
+        Values          ref;
+        };
+
+    HistoryEntry const *findReference(std::uint8_t seq) const;
+    void remember(std::uint8_t seq, Values const &ref);
+
+    HistoryEntry        m_History[kHistory];
+    std::uint8_t        m_iNext;
+    };
+
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_cPayloadDecoder_h_ */
@@ -0,0 +1,338 @@
+/*
+
+Module: Catena4610_cPayloadEncoder.cpp
+
+Function:
+    Compact encoding of measurement fields for uplinks.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cPayloadEncoder.h"
+
+#include <cmath>
+
+using namespace McciCatena4610;
+
+/****************************************************************************\
+|
+|   Component tables
+|
+\****************************************************************************/
+
+namespace {
+
+// the field (bitmap bit) that each component belongs to.
+const std::uint8_t kCompField[cPayloadEncoder::kNumComp] =
+    {
+    1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 3, 1 << 3, 1 << 4, 1 << 5
+    };
+
+// the size in bytes of each component when sent in full.
+constexpr std::uint8_t kCompSize[cPayloadEncoder::kNumComp] =
+    {
+    2, 2, 1, 2, 2, 1, 2, 2
+    };
+
+// the most varint bytes that a difference of each component can need.
+constexpr std::size_t getMaxDeltaFieldsSize(unsigned iComp = 0)
+    {
+    return iComp == cPayloadEncoder::kNumComp
+                ? 1
+                : (kCompSize[iComp] == 2 ? 3 : 2) +
+                  getMaxDeltaFieldsSize(iComp + 1);
+    }
+
+static_assert(
+    cDeltaEncoder::kMaxMessageSize == 3 + getMaxDeltaFieldsSize(),
+    "cDeltaEncoder::kMaxMessageSize doesn't match the component sizes"
+    );
+
+// which components are signed when sent in full.
+const bool kCompSigned[cPayloadEncoder::kNumComp] =
+    {
+    true, true, false, true, false, false, false, true
+    };
+
+} // namespace
+
+std::uint8_t
+cPayloadEncoder::getField(
+    unsigned iComp
+    )
+    {
+    return iComp < kNumComp ? kCompField[iComp] : 0;
+    }
+
+std::uint8_t
+cPayloadEncoder::getSize(
+    unsigned iComp
+    )
+    {
+    return iComp < kNumComp ? kCompSize[iComp] : 0;
+    }
+
+bool
+cPayloadEncoder::isSigned(
+    unsigned iComp
+    )
+    {
+    return iComp < kNumComp ? kCompSigned[iComp] : false;
+    }
+
+std::int32_t
+cPayloadEncoder::scaleAndClamp(
+    float v,
+    float scale,
+    std::int32_t vMin,
+    std::int32_t vMax
+    )
+    {
+    float const r = std::round(v * scale);
+
+    if (! (r > float(vMin)))
+        return vMin;
+    else if (r > float(vMax))
+        return vMax;
+    else
+        return std::int32_t(r);
+    }
+
+/****************************************************************************\
+|
+|   Encoding and decoding fields
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cPayloadEncoder::encodeFields()
+
+Function:
+    Write a bitmap and the fields it names.
+
+Definition:
+    static void McciCatena4610::cPayloadEncoder::encodeFields(
+            cPayloadWriter &w,
+            Values const &cur,
+            Values const *pRef
+            );
+
+Description:
+    The bitmap is cur.flags, restricted to kFieldMask. If pRef is null,
+    each component of each field present is written in full, exactly as
+    in format 0x15. Otherwise each is written as the zig-zag varint of
+    the difference from the same component of *pRef.
+
+Returns:
+    No explicit result.
+
+*/
+
+void
+cPayloadEncoder::encodeFields(
+    cPayloadWriter &w,
+    Values const &cur,
+    Values const *pRef
+    )
+    {
+    std::uint8_t const flags = cur.flags & kFieldMask;
+
+    w.put(flags);
+
+    for (unsigned iComp = 0; iComp < kNumComp; ++iComp)
+        {
+        if ((flags & kCompField[iComp]) == 0)
+            continue;
+
+        if (pRef != nullptr)
+            w.putDelta(cur.v[iComp] - pRef->v[iComp]);
+        else if (kCompSize[iComp] == 2)
+            w.put2(std::uint32_t(cur.v[iComp]));
+        else
+            w.put(std::uint8_t(cur.v[iComp]));
+        }
+    }
+
+/*
+
+Name:   McciCatena4610::cPayloadEncoder::decodeFields()
+
+Function:
+    Read a bitmap and fields written by encodeFields().
+
+Definition:
+    static bool McciCatena4610::cPayloadEncoder::decodeFields(
+            cPayloadReader &r,
+            Values &cur,
+            Values const *pRef
+            );
+
+Description:
+    pRef must be the same reference that was given to encodeFields().
+    Components of fields that are not present are set to zero.
+
+Returns:
+    false if the message was too short or had a bad varint.
+
+*/
+
+bool
+cPayloadEncoder::decodeFields(
+    cPayloadReader &r,
+    Values &cur,
+    Values const *pRef
+    )
+    {
+    std::uint8_t const flags = r.get();
+
+    cur.flags = flags;
+
+    for (unsigned iComp = 0; iComp < kNumComp; ++iComp)
+        {
+        std::int32_t v = 0;
+
+        if ((flags & kCompField[iComp]) == 0)
+            ;
+        else if (pRef != nullptr)
+            v = pRef->v[iComp] + r.getDelta();
+        else if (kCompSize[iComp] == 2)
+            {
+            v = r.get2();
+            if (kCompSigned[iComp] && (v & 0x8000))
+                v -= 0x10000;
+            }
+        else
+            v = r.get();
+
+        cur.v[iComp] = v;
+        }
+
+    return ! r.isError();
+    }
+
+void
+cPayloadEncoder::updateReference(
+    Values &ref,
+    Values const &cur
+    )
+    {
+    for (unsigned iComp = 0; iComp < kNumComp; ++iComp)
+        {
+        if ((cur.flags & kCompField[iComp]) != 0)
+            ref.v[iComp] = cur.v[iComp];
+        }
+    ref.flags |= cur.flags & kFieldMask;
+    }
+
+/****************************************************************************\
+|
+|   Delta frames
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cDeltaEncoder::encode()
+
+Function:
+    Encode a format 0x17 message.
+
+Definition:
+    std::size_t McciCatena4610::cDeltaEncoder::encode(
+            cPayloadEncoder::Values const &cur,
+            std::uint8_t *pBuffer,
+            std::size_t nBuffer
+            );
+
+Description:
+    The message is the format byte; a control byte with the keyframe
+    flag in bit 7 and the sequence number in bits 0..6; for delta frames
+    only, the sequence number of the reference frame; and then the
+    fields (see cPayloadEncoder::encodeFields()).
+
+    A keyframe is also sent whenever a delta frame would be no smaller
+    than one.
+
+    The frame becomes the new reference if acknowledge(true) is called
+    before the next encode(). If the message doesn't fit in nBuffer,
+    nothing is written past the end, the encoder's state is unchanged,
+    and the message must not be sent.
+
+Returns:
+    The size of the message, which may be larger than nBuffer.
+
+*/
+
+std::size_t
+cDeltaEncoder::encode(
+    cPayloadEncoder::Values const &cur,
+    std::uint8_t *pBuffer,
+    std::size_t nBuffer
+    )
+    {
+    bool fKeyframe =
+        ! this->m_fHaveRef ||
+        (this->m_KeyframeInterval != 0 &&
+         this->m_nSinceKeyframe >= this->m_KeyframeInterval);
+
+    if (! fKeyframe)
+        {
+        // a delta frame has one more header byte than a keyframe.
+        cPayloadWriter wKey(nullptr, 0);
+        cPayloadWriter wDelta(nullptr, 0);
+
+        cPayloadEncoder::encodeFields(wKey, cur, nullptr);
+        cPayloadEncoder::encodeFields(wDelta, cur, &this->m_Ref);
+        if (wDelta.getn() + 1 >= wKey.getn())
+            fKeyframe = true;
+        }
+
+    cPayloadWriter w(pBuffer, nBuffer);
+    std::uint8_t const seq = this->m_Seq;
+
+    w.put(kFormat);
+    w.put((fKeyframe ? kKeyframe : 0) | seq);
+    if (! fKeyframe)
+        w.put(this->m_RefSeq);
+
+    cPayloadEncoder::encodeFields(w, cur, fKeyframe ? nullptr : &this->m_Ref);
+
+    if (w.isOverflow())
+        return w.getn();
+
+    this->m_Seq = (seq + 1) & kSeqMask;
+    this->m_nSinceKeyframe = fKeyframe ? 1 : this->m_nSinceKeyframe + 1;
+
+    // remember what the receiver will reconstruct: a delta frame carries
+    // forward the reference's components for fields it doesn't include.
+    if (fKeyframe)
+        this->m_Pending = cPayloadEncoder::Values {};
+    else
+        this->m_Pending = this->m_Ref;
+    cPayloadEncoder::updateReference(this->m_Pending, cur);
+    this->m_PendingSeq = seq;
+    this->m_fPending = true;
+
+    return w.getn();
+    }
+
+void
+cDeltaEncoder::acknowledge(
+    bool fSuccess
+    )
+    {
+    if (this->m_fPending && fSuccess)
+        {
+        this->m_Ref = this->m_Pending;
+        this->m_RefSeq = this->m_PendingSeq;
+        this->m_fHaveRef = true;
+        }
+
+    this->m_fPending = false;
+    }
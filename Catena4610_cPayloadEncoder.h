@@ -0,0 +1,330 @@
+/*
+
+Module: Catena4610_cPayloadEncoder.h
+
+Function:
+    Compact encoding of measurement fields for uplinks.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_cPayloadEncoder_h_
+# define _Catena4610_cPayloadEncoder_h_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatena4610 {
+
+/****************************************************************************\
+|
+|   Byte-level writer and reader
+|
+\****************************************************************************/
+
+// write bytes to a buffer, counting them even if they don't fit; pass a
+// null buffer to just measure.
+class cPayloadWriter
+    {
+public:
+    cPayloadWriter(std::uint8_t *pBuffer, std::size_t nBuffer)
+        : m_pBuffer(pBuffer)
+        , m_nBuffer(pBuffer ? nBuffer : 0)
+        , m_n(0)
+        {}
+
+    void put(std::uint8_t v)
+        {
+        if (this->m_n < this->m_nBuffer)
+            this->m_pBuffer[this->m_n] = v;
+        ++this->m_n;
+        }
+
+    // big-endian 16 bits, as used by format 0x15.
+    void put2(std::uint32_t v)
+        {
+        this->put(std::uint8_t(v >> 8));
+        this->put(std::uint8_t(v));
+        }
+
+    // unsigned LEB128: 7 bits per byte, low bits first.
+    void putVarint(std::uint32_t v)
+        {
+        while (v >= 0x80)
+            {
+            this->put(std::uint8_t(v | 0x80));
+            v >>= 7;
+            }
+        this->put(std::uint8_t(v));
+        }
+
+    // zig-zag maps small negative and positive numbers to small codes.
+    void putDelta(std::int32_t v)
+        {
+        this->putVarint((std::uint32_t(v) << 1) ^ std::uint32_t(v >> 31));
+        }
+
+    std::size_t getn() const
+        {
+        return this->m_n;
+        }
+
+    bool isOverflow() const
+        {
+        return this->m_n > this->m_nBuffer;
+        }
+
+private:
+    std::uint8_t    *m_pBuffer;
+    std::size_t     m_nBuffer;
+    std::size_t     m_n;
+    };
+
+// the inverse of cPayloadWriter. Reading past the end returns zeros and
+// sets the error flag.
+class cPayloadReader
+    {
+public:
+    cPayloadReader(const std::uint8_t *pBuffer, std::size_t nBuffer)
+        : m_pBuffer(pBuffer)
+        , m_nBuffer(nBuffer)
+        , m_i(0)
+        , m_fError(false)
+        {}
+
+    std::uint8_t get()
+        {
+        if (this->m_i < this->m_nBuffer)
+            return this->m_pBuffer[this->m_i++];
+
+        this->m_fError = true;
+        return 0;
+        }
+
+    std::uint16_t get2()
+        {
+        std::uint16_t const hi = this->get();
+        return std::uint16_t((hi << 8) | this->get());
+        }
+
+    std::uint32_t getVarint()
+        {
+        std::uint32_t v = 0;
+
+        for (unsigned shift = 0; shift < 35; shift += 7)
+            {
+            std::uint8_t const b = this->get();
+
+            v |= std::uint32_t(b & 0x7F) << shift;
+            if ((b & 0x80) == 0)
+                return v;
+            }
+
+        this->m_fError = true;
+        return v;
+        }
+
+    std::int32_t getDelta()
+        {
+        std::uint32_t const zz = this->getVarint();
+        return std::int32_t(zz >> 1) ^ -std::int32_t(zz & 1);
+        }
+
+    std::size_t getIndex() const
+        {
+        return this->m_i;
+        }
+    std::size_t getRemaining() const
+        {
+        return this->m_nBuffer - this->m_i;
+        }
+    bool isError() const
+        {
+        return this->m_fError;
+        }
+
+private:
+    const std::uint8_t  *m_pBuffer;
+    std::size_t         m_nBuffer;
+    std::size_t         m_i;
+    bool                m_fError;
+    };
+
+/****************************************************************************\
+|
+|   Field encoding
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cPayloadEncoder
+
+Function:
+    Encode the format 0x15 fields 0..5 in full or as deltas.
+
+Description:
+    A measurement is first reduced to its over-the-air integers
+    (Values), one per component. Field 3 has three components; the
+    others have one. Fields can then be written in full, exactly as in
+    format 0x15, or as zig-zag varint differences from a reference.
+
+    Formats 0x16 (batch) and 0x17 (delta) are built from these.
+
+*/
+
+class cPayloadEncoder
+    {
+public:
+    // the components, in the order they're sent.
+    enum Component : unsigned
+        {
+        kVbat,          // volts * 4096, int16
+        kVbus,          // volts * 4096, int16
+        kBoot,          // boot count mod 256, uint8
+        kT,             // degrees C * 256, int16
+        kP,             // Pa / 4, uint16
+        kRH,            // % * 2.56, uint8
+        kLux,           // lux, uint16
+        kCompostT,      // degrees C * 256, int16
+        kNumComp
+        };
+
+    // the bitmap bits that can be carried.
+    static constexpr std::uint8_t kFieldMask = 0x3F;
+
+    // one measurement in over-the-air units. Components of fields that
+    // aren't present are zero.
+    struct Values
+        {
+        std::uint8_t                flags;
+        std::int32_t                v[kNumComp];
+        };
+
+    // the bitmap bit for a component
+    static std::uint8_t getField(unsigned iComp);
+    // the size in bytes of a component when sent in full
+    static std::uint8_t getSize(unsigned iComp);
+    // true if a component is signed when sent in full
+    static bool isSigned(unsigned iComp);
+
+    // scale a float and clamp it to [vMin, vMax]; NAN becomes vMin.
+    static std::int32_t scaleAndClamp(float v, float scale, std::int32_t vMin, std::int32_t vMax);
+
+    // write the bitmap and fields; in full if pRef is null, otherwise
+    // as differences from *pRef.
+    static void encodeFields(
+        cPayloadWriter &w,
+        Values const &cur,
+        Values const *pRef
+        );
+
+    // the inverse of encodeFields().
+    static bool decodeFields(
+        cPayloadReader &r,
+        Values &cur,
+        Values const *pRef
+        );
+
+    // copy the components present in cur into ref.
+    static void updateReference(Values &ref, Values const &cur);
+    };
+
+/****************************************************************************\
+|
+|   Delta frames (format 0x17)
+|
+\****************************************************************************/
+
+/*
+
+Name:   McciCatena4610::cDeltaEncoder
+
+Function:
+    Stateful encoder for format 0x17 messages.
+
+Description:
+    Each message is either a keyframe, with the fields in full, or a
+    delta frame, with the fields as differences from the last frame that
+    was acknowledged. Until a frame is acknowledged, and then every
+    m_KeyframeInterval frames, a keyframe is sent so that a receiver that
+    missed frames can resynchronize.
+
+    Call acknowledge() when the uplink of the last encoded frame
+    completes.
+
+*/
+
+class cDeltaEncoder
+    {
+public:
+    static constexpr std::uint8_t kFormat = 0x17;
+    // control byte: keyframe flag, and 7-bit sequence number
+    static constexpr std::uint8_t kKeyframe = 0x80;
+    static constexpr std::uint8_t kSeqMask = 0x7F;
+    // the largest 0x17 message: three header bytes, the bitmap, and
+    // every component as a worst-case difference. A difference of a
+    // 16-bit component needs 17 bits, 18 after zig-zag coding, so 3
+    // varint bytes; an 8-bit component needs 2.
+    static constexpr std::size_t kMaxMessageSize = 3 + 1 + 6 * 3 + 2 * 2;
+
+    cDeltaEncoder()
+        : m_KeyframeInterval(16)
+        , m_Seq(0)
+        , m_RefSeq(0)
+        , m_nSinceKeyframe(0)
+        , m_fHaveRef(false)
+        , m_fPending(false)
+        , m_Ref {}
+        , m_Pending {}
+        , m_PendingSeq(0)
+        {}
+
+    void setKeyframeInterval(std::uint8_t nFrames)
+        {
+        this->m_KeyframeInterval = nFrames;
+        }
+    std::uint8_t getKeyframeInterval() const
+        {
+        return this->m_KeyframeInterval;
+        }
+
+    // forget the reference; the next frame is a keyframe.
+    void reset()
+        {
+        this->m_fHaveRef = false;
+        this->m_fPending = false;
+        }
+
+    // encode a frame; returns its size, which may exceed nBuffer.
+    std::size_t encode(
+        cPayloadEncoder::Values const &cur,
+        std::uint8_t *pBuffer,
+        std::size_t nBuffer
+        );
+
+    // report the outcome of sending the last encoded frame.
+    void acknowledge(bool fSuccess);
+
+private:
+    std::uint8_t                    m_KeyframeInterval;
+    std::uint8_t                    m_Seq;
+    std::uint8_t                    m_RefSeq;
+    std::uint8_t                    m_nSinceKeyframe;
+    bool                            m_fHaveRef;
+    bool                            m_fPending;
+    cPayloadEncoder::Values         m_Ref;
+    cPayloadEncoder::Values         m_Pending;
+    std::uint8_t                    m_PendingSeq;
+    };
+
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_cPayloadEncoder_h_ */
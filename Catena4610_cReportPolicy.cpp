@@ -0,0 +1,121 @@
+/*
+
+Module: Catena4610_cReportPolicy.cpp
+
+Function:
+    Report-on-change uplink policy.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cReportPolicy.h"
+
+#include <cmath>
+
+using namespace McciCatena4610;
+
+/*
+
+Name:   McciCatena4610::cReportPolicy::evaluate()
+
+Function:
+    Decide whether to report a sample.
+
+Definition:
+    cReportPolicy::Reason McciCatena4610::cReportPolicy::evaluate(
+            Reading const &r,
+            std::uint32_t nowMs
+            );
+
+Description:
+    The tests are made in the order listed in the class description, and
+    the first that passes gives the reason. Times are compared by
+    difference, so millis() wrapping is harmless as long as the
+    heartbeat is less than 49 days.
+
+Returns:
+    The reason to report, or Reason::kNone.
+
+*/
+
+cReportPolicy::Reason
+cReportPolicy::evaluate(
+    Reading const &r,
+    std::uint32_t nowMs
+    )
+    {
+    Config const &c = this->m_Config;
+    Reason reason = Reason::kNone;
+
+    if (! this->m_fHaveReport)
+        reason = Reason::kFirst;
+    else if (nowMs - this->m_tReported >= c.heartbeatSec * 1000u)
+        reason = Reason::kHeartbeat;
+    else if (isOutsideDeadband(r.CompostT, this->m_Reported.CompostT, c.compostDeadband) ||
+             isOutsideDeadband(r.AirT, this->m_Reported.AirT, c.airDeadband) ||
+             isOutsideDeadband(r.RH, this->m_Reported.RH, c.rhDeadband))
+        reason = Reason::kDeadband;
+    else if (c.compostRate > 0 && this->m_fHavePrev &&
+             ! std::isnan(r.CompostT) && ! std::isnan(this->m_PrevCompostT))
+        {
+        std::uint32_t const dt = nowMs - this->m_tPrev;
+
+        if (dt != 0)
+            {
+            float const rate = std::fabs(r.CompostT - this->m_PrevCompostT) *
+                                (3600.0f * 1000.0f) / float(dt);
+
+            if (rate >= c.compostRate)
+                reason = Reason::kRate;
+            }
+        }
+
+    this->m_PrevCompostT = r.CompostT;
+    this->m_tPrev = nowMs;
+    this->m_fHavePrev = true;
+
+    if (reason != Reason::kNone)
+        {
+        this->m_Pending = r;
+        this->m_tPending = nowMs;
+        this->m_fPending = true;
+        }
+
+    return reason;
+    }
+
+void
+cReportPolicy::acknowledge(
+    bool fSuccess
+    )
+    {
+    if (this->m_fPending && fSuccess)
+        {
+        this->m_Reported = this->m_Pending;
+        this->m_tReported = this->m_tPending;
+        this->m_fHaveReport = true;
+        }
+
+    this->m_fPending = false;
+    }
+
+// a reading appearing or disappearing always counts as a change.
+bool
+cReportPolicy::isOutsideDeadband(
+    float v,
+    float ref,
+    float deadband
+    )
+    {
+    if (! (deadband > 0))
+        return false;
+    if (std::isnan(v) || std::isnan(ref))
+        return std::isnan(v) != std::isnan(ref);
+
+    return std::fabs(v - ref) >= deadband;
+    }
@@ -0,0 +1,152 @@
+/*
+
+Module: Catena4610_cReportPolicy.h
+
+Function:
+    Report-on-change uplink policy.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_cReportPolicy_h_
+# define _Catena4610_cReportPolicy_h_
+
+#pragma once
+
+#include <cstdint>
+
+namespace McciCatena4610 {
+
+/*
+
+Name:   McciCatena4610::cReportPolicy
+
+Function:
+    Decide whether a measurement is worth an uplink.
+
+Description:
+    When the policy is in use, the measurement loop samples every
+    Config::sampleSec, which is cheap, and only transmits when:
+
+    - nothing has been reported yet;
+    - Config::heartbeatSec has passed since the last report;
+    - a reading has moved by at least its deadband since the last
+      report, or a sensor has appeared or disappeared; or
+    - the compost temperature is changing faster than
+      Config::compostRate degrees C per hour, measured between
+      consecutive samples.
+
+    A deadband or rate of zero turns that test off. Readings are NAN if
+    they weren't measured.
+
+    evaluate() is called for every sample; if it returns a reason other
+    than kNone, the sample is sent, and acknowledge() is called when the
+    uplink completes. Only a successful uplink moves the baseline.
+
+*/
+
+class cReportPolicy
+    {
+public:
+    struct Config
+        {
+        std::uint32_t   sampleSec;          // how often to sample
+        std::uint32_t   heartbeatSec;       // longest time between reports
+        float           compostDeadband;    // degrees C
+        float           airDeadband;        // degrees C
+        float           rhDeadband;         // percent RH
+        float           compostRate;        // degrees C per hour
+        };
+
+    // the readings that the policy looks at.
+    struct Reading
+        {
+        float           CompostT;
+        float           AirT;
+        float           RH;
+        };
+
+    enum class Reason : std::uint8_t
+        {
+        kNone,          // don't report
+        kFirst,         // nothing reported yet
+        kHeartbeat,     // heartbeat deadline
+        kDeadband,      // a reading crossed its deadband
+        kRate,          // compost temperature rate-of-change alarm
+        };
+
+    static constexpr const char *getReasonName(Reason r)
+        {
+        return  r == Reason::kNone      ? "none" :
+                r == Reason::kFirst     ? "first" :
+                r == Reason::kHeartbeat ? "heartbeat" :
+                r == Reason::kDeadband  ? "deadband" :
+                r == Reason::kRate      ? "rate" :
+                                          "<<unknown>>";
+        }
+
+    cReportPolicy()
+        : m_Config { 5 * 60, 8 * 60 * 60, 0.5f, 1.0f, 5.0f, 2.0f }
+        , m_fHaveReport(false)
+        , m_fHavePrev(false)
+        , m_fPending(false)
+        {}
+
+    Config const &getConfig() const
+        {
+        return this->m_Config;
+        }
+    // change the configuration; the next sample is reported.
+    void setConfig(Config const &config)
+        {
+        this->m_Config = config;
+        if (this->m_Config.sampleSec == 0)
+            this->m_Config.sampleSec = 1;
+        this->reset();
+        }
+
+    // forget the baseline; the next sample is reported.
+    void reset()
+        {
+        this->m_fHaveReport = false;
+        this->m_fHavePrev = false;
+        this->m_fPending = false;
+        }
+
+    // decide whether to report a sample taken at nowMs.
+    Reason evaluate(Reading const &r, std::uint32_t nowMs);
+
+    // report the outcome of sending the last sample that evaluate()
+    // chose to report.
+    void acknowledge(bool fSuccess);
+
+private:
+    static bool isOutsideDeadband(float v, float ref, float deadband);
+
+    Config              m_Config;
+
+    // the last reading reported, and when.
+    Reading             m_Reported;
+    std::uint32_t       m_tReported;
+
+    // the previous sample, for the rate test.
+    float               m_PrevCompostT;
+    std::uint32_t       m_tPrev;
+
+    // the sample being sent.
+    Reading             m_Pending;
+    std::uint32_t       m_tPending;
+
+    bool                m_fHaveReport : 1;
+    bool                m_fHavePrev : 1;
+    bool                m_fPending : 1;
+    };
+
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_cReportPolicy_h_ */
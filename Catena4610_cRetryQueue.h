@@ -0,0 +1,196 @@
+/*
+
+Module: Catena4610_cRetryQueue.h
+
+Function:
+    Bounded queue of uplink frames waiting to be retried.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_cRetryQueue_h_
+# define _Catena4610_cRetryQueue_h_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatena4610 {
+
+/*
+
+Name:   McciCatena4610::cRetryQueue
+
+Function:
+    Hold failed uplinks until they're due to be tried again.
+
+Description:
+    Each entry refers to a frame (normally from a cTxFramePool); the
+    queue owns the frame while the entry is queued, and gives it back
+    when the entry is removed or evicted, so the caller can release it.
+
+    Entries have a priority and a due time. getNext() returns the
+    highest-priority entry that is due, oldest first. When the queue is
+    full, a new entry evicts the oldest entry of the lowest priority, if
+    that is no higher than its own: stale readings give way to fresh
+    ones. The queue does no timing itself; the caller sets the due
+    times (see cMeasurementLoop::queueRetry()).
+
+*/
+
+template <typename TFrame, std::uint8_t kCapacity>
+class cRetryQueue
+    {
+public:
+    enum Priority : std::uint8_t
+        {
+        kPriorityNormal,    // a single measurement
+        kPriorityHigh,      // several measurements (a batch)
+        };
+
+    struct Entry
+        {
+        TFrame                  *pFrame;
+        // Hal::millis() when first queued, and when next due
+        std::uint32_t           tQueued;
+        std::uint32_t           tDue;
+        // flash log slot to mark sent on success, or cFlashLog::kNoSlot
+        std::uint32_t           logSlot;
+        std::uint8_t            port;
+        std::uint8_t            priority;
+        // attempts that have failed so far
+        std::uint8_t            nTries;
+        };
+
+    cRetryQueue()
+        : m_n(0)
+        {}
+
+    std::uint8_t getn() const
+        {
+        return this->m_n;
+        }
+    bool isEmpty() const
+        {
+        return this->m_n == 0;
+        }
+
+    // add an entry. If the queue is full, pEvicted is set to the frame
+    // of the entry dropped to make room; if nothing could be dropped,
+    // it's set to e.pFrame and false is returned. Otherwise pEvicted is
+    // nullptr.
+    bool push(Entry const &e, TFrame *&pEvicted)
+        {
+        pEvicted = nullptr;
+
+        if (this->m_n == kCapacity)
+            {
+            std::uint8_t iVictim = 0;
+
+            for (std::uint8_t i = 1; i < this->m_n; ++i)
+                {
+                auto const &v = this->m_Entries[iVictim];
+                auto const &c = this->m_Entries[i];
+
+                if (c.priority < v.priority ||
+                    (c.priority == v.priority &&
+                     std::int32_t(c.tQueued - v.tQueued) < 0))
+                    iVictim = i;
+                }
+
+            if (this->m_Entries[iVictim].priority > e.priority)
+                {
+                pEvicted = e.pFrame;
+                return false;
+                }
+
+            pEvicted = this->m_Entries[iVictim].pFrame;
+            this->removeAt(iVictim);
+            }
+
+        this->m_Entries[this->m_n++] = e;
+        return true;
+        }
+
+    // the entry to try next, or nullptr if none is due at tNow.
+    Entry *getNext(std::uint32_t tNow)
+        {
+        Entry *pBest = nullptr;
+
+        for (std::uint8_t i = 0; i < this->m_n; ++i)
+            {
+            auto &c = this->m_Entries[i];
+
+            if (std::int32_t(tNow - c.tDue) < 0)
+                continue;
+
+            if (pBest == nullptr ||
+                c.priority > pBest->priority ||
+                (c.priority == pBest->priority &&
+                 std::int32_t(c.tQueued - pBest->tQueued) < 0))
+                pBest = &c;
+            }
+
+        return pBest;
+        }
+
+    // milliseconds until an entry is due: 0 if one is due now,
+    // UINT32_MAX if the queue is empty.
+    std::uint32_t getWaitMs(std::uint32_t tNow) const
+        {
+        std::uint32_t wait = UINT32_MAX;
+
+        for (std::uint8_t i = 0; i < this->m_n; ++i)
+            {
+            std::int32_t const d = std::int32_t(this->m_Entries[i].tDue - tNow);
+            std::uint32_t const w = d > 0 ? std::uint32_t(d) : 0;
+
+            if (w < wait)
+                wait = w;
+            }
+
+        return wait;
+        }
+
+    // make every entry due at tNow; used when the network is known to
+    // be reachable again.
+    void expedite(std::uint32_t tNow)
+        {
+        for (std::uint8_t i = 0; i < this->m_n; ++i)
+            this->m_Entries[i].tDue = tNow;
+        }
+
+    // remove an entry returned by getNext(); returns its frame.
+    TFrame *remove(Entry *pEntry)
+        {
+        std::ptrdiff_t const i = pEntry - this->m_Entries;
+
+        if (i < 0 || i >= this->m_n)
+            return nullptr;
+
+        TFrame * const pFrame = pEntry->pFrame;
+        this->removeAt(std::uint8_t(i));
+        return pFrame;
+        }
+
+private:
+    void removeAt(std::uint8_t i)
+        {
+        for (; i + 1 < this->m_n; ++i)
+            this->m_Entries[i] = this->m_Entries[i + 1];
+        --this->m_n;
+        }
+
+    Entry               m_Entries[kCapacity];
+    std::uint8_t        m_n;
+    };
+
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_cRetryQueue_h_ */
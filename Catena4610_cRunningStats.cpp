@@ -0,0 +1,81 @@
+/*
+
+Module: Catena4610_cRunningStats.cpp
+
+Function:
+    Running summary statistics of a series of readings.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cRunningStats.h"
+
+#include <cmath>
+
+using namespace McciCatena4610;
+
+/*
+
+Name:   McciCatena4610::cRunningStats::add()
+
+Function:
+    Add a reading to the summary.
+
+Definition:
+    void McciCatena4610::cRunningStats::add(
+            float v
+            );
+
+Description:
+    The minimum and maximum are updated directly. The mean moves by
+    (v - mean) / n, and the sum of squared differences grows by the
+    product of the differences from the old and new means.
+
+Returns:
+    No explicit result.
+
+*/
+
+void
+cRunningStats::add(
+    float v
+    )
+    {
+    if (std::isnan(v))
+        return;
+
+    if (this->m_n == 0)
+        {
+        this->m_Min = this->m_Max = v;
+        }
+    else
+        {
+        if (v < this->m_Min)
+            this->m_Min = v;
+        if (v > this->m_Max)
+            this->m_Max = v;
+        }
+
+    if (this->m_n == UINT16_MAX)
+        return;
+
+    ++this->m_n;
+
+    float const delta = v - this->m_Mean;
+
+    this->m_Mean += delta / float(this->m_n);
+    this->m_M2 += delta * (v - this->m_Mean);
+    }
+
+float
+cRunningStats::getStdDev(
+    void
+    ) const
+    {
+    return std::sqrt(this->getVariance());
+    }
@@ -0,0 +1,99 @@
+/*
+
+Module: Catena4610_cRunningStats.h
+
+Function:
+    Running summary statistics of a series of readings.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_cRunningStats_h_
+# define _Catena4610_cRunningStats_h_
+
+#pragma once
+
+#include <cstdint>
+
+namespace McciCatena4610 {
+
+/*
+
+Name:   McciCatena4610::cRunningStats
+
+Function:
+    Keep the count, minimum, maximum, mean and variance of readings
+    without storing them.
+
+Description:
+    The mean and variance are updated with Welford's method, which
+    stays accurate in single-precision float even when the readings are
+    large compared with their spread. Each add() is a few multiplies, so
+    the summary can be kept for every sample taken between uplinks.
+
+    NAN readings are ignored. The count saturates at 65535; after that
+    readings still update the minimum and maximum but not the mean.
+
+*/
+
+class cRunningStats
+    {
+public:
+    cRunningStats()
+        {
+        this->reset();
+        }
+
+    void reset()
+        {
+        this->m_n = 0;
+        this->m_Min = 0.0f;
+        this->m_Max = 0.0f;
+        this->m_Mean = 0.0f;
+        this->m_M2 = 0.0f;
+        }
+
+    // add a reading.
+    void add(float v);
+
+    std::uint16_t getCount() const
+        {
+        return this->m_n;
+        }
+    float getMin() const
+        {
+        return this->m_Min;
+        }
+    float getMax() const
+        {
+        return this->m_Max;
+        }
+    float getMean() const
+        {
+        return this->m_Mean;
+        }
+    // the sample variance; zero if there are fewer than two readings.
+    float getVariance() const
+        {
+        return this->m_n < 2 ? 0.0f : this->m_M2 / float(this->m_n - 1);
+        }
+    // the sample standard deviation.
+    float getStdDev() const;
+
+private:
+    std::uint16_t       m_n;
+    float               m_Min;
+    float               m_Max;
+    float               m_Mean;
+    // sum of squared differences from the mean
+    float               m_M2;
+    };
+
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_cRunningStats_h_ */
@@ -0,0 +1,154 @@
+/*
+
+Module: Catena4610_cStateProfiler.cpp
+
+Function:
+    Awake-time and charge accounting for the measurement FSM.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cStateProfiler.h"
+
+#include "Catena4610_hal.h"
+
+using namespace McciCatena4610;
+
+// charge the time since the last call to the current state.
+void
+cStateProfiler::accountElapsed(
+    void
+    )
+    {
+    std::uint32_t const tNowUs = Hal::micros();
+    std::uint32_t const tNowMs = Hal::millis();
+    std::uint32_t const dMs = tNowMs - this->m_tStateMs;
+    std::uint32_t us;
+
+    if (dMs < 60 * 1000)
+        us = tNowUs - this->m_tStateUs;
+    else if (dMs < UINT32_MAX / 1000)
+        us = dMs * 1000;
+    else
+        us = UINT32_MAX;
+
+    this->m_tStateUs = tNowUs;
+    this->m_tStateMs = tNowMs;
+
+    if (! this->m_fStarted)
+        return;
+
+    auto &s = this->m_State[this->m_iState];
+
+    s.totalUs += us;
+    s.cycleUs += us;
+
+    if (this->m_fStateAwake[this->m_iState])
+        this->m_Cycle.awakeUs += us;
+
+    this->addCharge(this->m_StateUa[this->m_iState], us);
+    }
+
+void
+cStateProfiler::addCharge(
+    std::uint32_t currentUa,
+    std::uint32_t us
+    )
+    {
+    this->m_Cycle.chargeUc += std::uint32_t(
+        (std::uint64_t(currentUa) * us) / 1000000u
+        );
+    }
+
+void
+cStateProfiler::enterState(
+    std::uint8_t iState
+    )
+    {
+    this->accountElapsed();
+
+    if (iState >= kMaxStates)
+        iState = 0;
+
+    this->m_iState = iState;
+    this->m_fStarted = true;
+    ++this->m_State[iState].nEntries;
+    }
+
+// close the cycle in progress, and start a new one.
+void
+cStateProfiler::startCycle(
+    void
+    )
+    {
+    this->accountElapsed();
+
+    for (auto &s : this->m_State)
+        {
+        s.lastCycleUs = s.cycleUs;
+        s.cycleUs = 0;
+        }
+
+    this->m_LastCycle = this->m_Cycle;
+    this->m_Cycle = CycleStats {};
+    ++this->m_nCycles;
+    }
+
+void
+cStateProfiler::addSensor(
+    std::uint8_t iSensor,
+    std::uint32_t us
+    )
+    {
+    if (iSensor >= kMaxSensors)
+        return;
+
+    auto &s = this->m_Sensor[iSensor];
+
+    s.lastUs = us;
+    if (us > s.maxUs)
+        s.maxUs = us;
+    ++s.n;
+    }
+
+void
+cStateProfiler::beginDeepSleep(
+    void
+    )
+    {
+    this->accountElapsed();
+    }
+
+void
+cStateProfiler::endDeepSleep(
+    std::uint32_t sleptMs
+    )
+    {
+    // don't charge whatever the clock did while asleep to the current
+    // state.
+    this->m_tStateUs = Hal::micros();
+    this->m_tStateMs = Hal::millis();
+
+    this->m_Cycle.deepSleepMs += sleptMs;
+    this->addCharge(kDeepSleepUa, sleptMs < UINT32_MAX / 1000 ? sleptMs * 1000 : UINT32_MAX);
+    }
+
+void
+cStateProfiler::reset(
+    void
+    )
+    {
+    for (auto &s : this->m_State)
+        s = StateStats {};
+    for (auto &s : this->m_Sensor)
+        s = SensorStats {};
+
+    this->m_Cycle = CycleStats {};
+    this->m_LastCycle = CycleStats {};
+    this->m_nCycles = 0;
+    }
@@ -0,0 +1,150 @@
+/*
+
+Module: Catena4610_cStateProfiler.h
+
+Function:
+    Awake-time and charge accounting for the measurement FSM.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_cStateProfiler_h_
+# define _Catena4610_cStateProfiler_h_
+
+#pragma once
+
+#include <cstdint>
+
+namespace McciCatena4610 {
+
+/*
+
+Name:   McciCatena4610::cStateProfiler
+
+Function:
+    Record where time, and so charge, goes in each measurement cycle.
+
+Description:
+    The owner calls enterState() on every state change, startCycle() at
+    the start of each measurement cycle, and addSensor() with the time
+    taken by each sensor read. Time in each state is kept for the cycle
+    in progress, for the last complete cycle, and in total.
+
+    Charge is estimated from a table of average currents per state, set
+    with setState(). States not marked awake (sleeping, idle) don't count
+    towards the awake time.
+
+    Time is measured with micros(), or with millis() for intervals over a
+    minute so that long sleeps don't wrap. Deep sleep is bracketed by
+    beginDeepSleep() and endDeepSleep(); the time slept is accounted
+    separately at kDeepSleepUa, whether or not the clock advanced.
+
+*/
+
+class cStateProfiler
+    {
+public:
+    static constexpr std::uint8_t kMaxStates = 16;
+    static constexpr std::uint8_t kMaxSensors = 8;
+    // rough average current in deep sleep, microamps
+    static constexpr std::uint32_t kDeepSleepUa = 30;
+
+    struct StateStats
+        {
+        std::uint64_t   totalUs;        // since boot or reset()
+        std::uint32_t   lastCycleUs;    // in the last complete cycle
+        std::uint32_t   cycleUs;        // in the cycle in progress
+        std::uint32_t   nEntries;       // times entered
+        };
+
+    struct SensorStats
+        {
+        std::uint32_t   lastUs;
+        std::uint32_t   maxUs;
+        std::uint32_t   n;
+        };
+
+    struct CycleStats
+        {
+        std::uint32_t   awakeUs;        // time in awake states
+        std::uint32_t   deepSleepMs;    // time in deep sleep
+        std::uint32_t   chargeUc;       // estimated charge, microcoulombs
+        };
+
+    cStateProfiler()
+        : m_State {}
+        , m_Sensor {}
+        , m_StateUa {}
+        , m_fStateAwake {}
+        , m_Cycle {}
+        , m_LastCycle {}
+        , m_nCycles(0)
+        , m_iState(0)
+        , m_tStateUs(0)
+        , m_tStateMs(0)
+        , m_tDeepSleepMs(0)
+        , m_fStarted(false)
+        {}
+
+    // set the average current and awake flag for a state.
+    void setState(std::uint8_t iState, std::uint32_t currentUa, bool fAwake)
+        {
+        if (iState < kMaxStates)
+            {
+            this->m_StateUa[iState] = currentUa;
+            this->m_fStateAwake[iState] = fAwake;
+            }
+        }
+
+    void enterState(std::uint8_t iState);
+    void startCycle();
+    void addSensor(std::uint8_t iSensor, std::uint32_t us);
+    void beginDeepSleep();
+    void endDeepSleep(std::uint32_t sleptMs);
+
+    // clear the statistics, but keep the state table.
+    void reset();
+
+    StateStats const &getState(std::uint8_t iState) const
+        {
+        return this->m_State[iState < kMaxStates ? iState : 0];
+        }
+    SensorStats const &getSensor(std::uint8_t iSensor) const
+        {
+        return this->m_Sensor[iSensor < kMaxSensors ? iSensor : 0];
+        }
+    CycleStats const &getLastCycle() const
+        {
+        return this->m_LastCycle;
+        }
+    std::uint32_t getCycleCount() const
+        {
+        return this->m_nCycles;
+        }
+
+private:
+    void accountElapsed();
+    void addCharge(std::uint32_t currentUa, std::uint32_t us);
+
+    StateStats          m_State[kMaxStates];
+    SensorStats         m_Sensor[kMaxSensors];
+    std::uint32_t       m_StateUa[kMaxStates];
+    bool                m_fStateAwake[kMaxStates];
+    CycleStats          m_Cycle;
+    CycleStats          m_LastCycle;
+    std::uint32_t       m_nCycles;
+    std::uint8_t        m_iState;
+    std::uint32_t       m_tStateUs;
+    std::uint32_t       m_tStateMs;
+    std::uint32_t       m_tDeepSleepMs;
+    bool                m_fStarted;
+    };
+
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_cStateProfiler_h_ */
@@ -0,0 +1,103 @@
+/*
+
+Module: Catena4610_cTxFramePool.h
+
+Function:
+    A small pool of uplink frame buffers.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_cTxFramePool_h_
+# define _Catena4610_cTxFramePool_h_
+
+#pragma once
+
+#include <Catena_TxBuffer.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatena4610 {
+
+/*
+
+Name:   McciCatena4610::cTxFramePool
+
+Function:
+    Own the buffers that uplinks are built in and sent from.
+
+Description:
+    An uplink is encoded straight into a frame from the pool, and the
+    radio is given a pointer to that frame. The frame stays allocated
+    until the send completes, so its contents outlive the FSM state that
+    built it, and nothing is copied on the way to the radio.
+
+    kFrameSize must be big enough for the largest message; kNumFrames is
+    how many can be held at once (for example, a batch waiting to go
+    while another is being sent).
+
+*/
+
+template <std::size_t kFrameSize, std::uint8_t kNumFrames>
+class cTxFramePool
+    {
+    static_assert(kNumFrames > 0 && kNumFrames <= 8, "kNumFrames must be 1..8");
+
+public:
+    using Frame_t = McciCatena::AbstractTxBuffer_t<kFrameSize>;
+
+    cTxFramePool()
+        : m_Busy(0)
+        {}
+
+    // get an empty frame; nullptr if they're all in use.
+    Frame_t *acquire()
+        {
+        for (std::uint8_t i = 0; i < kNumFrames; ++i)
+            {
+            if ((this->m_Busy & (1u << i)) == 0)
+                {
+                this->m_Busy |= 1u << i;
+                this->m_Frames[i].begin();
+                return &this->m_Frames[i];
+                }
+            }
+        return nullptr;
+        }
+
+    // return a frame to the pool; nullptr is ignored.
+    void release(Frame_t *pFrame)
+        {
+        for (std::uint8_t i = 0; i < kNumFrames; ++i)
+            {
+            if (pFrame == &this->m_Frames[i])
+                this->m_Busy &= ~(1u << i);
+            }
+        }
+
+    std::uint8_t getnFree() const
+        {
+        std::uint8_t n = 0;
+
+        for (std::uint8_t i = 0; i < kNumFrames; ++i)
+            {
+            if ((this->m_Busy & (1u << i)) == 0)
+                ++n;
+            }
+        return n;
+        }
+
+private:
+    Frame_t             m_Frames[kNumFrames];
+    std::uint8_t        m_Busy;
+    };
+
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_cTxFramePool_h_ */
@@ -19,6 +19,18 @@ Author:
 
 #include <Catena_CommandStream.h>
 
+McciCatena::cCommandStream::CommandFn cmdBatch;
+McciCatena::cCommandStream::CommandFn cmdBench;
+McciCatena::cCommandStream::CommandFn cmdBme280;
+McciCatena::cCommandStream::CommandFn cmdFormat;
+McciCatena::cCommandStream::CommandFn cmdLight;
+McciCatena::cCommandStream::CommandFn cmdLink;
 McciCatena::cCommandStream::CommandFn cmdLog;
+McciCatena::cCommandStream::CommandFn cmdOversample;
+McciCatena::cCommandStream::CommandFn cmdPolicy;
+McciCatena::cCommandStream::CommandFn cmdPower;
+McciCatena::cCommandStream::CommandFn cmdResolution;
+McciCatena::cCommandStream::CommandFn cmdStats;
+McciCatena::cCommandStream::CommandFn cmdTrace;
 
 #endif /* _Catena4610_cmd_h_ */
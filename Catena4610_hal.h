@@ -0,0 +1,557 @@
+/*
+
+Module: Catena4610_hal.h
+
+Function:
+    Hardware abstraction layer for the measurement loop.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_hal_h_
+# define _Catena4610_hal_h_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+
+Name:   CATENA4610_HOST_SIM
+
+Function:
+    Select the host simulation build of the measurement loop.
+
+Description:
+    Everything in cMeasurementLoop that touches the clock, the console,
+    sleep, the ADCs, the power-control pins, the sensors or the radio
+    goes through the functions in McciCatena4610::Hal. On the target
+    these are inline wrappers around the Arduino, Catena, sensor library
+    and LMIC calls, so there is no cost.
+
+    When CATENA4610_HOST_SIM is defined non-zero, none of those headers
+    is included, and the functions are only declared here. The host
+    build (see CMakeLists.txt) supplies them from a simulator with
+    a virtual clock, fake sensors and a fake radio, and supplies small
+    host versions of the platform classes the loop is built from (the
+    FSM, timer, pollable object, transmit buffer and SPI flash). This
+    lets the real fsmDispatch(), poll() and fillTxBuffer() run on a
+    workstation, so that months of uplink cycles can be simulated and
+    checked.
+
+*/
+
+#ifndef CATENA4610_HOST_SIM
+# define CATENA4610_HOST_SIM 0
+#endif
+
+#if ! CATENA4610_HOST_SIM
+# include <Arduino.h>
+# include <Wire.h>
+# include <SPI.h>
+# include <arduino_lmic.h>
+# include <Catena.h>
+# include <Catena_Si1133.h>
+# include <OneWire.h>
+# include <DallasTemperature.h>
+
+# include <cmath>
+
+extern McciCatena::Catena gCatena;
+extern McciCatena::Catena::LoRaWAN gLoRaWAN;
+extern McciCatena::StatusLed gLed;
+extern McciCatena::Catena_Si1133 gSi1133;
+extern OneWire oneWire;
+extern DallasTemperature sensor_CompostTemp;
+extern bool fHasCompostTemp;
+#endif
+
+class SPIClass;
+
+namespace McciCatena {
+class cPollableObject;
+} // namespace McciCatena
+
+namespace McciCatena4610 {
+namespace Hal {
+
+// completion callback for sendBuffer(); same shape as the LoRaWAN one.
+typedef void (SendBufferCbFn)(void *pClientData, bool fSuccess);
+
+// ROM address of a OneWire device.
+typedef std::uint8_t OneWireRom_t[8];
+
+#if CATENA4610_HOST_SIM
+
+// the status LED patterns the loop uses.
+enum class LedPattern : std::uint8_t
+    {
+    Off,
+    Measuring,
+    Sending,
+    Sleeping,
+    TwoShort,
+    };
+
+// D11 switches V_OUT2, which feeds the OneWire probes; D14 enables the
+// boost regulator.
+constexpr std::uint32_t kPinVout2 = 11;
+constexpr std::uint32_t kPinBoost = 14;
+constexpr std::uint32_t kPinModeInput = 0;
+constexpr std::uint32_t kPinModeOutput = 1;
+constexpr std::uint32_t kPinHigh = 1;
+
+//---- console ----
+void safePrintf(const char *pFmt, ...) __attribute__((__format__(__printf__, 1, 2)));
+//---- clock ----
+std::uint32_t millis(void);
+std::uint32_t micros(void);
+std::uint32_t getCycleCount(void);
+void delay(std::uint32_t ms);
+
+//---- platform ----
+float readVbat(void);
+float readVbus(void);
+bool getBootCount(std::uint32_t &bootCount);
+bool readAppConfig(std::uint8_t *pData, std::size_t nData);
+bool writeAppConfig(const std::uint8_t *pData, std::size_t nData);
+
+//---- power control and GPIO ----
+void pinMode(std::uint32_t pin, std::uint32_t mode);
+void digitalWrite(std::uint32_t pin, std::uint32_t value);
+
+//---- radio ----
+bool isProvisioned(void);
+std::uint8_t getDataRate(void);
+bool isRadioBusyWithin(std::uint32_t ms);
+std::uint32_t getDutyCycleWaitMs(void);
+bool getDownlinkSignal(std::int16_t &rssi, float &snr);
+void lowerDataRate(void);
+bool sendBuffer(
+    const std::uint8_t *pBuffer,
+    std::size_t nBuffer,
+    SendBufferCbFn *pDoneFn,
+    void *pClientData,
+    bool fConfirmed,
+    std::uint8_t port
+    );
+
+//---- platform services ----
+std::uint32_t getOperatingFlags(void);
+bool isConsoleConnected(void);
+void pollPlatform(void);
+void registerPollable(McciCatena::cPollableObject *pObject);
+void deepSleep(std::uint32_t sec);
+void setLed(LedPattern pattern);
+
+//---- buses ----
+void beginI2c(void);
+bool i2cReadRegisters(std::uint8_t addr, std::uint8_t reg, std::uint8_t *pBuf, std::size_t nBuf);
+bool i2cWriteRegister(std::uint8_t addr, std::uint8_t reg, std::uint8_t value);
+void beginSpi(SPIClass *pSpi);
+void endSpi(SPIClass *pSpi);
+void suspendBuses(void);
+void resumeBuses(void);
+
+//---- Si1133 ----
+bool si1133Begin(void);
+void si1133Start(void);
+bool si1133IsReady(void);
+std::uint32_t si1133Read(void);
+void si1133Stop(void);
+
+//---- OneWire compost probes ----
+bool hasCompostProbe(void);
+bool compostResetBus(void);
+std::uint8_t compostSearch(void);
+bool compostGetAddress(OneWireRom_t rom, std::uint8_t index);
+std::uint8_t compostGetResolution(const OneWireRom_t rom);
+bool compostSetResolution(const OneWireRom_t rom, std::uint8_t bits);
+void compostStartConversion(void);
+bool compostIsConversionComplete(void);
+std::uint32_t compostGetConversionMs(std::uint8_t bits);
+float compostGetTempC(const OneWireRom_t rom);
+
+#else // ! CATENA4610_HOST_SIM
+
+using LedPattern = McciCatena::LedPattern;
+
+constexpr std::uint32_t kPinVout2 = D11;
+constexpr std::uint32_t kPinBoost = D14;
+constexpr std::uint32_t kPinModeInput = INPUT;
+constexpr std::uint32_t kPinModeOutput = OUTPUT;
+constexpr std::uint32_t kPinHigh = HIGH;
+
+//---- console ----
+template <typename... Args>
+inline void safePrintf(const char *pFmt, Args... args)
+    {
+    gCatena.SafePrintf(pFmt, args...);
+    }
+
+//---- clock ----
+inline std::uint32_t millis(void)
+    {
+    return ::millis();
+    }
+
+inline std::uint32_t micros(void)
+    {
+    return ::micros();
+    }
+
+// CPU cycles, for benchmarks; wraps. The Cortex-M0+ has no cycle
+// counter, so this is derived from micros().
+inline std::uint32_t getCycleCount(void)
+    {
+    return ::micros() * (F_CPU / 1000000);
+    }
+
+inline void delay(std::uint32_t ms)
+    {
+    ::delay(ms);
+    }
+
+//---- platform ----
+inline float readVbat(void)
+    {
+    return gCatena.ReadVbat();
+    }
+
+inline float readVbus(void)
+    {
+    return gCatena.ReadVbus();
+    }
+
+inline bool getBootCount(std::uint32_t &bootCount)
+    {
+    return gCatena.getBootCount(bootCount);
+    }
+
+// the application settings live in FRAM, under the platform's
+// application configuration key.
+inline bool readAppConfig(std::uint8_t *pData, std::size_t nData)
+    {
+    auto const pFram = gCatena.getFram();
+
+    return pFram != nullptr &&
+           pFram->getField(McciCatena::cFramStorage::StandardKeys::kAppConf, pData, nData);
+    }
+
+inline bool writeAppConfig(const std::uint8_t *pData, std::size_t nData)
+    {
+    auto const pFram = gCatena.getFram();
+
+    if (pFram == nullptr)
+        return false;
+
+    pFram->saveField(McciCatena::cFramStorage::StandardKeys::kAppConf, pData, nData);
+    return true;
+    }
+
+//---- power control and GPIO ----
+inline void pinMode(std::uint32_t pin, std::uint32_t mode)
+    {
+    ::pinMode(pin, mode);
+    }
+
+inline void digitalWrite(std::uint32_t pin, std::uint32_t value)
+    {
+    ::digitalWrite(pin, value);
+    }
+
+//---- radio ----
+inline bool isProvisioned(void)
+    {
+    return gLoRaWAN.IsProvisioned();
+    }
+
+inline std::uint8_t getDataRate(void)
+    {
+    return LMIC.datarate;
+    }
+
+// true if the LMIC is mid-transaction, or has a job due within ms.
+inline bool isRadioBusyWithin(std::uint32_t ms)
+    {
+    if (LMIC.opmode & (OP_TXDATA | OP_TXRXPEND | OP_JOINING | OP_POLL))
+        return true;
+
+    return os_queryTimeCriticalJobs(ms2osticks(ms)) != 0;
+    }
+
+// milliseconds until the LMIC's global duty-cycle limit allows another
+// uplink; zero if it would go now.
+inline std::uint32_t getDutyCycleWaitMs(void)
+    {
+    ostime_t const wait = ostime_t(LMIC.globalDutyAvail - os_getTime());
+
+    return wait > 0 ? std::uint32_t(osticks2ms(wait)) : 0;
+    }
+
+// the signal of the downlink received after the last uplink; false if
+// none was received. The LMIC keeps RSSI offset by RSSI_OFF, and SNR in
+// quarter dB.
+inline bool getDownlinkSignal(std::int16_t &rssi, float &snr)
+    {
+    if ((LMIC.txrxFlags & (TXRX_DNW1 | TXRX_DNW2)) == 0)
+        return false;
+
+    rssi = std::int16_t(LMIC.rssi - RSSI_OFF);
+    snr = LMIC.snr / 4.0f;
+    return true;
+    }
+
+// use the next slower data rate, if there is one.
+inline void lowerDataRate(void)
+    {
+    if (LMIC.datarate > 0)
+        LMIC_setDrTxpow(LMIC.datarate - 1, KEEP_TXPOW);
+    }
+
+inline bool sendBuffer(
+    const std::uint8_t *pBuffer,
+    std::size_t nBuffer,
+    SendBufferCbFn *pDoneFn,
+    void *pClientData,
+    bool fConfirmed,
+    std::uint8_t port
+    )
+    {
+    return gLoRaWAN.SendBuffer(pBuffer, nBuffer, pDoneFn, pClientData, fConfirmed, port);
+    }
+
+//---- platform services ----
+inline std::uint32_t getOperatingFlags(void)
+    {
+    return gCatena.GetOperatingFlags();
+    }
+
+// true if a terminal has the USB serial port open.
+inline bool isConsoleConnected(void)
+    {
+#ifdef USBCON
+    return Serial.dtr();
+#else
+    return false;
+#endif
+    }
+
+// run the platform's pollable objects once; used while busy-waiting.
+inline void pollPlatform(void)
+    {
+    gCatena.poll();
+    yield();
+    }
+
+inline void registerPollable(McciCatena::cPollableObject *pObject)
+    {
+    gCatena.registerObject(pObject);
+    }
+
+inline void deepSleep(std::uint32_t sec)
+    {
+    gCatena.Sleep(sec);
+    }
+
+inline void setLed(LedPattern pattern)
+    {
+    gLed.Set(pattern);
+    }
+
+//---- buses ----
+inline void beginI2c(void)
+    {
+    Wire.begin();
+    }
+
+inline bool i2cReadRegisters(std::uint8_t addr, std::uint8_t reg, std::uint8_t *pBuf, std::size_t nBuf)
+    {
+    Wire.beginTransmission(addr);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0)
+        return false;
+
+    if (Wire.requestFrom(addr, std::uint8_t(nBuf)) != nBuf)
+        return false;
+
+    for (std::size_t i = 0; i < nBuf; ++i)
+        pBuf[i] = std::uint8_t(Wire.read());
+
+    return true;
+    }
+
+inline bool i2cWriteRegister(std::uint8_t addr, std::uint8_t reg, std::uint8_t value)
+    {
+    Wire.beginTransmission(addr);
+    Wire.write(reg);
+    Wire.write(value);
+    return Wire.endTransmission() == 0;
+    }
+
+inline void beginSpi(SPIClass *pSpi)
+    {
+    pSpi->begin();
+    }
+
+inline void endSpi(SPIClass *pSpi)
+    {
+    pSpi->end();
+    }
+
+// stop the console, I2C and the primary SPI before deep sleep.
+inline void suspendBuses(void)
+    {
+    Serial.end();
+    Wire.end();
+    SPI.end();
+    }
+
+inline void resumeBuses(void)
+    {
+    Serial.begin();
+    Wire.begin();
+    SPI.begin();
+    }
+
+//---- Si1133 ----
+// start the light sensor, measuring white light on channel 0.
+inline bool si1133Begin(void)
+    {
+    if (! gSi1133.begin())
+        return false;
+
+    auto const measConfig = McciCatena::Catena_Si1133::ChannelConfiguration_t()
+        .setAdcMux(McciCatena::Catena_Si1133::InputLed_t::LargeWhite)
+        .setSwGainCode(0)
+        .setHwGainCode(0)
+        .setPostShift(1)
+        .set24bit(false);
+
+    gSi1133.configure(0, measConfig, 0);
+    return true;
+    }
+
+inline void si1133Start(void)
+    {
+    gSi1133.start(true);
+    }
+
+inline bool si1133IsReady(void)
+    {
+    return gSi1133.isOneTimeReady();
+    }
+
+// read channel 0 of a finished one-time measurement, and stop.
+inline std::uint32_t si1133Read(void)
+    {
+    std::uint32_t data[1];
+
+    gSi1133.readMultiChannelData(data, 1);
+    gSi1133.stop();
+    return data[0];
+    }
+
+inline void si1133Stop(void)
+    {
+    gSi1133.stop();
+    }
+
+//---- OneWire compost probes ----
+// true if the platform flags say a OneWire probe may be fitted.
+inline bool hasCompostProbe(void)
+    {
+    return fHasCompostTemp;
+    }
+
+// reset the bus; true if some device answered with a presence pulse.
+inline bool compostResetBus(void)
+    {
+    return oneWire.reset() != 0;
+    }
+
+// search the bus; returns the number of devices found.
+inline std::uint8_t compostSearch(void)
+    {
+    sensor_CompostTemp.begin();
+    return sensor_CompostTemp.getDeviceCount();
+    }
+
+inline bool compostGetAddress(OneWireRom_t rom, std::uint8_t index)
+    {
+    return sensor_CompostTemp.getAddress(rom, index);
+    }
+
+inline std::uint8_t compostGetResolution(const OneWireRom_t rom)
+    {
+    return sensor_CompostTemp.getResolution(rom);
+    }
+
+// set the resolution in bits, in the probe's scratchpad only: the
+// probe goes back to the resolution in its EEPROM when it's powered
+// off. DallasTemperature::setResolution() isn't used, because it also
+// copies the scratchpad to the EEPROM, which wears it and blocks for
+// 20 to 30 ms in delay().
+inline bool compostSetResolution(const OneWireRom_t rom, std::uint8_t bits)
+    {
+    // DS18B20 function command, scratchpad offsets and config register.
+    constexpr std::uint8_t kWriteScratchpad = 0x4E;
+    constexpr std::uint8_t kHighAlarm = 2;
+    constexpr std::uint8_t kLowAlarm = 3;
+    constexpr std::uint8_t kConfigBase = 0x1F;   // R1:R0 (bits 6:5) = 0: 9 bits
+    std::uint8_t scratchPad[9];
+
+    if (bits < 9 || bits > 12)
+        return false;
+
+    // read the scratchpad (with CRC check), to keep the alarm bytes.
+    if (! sensor_CompostTemp.isConnected(rom, scratchPad))
+        return false;
+
+    if (! oneWire.reset())
+        return false;
+    oneWire.select(rom);
+    oneWire.write(kWriteScratchpad);
+    oneWire.write(scratchPad[kHighAlarm]);
+    oneWire.write(scratchPad[kLowAlarm]);
+    oneWire.write(std::uint8_t(kConfigBase | ((bits - 9) << 5)));
+    return oneWire.reset() != 0;
+    }
+
+// broadcast a conversion request to every probe; don't wait.
+inline void compostStartConversion(void)
+    {
+    sensor_CompostTemp.setWaitForConversion(false);
+    sensor_CompostTemp.requestTemperatures();
+    }
+
+inline bool compostIsConversionComplete(void)
+    {
+    return sensor_CompostTemp.isConversionComplete();
+    }
+
+inline std::uint32_t compostGetConversionMs(std::uint8_t bits)
+    {
+    return sensor_CompostTemp.millisToWaitForConversion(bits);
+    }
+
+// the temperature read by a probe; NAN if it didn't answer.
+inline float compostGetTempC(const OneWireRom_t rom)
+    {
+    float const tempC = sensor_CompostTemp.getTempC(rom);
+
+    return tempC != DEVICE_DISCONNECTED_C ? tempC : NAN;
+    }
+
+#endif // CATENA4610_HOST_SIM
+
+} // namespace Hal
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_hal_h_ */
@@ -21,6 +21,7 @@ Author:
 #include <Catena.h>
 #include <Catena_Led.h>
 #include <Catena_Mx25v8035f.h>
+#include <Catena_Si1133.h>
 #include <Catena_Timer.h>
 #include <OneWire.h>
 #include <DallasTemperature.h>
@@ -35,6 +36,7 @@ extern  McciCatena::Catena::LoRaWAN             gLoRaWAN;
 extern  McciCatena::StatusLed                   gLed;
 
 extern  SPIClass                                gSPI2;
+extern  McciCatena::Catena_Si1133               gSi1133;
 extern  McciCatena4610::cMeasurementLoop        gMeasurementLoop;
 
 //   The Temp Probe
@@ -44,5 +46,6 @@ extern bool                                     fHasCompostTemp;
 
 //   The flash
 extern  McciCatena::Catena_Mx25v8035f           gFlash;
+extern  McciCatena4610::cFlashLog               gFlashLog;
 
 #endif // !defined(_ThermoSense-Lorawan_h_)
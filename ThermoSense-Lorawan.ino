@@ -61,6 +61,12 @@ SPIClass gSPI2(
 /* instantiate the flash */
 Catena_Mx25v8035f gFlash;
 
+/* the measurement log in the flash */
+cFlashLog gFlashLog;
+
+/* the ambient light sensor */
+Catena_Si1133 gSi1133;
+
 OneWire oneWire(PIN_ONE_WIRE);
 DallasTemperature sensor_CompostTemp(&oneWire);
 bool fHasCompostTemp;
@@ -74,7 +80,19 @@ bool fHasCompostTemp;
 // the individual commmands are put in this table
 static const cCommandStream::cEntry sMyExtraCommmands[] =
         {
+        { "batch", cmdBatch },
+        { "bench", cmdBench },
+        { "bme280", cmdBme280 },
+        { "format", cmdFormat },
+        { "light", cmdLight },
+        { "link", cmdLink },
         { "log", cmdLog },
+        { "oversample", cmdOversample },
+        { "policy", cmdPolicy },
+        { "power", cmdPower },
+        { "resolution", cmdResolution },
+        { "stats", cmdStats },
+        { "trace", cmdTrace },
         // other commands go here....
         };
 
@@ -220,8 +238,20 @@ void setup_flash(void)
     if (gFlash.begin(&gSPI2, Catena::PIN_SPI2_FLASH_SS))
         {
         gMeasurementLoop.registerSecondSpi(&gSPI2);
-        gFlash.powerDown();
-        gCatena.SafePrintf("FLASH found, put power down\n");
+        if (gFlashLog.begin(&gFlash, cMeasurementLoop::kLogRecordLayout))
+            {
+            gMeasurementLoop.registerFlashLog(&gFlashLog);
+            gCatena.SafePrintf(
+                "FLASH found, log next seq %u%s\n",
+                gFlashLog.getNextSeq(),
+                gFlashLog.hasUnsent() ? " (unsent data)" : ""
+                );
+            }
+        else
+            {
+            gFlash.powerDown();
+            gCatena.SafePrintf("FLASH found, log not usable, put power down\n");
+            }
         }
     else
         {
@@ -231,10 +261,24 @@ void setup_flash(void)
         }
     }
 
+// downlinks on the configuration port go to the measurement loop; others
+// are ignored.
+static void receiveMessage(
+    void *pContext,
+    uint8_t port,
+    const uint8_t *pMessage,
+    size_t nMessage
+    )
+    {
+    if (port == cMeasurementLoop::kConfigPort)
+        gMeasurementLoop.processConfigDownlink(pMessage, nMessage);
+    }
+
 void setup_radio()
     {
     gLoRaWAN.begin(&gCatena);
     gCatena.registerObject(&gLoRaWAN);
+    gLoRaWAN.SetReceiveBufferBufferCb(receiveMessage, nullptr);
     LMIC_setClockError(5 * MAX_CLOCK_ERROR / 100);
     }
 
@@ -0,0 +1,103 @@
+/*
+
+Module:	cmdBatch.cpp
+
+Function:
+    Process the "batch" command
+
+Copyright and License:
+    This file copyright (C) 2022 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cmd.h"
+
+#include "ThermoSense-Lorawan.h"
+
+using namespace McciCatena;
+
+/*
+
+Name:   ::cmdBatch()
+
+Function:
+    Command dispatcher for "batch" command.
+
+Definition:
+    McciCatena::cCommandStream::CommandFn cmdBatch;
+
+    McciCatena::cCommandStream::CommandStatus cmdBatch(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        );
+
+Description:
+    The "batch" command has the following syntax:
+
+    batch
+        Display the current batching parameters.
+
+    batch {seconds} {depth}
+        Sample every {seconds}, and send up to {depth} samples in each
+        uplink. A {depth} of 0 or 1 turns batching off. The setting
+        is saved in FRAM.
+
+Returns:
+    cCommandStream::CommandStatus::kSuccess if successful.
+    Some other value for failure.
+
+*/
+
+// argv[0] is "batch"
+// argv[1] is the sampling interval in seconds
+// argv[2] is the number of samples per uplink
+cCommandStream::CommandStatus cmdBatch(
+    cCommandStream *pThis,
+    void *pContext,
+    int argc,
+    char **argv
+    )
+    {
+    if (argc != 1 && argc != 3)
+        return cCommandStream::CommandStatus::kInvalidParameter;
+
+    if (argc == 3)
+        {
+        cCommandStream::CommandStatus status;
+        uint32_t sampleSec;
+        uint32_t depth;
+
+        status = cCommandStream::getuint32(argc, argv, 1, /*radix*/ 0, sampleSec, /* default */ 0);
+        if (status != cCommandStream::CommandStatus::kSuccess)
+            return status;
+
+        status = cCommandStream::getuint32(argc, argv, 2, /*radix*/ 0, depth, /* default */ 0);
+        if (status != cCommandStream::CommandStatus::kSuccess)
+            return status;
+
+        if (sampleSec == 0 || depth > 255)
+            return cCommandStream::CommandStatus::kInvalidParameter;
+
+        gMeasurementLoop.setBatching(sampleSec, uint8_t(depth));
+        }
+
+    pThis->printf(
+        "batch: sample every %u secs, %u samples per uplink%s\n",
+        gMeasurementLoop.getBatchSampleTime(),
+        gMeasurementLoop.getBatchDepth(),
+        gMeasurementLoop.getBatchDepth() > 1 ? "" : " (off)"
+        );
+
+    return cCommandStream::CommandStatus::kSuccess;
+    }
@@ -0,0 +1,104 @@
+/*
+
+Module:	cmdBench.cpp
+
+Function:
+    Process the "bench" command
+
+Copyright and License:
+    This file copyright (C) 2022 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cmd.h"
+
+#include "ThermoSense-Lorawan.h"
+
+using namespace McciCatena;
+using namespace McciCatena4610;
+
+/*
+
+Name:   ::cmdBench()
+
+Function:
+    Command dispatcher for "bench" command.
+
+Definition:
+    McciCatena::cCommandStream::CommandFn cmdBench;
+
+    McciCatena::cCommandStream::CommandStatus cmdBench(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        );
+
+Description:
+    The "bench" command has the following syntax:
+
+    bench [{iterations}]
+        Run each payload encoder and decoder {iterations} times
+        (default 1000) on the test vectors, and print a CSV report: a
+        header line, then per case the name, the frame size in bytes,
+        the time and CPU cycles per run, and 1 if the output matched
+        the test vector (0 means the encoding has changed). Uplinks
+        are held off while it runs.
+
+Returns:
+    cCommandStream::CommandStatus::kSuccess if successful.
+    Some other value for failure.
+
+*/
+
+// argv[0] is "bench"
+// argv[1] is the number of iterations
+cCommandStream::CommandStatus cmdBench(
+    cCommandStream *pThis,
+    void *pContext,
+    int argc,
+    char **argv
+    )
+    {
+    cCommandStream::CommandStatus status;
+    uint32_t nIterations;
+
+    if (argc > 2)
+        return cCommandStream::CommandStatus::kInvalidParameter;
+
+    status = cCommandStream::getuint32(argc, argv, 1, /*radix*/ 0, nIterations, /* default */ 1000);
+    if (status != cCommandStream::CommandStatus::kSuccess)
+        return status;
+
+    if (nIterations == 0)
+        return cCommandStream::CommandStatus::kInvalidParameter;
+
+    cMeasurementLoop::BenchResult results[cMeasurementLoop::kNumBenchCases];
+
+    gMeasurementLoop.runPayloadBenchmark(results, nIterations);
+
+    pThis->printf("case,bytes,ns_per_op,cycles_per_op,ok\n");
+    for (auto const &r : results)
+        {
+        std::uint64_t const ns = std::uint64_t(r.totalUs) * 1000u / nIterations;
+
+        pThis->printf("%s,%u,%u,%u,%u\n",
+            r.pName,
+            r.nBytes,
+            std::uint32_t(ns),
+            r.totalCycles / nIterations,
+            r.fOk ? 1 : 0
+            );
+        }
+
+    return cCommandStream::CommandStatus::kSuccess;
+    }
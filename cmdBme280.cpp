@@ -0,0 +1,102 @@
+/*
+
+Module:	cmdBme280.cpp
+
+Function:
+    Process the "bme280" command
+
+Copyright and License:
+    This file copyright (C) 2022 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cmd.h"
+
+#include "ThermoSense-Lorawan.h"
+
+#include <cstring>
+
+using namespace McciCatena;
+using namespace McciCatena4610;
+
+/*
+
+Name:   ::cmdBme280()
+
+Function:
+    Command dispatcher for "bme280" command.
+
+Definition:
+    McciCatena::cCommandStream::CommandFn cmdBme280;
+
+    McciCatena::cCommandStream::CommandStatus cmdBme280(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        );
+
+Description:
+    The "bme280" command has the following syntax:
+
+    bme280
+        Display the BME280 profile, the profile in use, and its
+        conversion time.
+
+    bme280 lowpower | standard | hires | auto
+        Select the profile, and save it in FRAM. lowpower takes one
+        sample of each value; standard oversamples pressure by 4;
+        hires oversamples everything and filters pressure. auto uses
+        lowpower on battery and hires on USB power.
+
+Returns:
+    cCommandStream::CommandStatus::kSuccess if successful.
+    Some other value for failure.
+
+*/
+
+// argv[0] is "bme280"
+// argv[1] is the profile name
+cCommandStream::CommandStatus cmdBme280(
+    cCommandStream *pThis,
+    void *pContext,
+    int argc,
+    char **argv
+    )
+    {
+    if (argc == 2)
+        {
+        std::uint8_t profile;
+
+        for (profile = 0; profile < cAppConfig::kBme280NumProfiles; ++profile)
+            {
+            if (std::strcmp(argv[1], cAppConfig::getBme280ProfileName(profile)) == 0)
+                break;
+            }
+
+        if (! gMeasurementLoop.setBme280Profile(profile))
+            return cCommandStream::CommandStatus::kInvalidParameter;
+        }
+    else if (argc != 1)
+        return cCommandStream::CommandStatus::kInvalidParameter;
+
+    std::uint8_t const active = gMeasurementLoop.getBme280ActiveProfile();
+
+    pThis->printf(
+        "bme280: %s (%s, %u ms)\n",
+        cAppConfig::getBme280ProfileName(gMeasurementLoop.getBme280Profile()),
+        cAppConfig::getBme280ProfileName(active),
+        unsigned(cMeasurementLoop::getBme280ConversionMs(active))
+        );
+
+    return cCommandStream::CommandStatus::kSuccess;
+    }
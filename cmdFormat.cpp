@@ -0,0 +1,111 @@
+/*
+
+Module:	cmdFormat.cpp
+
+Function:
+    Process the "format" command
+
+Copyright and License:
+    This file copyright (C) 2022 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cmd.h"
+
+#include "ThermoSense-Lorawan.h"
+
+using namespace McciCatena;
+
+/*
+
+Name:   ::cmdFormat()
+
+Function:
+    Command dispatcher for "format" command.
+
+Definition:
+    McciCatena::cCommandStream::CommandFn cmdFormat;
+
+    McciCatena::cCommandStream::CommandStatus cmdFormat(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        );
+
+Description:
+    The "format" command has the following syntax:
+
+    format
+        Display the format used for single-measurement uplinks.
+
+    format 0x15
+        Send each measurement in full (the default).
+
+    format 0x17 [{keyframes}]
+        Send each measurement as differences from the last one sent,
+        with a full measurement every {keyframes} uplinks (default 16;
+        0 means only when needed).
+
+    Batched uplinks (format 0x16) are controlled by the "batch" command.
+
+Returns:
+    cCommandStream::CommandStatus::kSuccess if successful.
+    Some other value for failure.
+
+*/
+
+// argv[0] is "format"
+// argv[1] is the format code
+// argv[2] is the keyframe interval, for format 0x17
+cCommandStream::CommandStatus cmdFormat(
+    cCommandStream *pThis,
+    void *pContext,
+    int argc,
+    char **argv
+    )
+    {
+    if (argc > 3)
+        return cCommandStream::CommandStatus::kInvalidParameter;
+
+    if (argc > 1)
+        {
+        cCommandStream::CommandStatus status;
+        uint32_t format;
+        uint32_t keyframes;
+
+        status = cCommandStream::getuint32(argc, argv, 1, /*radix*/ 0, format, /* default */ 0);
+        if (status != cCommandStream::CommandStatus::kSuccess)
+            return status;
+
+        status = cCommandStream::getuint32(argc, argv, 2, /*radix*/ 0, keyframes, /* default */ 16);
+        if (status != cCommandStream::CommandStatus::kSuccess)
+            return status;
+
+        if (format == 0x15 && argc == 2)
+            gMeasurementLoop.setDeltaUplink(false, gMeasurementLoop.getKeyframeInterval());
+        else if (format == 0x17 && keyframes <= 255)
+            gMeasurementLoop.setDeltaUplink(true, uint8_t(keyframes));
+        else
+            return cCommandStream::CommandStatus::kInvalidParameter;
+        }
+
+    if (gMeasurementLoop.getDeltaUplink())
+        pThis->printf(
+            "format: 0x17, keyframe every %u uplinks\n",
+            gMeasurementLoop.getKeyframeInterval()
+            );
+    else
+        pThis->printf("format: 0x15\n");
+
+    return cCommandStream::CommandStatus::kSuccess;
+    }
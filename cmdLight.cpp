@@ -0,0 +1,92 @@
+/*
+
+Module:	cmdLight.cpp
+
+Function:
+    Process the "light" command
+
+Copyright and License:
+    This file copyright (C) 2022 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cmd.h"
+
+#include "ThermoSense-Lorawan.h"
+
+#include <cstring>
+
+using namespace McciCatena;
+
+/*
+
+Name:   ::cmdLight()
+
+Function:
+    Command dispatcher for "light" command.
+
+Definition:
+    McciCatena::cCommandStream::CommandFn cmdLight;
+
+    McciCatena::cCommandStream::CommandStatus cmdLight(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        );
+
+Description:
+    The "light" command has the following syntax:
+
+    light
+        Display whether ambient light is sampled.
+
+    light on | off
+        Turn ambient light sampling on or off. When it is off, the
+        Si1133 is not started, and field 4 is not sent. Use this for
+        sealed installations, where the light level means nothing.
+        The setting is saved in FRAM.
+
+Returns:
+    cCommandStream::CommandStatus::kSuccess if successful.
+    Some other value for failure.
+
+*/
+
+// argv[0] is "light"
+// argv[1] is "on" or "off"
+cCommandStream::CommandStatus cmdLight(
+    cCommandStream *pThis,
+    void *pContext,
+    int argc,
+    char **argv
+    )
+    {
+    if (argc == 2)
+        {
+        if (std::strcmp(argv[1], "on") == 0)
+            gMeasurementLoop.setLightSampling(true);
+        else if (std::strcmp(argv[1], "off") == 0)
+            gMeasurementLoop.setLightSampling(false);
+        else
+            return cCommandStream::CommandStatus::kInvalidParameter;
+        }
+    else if (argc != 1)
+        return cCommandStream::CommandStatus::kInvalidParameter;
+
+    pThis->printf(
+        "light: %s\n",
+        gMeasurementLoop.getLightSampling() ? "on" : "off"
+        );
+
+    return cCommandStream::CommandStatus::kSuccess;
+    }
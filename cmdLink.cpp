@@ -0,0 +1,128 @@
+/*
+
+Module:	cmdLink.cpp
+
+Function:
+    Process the "link" command
+
+Copyright and License:
+    This file copyright (C) 2022 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cmd.h"
+
+#include "ThermoSense-Lorawan.h"
+
+#include <cstring>
+
+using namespace McciCatena;
+using namespace McciCatena4610;
+
+/*
+
+Name:   ::cmdLink()
+
+Function:
+    Command dispatcher for "link" command.
+
+Definition:
+    McciCatena::cCommandStream::CommandFn cmdLink;
+
+    McciCatena::cCommandStream::CommandStatus cmdLink(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        );
+
+Description:
+    The "link" command has the following syntax:
+
+    link
+        Display the link quality (unknown, good, marginal or lost), the
+        ACKs received for recent confirmed uplinks, and the average
+        downlink RSSI and SNR.
+
+    link on | off
+        Turn the confirmed-uplink policy on or off. When it is on, one
+        uplink in {n} is confirmed, twice as often while the link is
+        marginal, and the data rate is lowered when ACKs keep being
+        missed. The setting is saved in FRAM.
+
+    link confirm {n}
+        Confirm one uplink in {n} while the link is good.
+
+Returns:
+    cCommandStream::CommandStatus::kSuccess if successful.
+    Some other value for failure.
+
+*/
+
+// argv[0] is "link"
+// argv[1] is "on", "off" or "confirm"
+// argv[2] is the confirm interval for "confirm"
+cCommandStream::CommandStatus cmdLink(
+    cCommandStream *pThis,
+    void *pContext,
+    int argc,
+    char **argv
+    )
+    {
+    if (argc == 3 && std::strcmp(argv[1], "confirm") == 0)
+        {
+        cCommandStream::CommandStatus status;
+        uint32_t nFrames;
+
+        status = cCommandStream::getuint32(argc, argv, 2, /*radix*/ 0, nFrames, /* default */ 0);
+        if (status != cCommandStream::CommandStatus::kSuccess)
+            return status;
+
+        if (nFrames == 0 || nFrames > 255)
+            return cCommandStream::CommandStatus::kInvalidParameter;
+
+        gMeasurementLoop.setLinkConfirmInterval(uint8_t(nFrames));
+        }
+    else if (argc == 2)
+        {
+        if (std::strcmp(argv[1], "on") == 0)
+            gMeasurementLoop.setLinkPolicy(true);
+        else if (std::strcmp(argv[1], "off") == 0)
+            gMeasurementLoop.setLinkPolicy(false);
+        else
+            return cCommandStream::CommandStatus::kInvalidParameter;
+        }
+    else if (argc != 1)
+        return cCommandStream::CommandStatus::kInvalidParameter;
+
+    auto const &link = gMeasurementLoop.getLinkState();
+
+    pThis->printf(
+        "link: %s, policy %s, confirm 1 in %u\n",
+        cLinkPolicy::getQualityName(link.getQuality()),
+        gMeasurementLoop.getLinkPolicy() ? "on" : "off",
+        link.getConfig().confirmEvery
+        );
+    pThis->printf(
+        "  acked %u of %u confirmed uplinks\n",
+        link.getnAcked(),
+        link.getnHistory()
+        );
+    if (link.hasSignal())
+        pThis->printf(
+            "  downlink rssi %d dBm, snr %d dB\n",
+            int(link.getRssi()),
+            int(link.getSnr())
+            );
+
+    return cCommandStream::CommandStatus::kSuccess;
+    }
@@ -0,0 +1,113 @@
+/*
+
+Module:	cmdOversample.cpp
+
+Function:
+    Process the "oversample" command
+
+Copyright and License:
+    This file copyright (C) 2022 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cmd.h"
+
+#include "ThermoSense-Lorawan.h"
+
+using namespace McciCatena;
+
+/*
+
+Name:   ::cmdOversample()
+
+Function:
+    Command dispatcher for "oversample" command.
+
+Definition:
+    McciCatena::cCommandStream::CommandFn cmdOversample;
+
+    McciCatena::cCommandStream::CommandStatus cmdOversample(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        );
+
+Description:
+    The "oversample" command has the following syntax:
+
+    oversample
+        Display the number of compost temperature samples per uplink,
+        and the summary of the samples taken since the last uplink.
+
+    oversample {n}
+        Take {n} compost temperature samples per uplink interval, and
+        send their summary with the last. Only the supply voltages and
+        the compost temperature are read for the extra samples. An {n}
+        of 0 or 1 turns oversampling off. Oversampling is not used while
+        batching or reporting on change.
+
+Returns:
+    cCommandStream::CommandStatus::kSuccess if successful.
+    Some other value for failure.
+
+*/
+
+// argv[0] is "oversample"
+// argv[1] is the number of samples per uplink
+cCommandStream::CommandStatus cmdOversample(
+    cCommandStream *pThis,
+    void *pContext,
+    int argc,
+    char **argv
+    )
+    {
+    if (argc > 2)
+        return cCommandStream::CommandStatus::kInvalidParameter;
+
+    if (argc == 2)
+        {
+        cCommandStream::CommandStatus status;
+        uint32_t nSamples;
+
+        status = cCommandStream::getuint32(argc, argv, 1, /*radix*/ 0, nSamples, /* default */ 1);
+        if (status != cCommandStream::CommandStatus::kSuccess)
+            return status;
+
+        if (nSamples > 255)
+            return cCommandStream::CommandStatus::kInvalidParameter;
+
+        gMeasurementLoop.setCompostOversample(uint8_t(nSamples));
+        }
+
+    auto const &stats = gMeasurementLoop.getCompostStats();
+
+    pThis->printf(
+        "oversample: %u samples per uplink%s\n",
+        gMeasurementLoop.getCompostOversample(),
+        gMeasurementLoop.getCompostOversample() > 1 ? "" : " (off)"
+        );
+
+    if (stats.getCount() == 0)
+        pThis->printf("no compost samples since the last uplink\n");
+    else
+        pThis->printf(
+            "%u samples: min %d, max %d, mean %d, sd %d mdegC\n",
+            stats.getCount(),
+            int(stats.getMin() * 1000.0f),
+            int(stats.getMax() * 1000.0f),
+            int(stats.getMean() * 1000.0f),
+            int(stats.getStdDev() * 1000.0f)
+            );
+
+    return cCommandStream::CommandStatus::kSuccess;
+    }
@@ -0,0 +1,172 @@
+/*
+
+Module:	cmdPolicy.cpp
+
+Function:
+    Process the "policy" command
+
+Copyright and License:
+    This file copyright (C) 2022 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cmd.h"
+
+#include "ThermoSense-Lorawan.h"
+
+#include <cstdlib>
+#include <cstring>
+
+using namespace McciCatena;
+using namespace McciCatena4610;
+
+static bool parseFloat(const char *pArg, float &v)
+    {
+    char *pEnd;
+
+    v = std::strtof(pArg, &pEnd);
+    return pEnd != pArg && *pEnd == '\0' && v >= 0;
+    }
+
+static void printFloat(cCommandStream *pThis, const char *pName, float v, const char *pUnits)
+    {
+    // SafePrintf doesn't do floats; print hundredths.
+    std::uint32_t const v100 = std::uint32_t(v * 100.0f + 0.5f);
+
+    pThis->printf("  %-10s %u.%02u %s\n", pName, v100 / 100, v100 % 100, pUnits);
+    }
+
+/*
+
+Name:   ::cmdPolicy()
+
+Function:
+    Command dispatcher for "policy" command.
+
+Definition:
+    McciCatena::cCommandStream::CommandFn cmdPolicy;
+
+    McciCatena::cCommandStream::CommandStatus cmdPolicy(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        );
+
+Description:
+    The "policy" command has the following syntax:
+
+    policy
+        Display the report-on-change settings.
+
+    policy on | off
+        Turn report-on-change on or off. When it's off, every
+        measurement is sent.
+
+    policy sample {seconds}
+    policy heartbeat {seconds}
+        Set the sampling interval, or the longest time between uplinks.
+
+    policy compost {degrees}
+    policy air {degrees}
+    policy rh {percent}
+        Set the deadband for compost temperature, air temperature, or
+        humidity. 0 turns the test off.
+
+    policy rate {degrees per hour}
+        Set the compost temperature rate-of-change alarm. 0 turns the
+        test off.
+
+Returns:
+    cCommandStream::CommandStatus::kSuccess if successful.
+    Some other value for failure.
+
+*/
+
+// argv[0] is "policy"
+// argv[1] is "on", "off" or a parameter name
+// argv[2] is the parameter value
+cCommandStream::CommandStatus cmdPolicy(
+    cCommandStream *pThis,
+    void *pContext,
+    int argc,
+    char **argv
+    )
+    {
+    if (argc == 2)
+        {
+        if (std::strcmp(argv[1], "on") == 0)
+            gMeasurementLoop.setReportPolicy(true);
+        else if (std::strcmp(argv[1], "off") == 0)
+            gMeasurementLoop.setReportPolicy(false);
+        else
+            return cCommandStream::CommandStatus::kInvalidParameter;
+        }
+    else if (argc == 3)
+        {
+        cReportPolicy::Config config = gMeasurementLoop.getReportPolicyConfig();
+        const char * const pName = argv[1];
+
+        if (std::strcmp(pName, "sample") == 0 || std::strcmp(pName, "heartbeat") == 0)
+            {
+            std::uint32_t sec;
+            auto const status = cCommandStream::getuint32(argc, argv, 2, /*radix*/ 0, sec, /* default */ 0);
+
+            if (status != cCommandStream::CommandStatus::kSuccess)
+                return status;
+            if (sec == 0 || sec > 0x7FFFFFFF / 1000)
+                return cCommandStream::CommandStatus::kInvalidParameter;
+
+            if (pName[0] == 's')
+                config.sampleSec = sec;
+            else
+                config.heartbeatSec = sec;
+            }
+        else
+            {
+            float v;
+            float *pV;
+
+            if (std::strcmp(pName, "compost") == 0)
+                pV = &config.compostDeadband;
+            else if (std::strcmp(pName, "air") == 0)
+                pV = &config.airDeadband;
+            else if (std::strcmp(pName, "rh") == 0)
+                pV = &config.rhDeadband;
+            else if (std::strcmp(pName, "rate") == 0)
+                pV = &config.compostRate;
+            else
+                return cCommandStream::CommandStatus::kInvalidParameter;
+
+            if (! parseFloat(argv[2], v))
+                return cCommandStream::CommandStatus::kInvalidParameter;
+
+            *pV = v;
+            }
+
+        gMeasurementLoop.setReportPolicyConfig(config);
+        }
+    else if (argc != 1)
+        return cCommandStream::CommandStatus::kInvalidParameter;
+
+    auto const &config = gMeasurementLoop.getReportPolicyConfig();
+
+    pThis->printf("policy: %s\n", gMeasurementLoop.getReportPolicy() ? "on" : "off");
+    pThis->printf("  %-10s %u secs\n", "sample", config.sampleSec);
+    pThis->printf("  %-10s %u secs\n", "heartbeat", config.heartbeatSec);
+    printFloat(pThis, "compost", config.compostDeadband, "deg C");
+    printFloat(pThis, "air", config.airDeadband, "deg C");
+    printFloat(pThis, "rh", config.rhDeadband, "%RH");
+    printFloat(pThis, "rate", config.compostRate, "deg C/hour");
+
+    return cCommandStream::CommandStatus::kSuccess;
+    }
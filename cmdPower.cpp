@@ -0,0 +1,107 @@
+/*
+
+Module:	cmdPower.cpp
+
+Function:
+    Process the "power" command
+
+Copyright and License:
+    This file copyright (C) 2022 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cmd.h"
+
+#include "ThermoSense-Lorawan.h"
+
+#include <cstring>
+
+using namespace McciCatena;
+using namespace McciCatena4610;
+
+/*
+
+Name:   ::cmdPower()
+
+Function:
+    Command dispatcher for "power" command.
+
+Definition:
+    McciCatena::cCommandStream::CommandFn cmdPower;
+
+    McciCatena::cCommandStream::CommandStatus cmdPower(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        );
+
+Description:
+    The "power" command has the following syntax:
+
+    power
+        Display the power level (usb, battery, low or critical), and
+        the operating profile in use.
+
+    power on | off
+        Turn the operating profiles on or off. When they are on, the
+        uplink interval, the OneWire resolution, the optional sensors
+        and confirmed uplinks follow the power level. When they are
+        off, the battery profile is always used. The setting is saved
+        in FRAM.
+
+Returns:
+    cCommandStream::CommandStatus::kSuccess if successful.
+    Some other value for failure.
+
+*/
+
+// argv[0] is "power"
+// argv[1] is "on" or "off"
+cCommandStream::CommandStatus cmdPower(
+    cCommandStream *pThis,
+    void *pContext,
+    int argc,
+    char **argv
+    )
+    {
+    if (argc == 2)
+        {
+        if (std::strcmp(argv[1], "on") == 0)
+            gMeasurementLoop.setPowerProfiles(true);
+        else if (std::strcmp(argv[1], "off") == 0)
+            gMeasurementLoop.setPowerProfiles(false);
+        else
+            return cCommandStream::CommandStatus::kInvalidParameter;
+        }
+    else if (argc != 1)
+        return cCommandStream::CommandStatus::kInvalidParameter;
+
+    auto const &profile = gMeasurementLoop.getOperatingProfile();
+
+    pThis->printf(
+        "power: %s, profiles %s\n",
+        cMeasurementLoop::getPowerLevelName(gMeasurementLoop.getPowerLevel()),
+        gMeasurementLoop.getPowerProfiles() ? "on" : "off"
+        );
+    pThis->printf(
+        "  interval %s%u, compost <= %u bits, light %s, env %s, %s uplinks\n",
+        profile.cycleShift < 0 ? "/" : "x",
+        1u << (profile.cycleShift < 0 ? -profile.cycleShift : profile.cycleShift),
+        profile.maxCompostBits,
+        profile.fLight ? "on" : "off",
+        profile.fEnv ? "on" : "off",
+        profile.fConfirmed ? "confirmed" : "unconfirmed"
+        );
+
+    return cCommandStream::CommandStatus::kSuccess;
+    }
@@ -0,0 +1,151 @@
+/*
+
+Module:	cmdResolution.cpp
+
+Function:
+    Process the "resolution" command
+
+Copyright and License:
+    This file copyright (C) 2022 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cmd.h"
+
+#include "ThermoSense-Lorawan.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace McciCatena;
+using namespace McciCatena4610;
+
+// parse "9".."12" or "auto".
+static bool parseResolution(const char *pArg, std::uint8_t &bits)
+    {
+    if (std::strcmp(pArg, "auto") == 0)
+        {
+        bits = cAppConfig::kResolutionAuto;
+        return true;
+        }
+
+    char *pEnd;
+    unsigned long const v = std::strtoul(pArg, &pEnd, 10);
+
+    if (*pArg == '\0' || *pEnd != '\0' ||
+        v < cAppConfig::kResolutionMin || v > cAppConfig::kResolutionMax)
+        return false;
+
+    bits = std::uint8_t(v);
+    return true;
+    }
+
+/*
+
+Name:   ::cmdResolution()
+
+Function:
+    Command dispatcher for "resolution" command.
+
+Definition:
+    McciCatena::cCommandStream::CommandFn cmdResolution;
+
+    McciCatena::cCommandStream::CommandStatus cmdResolution(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        );
+
+Description:
+    The "resolution" command has the following syntax:
+
+    resolution
+        Display the configured and current resolution of each OneWire
+        compost probe.
+
+    resolution {bits} | auto
+        Set the resolution of all the probes.
+
+    resolution {probe} {bits} | auto
+        Set the resolution of one probe; probes are numbered from 0, in
+        OneWire search order.
+
+    {bits} is 9 to 12. Each bit less halves the conversion time, from
+    750 ms at 12 bits to 94 ms at 9 bits. "auto" lowers the resolution
+    while readings are stable, and raises it when they change quickly.
+    The setting is saved in FRAM.
+
+Returns:
+    cCommandStream::CommandStatus::kSuccess if successful.
+    Some other value for failure.
+
+*/
+
+// argv[0] is "resolution"
+// argv[1] is the probe number or the resolution
+// argv[2] is the resolution, if argv[1] is the probe number
+cCommandStream::CommandStatus cmdResolution(
+    cCommandStream *pThis,
+    void *pContext,
+    int argc,
+    char **argv
+    )
+    {
+    constexpr auto kAllProbes = cMeasurementLoop::kMaxCompostProbes;
+
+    if (argc == 2 || argc == 3)
+        {
+        std::uint8_t bits;
+        std::uint32_t iProbe = kAllProbes;
+
+        if (argc == 3)
+            {
+            auto const status = cCommandStream::getuint32(argc, argv, 1, /*radix*/ 0, iProbe, /* default */ 0);
+
+            if (status != cCommandStream::CommandStatus::kSuccess)
+                return status;
+            if (iProbe >= kAllProbes)
+                return cCommandStream::CommandStatus::kInvalidParameter;
+            }
+
+        if (! parseResolution(argv[argc - 1], bits))
+            return cCommandStream::CommandStatus::kInvalidParameter;
+
+        gMeasurementLoop.setCompostResolution(std::uint8_t(iProbe), bits);
+        }
+    else if (argc != 1)
+        return cCommandStream::CommandStatus::kInvalidParameter;
+
+    auto const &config = gMeasurementLoop.getAppConfig().get();
+
+    pThis->printf("%-6s %10s %8s\n", "probe", "setting", "current");
+    for (std::uint8_t i = 0; i < kAllProbes; ++i)
+        {
+        auto const bits = config.CompostResolution[i];
+        auto const current = gMeasurementLoop.getCompostResolution(i);
+        char setting[8];
+
+        if (bits == cAppConfig::kResolutionAuto)
+            std::strcpy(setting, "auto");
+        else
+            std::snprintf(setting, sizeof(setting), "%u", bits);
+
+        if (current != 0)
+            pThis->printf("%-6u %10s %8u\n", i, setting, current);
+        else
+            pThis->printf("%-6u %10s %8s\n", i, setting, "-");
+        }
+
+    return cCommandStream::CommandStatus::kSuccess;
+    }
@@ -0,0 +1,141 @@
+/*
+
+Module:	cmdStats.cpp
+
+Function:
+    Process the "stats" command
+
+Copyright and License:
+    This file copyright (C) 2022 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cmd.h"
+
+#include "ThermoSense-Lorawan.h"
+
+#include <cstring>
+
+using namespace McciCatena;
+using namespace McciCatena4610;
+
+static void printStats(cCommandStream *pThis)
+    {
+    auto const &profiler = gMeasurementLoop.getProfiler();
+    auto const &cycle = profiler.getLastCycle();
+
+    pThis->printf("%u cycles; last cycle: awake %u ms, deep sleep %u s, charge %u uC\n",
+        profiler.getCycleCount(),
+        cycle.awakeUs / 1000,
+        cycle.deepSleepMs / 1000,
+        cycle.chargeUc
+        );
+
+    pThis->printf("%-18s %8s %10s %10s\n", "state", "entries", "last(ms)", "total(s)");
+    for (std::uint8_t i = std::uint8_t(cMeasurementLoop::State::stInitial);
+         i <= std::uint8_t(cMeasurementLoop::State::stFinal);
+         ++i)
+        {
+        auto const &s = profiler.getState(i);
+
+        pThis->printf("%-18s %8u %10u %10u\n",
+            cMeasurementLoop::getStateName(cMeasurementLoop::State(i)),
+            s.nEntries,
+            s.lastCycleUs / 1000,
+            std::uint32_t(s.totalUs / 1000000)
+            );
+        }
+
+    pThis->printf("%-18s %8s %10s %10s\n", "sensor", "reads", "last(us)", "max(us)");
+    for (std::uint8_t i = 0; i < cMeasurementLoop::kProfileNumSensors; ++i)
+        {
+        auto const &s = profiler.getSensor(i);
+
+        pThis->printf("%-18s %8u %10u %10u\n",
+            cMeasurementLoop::getProfileSensorName(i),
+            s.n,
+            s.lastUs,
+            s.maxUs
+            );
+        }
+
+    pThis->printf("diagnostic uplink: %s\n", gMeasurementLoop.getDiagUplink() ? "on" : "off");
+    pThis->printf("uplinks waiting to retry: %u\n", gMeasurementLoop.getRetryCount());
+    }
+
+/*
+
+Name:   ::cmdStats()
+
+Function:
+    Command dispatcher for "stats" command.
+
+Definition:
+    McciCatena::cCommandStream::CommandFn cmdStats;
+
+    McciCatena::cCommandStream::CommandStatus cmdStats(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        );
+
+Description:
+    The "stats" command has the following syntax:
+
+    stats
+        Display the time spent in each state of the measurement loop,
+        the time taken by each sensor, the awake time and estimated
+        charge of the last measurement cycle, and the number of failed
+        uplinks waiting to be retried.
+
+    stats reset
+        Clear the statistics.
+
+    stats diag on | off
+        Turn the diagnostic extension field in uplinks on or off.
+
+Returns:
+    cCommandStream::CommandStatus::kSuccess if successful.
+    Some other value for failure.
+
+*/
+
+// argv[0] is "stats"
+// argv[1] is "reset" or "diag"
+// argv[2] is "on" or "off" for "diag"
+cCommandStream::CommandStatus cmdStats(
+    cCommandStream *pThis,
+    void *pContext,
+    int argc,
+    char **argv
+    )
+    {
+    if (argc == 2 && std::strcmp(argv[1], "reset") == 0)
+        {
+        gMeasurementLoop.resetProfiler();
+        }
+    else if (argc == 3 && std::strcmp(argv[1], "diag") == 0)
+        {
+        if (std::strcmp(argv[2], "on") == 0)
+            gMeasurementLoop.setDiagUplink(true);
+        else if (std::strcmp(argv[2], "off") == 0)
+            gMeasurementLoop.setDiagUplink(false);
+        else
+            return cCommandStream::CommandStatus::kInvalidParameter;
+        }
+    else if (argc != 1)
+        return cCommandStream::CommandStatus::kInvalidParameter;
+
+    printStats(pThis);
+    return cCommandStream::CommandStatus::kSuccess;
+    }
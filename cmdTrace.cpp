@@ -0,0 +1,114 @@
+/*
+
+Module:	cmdTrace.cpp
+
+Function:
+    Process the "trace" command
+
+Copyright and License:
+    This file copyright (C) 2022 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cmd.h"
+
+#include "ThermoSense-Lorawan.h"
+
+#include <cstring>
+
+using namespace McciCatena;
+using namespace McciCatena4610;
+
+/*
+
+Name:   ::cmdTrace()
+
+Function:
+    Command dispatcher for "trace" command.
+
+Definition:
+    McciCatena::cCommandStream::CommandFn cmdTrace;
+
+    McciCatena::cCommandStream::CommandStatus cmdTrace(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        );
+
+Description:
+    The "trace" command has the following syntax:
+
+    trace
+        Display the recent measurement loop events, oldest first, one
+        per line: the time in ms, then state changes, sensor results
+        and latencies, the values read, uplinks (port, length,
+        confirmed and the hash of the bytes), uplink completions,
+        power changes and provisioning changes. Capture this from
+        boot, with no events lost, to replay it with host/traceReplay.
+
+    trace clear
+        Forget the events recorded so far.
+
+    trace on | off
+        Turn recording on or off.
+
+Returns:
+    cCommandStream::CommandStatus::kSuccess if successful.
+    Some other value for failure.
+
+*/
+
+// argv[0] is "trace"
+// argv[1] is "clear", "on" or "off"
+cCommandStream::CommandStatus cmdTrace(
+    cCommandStream *pThis,
+    void *pContext,
+    int argc,
+    char **argv
+    )
+    {
+    auto &trace = gMeasurementLoop.getEventTrace();
+
+    if (argc == 2)
+        {
+        if (std::strcmp(argv[1], "clear") == 0)
+            trace.clear();
+        else if (std::strcmp(argv[1], "on") == 0)
+            trace.setEnabled(true);
+        else if (std::strcmp(argv[1], "off") == 0)
+            trace.setEnabled(false);
+        else
+            return cCommandStream::CommandStatus::kInvalidParameter;
+        }
+    else if (argc != 1)
+        return cCommandStream::CommandStatus::kInvalidParameter;
+
+    pThis->printf("trace: %u events (%u lost), recording %s\n",
+        unsigned(trace.getn()),
+        unsigned(trace.getnLost()),
+        trace.isEnabled() ? "on" : "off"
+        );
+
+    if (argc == 1)
+        {
+        char line[80];
+
+        for (std::uint16_t i = 0; i < trace.getn(); ++i)
+            {
+            cMeasurementLoop::formatTraceEvent(line, sizeof(line), trace.get(i));
+            pThis->printf("%s\n", line);
+            }
+        }
+
+    return cCommandStream::CommandStatus::kSuccess;
+    }
@@ -23,11 +23,170 @@ function dewpoint(t, rh) {
     return tdew;
 }
 
-function Decoder(bytes, port) {
+// per component of fields 0..5: vBat, vBus, boot, tempC, p, rh, lux, tWater
+var compField = [0x1, 0x2, 0x4, 0x8, 0x8, 0x8, 0x10, 0x20];
+var compSize = [2, 2, 1, 2, 2, 1, 2, 2];
+var compSigned = [true, true, false, true, false, false, false, true];
+
+// read a bitmap and its fields, starting at bytes[i]. If ref is null the
+// fields are in full, as in format 0x15; otherwise each component is a
+// zig-zag varint difference from ref. Returns { flags, v, i }.
+function readFields(bytes, i, ref) {
+    var flags = bytes[i++];
+    var v = [0, 0, 0, 0, 0, 0, 0, 0];
+
+    for (var iComp = 0; iComp < compField.length; ++iComp) {
+        if (!(flags & compField[iComp]))
+            continue;
+
+        var raw;
+        if (ref === null) {
+            if (compSize[iComp] === 2) {
+                raw = (bytes[i] << 8) + bytes[i + 1];
+                i += 2;
+                if (compSigned[iComp] && (raw & 0x8000))
+                    raw = -0x10000 + raw;
+            } else {
+                raw = bytes[i++];
+            }
+        } else {
+            // varint, low 7 bits first, then undo the zig-zag
+            var zz = 0;
+            var scale = 1;
+            var b;
+            do {
+                b = bytes[i++];
+                zz += (b & 0x7F) * scale;
+                scale *= 128;
+            } while (b & 0x80);
+            raw = ref[iComp] + ((zz % 2) ? -(zz + 1) / 2 : zz / 2);
+        }
+        v[iComp] = raw;
+    }
+
+    return { flags: flags, v: v, i: i };
+}
+
+// copy the components present in flags from v to ref.
+function updateRef(ref, flags, v) {
+    for (var iComp = 0; iComp < compField.length; ++iComp) {
+        if (flags & compField[iComp])
+            ref[iComp] = v[iComp];
+    }
+}
+
+// convert raw components to engineering units.
+function valuesToSample(sample, flags, v) {
+    if (flags & 0x1)
+        sample.vBat = v[0] / 4096.0;
+    if (flags & 0x2)
+        sample.vBus = v[1] / 4096.0;
+    if (flags & 0x4)
+        sample.boot = v[2];
+    if (flags & 0x8) {
+        sample.tempC = v[3] / 256;
+        sample.p = v[4] * 4 / 100.0;
+        sample.rh = v[5] / 256 * 100;
+        sample.tDewC = dewpoint(sample.tempC, sample.rh);
+    }
+    if (flags & 0x10)
+        sample.lux = v[6];
+    if (flags & 0x20)
+        sample.tWater = v[7] / 256;
+    return sample;
+}
+
+// decode a format 0x16 message: several samples, the first in full and
+// the rest as zig-zag varint differences.
+function decodeBatch(bytes) {
+    var decoded = {};
+    var nSamples = bytes[1] & 0x7F;
+    // bit 7: the newest sample was taken one interval before the send.
+    var ageOffset = (bytes[1] & 0x80) ? 1 : 0;
+    var interval = (bytes[2] << 8) + bytes[3];
+    var i = 4;
+    var last = [0, 0, 0, 0, 0, 0, 0, 0];
+
+    decoded.interval = interval;
+    decoded.samples = [];
+
+    for (var iSample = 0; iSample < nSamples; ++iSample) {
+        var f = readFields(bytes, i, iSample === 0 ? null : last);
+        i = f.i;
+        updateRef(last, f.flags, f.v);
+
+        var sample = { ageSeconds: (nSamples - 1 - iSample + ageOffset) * interval };
+        decoded.samples.push(valuesToSample(sample, f.flags, f.v));
+    }
+
+    return decoded;
+}
+
+// decode a format 0x17 message: a keyframe with the fields in full, or a
+// delta frame with differences from the frame numbered refSeq. refs maps
+// sequence numbers to the components of frames already received; if it
+// is not supplied, delta frames are reported as raw differences.
+function decodeDelta(bytes, refs) {
+    var decoded = {};
+    var ctrl = bytes[1];
+    var fKeyframe = (ctrl & 0x80) !== 0;
+    var i = 2;
+    var ref = null;
+
+    decoded.seq = ctrl & 0x7F;
+    decoded.keyframe = fKeyframe;
+
+    if (!fKeyframe) {
+        decoded.refSeq = bytes[i++];
+        if (refs && (decoded.refSeq in refs))
+            ref = refs[decoded.refSeq];
+    }
+
+    if (fKeyframe || ref !== null) {
+        var f = readFields(bytes, i, fKeyframe ? null : ref);
+        valuesToSample(decoded, f.flags, f.v);
+
+        if (refs) {
+            // the frame's components, with the reference's for fields
+            // it didn't carry.
+            var newRef = fKeyframe ? [0, 0, 0, 0, 0, 0, 0, 0] : ref.slice();
+            updateRef(newRef, f.flags, f.v);
+            refs[decoded.seq] = newRef;
+        }
+    } else {
+        var d = readFields(bytes, i, [0, 0, 0, 0, 0, 0, 0, 0]);
+        if (refs)
+            decoded.error = "missing reference frame";
+        decoded.delta = {};
+        valuesToSample(decoded.delta, d.flags & ~0x8, d.v);
+        if (d.flags & 0x8) {
+            decoded.delta.tempC = d.v[3] / 256;
+            decoded.delta.p = d.v[4] * 4 / 100.0;
+            decoded.delta.rh = d.v[5] / 256 * 100;
+        }
+    }
+
+    return decoded;
+}
+
+function Decoder(bytes, port, refs) {
     // Decode an uplink message from a buffer
     // (array) of bytes to an object of fields.
     var decoded = {};
 
+    if (port === 2) {
+        // backfilled data from the flash log: a uint32 sequence number
+        // and a uint16 age in minutes, followed by a port 1 message.
+        decoded = Decoder(bytes.slice(6), 1);
+        if (decoded === null)
+            return null;
+        decoded.seq = (bytes[0] * 0x1000000) + (bytes[1] << 16) + (bytes[2] << 8) + bytes[3];
+        var ageRaw = (bytes[4] << 8) + bytes[5];
+        if (ageRaw !== 0xFFFF)
+            decoded.ageMinutes = ageRaw;
+        return decoded;
+    }
+
     if (port === 1) {
         cmd = bytes[0];
         if (cmd == 0x15) {
@@ -83,6 +242,21 @@ function Decoder(bytes, port) {
             //    "tempC": -10.39453125,
             //    "vBat": 4.1767578125
             //    }
+            // 15 A0 1C 11 01 03 1B 80 1A 40
+            //    {
+            //    "tProbes": [28.06640625, 27.5, 26.25],
+            //    "tWater": 28.06640625
+            //    }
+            // 15 A0 1C 11 02 0B B8 0F A0 07 D0
+            //    {
+            //    "diag": { "awakeMs": 3000, "chargeMc": 40, "transmitMs": 2000 },
+            //    "tWater": 28.06640625
+            //    }
+            // 15 A0 1C 11 04 05 1B F0 1C 80 1C 20 00 38
+            //    {
+            //    "tWater": 28.06640625,
+            //    "tWaterStats": { "n": 5, "min": 27.9375, "max": 28.5, "mean": 28.125, "stdDev": 0.21875 }
+            //    }
             // i is used as the index into the message. Start with the flag byte.
             var i = 1;
             // fetch the bitmap.
@@ -158,6 +332,72 @@ function Decoder(bytes, port) {
                 decoded.rhSoil = tempRH / 256 * 100;
                 decoded.tSoilDew = dewpoint(decoded.tSoil, decoded.rhSoil);
             }
+
+            if (flags & 0x80) {
+                // extension fields: another bitmap, then the fields.
+                var extFlags = bytes[i++];
+
+                if (extFlags & 0x1) {
+                    // additional compost probes: count of all probes,
+                    // then int16 temperatures of probes 1..n-1.
+                    var nProbes = bytes[i++];
+                    decoded.tProbes = [("tWater" in decoded) ? decoded.tWater : null];
+                    for (var iProbe = 1; iProbe < nProbes; ++iProbe) {
+                        var tProbeRaw = (bytes[i] << 8) + bytes[i + 1];
+                        i += 2;
+                        if (tProbeRaw === 0x8000) {
+                            // no reading from this probe
+                            decoded.tProbes.push(null);
+                        } else {
+                            if (tProbeRaw & 0x8000)
+                                tProbeRaw = -0x10000 + tProbeRaw;
+                            decoded.tProbes.push(tProbeRaw / 256);
+                        }
+                    }
+                }
+
+                if (extFlags & 0x2) {
+                    // diagnostics for the previous measurement cycle:
+                    // awake ms, charge in units of 10 uC, transmit ms.
+                    decoded.diag = {};
+                    decoded.diag.awakeMs = (bytes[i] << 8) + bytes[i + 1];
+                    decoded.diag.chargeMc = ((bytes[i + 2] << 8) + bytes[i + 3]) / 100;
+                    decoded.diag.transmitMs = (bytes[i + 4] << 8) + bytes[i + 5];
+                    i += 6;
+                }
+
+                if (extFlags & 0x4) {
+                    // compost temperature summary since the last uplink:
+                    // sample count, then int16 min, max, mean, std dev.
+                    var stats = { n: bytes[i++] };
+                    var statNames = ["min", "max", "mean", "stdDev"];
+                    for (var iStat = 0; iStat < statNames.length; ++iStat) {
+                        var statRaw = (bytes[i] << 8) + bytes[i + 1];
+                        i += 2;
+                        if (statRaw & 0x8000)
+                            statRaw = -0x10000 + statRaw;
+                        stats[statNames[iStat]] = statRaw / 256;
+                    }
+                    decoded.tWaterStats = stats;
+                }
+            }
+        } else if (cmd == 0x16) {
+            // batched samples.
+            // test vector:
+            // 16 02 03 84 29 44 60 15 9D 5F CD C3 1C 11 29 07 0E 09 00 1E
+            //    { "interval": 900, "samples": [
+            //      { "ageSeconds": 900, "vBat": 4.2734375, "tempC": 21.61328125, "p": 981, "rh": 76.171875, "tWater": 28.06640625, ... },
+            //      { "ageSeconds": 0, "vBat": 4.2724609375, "tempC": 21.640625, "p": 980.8, "rh": 76.171875, "tWater": 28.125, ... }
+            //    ] }
+            decoded = decodeBatch(bytes);
+        } else if (cmd == 0x17) {
+            // delta-encoded sample.
+            // test vectors:
+            // 17 80 29 44 60 15 9D 5F CD C3 1C 11
+            //    { "seq": 0, "keyframe": true, "vBat": 4.2734375, "tempC": 21.61328125, "p": 981, "rh": 76.171875, "tWater": 28.06640625, ... }
+            // 17 01 00 29 07 0E 09 00 1E
+            //    { "seq": 1, "keyframe": false, "refSeq": 0, "vBat": 4.2724609375, "tempC": 21.640625, "p": 980.8, "rh": 76.171875, "tWater": 28.125, ... }
+            decoded = decodeDelta(bytes, refs);
         } else {
             node.error("not ours! " + bytes[0].toString());
             return null;
@@ -177,11 +417,18 @@ if ("payload_raw" in msg) {
     bytes = msg.payload;  // pick up data for conveneince
 }
 
+// format 0x17 delta frames are decoded against frames already received
+// from the same device; keep those in the node context.
+var refsKey = "deltaRefs_" + (("dev_id" in msg) ? msg.dev_id : "default");
+var refs = context.get(refsKey) || {};
+
 // try to decode.
-var result = Decoder(bytes, msg.port);
+var result = Decoder(bytes, msg.port, refs);
+
+context.set(refsKey, refs);
 
 if (result === null) {
-    node.error("not port 1/fmt 0x15! port=" + msg.port.toString());
+    node.error("not port 1,2/fmt 0x15..0x17! port=" + msg.port.toString());
 }
 
 // now update msg with the new payload and new .local field
@@ -0,0 +1,1042 @@
+/*
+
+Module: Catena4610_cHostSim.cpp
+
+Function:
+    The host simulator, and the Hal functions of the host build.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cHostSim.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <x86intrin.h>
+#endif
+
+using namespace McciCatena4610;
+
+cHostSim McciCatena4610::gHostSim;
+
+/****************************************************************************\
+|
+|   BME280 model
+|
+\****************************************************************************/
+
+namespace {
+
+// the calibration of the worked example in the BME280 datasheet, with
+// humidity terms from a production part.
+constexpr std::uint16_t kT1 = 27504;
+constexpr std::int16_t kT2 = 26435;
+constexpr std::int16_t kT3 = -1000;
+constexpr std::uint16_t kP1 = 36477;
+constexpr std::int16_t kP2 = -10685;
+constexpr std::int16_t kP3 = 3024;
+constexpr std::int16_t kP4 = 2855;
+constexpr std::int16_t kP5 = 140;
+constexpr std::int16_t kP6 = -7;
+constexpr std::int16_t kP7 = 15500;
+constexpr std::int16_t kP8 = -14600;
+constexpr std::int16_t kP9 = 6000;
+constexpr std::uint8_t kH1 = 75;
+constexpr std::int16_t kH2 = 362;
+constexpr std::uint8_t kH3 = 0;
+constexpr std::int16_t kH4 = 313;
+constexpr std::int16_t kH5 = 50;
+constexpr std::int8_t kH6 = 30;
+
+constexpr std::int32_t kSkipped20 = 0x80000;
+constexpr std::int32_t kSkipped16 = 0x8000;
+
+// datasheet section 4.2.3; returns degrees C * 100.
+std::int32_t compensateT(std::int32_t adcT, std::int32_t &tFine)
+    {
+    std::int32_t const dT = (adcT >> 4) - std::int32_t(kT1);
+    std::int32_t const var1 = (((adcT >> 3) - (std::int32_t(kT1) << 1)) * kT2) >> 11;
+    std::int32_t const var2 = (((dT * dT) >> 12) * kT3) >> 14;
+
+    tFine = var1 + var2;
+    return (tFine * 5 + 128) >> 8;
+    }
+
+// returns Pa in Q24.8.
+std::int64_t compensateP(std::int32_t adcP, std::int32_t tFine)
+    {
+    std::int64_t var1 = std::int64_t(tFine) - 128000;
+    std::int64_t var2 = var1 * var1 * kP6;
+    std::int64_t p;
+
+    var2 = var2 + ((var1 * kP5) << 17);
+    var2 = var2 + (std::int64_t(kP4) << 35);
+    var1 = ((var1 * var1 * kP3) >> 8) + ((var1 * kP2) << 12);
+    var1 = ((std::int64_t(1) << 47) + var1) * kP1 >> 33;
+
+    p = 1048576 - adcP;
+    p = (((p << 31) - var2) * 3125) / var1;
+    var1 = (std::int64_t(kP9) * (p >> 13) * (p >> 13)) >> 25;
+    var2 = (std::int64_t(kP8) * p) >> 19;
+    return ((p + var1 + var2) >> 8) + (std::int64_t(kP7) << 4);
+    }
+
+// returns percent RH in Q22.10.
+std::int32_t compensateH(std::int32_t adcH, std::int32_t tFine)
+    {
+    std::int32_t v = tFine - 76800;
+
+    v = (((((adcH << 14) - (std::int32_t(kH4) << 20) - (kH5 * v)) + 16384) >> 15) *
+         (((((((v * kH6) >> 10) * (((v * std::int32_t(kH3)) >> 11) + 32768)) >> 10) +
+            2097152) * kH2 + 8192) >> 14));
+    v = v - (((((v >> 15) * (v >> 15)) >> 7) * kH1) >> 4);
+    v = std::max<std::int32_t>(0, std::min<std::int32_t>(v, 419430400));
+    return v >> 12;
+    }
+
+// the smallest raw value in [0, nMax) for which fn() has reached the
+// target; fn() must be monotonic. fIncreasing says which way.
+template <typename Fn>
+std::int32_t invert(Fn fn, std::int64_t target, std::int32_t nMax, bool fIncreasing)
+    {
+    std::int32_t lo = 0;
+    std::int32_t hi = nMax - 1;
+
+    while (lo < hi)
+        {
+        std::int32_t const mid = lo + (hi - lo) / 2;
+        std::int64_t const v = fn(mid);
+
+        if (fIncreasing ? v >= target : v <= target)
+            hi = mid;
+        else
+            lo = mid + 1;
+        }
+
+    return lo;
+    }
+
+void putU16Le(std::uint8_t *p, std::uint16_t v)
+    {
+    p[0] = std::uint8_t(v);
+    p[1] = std::uint8_t(v >> 8);
+    }
+
+unsigned getOversamplingCount(unsigned code)
+    {
+    return code == 0 ? 0 : 1u << (std::min(code, 5u) - 1);
+    }
+
+} // namespace
+
+void
+cHostSim::bme280Reset(
+    void
+    )
+    {
+    auto &r = this->m_Bme280Regs;
+
+    std::memset(r, 0, sizeof(r));
+    r[0xD0] = 0x60;
+
+    putU16Le(r + 0x88, kT1);
+    putU16Le(r + 0x8A, std::uint16_t(kT2));
+    putU16Le(r + 0x8C, std::uint16_t(kT3));
+    putU16Le(r + 0x8E, kP1);
+    putU16Le(r + 0x90, std::uint16_t(kP2));
+    putU16Le(r + 0x92, std::uint16_t(kP3));
+    putU16Le(r + 0x94, std::uint16_t(kP4));
+    putU16Le(r + 0x96, std::uint16_t(kP5));
+    putU16Le(r + 0x98, std::uint16_t(kP6));
+    putU16Le(r + 0x9A, std::uint16_t(kP7));
+    putU16Le(r + 0x9C, std::uint16_t(kP8));
+    putU16Le(r + 0x9E, std::uint16_t(kP9));
+    r[0xA1] = kH1;
+    putU16Le(r + 0xE1, std::uint16_t(kH2));
+    r[0xE3] = kH3;
+    r[0xE4] = std::uint8_t(kH4 >> 4);
+    r[0xE5] = std::uint8_t((kH4 & 0x0F) | ((kH5 & 0x0F) << 4));
+    r[0xE6] = std::uint8_t(kH5 >> 4);
+    r[0xE7] = std::uint8_t(kH6);
+
+    // nothing measured yet.
+    r[0xF7] = 0x80;
+    r[0xFA] = 0x80;
+    r[0xFD] = 0x80;
+
+    this->m_fBme280Busy = false;
+    }
+
+// the raw values that compensate to the environment set by setEnv().
+void
+cHostSim::bme280Compute(
+    std::int32_t &adcT,
+    std::int32_t &adcP,
+    std::int32_t &adcH
+    ) const
+    {
+    std::int32_t tFine;
+
+    adcT = invert(
+        [&tFine](std::int32_t adc) { return compensateT(adc, tFine); },
+        std::lround(this->m_EnvTempC * 100.0f),
+        1 << 20,
+        true
+        );
+    compensateT(adcT, tFine);
+
+    adcP = invert(
+        [tFine](std::int32_t adc) { return compensateP(adc, tFine); },
+        std::llround(this->m_EnvPressurePa * 256.0),
+        1 << 20,
+        false
+        );
+
+    adcH = invert(
+        [tFine](std::int32_t adc) { return compensateH(adc, tFine); },
+        std::lround(this->m_EnvRH * 1024.0f),
+        1 << 16,
+        true
+        );
+
+    // the skipped markers can't be real readings.
+    if (adcT == kSkipped20)
+        ++adcT;
+    if (adcP == kSkipped20)
+        ++adcP;
+    if (adcH == kSkipped16)
+        ++adcH;
+    }
+
+void
+cHostSim::bme280StartForced(
+    void
+    )
+    {
+    auto &r = this->m_Bme280Regs;
+    unsigned const nT = getOversamplingCount(r[0xF4] >> 5);
+    unsigned const nP = getOversamplingCount((r[0xF4] >> 2) & 7);
+    unsigned const nH = getOversamplingCount(r[0xF2] & 7);
+    std::int32_t adcT, adcP, adcH;
+
+    this->bme280Compute(adcT, adcP, adcH);
+    if (nT == 0)
+        adcT = kSkipped20;
+    if (nP == 0)
+        adcP = kSkipped20;
+    if (nH == 0)
+        adcH = kSkipped16;
+
+    r[0xF7] = std::uint8_t(adcP >> 12);
+    r[0xF8] = std::uint8_t(adcP >> 4);
+    r[0xF9] = std::uint8_t(adcP << 4);
+    r[0xFA] = std::uint8_t(adcT >> 12);
+    r[0xFB] = std::uint8_t(adcT >> 4);
+    r[0xFC] = std::uint8_t(adcT << 4);
+    r[0xFD] = std::uint8_t(adcH >> 8);
+    r[0xFE] = std::uint8_t(adcH);
+
+    // datasheet appendix B, typical times.
+    std::uint32_t us = 1000 + 2000 * nT;
+
+    if (nP != 0)
+        us += 2000 * nP + 500;
+    if (nH != 0)
+        us += 2000 * nH + 500;
+
+    this->m_tBme280Done = this->millis() + (us + 999) / 1000;
+    this->m_fBme280Busy = true;
+    }
+
+std::uint8_t
+cHostSim::bme280ReadRegister(
+    std::uint8_t reg
+    ) const
+    {
+    bool const fBusy = this->m_fBme280Busy &&
+                       std::int32_t(this->millis() - this->m_tBme280Done) < 0;
+
+    if (reg == 0xF3)
+        return fBusy ? 1u << 3 : 0;
+    if (reg == 0xF4)
+        return std::uint8_t((this->m_Bme280Regs[reg] & ~3u) | (fBusy ? 1 : 0));
+
+    return this->m_Bme280Regs[reg];
+    }
+
+bool
+cHostSim::i2cRead(
+    std::uint8_t addr,
+    std::uint8_t reg,
+    std::uint8_t *pBuf,
+    std::size_t nBuf
+    )
+    {
+    if (addr != kBme280Address || ! this->m_fBme280Present)
+        return false;
+
+    for (std::size_t i = 0; i < nBuf; ++i)
+        pBuf[i] = this->bme280ReadRegister(std::uint8_t(reg + i));
+
+    return true;
+    }
+
+bool
+cHostSim::i2cWrite(
+    std::uint8_t addr,
+    std::uint8_t reg,
+    std::uint8_t value
+    )
+    {
+    if (addr != kBme280Address || ! this->m_fBme280Present)
+        return false;
+
+    if (reg == 0xE0)
+        {
+        if (value == 0xB6)
+            this->bme280Reset();
+        }
+    else if (reg == 0xF2 || reg == 0xF5)
+        this->m_Bme280Regs[reg] = value;
+    else if (reg == 0xF4)
+        {
+        this->m_Bme280Regs[reg] = std::uint8_t(value & ~3u);
+        if ((value & 3) == 1 || (value & 3) == 2)
+            this->bme280StartForced();
+        }
+
+    return true;
+    }
+
+/****************************************************************************\
+|
+|   The simulator
+|
+\****************************************************************************/
+
+cHostSim::cHostSim()
+    {
+    this->reset();
+    }
+
+void
+cHostSim::reset(
+    void
+    )
+    {
+    this->m_us = 0;
+    this->m_TickMs = kDefaultTickMs;
+
+    this->m_Vbat = 3.7f;
+    this->m_Vbus = 0.0f;
+    this->m_BootCount = 1;
+    this->m_OperatingFlags = 1;     // fUnattended: deep sleep when idle
+    this->m_AppConfig.clear();
+    std::memset(this->m_PinMode, 0, sizeof(this->m_PinMode));
+    std::memset(this->m_PinLevel, 0, sizeof(this->m_PinLevel));
+    this->m_Led = Hal::LedPattern::Off;
+    this->m_Pollables.clear();
+    this->m_fConsoleEcho = false;
+    this->m_Console.clear();
+    this->m_nDeepSleep = 0;
+    this->m_DeepSleepMs = 0;
+
+    this->m_fBme280Present = true;
+    this->setEnv(20.0f, 101325.0f, 50.0f);
+    this->bme280Reset();
+    this->m_tBme280Done = 0;
+
+    this->m_fSi1133Present = true;
+    this->m_fSi1133Running = false;
+    this->m_Lux = 500;
+    this->m_Si1133LatencyMs = 10;
+    this->m_tSi1133Start = 0;
+
+    this->m_fCompostFitted = true;
+    this->m_Probes.clear();
+    this->m_Found.clear();
+    this->m_tConversionStart = 0;
+    this->m_nProbeResolutionWrites = 0;
+    this->m_fConversionPending = false;
+
+    this->m_fProvisioned = true;
+    this->m_DataRate = 3;
+    this->m_AirtimeMs = kDefaultAirtimeMs;
+    this->m_pRadioResultFn = nullptr;
+    this->m_pRadioResultContext = nullptr;
+    this->m_fDownlink = false;
+    this->m_DownlinkRssi = 0;
+    this->m_DownlinkSnr = 0;
+    this->m_Uplinks.clear();
+    this->m_fTxPending = false;
+    this->m_fTxSuccess = false;
+    this->m_tTxDone = 0;
+    this->m_pTxDoneFn = nullptr;
+    this->m_pTxDoneContext = nullptr;
+    }
+
+void
+cHostSim::step(
+    void
+    )
+    {
+    this->serviceRadio();
+
+    for (auto const pObject : this->m_Pollables)
+        pObject->poll();
+
+    this->advance(this->m_TickMs);
+    }
+
+void
+cHostSim::run(
+    std::uint32_t ms
+    )
+    {
+    std::uint64_t const tEnd = this->getElapsedMs() + ms;
+
+    while (this->getElapsedMs() < tEnd)
+        this->step();
+    }
+
+// used while the loop busy-waits; time has to move.
+void
+cHostSim::pollPlatform(
+    void
+    )
+    {
+    this->serviceRadio();
+
+    for (auto const pObject : this->m_Pollables)
+        pObject->poll();
+
+    this->advance(1);
+    }
+
+void
+cHostSim::registerPollable(
+    McciCatena::cPollableObject *pObject
+    )
+    {
+    if (std::find(this->m_Pollables.begin(), this->m_Pollables.end(), pObject) ==
+        this->m_Pollables.end())
+        this->m_Pollables.push_back(pObject);
+    }
+
+void
+cHostSim::deepSleep(
+    std::uint32_t sec
+    )
+    {
+    this->advance(sec * 1000);
+    ++this->m_nDeepSleep;
+    this->m_DeepSleepMs += std::uint64_t(sec) * 1000;
+    }
+
+void
+cHostSim::consoleWrite(
+    const char *pText
+    )
+    {
+    this->m_Console += pText;
+    if (this->m_fConsoleEcho)
+        std::fputs(pText, stdout);
+    }
+
+bool
+cHostSim::readAppConfig(
+    std::uint8_t *pData,
+    std::size_t nData
+    ) const
+    {
+    if (this->m_AppConfig.size() != nData)
+        return false;
+
+    std::memcpy(pData, this->m_AppConfig.data(), nData);
+    return true;
+    }
+
+bool
+cHostSim::writeAppConfig(
+    const std::uint8_t *pData,
+    std::size_t nData
+    )
+    {
+    this->m_AppConfig.assign(pData, pData + nData);
+    return true;
+    }
+
+void
+cHostSim::pinMode(
+    std::uint32_t pin,
+    std::uint32_t mode
+    )
+    {
+    bool const fWasOn = this->isProbePowerOn();
+
+    if (pin < sizeof(this->m_PinMode))
+        this->m_PinMode[pin] = std::uint8_t(mode);
+
+    this->checkProbePowerOff(fWasOn);
+    }
+
+void
+cHostSim::digitalWrite(
+    std::uint32_t pin,
+    std::uint32_t value
+    )
+    {
+    bool const fWasOn = this->isProbePowerOn();
+
+    if (pin < sizeof(this->m_PinLevel))
+        this->m_PinLevel[pin] = value != 0;
+
+    this->checkProbePowerOff(fWasOn);
+    }
+
+bool
+cHostSim::isPinHigh(
+    std::uint32_t pin
+    ) const
+    {
+    return pin < sizeof(this->m_PinMode) &&
+           this->m_PinMode[pin] == Hal::kPinModeOutput &&
+           this->m_PinLevel[pin] != 0;
+    }
+
+/****************************************************************************\
+|
+|   OneWire probes
+|
+\****************************************************************************/
+
+std::size_t
+cHostSim::addProbe(
+    float tempC,
+    std::uint8_t bits
+    )
+    {
+    Probe p {};
+    std::size_t const i = this->m_Probes.size();
+
+    // a DS18B20 family code, and a serial number made from the index.
+    p.rom[0] = 0x28;
+    p.rom[1] = std::uint8_t(i + 1);
+    p.rom[7] = std::uint8_t(0xA5 ^ i);
+    p.TempC = tempC;
+    p.Bits = bits;
+    p.EepromBits = bits;
+    p.fConnected = true;
+
+    this->m_Probes.push_back(p);
+    return i;
+    }
+
+bool
+cHostSim::isProbePowerOn(
+    void
+    ) const
+    {
+    return this->isPinHigh(Hal::kPinVout2);
+    }
+
+// when V_OUT2 goes off, the probes lose their scratchpads, and come
+// back at the resolution in their EEPROMs.
+void
+cHostSim::checkProbePowerOff(
+    bool fWasOn
+    )
+    {
+    if (! fWasOn || this->isProbePowerOn())
+        return;
+
+    for (auto &p : this->m_Probes)
+        p.Bits = p.EepromBits;
+    }
+
+cHostSim::Probe const *
+cHostSim::findProbe(
+    const Hal::OneWireRom_t rom
+    ) const
+    {
+    if (! this->isProbePowerOn())
+        return nullptr;
+
+    for (auto const &p : this->m_Probes)
+        {
+        if (p.fConnected && std::memcmp(p.rom, rom, sizeof(p.rom)) == 0)
+            return &p;
+        }
+
+    return nullptr;
+    }
+
+bool
+cHostSim::compostResetBus(
+    void
+    ) const
+    {
+    if (! this->isProbePowerOn())
+        return false;
+
+    return std::any_of(
+        this->m_Probes.begin(), this->m_Probes.end(),
+        [](Probe const &p) { return p.fConnected; }
+        );
+    }
+
+std::uint8_t
+cHostSim::compostSearch(
+    void
+    )
+    {
+    this->m_Found.clear();
+    if (! this->isProbePowerOn())
+        return 0;
+
+    for (std::size_t i = 0; i < this->m_Probes.size(); ++i)
+        {
+        if (this->m_Probes[i].fConnected)
+            this->m_Found.push_back(i);
+        }
+
+    return std::uint8_t(this->m_Found.size());
+    }
+
+bool
+cHostSim::compostGetAddress(
+    Hal::OneWireRom_t rom,
+    std::uint8_t index
+    ) const
+    {
+    if (index >= this->m_Found.size())
+        return false;
+
+    std::memcpy(rom, this->m_Probes[this->m_Found[index]].rom, sizeof(Hal::OneWireRom_t));
+    return true;
+    }
+
+std::uint8_t
+cHostSim::compostGetResolution(
+    const Hal::OneWireRom_t rom
+    ) const
+    {
+    auto const pProbe = this->findProbe(rom);
+
+    return pProbe ? pProbe->Bits : 0;
+    }
+
+bool
+cHostSim::compostSetResolution(
+    const Hal::OneWireRom_t rom,
+    std::uint8_t bits
+    )
+    {
+    auto const pProbe = this->findProbe(rom);
+
+    if (pProbe == nullptr || bits < 9 || bits > 12)
+        return false;
+
+    this->m_Probes[pProbe - this->m_Probes.data()].Bits = bits;
+    ++this->m_nProbeResolutionWrites;
+    return true;
+    }
+
+void
+cHostSim::compostStartConversion(
+    void
+    )
+    {
+    this->m_tConversionStart = this->millis();
+    this->m_fConversionPending = true;
+    }
+
+bool
+cHostSim::compostIsConversionComplete(
+    void
+    ) const
+    {
+    if (! this->m_fConversionPending)
+        return true;
+
+    std::uint32_t tConversion = 0;
+
+    for (auto const &p : this->m_Probes)
+        {
+        if (p.fConnected)
+            tConversion = std::max(tConversion, compostGetConversionMs(p.Bits));
+        }
+
+    return this->millis() - this->m_tConversionStart >= tConversion;
+    }
+
+std::uint32_t
+cHostSim::compostGetConversionMs(
+    std::uint8_t bits
+    )
+    {
+    if (bits < 9)
+        bits = 9;
+    else if (bits > 12)
+        bits = 12;
+
+    return 94u << (bits - 9);
+    }
+
+float
+cHostSim::compostGetTempC(
+    const Hal::OneWireRom_t rom
+    ) const
+    {
+    auto const pProbe = this->findProbe(rom);
+
+    if (pProbe == nullptr)
+        return NAN;
+
+    // the DS18B20 leaves the low bits undefined; treat them as zero.
+    float const lsb = 0.0625f * float(1u << (12 - pProbe->Bits));
+
+    return std::floor(pProbe->TempC / lsb) * lsb;
+    }
+
+/****************************************************************************\
+|
+|   Radio
+|
+\****************************************************************************/
+
+bool
+cHostSim::sendBuffer(
+    const std::uint8_t *pBuffer,
+    std::size_t nBuffer,
+    Hal::SendBufferCbFn *pDoneFn,
+    void *pClientData,
+    bool fConfirmed,
+    std::uint8_t port
+    )
+    {
+    if (! this->m_fProvisioned || this->m_fTxPending)
+        return false;
+
+    Uplink u;
+
+    u.tMs = this->millis();
+    u.port = port;
+    u.fConfirmed = fConfirmed;
+    u.data.assign(pBuffer, pBuffer + nBuffer);
+    u.fSuccess = this->m_pRadioResultFn == nullptr ||
+                 this->m_pRadioResultFn(this->m_pRadioResultContext, u);
+
+    this->m_Uplinks.push_back(u);
+
+    this->m_fTxPending = true;
+    this->m_fTxSuccess = u.fSuccess;
+    this->m_tTxDone = u.tMs + this->m_AirtimeMs;
+    this->m_pTxDoneFn = pDoneFn;
+    this->m_pTxDoneContext = pClientData;
+    return true;
+    }
+
+void
+cHostSim::serviceRadio(
+    void
+    )
+    {
+    if (! this->m_fTxPending || std::int32_t(this->millis() - this->m_tTxDone) < 0)
+        return;
+
+    this->m_fTxPending = false;
+    if (this->m_pTxDoneFn != nullptr)
+        this->m_pTxDoneFn(this->m_pTxDoneContext, this->m_fTxSuccess);
+    }
+
+bool
+cHostSim::getDownlinkSignal(
+    std::int16_t &rssi,
+    float &snr
+    ) const
+    {
+    if (! this->m_fDownlink)
+        return false;
+
+    rssi = this->m_DownlinkRssi;
+    snr = this->m_DownlinkSnr;
+    return true;
+    }
+
+/****************************************************************************\
+|
+|   The Hal
+|
+\****************************************************************************/
+
+namespace McciCatena4610 {
+namespace Hal {
+
+std::uint32_t millis(void)
+    {
+    return gHostSim.millis();
+    }
+
+std::uint32_t micros(void)
+    {
+    return gHostSim.micros();
+    }
+
+// the host's own counter, not the virtual clock, so that benchmarks
+// measure the work done. On other than x86 it counts nanoseconds.
+std::uint32_t getCycleCount(void)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+    return std::uint32_t(__rdtsc());
+#else
+    return std::uint32_t(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+            ).count()
+        );
+#endif
+    }
+
+void delay(std::uint32_t ms)
+    {
+    gHostSim.advance(ms);
+    }
+
+void safePrintf(const char *pFmt, ...)
+    {
+    char buf[256];
+    std::va_list ap;
+
+    va_start(ap, pFmt);
+    std::vsnprintf(buf, sizeof(buf), pFmt, ap);
+    va_end(ap);
+
+    gHostSim.consoleWrite(buf);
+    }
+
+float readVbat(void)
+    {
+    return gHostSim.readVbat();
+    }
+
+float readVbus(void)
+    {
+    return gHostSim.readVbus();
+    }
+
+bool getBootCount(std::uint32_t &bootCount)
+    {
+    return gHostSim.getBootCount(bootCount);
+    }
+
+bool readAppConfig(std::uint8_t *pData, std::size_t nData)
+    {
+    return gHostSim.readAppConfig(pData, nData);
+    }
+
+bool writeAppConfig(const std::uint8_t *pData, std::size_t nData)
+    {
+    return gHostSim.writeAppConfig(pData, nData);
+    }
+
+void pinMode(std::uint32_t pin, std::uint32_t mode)
+    {
+    gHostSim.pinMode(pin, mode);
+    }
+
+void digitalWrite(std::uint32_t pin, std::uint32_t value)
+    {
+    gHostSim.digitalWrite(pin, value);
+    }
+
+bool isProvisioned(void)
+    {
+    return gHostSim.isProvisioned();
+    }
+
+std::uint8_t getDataRate(void)
+    {
+    return gHostSim.getDataRate();
+    }
+
+bool isRadioBusyWithin(std::uint32_t /* ms */)
+    {
+    return gHostSim.isRadioBusy();
+    }
+
+std::uint32_t getDutyCycleWaitMs(void)
+    {
+    return 0;
+    }
+
+bool getDownlinkSignal(std::int16_t &rssi, float &snr)
+    {
+    return gHostSim.getDownlinkSignal(rssi, snr);
+    }
+
+void lowerDataRate(void)
+    {
+    gHostSim.lowerDataRate();
+    }
+
+bool sendBuffer(
+    const std::uint8_t *pBuffer,
+    std::size_t nBuffer,
+    SendBufferCbFn *pDoneFn,
+    void *pClientData,
+    bool fConfirmed,
+    std::uint8_t port
+    )
+    {
+    return gHostSim.sendBuffer(pBuffer, nBuffer, pDoneFn, pClientData, fConfirmed, port);
+    }
+
+std::uint32_t getOperatingFlags(void)
+    {
+    return gHostSim.getOperatingFlags();
+    }
+
+bool isConsoleConnected(void)
+    {
+    return false;
+    }
+
+void pollPlatform(void)
+    {
+    gHostSim.pollPlatform();
+    }
+
+void registerPollable(McciCatena::cPollableObject *pObject)
+    {
+    gHostSim.registerPollable(pObject);
+    }
+
+void deepSleep(std::uint32_t sec)
+    {
+    gHostSim.deepSleep(sec);
+    }
+
+void setLed(LedPattern pattern)
+    {
+    gHostSim.setLed(pattern);
+    }
+
+void beginI2c(void)
+    {
+    }
+
+bool i2cReadRegisters(std::uint8_t addr, std::uint8_t reg, std::uint8_t *pBuf, std::size_t nBuf)
+    {
+    return gHostSim.i2cRead(addr, reg, pBuf, nBuf);
+    }
+
+bool i2cWriteRegister(std::uint8_t addr, std::uint8_t reg, std::uint8_t value)
+    {
+    return gHostSim.i2cWrite(addr, reg, value);
+    }
+
+void beginSpi(SPIClass * /* pSpi */)
+    {
+    }
+
+void endSpi(SPIClass * /* pSpi */)
+    {
+    }
+
+void suspendBuses(void)
+    {
+    }
+
+void resumeBuses(void)
+    {
+    }
+
+bool si1133Begin(void)
+    {
+    return gHostSim.si1133Begin();
+    }
+
+void si1133Start(void)
+    {
+    gHostSim.si1133Start();
+    }
+
+bool si1133IsReady(void)
+    {
+    return gHostSim.si1133IsReady();
+    }
+
+std::uint32_t si1133Read(void)
+    {
+    return gHostSim.si1133Read();
+    }
+
+void si1133Stop(void)
+    {
+    gHostSim.si1133Stop();
+    }
+
+bool hasCompostProbe(void)
+    {
+    return gHostSim.hasCompostProbe();
+    }
+
+bool compostResetBus(void)
+    {
+    return gHostSim.compostResetBus();
+    }
+
+std::uint8_t compostSearch(void)
+    {
+    return gHostSim.compostSearch();
+    }
+
+bool compostGetAddress(OneWireRom_t rom, std::uint8_t index)
+    {
+    return gHostSim.compostGetAddress(rom, index);
+    }
+
+std::uint8_t compostGetResolution(const OneWireRom_t rom)
+    {
+    return gHostSim.compostGetResolution(rom);
+    }
+
+bool compostSetResolution(const OneWireRom_t rom, std::uint8_t bits)
+    {
+    return gHostSim.compostSetResolution(rom, bits);
+    }
+
+void compostStartConversion(void)
+    {
+    gHostSim.compostStartConversion();
+    }
+
+bool compostIsConversionComplete(void)
+    {
+    return gHostSim.compostIsConversionComplete();
+    }
+
+std::uint32_t compostGetConversionMs(std::uint8_t bits)
+    {
+    return cHostSim::compostGetConversionMs(bits);
+    }
+
+float compostGetTempC(const OneWireRom_t rom)
+    {
+    return gHostSim.compostGetTempC(rom);
+    }
+
+} // namespace Hal
+} // namespace McciCatena4610
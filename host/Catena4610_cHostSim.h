@@ -0,0 +1,417 @@
+/*
+
+Module: Catena4610_cHostSim.h
+
+Function:
+    The host simulator behind McciCatena4610::Hal.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_cHostSim_h_
+# define _Catena4610_cHostSim_h_
+
+#pragma once
+
+#include "Catena4610_hal.h"
+
+#include <Catena_PollableInterface.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace McciCatena4610 {
+
+/*
+
+Name:   McciCatena4610::cHostSim
+
+Function:
+    Virtual clock, fake sensors and fake radio for the host build.
+
+Description:
+    In the host build (CATENA4610_HOST_SIM), every Hal function is
+    answered by the one instance of this class, gHostSim. A test sets
+    up the world (supply voltages, what the sensors read, whether the
+    radio gets through), starts cMeasurementLoop the way setup() does,
+    and calls run() to let virtual time go by. Nothing waits in real
+    time: the clock only moves in run(), in Hal::delay(), in
+    Hal::pollPlatform(), and in Hal::deepSleep(), which jumps it by
+    the whole sleep.
+
+    The sensors are modelled at the level the loop talks to them:
+
+    - The BME280 is a register file at I2C address 0x77 with datasheet
+      calibration. A forced conversion stays busy for the datasheet
+      time, then returns the raw values that compensate to the
+      temperature, pressure and humidity set by setEnv().
+    - The Si1133 returns setLux() a fixed time after it's started.
+    - The DS18B20 probes answer only while V_OUT2 (D11) is driven
+      high. Conversion takes 94 ms << (bits - 9), and readings are
+      truncated to the probe's resolution. A resolution that's set
+      is lost when V_OUT2 goes low, as only the scratchpad is written.
+
+    The radio records every uplink and completes it after the airtime.
+    By default every uplink gets through; setRadioResult() installs a
+    function that decides, so tests can simulate an outage.
+
+*/
+
+class cHostSim
+    {
+public:
+    // an uplink, as handed to the radio.
+    struct Uplink
+        {
+        std::uint32_t               tMs;
+        std::uint8_t                port;
+        bool                        fConfirmed;
+        bool                        fSuccess;
+        std::vector<std::uint8_t>   data;
+        };
+
+    // a DS18B20 on the OneWire bus.
+    struct Probe
+        {
+        Hal::OneWireRom_t           rom;
+        float                       TempC;
+        // resolution now (the scratchpad), and at power-on (the EEPROM)
+        std::uint8_t                Bits;
+        std::uint8_t                EepromBits;
+        bool                        fConnected;
+        };
+
+    // decide whether an uplink gets through.
+    typedef bool (RadioResultFn)(void *pContext, Uplink const &uplink);
+
+    // the time that run() advances for each pass through loop().
+    static constexpr std::uint32_t kDefaultTickMs = 10;
+    static constexpr std::uint32_t kDefaultAirtimeMs = 1500;
+    static constexpr std::uint8_t kBme280Address = 0x77;
+
+    cHostSim();
+
+    // put everything back to power-on defaults.
+    void reset();
+
+    //---- time ----
+    std::uint32_t millis() const
+        {
+        return std::uint32_t(this->m_us / 1000);
+        }
+    std::uint32_t micros() const
+        {
+        return std::uint32_t(this->m_us);
+        }
+    std::uint64_t getElapsedMs() const
+        {
+        return this->m_us / 1000;
+        }
+    void advance(std::uint32_t ms)
+        {
+        this->m_us += std::uint64_t(ms) * 1000;
+        }
+
+    // run loop() for ms of virtual time.
+    void run(std::uint32_t ms);
+    // one pass through loop(), then advance the clock by the tick.
+    void step();
+
+    void setTickMs(std::uint32_t ms)
+        {
+        this->m_TickMs = ms;
+        }
+
+    //---- platform ----
+    void setVbat(float v)
+        {
+        this->m_Vbat = v;
+        }
+    void setVbus(float v)
+        {
+        this->m_Vbus = v;
+        }
+    void setBootCount(std::uint32_t n)
+        {
+        this->m_BootCount = n;
+        }
+    void setOperatingFlags(std::uint32_t flags)
+        {
+        this->m_OperatingFlags = flags;
+        }
+    void setConsoleEcho(bool fEcho)
+        {
+        this->m_fConsoleEcho = fEcho;
+        }
+    std::string const &getConsole() const
+        {
+        return this->m_Console;
+        }
+    Hal::LedPattern getLed() const
+        {
+        return this->m_Led;
+        }
+    // the level of an output pin; false if it's an input.
+    bool isPinHigh(std::uint32_t pin) const;
+    std::uint32_t getDeepSleepCount() const
+        {
+        return this->m_nDeepSleep;
+        }
+    std::uint64_t getDeepSleepMs() const
+        {
+        return this->m_DeepSleepMs;
+        }
+
+    //---- sensors ----
+    void setEnv(float tempC, float pressurePa, float rh)
+        {
+        this->m_EnvTempC = tempC;
+        this->m_EnvPressurePa = pressurePa;
+        this->m_EnvRH = rh;
+        }
+    void setBme280Present(bool fPresent)
+        {
+        this->m_fBme280Present = fPresent;
+        }
+    void setLux(std::uint32_t lux)
+        {
+        this->m_Lux = lux;
+        }
+    void setSi1133Present(bool fPresent)
+        {
+        this->m_fSi1133Present = fPresent;
+        }
+    void setSi1133LatencyMs(std::uint32_t ms)
+        {
+        this->m_Si1133LatencyMs = ms;
+        }
+    // false if the board has no OneWire hardware (fHasWaterOneWire).
+    void setCompostFitted(bool fFitted)
+        {
+        this->m_fCompostFitted = fFitted;
+        }
+    // add a probe; returns its index.
+    std::size_t addProbe(float tempC, std::uint8_t bits = 12);
+    Probe &getProbe(std::size_t i)
+        {
+        return this->m_Probes[i];
+        }
+    std::uint32_t getProbeResolutionWrites() const
+        {
+        return this->m_nProbeResolutionWrites;
+        }
+
+    //---- radio ----
+    void setProvisioned(bool fProvisioned)
+        {
+        this->m_fProvisioned = fProvisioned;
+        }
+    void setAirtimeMs(std::uint32_t ms)
+        {
+        this->m_AirtimeMs = ms;
+        }
+    void setRadioResult(RadioResultFn *pFn, void *pContext)
+        {
+        this->m_pRadioResultFn = pFn;
+        this->m_pRadioResultContext = pContext;
+        }
+    void setDataRate(std::uint8_t dr)
+        {
+        this->m_DataRate = dr;
+        }
+    void setDownlinkSignal(bool fDownlink, std::int16_t rssi = 0, float snr = 0)
+        {
+        this->m_fDownlink = fDownlink;
+        this->m_DownlinkRssi = rssi;
+        this->m_DownlinkSnr = snr;
+        }
+    std::vector<Uplink> const &getUplinks() const
+        {
+        return this->m_Uplinks;
+        }
+    void clearUplinks()
+        {
+        this->m_Uplinks.clear();
+        }
+
+    //---- the Hal, in the host build ----
+    void consoleWrite(const char *pText);
+    float readVbat() const
+        {
+        return this->m_Vbat;
+        }
+    float readVbus() const
+        {
+        return this->m_Vbus;
+        }
+    bool getBootCount(std::uint32_t &bootCount) const
+        {
+        bootCount = this->m_BootCount;
+        return true;
+        }
+    bool readAppConfig(std::uint8_t *pData, std::size_t nData) const;
+    bool writeAppConfig(const std::uint8_t *pData, std::size_t nData);
+    void pinMode(std::uint32_t pin, std::uint32_t mode);
+    void digitalWrite(std::uint32_t pin, std::uint32_t value);
+    std::uint32_t getOperatingFlags() const
+        {
+        return this->m_OperatingFlags;
+        }
+    void pollPlatform();
+    void registerPollable(McciCatena::cPollableObject *pObject);
+    void deepSleep(std::uint32_t sec);
+    void setLed(Hal::LedPattern pattern)
+        {
+        this->m_Led = pattern;
+        }
+
+    bool i2cRead(std::uint8_t addr, std::uint8_t reg, std::uint8_t *pBuf, std::size_t nBuf);
+    bool i2cWrite(std::uint8_t addr, std::uint8_t reg, std::uint8_t value);
+
+    bool si1133Begin() const
+        {
+        return this->m_fSi1133Present;
+        }
+    void si1133Start()
+        {
+        this->m_tSi1133Start = this->millis();
+        this->m_fSi1133Running = true;
+        }
+    bool si1133IsReady() const
+        {
+        return this->m_fSi1133Running &&
+               this->millis() - this->m_tSi1133Start >= this->m_Si1133LatencyMs;
+        }
+    std::uint32_t si1133Read()
+        {
+        this->m_fSi1133Running = false;
+        return this->m_Lux;
+        }
+    void si1133Stop()
+        {
+        this->m_fSi1133Running = false;
+        }
+
+    bool hasCompostProbe() const
+        {
+        return this->m_fCompostFitted;
+        }
+    bool compostResetBus() const;
+    std::uint8_t compostSearch();
+    bool compostGetAddress(Hal::OneWireRom_t rom, std::uint8_t index) const;
+    std::uint8_t compostGetResolution(const Hal::OneWireRom_t rom) const;
+    bool compostSetResolution(const Hal::OneWireRom_t rom, std::uint8_t bits);
+    void compostStartConversion();
+    bool compostIsConversionComplete() const;
+    static std::uint32_t compostGetConversionMs(std::uint8_t bits);
+    float compostGetTempC(const Hal::OneWireRom_t rom) const;
+
+    bool isProvisioned() const
+        {
+        return this->m_fProvisioned;
+        }
+    std::uint8_t getDataRate() const
+        {
+        return this->m_DataRate;
+        }
+    bool isRadioBusy() const
+        {
+        return this->m_fTxPending;
+        }
+    bool getDownlinkSignal(std::int16_t &rssi, float &snr) const;
+    void lowerDataRate()
+        {
+        if (this->m_DataRate > 0)
+            --this->m_DataRate;
+        }
+    bool sendBuffer(
+        const std::uint8_t *pBuffer,
+        std::size_t nBuffer,
+        Hal::SendBufferCbFn *pDoneFn,
+        void *pClientData,
+        bool fConfirmed,
+        std::uint8_t port
+        );
+
+private:
+    // the BME280 register model.
+    void bme280Reset();
+    void bme280StartForced();
+    std::uint8_t bme280ReadRegister(std::uint8_t reg) const;
+    void bme280Compute(std::int32_t &adcT, std::int32_t &adcP, std::int32_t &adcH) const;
+
+    // complete the uplink in progress, if its time has come.
+    void serviceRadio();
+
+    // a probe, by ROM; null if none matches.
+    Probe const *findProbe(const Hal::OneWireRom_t rom) const;
+    // true if V_OUT2 is on, so the probes can answer.
+    bool isProbePowerOn() const;
+    void checkProbePowerOff(bool fWasOn);
+
+    std::uint64_t                   m_us;
+    std::uint32_t                   m_TickMs;
+
+    float                           m_Vbat;
+    float                           m_Vbus;
+    std::uint32_t                   m_BootCount;
+    std::uint32_t                   m_OperatingFlags;
+    std::vector<std::uint8_t>       m_AppConfig;
+    std::uint8_t                    m_PinMode[32];
+    std::uint8_t                    m_PinLevel[32];
+    Hal::LedPattern                 m_Led;
+    std::vector<McciCatena::cPollableObject *> m_Pollables;
+    bool                            m_fConsoleEcho;
+    std::string                     m_Console;
+    std::uint32_t                   m_nDeepSleep;
+    std::uint64_t                   m_DeepSleepMs;
+
+    bool                            m_fBme280Present;
+    float                           m_EnvTempC;
+    float                           m_EnvPressurePa;
+    float                           m_EnvRH;
+    std::uint8_t                    m_Bme280Regs[256];
+    std::uint32_t                   m_tBme280Done;
+    bool                            m_fBme280Busy;
+
+    bool                            m_fSi1133Present;
+    bool                            m_fSi1133Running;
+    std::uint32_t                   m_Lux;
+    std::uint32_t                   m_Si1133LatencyMs;
+    std::uint32_t                   m_tSi1133Start;
+
+    bool                            m_fCompostFitted;
+    std::vector<Probe>              m_Probes;
+    std::vector<std::size_t>        m_Found;
+    std::uint32_t                   m_tConversionStart;
+    std::uint32_t                   m_nProbeResolutionWrites;
+    bool                            m_fConversionPending;
+
+    bool                            m_fProvisioned;
+    std::uint8_t                    m_DataRate;
+    std::uint32_t                   m_AirtimeMs;
+    RadioResultFn                   *m_pRadioResultFn;
+    void                            *m_pRadioResultContext;
+    bool                            m_fDownlink;
+    std::int16_t                    m_DownlinkRssi;
+    float                           m_DownlinkSnr;
+    std::vector<Uplink>             m_Uplinks;
+    bool                            m_fTxPending;
+    bool                            m_fTxSuccess;
+    std::uint32_t                   m_tTxDone;
+    Hal::SendBufferCbFn             *m_pTxDoneFn;
+    void                            *m_pTxDoneContext;
+    };
+
+extern cHostSim gHostSim;
+
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_cHostSim_h_ */
@@ -0,0 +1,546 @@
+/*
+
+Module: Catena4610_cTraceReplay.cpp
+
+Function:
+    Replay of a measurement loop event trace in the host simulator.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cTraceReplay.h"
+
+#include "Catena4610_cHostSim.h"
+#include "Catena4610_cMeasurementLoop.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+
+using namespace McciCatena4610;
+
+/****************************************************************************\
+|
+|   Parsing
+|
+\****************************************************************************/
+
+namespace {
+
+// find the code whose name is pName; false if there's none.
+template <typename NameFn>
+bool findName(const char *pName, unsigned nCodes, NameFn getName, std::uint8_t &code)
+    {
+    for (unsigned i = 0; i < nCodes; ++i)
+        {
+        if (std::strcmp(pName, getName(std::uint8_t(i))) == 0)
+            {
+            code = std::uint8_t(i);
+            return true;
+            }
+        }
+    return false;
+    }
+
+const char *getStateName(std::uint8_t i)
+    {
+    return cMeasurementLoop::getStateName(cMeasurementLoop::State(i));
+    }
+
+} // namespace
+
+bool
+cTraceReplay::parseLine(
+    const char *pLine,
+    Event &e
+    )
+    {
+    unsigned t;
+    char word[16];
+    char name[32];
+    unsigned u1, u2, x;
+    int n;
+
+    if (std::sscanf(pLine, "%u %15s %n", &t, word, &n) != 2)
+        return false;
+
+    const char * const pRest = pLine + n;
+
+    e = Event { t, Type::kState, 0, 0, 0 };
+
+    if (std::strcmp(word, "state") == 0)
+        {
+        return std::sscanf(pRest, "%31s", name) == 1 &&
+               findName(name, unsigned(cMeasurementLoop::State::stFinal) + 1, getStateName, e.a);
+        }
+    else if (std::strcmp(word, "sensor") == 0)
+        {
+        e.type = Type::kSensor;
+        if (std::sscanf(pRest, "%31s %15s %u ms", name, word, &u1) != 3 ||
+            ! findName(name, cMeasurementLoop::kNumSensorTasks, cMeasurementLoop::getSensorTaskName, e.a))
+            return false;
+        e.b = std::strcmp(word, "ok") == 0;
+        e.c = u1;
+        return true;
+        }
+    else if (std::strcmp(word, "value") == 0)
+        {
+        e.type = Type::kValue;
+        if (std::sscanf(pRest, "%31[a-z][%u] %*d/1000 bits %x", name, &u1, &x) != 3 ||
+            ! findName(name, unsigned(cEventTrace::Value::kNumValues), cEventTrace::getValueName, e.a))
+            return false;
+        e.b = std::uint16_t(u1);
+        e.c = x;
+        return true;
+        }
+    else if (std::strcmp(word, "tx") == 0)
+        {
+        e.type = Type::kTxStart;
+        if (std::sscanf(pRest, "port %u len %u %15s hash %x", &u1, &u2, word, &x) != 4)
+            return false;
+        e.a = std::uint8_t(u1);
+        e.b = std::uint16_t(u2 | (std::strcmp(word, "confirmed") == 0 ? 0x8000 : 0));
+        e.c = x;
+        return true;
+        }
+    else if (std::strcmp(word, "txdone") == 0)
+        {
+        e.type = Type::kTxDone;
+        if (std::sscanf(pRest, "%15s", word) != 1)
+            return false;
+        e.a = std::strcmp(word, "ok") == 0;
+        return true;
+        }
+    else if (std::strcmp(word, "power") == 0)
+        {
+        e.type = Type::kPower;
+        if (std::sscanf(pRest, "%31s vbat %u mV usb %u", name, &u1, &u2) != 3 ||
+            ! findName(name, cMeasurementLoop::kNumPowerLevels, cMeasurementLoop::getPowerLevelName, e.a))
+            return false;
+        e.b = std::uint16_t(u1);
+        e.c = u2;
+        return true;
+        }
+    else if (std::strcmp(word, "provisioned") == 0)
+        {
+        e.type = Type::kProvisioned;
+        if (std::sscanf(pRest, "%u", &u1) != 1)
+            return false;
+        e.a = u1 != 0;
+        return true;
+        }
+
+    return false;
+    }
+
+bool
+cTraceReplay::read(
+    std::FILE *pFile,
+    std::vector<Event> &events
+    )
+    {
+    char line[128];
+    Event e;
+
+    while (std::fgets(line, sizeof(line), pFile) != nullptr)
+        {
+        if (parseLine(line, e))
+            events.push_back(e);
+        }
+
+    return ! events.empty();
+    }
+
+bool
+cTraceReplay::hasBuildSensors(
+    std::vector<Event> const &trace
+    )
+    {
+    for (auto const &e : trace)
+        {
+        if (e.type != Type::kSensor)
+            continue;
+
+        if ((e.a == cMeasurementLoop::kTaskEnv && ! Sensors::Bme280::kEnabled) ||
+            (e.a == cMeasurementLoop::kTaskLight && ! Sensors::Si1133::kEnabled) ||
+            (e.a == cMeasurementLoop::kTaskCompost && ! Sensors::Compost::kEnabled))
+            return false;
+        }
+
+    return true;
+    }
+
+/****************************************************************************\
+|
+|   Replay
+|
+\****************************************************************************/
+
+namespace {
+
+// a change to the simulated world, and when to make it.
+struct Input
+    {
+    std::uint32_t           t;
+    std::function<void()>   apply;
+    };
+
+// the loop as setup() builds it; value-initialized, so it starts zeroed
+// like the sketch's globals.
+struct cDevice
+    {
+    McciCatena::Catena_Mx25v8035f   flash;
+    cFlashLog                       log;
+    cMeasurementLoop                loop;
+    };
+
+// the outcome of each uplink that reached the radio, in order.
+bool radioResult(void *pContext, cHostSim::Uplink const &)
+    {
+    auto const pResults = static_cast<std::deque<bool> *>(pContext);
+
+    if (pResults->empty())
+        return true;
+
+    bool const fSuccess = pResults->front();
+    pResults->pop_front();
+    return fSuccess;
+    }
+
+// the simulated sensor readings that are set together.
+struct World
+    {
+    float   TempC = 20.0f;
+    float   PressurePa = 101325.0f;
+    float   RH = 50.0f;
+    };
+
+void applyValue(World &world, cEventTrace::Event const &e)
+    {
+    float const v = cEventTrace::getValue(e);
+
+    switch (cEventTrace::Value(e.a))
+        {
+    case cEventTrace::Value::kVbat:         gHostSim.setVbat(v); break;
+    case cEventTrace::Value::kVbus:         gHostSim.setVbus(v); break;
+    case cEventTrace::Value::kBootCount:    gHostSim.setBootCount(std::uint32_t(v)); break;
+    case cEventTrace::Value::kTemperature:  world.TempC = v; break;
+    case cEventTrace::Value::kPressure:     world.PressurePa = v; break;
+    case cEventTrace::Value::kHumidity:     world.RH = v; break;
+    case cEventTrace::Value::kLux:          gHostSim.setLux(std::uint32_t(v)); break;
+    case cEventTrace::Value::kCompostTemp:
+        {
+        auto &probe = gHostSim.getProbe(e.b);
+
+        probe.fConnected = ! std::isnan(v);
+        if (probe.fConnected)
+            probe.TempC = v;
+        }
+        break;
+    default:
+        break;
+        }
+
+    gHostSim.setEnv(world.TempC, world.PressurePa, world.RH);
+    }
+
+// the sensor task that reads a value, or kNumSensorTasks for values
+// read directly.
+std::uint8_t getValueTask(std::uint8_t value)
+    {
+    switch (cEventTrace::Value(value))
+        {
+    case cEventTrace::Value::kTemperature:
+    case cEventTrace::Value::kPressure:
+    case cEventTrace::Value::kHumidity:
+        return cMeasurementLoop::kTaskEnv;
+    case cEventTrace::Value::kLux:
+        return cMeasurementLoop::kTaskLight;
+    case cEventTrace::Value::kCompostTemp:
+        return cMeasurementLoop::kTaskCompost;
+    default:
+        return cMeasurementLoop::kNumSensorTasks;
+        }
+    }
+
+std::uint32_t absDiff(std::uint32_t a, std::uint32_t b)
+    {
+    return a > b ? a - b : b - a;
+    }
+
+bool isMatch(
+    cEventTrace::Event const &expected,
+    cEventTrace::Event const &actual,
+    std::uint32_t toleranceMs
+    )
+    {
+    if (expected.type != actual.type ||
+        expected.a != actual.a ||
+        expected.b != actual.b ||
+        absDiff(expected.t, actual.t) > toleranceMs)
+        return false;
+
+    if (expected.type == cEventTrace::Type::kSensor)
+        return absDiff(expected.c, actual.c) <= toleranceMs;
+    else
+        return expected.c == actual.c;
+    }
+
+std::string formatEvent(cEventTrace::Event const &e)
+    {
+    char line[80];
+
+    cMeasurementLoop::formatTraceEvent(line, sizeof(line), e);
+    return std::string(line + std::strspn(line, " "));
+    }
+
+} // namespace
+
+/*
+
+Name:   McciCatena4610::cTraceReplay::replay()
+
+Function:
+    Run the loop against the inputs of a trace and check its results.
+
+Definition:
+    static cTraceReplay::Result
+    McciCatena4610::cTraceReplay::replay(
+            std::vector<cEventTrace::Event> const &trace,
+            cTraceReplay::Options const &options
+            );
+
+Description:
+    gHostSim is reset, set up from the trace (which sensors answered,
+    how many compost probes there were), and advanced to the time of
+    the first event, which is when the device called begin(). The loop
+    is then started as setup() starts it, and run until the time of
+    the last event, with each input applied just before the poll at
+    its time. Finally the results the loop recorded are compared with
+    those in the trace.
+
+Returns:
+    The number of results checked, the number that didn't match, and
+    a description of the first options.maxReport mismatches.
+
+*/
+
+cTraceReplay::Result
+cTraceReplay::replay(
+    std::vector<Event> const &trace,
+    Options const &options
+    )
+    {
+    Result result;
+
+    if (trace.empty())
+        return result;
+
+    //---- turn the inputs into a schedule ----
+    World world;
+    std::deque<bool> radioResults;
+    std::vector<Input> inputs;
+    std::vector<std::size_t> pending[cMeasurementLoop::kNumSensorTasks];
+    bool fSensorSeen[cMeasurementLoop::kNumSensorTasks] = {};
+    std::size_t nProbes = 0;
+    bool fUsb = false;
+
+    for (std::size_t i = 0; i < trace.size(); ++i)
+        {
+        Event const e = trace[i];
+
+        switch (e.type)
+            {
+        case Type::kValue:
+            {
+            std::uint8_t const iTask = getValueTask(e.a);
+
+            if (iTask < cMeasurementLoop::kNumSensorTasks)
+                pending[iTask].push_back(i);
+            else
+                inputs.push_back({ e.t, [&world, e] { applyValue(world, e); } });
+
+            if (e.a == std::uint8_t(cEventTrace::Value::kCompostTemp))
+                nProbes = std::max<std::size_t>(nProbes, e.b + 1u);
+            }
+            break;
+
+        // the sensor sampled when its task started.
+        case Type::kSensor:
+            {
+            std::uint32_t const tStart = e.t - e.c;
+
+            if (e.a >= cMeasurementLoop::kNumSensorTasks)
+                break;
+
+            fSensorSeen[e.a] = true;
+            for (auto const iValue : pending[e.a])
+                {
+                Event const v = trace[iValue];
+
+                inputs.push_back({ tStart, [&world, v] { applyValue(world, v); } });
+                }
+            pending[e.a].clear();
+
+            // make the sensor fail the same way: the Si1133 never
+            // finishes, and the BME280 and probes don't answer.
+            bool const fSuccess = e.b != 0;
+
+            if (e.a == cMeasurementLoop::kTaskLight)
+                {
+                std::uint32_t const latency = fSuccess ? e.c : UINT32_MAX;
+
+                inputs.push_back({ tStart, [latency] { gHostSim.setSi1133LatencyMs(latency); } });
+                }
+            else if (e.a == cMeasurementLoop::kTaskEnv)
+                inputs.push_back({ tStart, [fSuccess] { gHostSim.setBme280Present(fSuccess); } });
+            else if (! fSuccess)
+                inputs.push_back({ tStart, [&nProbes]
+                    {
+                    for (std::size_t iProbe = 0; iProbe < nProbes; ++iProbe)
+                        gHostSim.getProbe(iProbe).fConnected = false;
+                    } });
+            }
+            break;
+
+        // an uplink that failed at once never reached the radio.
+        case Type::kTxStart:
+            for (std::size_t j = i + 1; j < trace.size(); ++j)
+                {
+                if (trace[j].type != Type::kTxDone)
+                    continue;
+
+                if (trace[j].t != e.t)
+                    {
+                    std::uint32_t const airtime = trace[j].t - e.t;
+
+                    inputs.push_back({ e.t, [airtime] { gHostSim.setAirtimeMs(airtime); } });
+                    radioResults.push_back(trace[j].a != 0);
+                    }
+                break;
+                }
+            break;
+
+        // USB power came or went; use the next Vbus reading before the
+        // next change, if there is one.
+        case Type::kPower:
+            if ((e.c != 0) != fUsb)
+                {
+                float vbus = e.c ? 5.0f : 0.0f;
+
+                fUsb = e.c != 0;
+                for (std::size_t j = i + 1; j < trace.size(); ++j)
+                    {
+                    if (trace[j].type == Type::kPower)
+                        break;
+                    if (trace[j].type == Type::kValue &&
+                        trace[j].a == std::uint8_t(cEventTrace::Value::kVbus))
+                        {
+                        vbus = cEventTrace::getValue(trace[j]);
+                        break;
+                        }
+                    }
+
+                inputs.push_back({ e.t, [vbus] { gHostSim.setVbus(vbus); } });
+                }
+            break;
+
+        case Type::kProvisioned:
+            {
+            bool const fProvisioned = e.a != 0;
+
+            inputs.push_back({ e.t, [fProvisioned] { gHostSim.setProvisioned(fProvisioned); } });
+            }
+            break;
+
+        default:
+            break;
+            }
+        }
+
+    std::stable_sort(
+        inputs.begin(), inputs.end(),
+        [](Input const &a, Input const &b) { return a.t < b.t; }
+        );
+
+    //---- set up the world, and start the loop at the first event ----
+    gHostSim.reset();
+    gHostSim.setOperatingFlags(options.operatingFlags);
+    gHostSim.setRadioResult(radioResult, &radioResults);
+    gHostSim.setBme280Present(fSensorSeen[cMeasurementLoop::kTaskEnv]);
+    gHostSim.setSi1133Present(fSensorSeen[cMeasurementLoop::kTaskLight]);
+    for (std::size_t i = 0; i < nProbes; ++i)
+        gHostSim.addProbe(world.TempC);
+
+    std::uint32_t const tBegin = trace.front().t;
+    std::uint32_t const tEnd = trace.back().t;
+    std::size_t iInput = 0;
+
+    auto const applyInputs =
+        [&inputs, &iInput]()
+            {
+            while (iInput < inputs.size() && inputs[iInput].t <= gHostSim.millis())
+                inputs[iInput++].apply();
+            };
+
+    gHostSim.advance(tBegin);
+    applyInputs();
+
+    std::unique_ptr<cDevice> pDevice(new cDevice());
+    auto &loop = pDevice->loop;
+
+    if (pDevice->log.begin(&pDevice->flash, cMeasurementLoop::kLogRecordLayout))
+        loop.registerFlashLog(&pDevice->log);
+    loop.getEventTrace().clear();
+    loop.begin();
+    loop.requestActive(true);
+
+    while (gHostSim.millis() <= tEnd)
+        {
+        applyInputs();
+        gHostSim.step();
+        }
+
+    //---- compare the results ----
+    auto const &actualTrace = loop.getEventTrace();
+    std::vector<Event> expected;
+    std::vector<Event> actual;
+
+    for (auto const &e : trace)
+        if (isResult(e))
+            expected.push_back(e);
+    for (std::uint16_t i = 0; i < actualTrace.getn(); ++i)
+        if (isResult(actualTrace.get(i)))
+            actual.push_back(actualTrace.get(i));
+
+    if (actualTrace.getnLost() != 0)
+        result.report += "replay trace overflowed: raise CATENA4610_EVENT_TRACE_EVENTS\n";
+
+    auto const report =
+        [&result, &options](std::string const &text)
+            {
+            if (++result.nMismatched <= options.maxReport)
+                result.report += text + "\n";
+            };
+
+    for (std::size_t i = 0; i < std::max(expected.size(), actual.size()); ++i)
+        {
+        ++result.nChecked;
+
+        if (i >= actual.size())
+            report("missing: " + formatEvent(expected[i]));
+        else if (i >= expected.size())
+            report("extra: " + formatEvent(actual[i]));
+        else if (! isMatch(expected[i], actual[i], options.toleranceMs))
+            report("expected: " + formatEvent(expected[i]) + "\n     got: " + formatEvent(actual[i]));
+        }
+
+    return result;
+    }
@@ -0,0 +1,109 @@
+/*
+
+Module: Catena4610_cTraceReplay.h
+
+Function:
+    Replay of a measurement loop event trace in the host simulator.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_cTraceReplay_h_
+# define _Catena4610_cTraceReplay_h_
+
+#pragma once
+
+#include "Catena4610_cEventTrace.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace McciCatena4610 {
+
+/*
+
+Name:   McciCatena4610::cTraceReplay
+
+Function:
+    Run the measurement loop in gHostSim against a recorded trace.
+
+Description:
+    A trace is the output of the "trace" command (or of
+    cMeasurementLoop::formatTraceEvent()), captured from boot with no
+    events lost. Its events fall in two groups:
+
+    - inputs, which say what the world did: the values the loop read,
+      the latency of each Si1133 measurement, whether each uplink got
+      through and how long it took, USB power coming and going, and
+      provisioning changes. replay() feeds each to gHostSim at the
+      time the device saw it. Sensor values are applied when their
+      sensor task started, since that's when the sensor sampled.
+
+    - results, which say what the loop did: the states it entered,
+      sensor task outcomes and latencies, the uplinks it started
+      (port, length, confirmed, hash of the bytes), the completions
+      it saw, and its power level and provisioning changes. replay()
+      runs the loop through fsmDispatch(), from begin() to the time of
+      the last event, and compares the events it records with these,
+      one by one, in order.
+
+    Times and latencies must match to within the tolerance, which is
+    zero for a trace taken in the simulator. A trace from a device
+    needs a tolerance of at least the simulator tick (10 ms); it
+    should also come from a device with the default settings, as the
+    settings in FRAM aren't in the trace.
+
+*/
+
+class cTraceReplay
+    {
+public:
+    using Event = cEventTrace::Event;
+    using Type = cEventTrace::Type;
+
+    struct Options
+        {
+        std::uint32_t   toleranceMs = 0;
+        std::uint32_t   operatingFlags = 1;     // fUnattended
+        std::size_t     maxReport = 10;         // mismatches described
+        };
+
+    struct Result
+        {
+        std::size_t     nChecked = 0;           // results compared
+        std::size_t     nMismatched = 0;
+        std::string     report;                 // the first mismatches
+
+        bool isOk() const
+            {
+            return this->nChecked != 0 && this->nMismatched == 0;
+            }
+        };
+
+    // parse one line of a trace; false if it isn't an event.
+    static bool parseLine(const char *pLine, Event &e);
+    // read every event in a file; false if there were none.
+    static bool read(std::FILE *pFile, std::vector<Event> &events);
+    // true for the events that replay() checks.
+    static bool isResult(Event const &e)
+        {
+        return e.type != Type::kValue;
+        }
+
+    // false if the trace used a sensor that this build leaves out (see
+    // Catena4610_SensorRegistry.h); such a trace can't be replayed.
+    static bool hasBuildSensors(std::vector<Event> const &trace);
+
+    static Result replay(std::vector<Event> const &trace, Options const &options);
+    };
+
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_cTraceReplay_h_ */
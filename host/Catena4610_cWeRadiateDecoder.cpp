@@ -0,0 +1,549 @@
+/*
+
+Module: Catena4610_cWeRadiateDecoder.cpp
+
+Function:
+    Native C++ port of extra/WeRadiate-decoder-ttn.js.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cWeRadiateDecoder.h"
+
+#include <cmath>
+#include <cstring>
+
+using namespace McciCatena4610;
+
+namespace {
+
+// per component of fields 0..5: vBat, vBus, boot, tempC, p, rh, lux, tWater
+const std::uint8_t kCompField[] = { 0x1, 0x2, 0x4, 0x8, 0x8, 0x8, 0x10, 0x20 };
+const std::uint8_t kCompSize[] = { 2, 2, 1, 2, 2, 1, 2, 2 };
+const bool kCompSigned[] = { true, true, false, true, false, false, false, true };
+
+// bytes[i]. The JavaScript reads undefined past the end, and goes on
+// with NaN; here it's 0, and nothing is read out of the buffer.
+inline double at(const std::uint8_t *pBytes, std::size_t nBytes, std::size_t i)
+    {
+    return i < nBytes ? pBytes[i] : 0;
+    }
+
+// a big-endian int16 or uint16 at bytes[i].
+inline double get2(const std::uint8_t *pBytes, std::size_t nBytes, std::size_t i, bool fSigned)
+    {
+    double raw = at(pBytes, nBytes, i) * 256 + at(pBytes, nBytes, i + 1);
+
+    if (fSigned && raw >= 0x8000)
+        raw += -0x10000;
+    return raw;
+    }
+
+} // namespace
+
+void
+cWeRadiateDecoder::reset(
+    void
+    )
+    {
+    std::memset(this->m_fRef, 0, sizeof(this->m_fRef));
+    }
+
+// calculate dewpoint (degrees C) given temperature (C) and relative
+// humidity (0..100); see the JavaScript for the source.
+double
+cWeRadiateDecoder::dewpoint(
+    double t,
+    double rh
+    )
+    {
+    double const c1 = 243.04;
+    double const c2 = 17.625;
+    double h = rh / 100;
+
+    if (h <= 0.01)
+        h = 0.01;
+    else if (h > 1.0)
+        h = 1.0;
+
+    double const lnh = std::log(h);
+    double const tpc1 = t + c1;
+    double const txc2 = t * c2;
+    double const txc2_tpc1 = txc2 / tpc1;
+
+    return c1 * (lnh + txc2_tpc1) / (c2 - lnh - txc2_tpc1);
+    }
+
+// read a bitmap and its fields, starting at bytes[i]. If pRef is null
+// the fields are in full, as in format 0x15; otherwise each component
+// is a zig-zag varint difference from pRef.
+void
+cWeRadiateDecoder::readFields(
+    const std::uint8_t *pBytes,
+    std::size_t nBytes,
+    std::size_t i,
+    const double *pRef,
+    Fields &f
+    )
+    {
+    f.flags = std::uint8_t(at(pBytes, nBytes, i++));
+
+    for (unsigned iComp = 0; iComp < kNumComp; ++iComp)
+        {
+        f.v[iComp] = 0;
+        if (! (f.flags & kCompField[iComp]))
+            continue;
+
+        double raw;
+
+        if (pRef == nullptr)
+            {
+            if (kCompSize[iComp] == 2)
+                {
+                raw = get2(pBytes, nBytes, i, kCompSigned[iComp]);
+                i += 2;
+                }
+            else
+                raw = at(pBytes, nBytes, i++);
+            }
+        else
+            {
+            // varint, low 7 bits first, then undo the zig-zag
+            double zz = 0;
+            double scale = 1;
+            std::uint8_t b;
+
+            do  {
+                b = std::uint8_t(at(pBytes, nBytes, i++));
+                zz += (b & 0x7F) * scale;
+                scale *= 128;
+                } while ((b & 0x80) && i < nBytes);
+
+            raw = pRef[iComp] + (std::fmod(zz, 2) != 0 ? -(zz + 1) / 2 : zz / 2);
+            }
+
+        f.v[iComp] = raw;
+        }
+
+    f.i = i;
+    }
+
+// copy the components present in flags from pV to pRef.
+void
+cWeRadiateDecoder::updateRef(
+    double *pRef,
+    std::uint8_t flags,
+    const double *pV
+    )
+    {
+    for (unsigned iComp = 0; iComp < kNumComp; ++iComp)
+        {
+        if (flags & kCompField[iComp])
+            pRef[iComp] = pV[iComp];
+        }
+    }
+
+// convert raw components to engineering units.
+void
+cWeRadiateDecoder::valuesToSample(
+    Sample &sample,
+    std::uint8_t flags,
+    const double *pV
+    )
+    {
+    if (flags & 0x1)
+        {
+        sample.vBat = pV[0] / 4096.0;
+        sample.fields |= kVBat;
+        }
+    if (flags & 0x2)
+        {
+        sample.vBus = pV[1] / 4096.0;
+        sample.fields |= kVBus;
+        }
+    if (flags & 0x4)
+        {
+        sample.boot = pV[2];
+        sample.fields |= kBoot;
+        }
+    if (flags & 0x8)
+        {
+        sample.tempC = pV[3] / 256;
+        sample.p = pV[4] * 4 / 100.0;
+        sample.rh = pV[5] / 256 * 100;
+        sample.tDewC = dewpoint(sample.tempC, sample.rh);
+        sample.fields |= kTempC;
+        }
+    if (flags & 0x10)
+        {
+        sample.lux = pV[6];
+        sample.fields |= kLux;
+        }
+    if (flags & 0x20)
+        {
+        sample.tWater = pV[7] / 256;
+        sample.fields |= kTWater;
+        }
+    }
+
+// decode a format 0x15 message on port 1.
+void
+cWeRadiateDecoder::decodePort1(
+    const std::uint8_t *pBytes,
+    std::size_t nBytes,
+    Decoded &d
+    )
+    {
+    // i is used as the index into the message. Start with the flag byte.
+    std::size_t i = 1;
+    // fetch the bitmap.
+    std::uint8_t const flags = std::uint8_t(at(pBytes, nBytes, i++));
+
+    if (flags & 0x1)
+        {
+        d.vBat = get2(pBytes, nBytes, i, true) / 4096.0;
+        i += 2;
+        d.fields |= kVBat;
+        }
+
+    if (flags & 0x2)
+        {
+        d.vBus = get2(pBytes, nBytes, i, true) / 4096.0;
+        i += 2;
+        d.fields |= kVBus;
+        }
+
+    if (flags & 0x4)
+        {
+        d.boot = at(pBytes, nBytes, i);
+        i += 1;
+        d.fields |= kBoot;
+        }
+
+    if (flags & 0x8)
+        {
+        // we have temp, pressure, RH
+        double const tRaw = get2(pBytes, nBytes, i, true);
+        i += 2;
+        double const pRaw = get2(pBytes, nBytes, i, false);
+        i += 2;
+        double const hRaw = at(pBytes, nBytes, i++);
+
+        d.tempC = tRaw / 256;
+        d.pError = "none";
+        d.p = pRaw * 4 / 100.0;
+        d.rh = hRaw / 256 * 100;
+        d.tDewC = dewpoint(d.tempC, d.rh);
+        d.fields |= kTempC | kError;
+        }
+
+    if (flags & 0x10)
+        {
+        // we have lux
+        d.lux = get2(pBytes, nBytes, i, false);
+        i += 2;
+        d.fields |= kLux;
+        }
+
+    if (flags & 0x20)
+        {
+        // onewire temperature
+        d.tWater = get2(pBytes, nBytes, i, true) / 256;
+        i += 2;
+        d.fields |= kTWater;
+        }
+
+    if (flags & 0x40)
+        {
+        // temperature followed by RH
+        double const tempRaw = get2(pBytes, nBytes, i, true);
+        i += 2;
+        double const tempRH = at(pBytes, nBytes, i);
+        i += 1;
+        d.tSoil = tempRaw / 256;
+        d.rhSoil = tempRH / 256 * 100;
+        d.tSoilDew = dewpoint(d.tSoil, d.rhSoil);
+        d.fields |= kTSoil;
+        }
+
+    if (flags & 0x80)
+        {
+        // extension fields: another bitmap, then the fields.
+        std::uint8_t const extFlags = std::uint8_t(at(pBytes, nBytes, i++));
+
+        if (extFlags & 0x1)
+            {
+            // additional compost probes: count of all probes, then
+            // int16 temperatures of probes 1..n-1.
+            std::uint8_t const nProbes = std::uint8_t(at(pBytes, nBytes, i++));
+
+            d.tProbes[0] = (d.fields & kTWater) ? d.tWater : NAN;
+            d.nProbes = 1;
+            for (std::uint8_t iProbe = 1; iProbe < nProbes; ++iProbe)
+                {
+                double tProbeRaw = get2(pBytes, nBytes, i, false);
+                double tProbe;
+
+                i += 2;
+                if (tProbeRaw == 0x8000)
+                    {
+                    // no reading from this probe
+                    tProbe = NAN;
+                    }
+                else
+                    {
+                    if (tProbeRaw >= 0x8000)
+                        tProbeRaw = -0x10000 + tProbeRaw;
+                    tProbe = tProbeRaw / 256;
+                    }
+
+                if (d.nProbes < kMaxProbes)
+                    d.tProbes[d.nProbes++] = tProbe;
+                }
+            d.fields |= kTProbes;
+            }
+
+        if (extFlags & 0x2)
+            {
+            // diagnostics for the previous measurement cycle: awake
+            // ms, charge in units of 10 uC, transmit ms.
+            d.diag.awakeMs = get2(pBytes, nBytes, i, false);
+            d.diag.chargeMc = get2(pBytes, nBytes, i + 2, false) / 100;
+            d.diag.transmitMs = get2(pBytes, nBytes, i + 4, false);
+            i += 6;
+            d.fields |= kDiag;
+            }
+
+        if (extFlags & 0x4)
+            {
+            // compost temperature summary since the last uplink: sample
+            // count, then int16 min, max, mean, std dev.
+            double *const pStats[] =
+                {
+                &d.tWaterStats.min, &d.tWaterStats.max,
+                &d.tWaterStats.mean, &d.tWaterStats.stdDev
+                };
+
+            d.tWaterStats.n = at(pBytes, nBytes, i++);
+            for (auto const pStat : pStats)
+                {
+                *pStat = get2(pBytes, nBytes, i, true) / 256;
+                i += 2;
+                }
+            d.fields |= kTWaterStats;
+            }
+        }
+    }
+
+// decode a format 0x16 message: several samples, the first in full and
+// the rest as zig-zag varint differences.
+void
+cWeRadiateDecoder::decodeBatch(
+    const std::uint8_t *pBytes,
+    std::size_t nBytes,
+    Decoded &d
+    )
+    {
+    std::uint8_t const nSamples = std::uint8_t(at(pBytes, nBytes, 1)) & 0x7F;
+    // bit 7: the newest sample was taken one interval before the send.
+    unsigned const ageOffset = (at(pBytes, nBytes, 1) >= 0x80) ? 1 : 0;
+    double const interval = get2(pBytes, nBytes, 2, false);
+    std::size_t i = 4;
+    Comp last = {};
+    Fields f;
+
+    d.interval = interval;
+    d.nSamples = nSamples;
+    d.extra |= kInterval;
+
+    for (std::uint8_t iSample = 0; iSample < nSamples; ++iSample)
+        {
+        Sample &sample = d.samples[iSample];
+
+        readFields(pBytes, nBytes, i, iSample == 0 ? nullptr : last, f);
+        i = f.i;
+        updateRef(last, f.flags, f.v);
+
+        sample.fields = kAgeSeconds;
+        sample.ageSeconds = (nSamples - 1 - iSample + ageOffset) * interval;
+        valuesToSample(sample, f.flags, f.v);
+        }
+    }
+
+// decode a format 0x17 message: a keyframe with the fields in full, or
+// a delta frame with differences from the frame numbered refSeq. With
+// fRefs false (the JavaScript's refs not supplied), delta frames are
+// reported as raw differences.
+void
+cWeRadiateDecoder::decodeDelta(
+    const std::uint8_t *pBytes,
+    std::size_t nBytes,
+    Decoded &d,
+    bool fRefs
+    )
+    {
+    std::uint8_t const ctrl = std::uint8_t(at(pBytes, nBytes, 1));
+    bool const fKeyframe = (ctrl & 0x80) != 0;
+    std::size_t i = 2;
+    const double *pRef = nullptr;
+    Fields f;
+
+    d.seq = ctrl & 0x7F;
+    d.keyframe = fKeyframe;
+    d.extra |= kSeq | kKeyframe;
+
+    if (! fKeyframe)
+        {
+        std::uint8_t const refSeq = std::uint8_t(at(pBytes, nBytes, i++));
+
+        d.refSeq = refSeq;
+        d.extra |= kRefSeq;
+        if (fRefs && refSeq < 128 && this->m_fRef[refSeq])
+            pRef = this->m_Refs[refSeq];
+        }
+
+    if (fKeyframe || pRef != nullptr)
+        {
+        readFields(pBytes, nBytes, i, fKeyframe ? nullptr : pRef, f);
+        valuesToSample(d, f.flags, f.v);
+
+        if (fRefs)
+            {
+            // the frame's components, with the reference's for fields
+            // it didn't carry.
+            Comp newRef = {};
+            std::uint8_t const seq = ctrl & 0x7F;
+
+            if (! fKeyframe)
+                std::memcpy(newRef, pRef, sizeof(newRef));
+            updateRef(newRef, f.flags, f.v);
+            std::memcpy(this->m_Refs[seq], newRef, sizeof(newRef));
+            this->m_fRef[seq] = true;
+            }
+        }
+    else
+        {
+        static const Comp kZero = {};
+
+        readFields(pBytes, nBytes, i, kZero, f);
+        if (fRefs)
+            {
+            d.pError = "missing reference frame";
+            d.fields |= kError;
+            }
+
+        // differences, in units; there's no meaningful dew point.
+        d.delta.fields = 0;
+        valuesToSample(d.delta, f.flags & ~0x8, f.v);
+        if (f.flags & 0x8)
+            {
+            d.delta.tempC = f.v[3] / 256;
+            d.delta.p = f.v[4] * 4 / 100.0;
+            d.delta.rh = f.v[5] / 256 * 100;
+            d.delta.tDewC = NAN;
+            d.delta.fields |= kTempC;
+            }
+        d.extra |= kDelta;
+        }
+    }
+
+bool
+cWeRadiateDecoder::decodePort(
+    const std::uint8_t *pBytes,
+    std::size_t nBytes,
+    std::uint8_t port,
+    Decoded &d,
+    bool fRefs
+    )
+    {
+    if (port == 2)
+        {
+        // backfilled data from the flash log: a uint32 sequence number
+        // and a uint16 age in minutes, followed by a port 1 message.
+        if (nBytes < 6)
+            return false;
+
+        this->decodePort(pBytes + 6, nBytes - 6, 1, d, false);
+        d.seq = at(pBytes, nBytes, 0) * 0x1000000 + at(pBytes, nBytes, 1) * 0x10000 +
+                at(pBytes, nBytes, 2) * 0x100 + at(pBytes, nBytes, 3);
+        d.extra |= kSeq;
+
+        double const ageRaw = get2(pBytes, nBytes, 4, false);
+        if (ageRaw != 0xFFFF)
+            {
+            d.ageMinutes = ageRaw;
+            d.extra |= kAgeMinutes;
+            }
+        return true;
+        }
+
+    if (port != 1 || nBytes == 0)
+        return false;
+
+    switch (pBytes[0])
+        {
+    case 0x15:
+        decodePort1(pBytes, nBytes, d);
+        return true;
+
+    case 0x16:
+        decodeBatch(pBytes, nBytes, d);
+        return true;
+
+    case 0x17:
+        this->decodeDelta(pBytes, nBytes, d, fRefs);
+        return true;
+
+    default:
+        return false;
+        }
+    }
+
+/*
+
+Name:   McciCatena4610::cWeRadiateDecoder::decode()
+
+Function:
+    Decoder(bytes, port, refs), in C++.
+
+Definition:
+    bool McciCatena4610::cWeRadiateDecoder::decode(
+            const std::uint8_t *pBytes,
+            std::size_t nBytes,
+            std::uint8_t port,
+            cWeRadiateDecoder::Decoded &d
+            );
+
+Description:
+    The result is written to d. Only the flag words and counts are
+    cleared first; a property is valid only if its bit is set in
+    d.fields or d.extra (or d.samples[i].fields, d.delta.fields).
+
+Returns:
+    false if the port or format isn't one the decoder knows, in which
+    case the JavaScript returns an empty object.
+
+*/
+
+bool
+cWeRadiateDecoder::decode(
+    const std::uint8_t *pBytes,
+    std::size_t nBytes,
+    std::uint8_t port,
+    Decoded &d
+    )
+    {
+    d.fields = 0;
+    d.extra = 0;
+    d.nProbes = 0;
+    d.nSamples = 0;
+    d.delta.fields = 0;
+    d.pError = nullptr;
+
+    return this->decodePort(pBytes, nBytes, port, d, true);
+    }
@@ -0,0 +1,175 @@
+/*
+
+Module: Catena4610_cWeRadiateDecoder.h
+
+Function:
+    Native C++ port of extra/WeRadiate-decoder-ttn.js.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena4610_cWeRadiateDecoder_h_
+# define _Catena4610_cWeRadiateDecoder_h_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatena4610 {
+
+/*
+
+Name:   McciCatena4610::cWeRadiateDecoder
+
+Function:
+    Decode uplinks the way the TTN console decoder does.
+
+Description:
+    This follows WeRadiate-decoder-ttn.js function by function, so the
+    host benchmark can time the decoder that runs in the network, in
+    place of cPayloadDecoder (which decodes to over-the-air integers
+    and does none of the unit conversion). The JavaScript object
+    becomes a Sample, with a bit in Sample::fields for each property
+    that the JavaScript would have set; numbers are doubles, as they
+    are in JavaScript. Port 2 and formats 0x15, 0x16 and 0x17 are
+    decoded; anything else gives an empty result, as it does there.
+
+    The reference frames of format 0x17 (the JavaScript's refs object)
+    are kept in the decoder object, so decode successive frames with
+    the same object.
+
+*/
+
+class cWeRadiateDecoder
+    {
+public:
+    static constexpr std::uint8_t kMaxProbes = 8;
+    static constexpr std::uint8_t kMaxSamples = 127;
+    static constexpr std::uint8_t kNumComp = 8;
+
+    // bits of Sample::fields.
+    enum Field : std::uint32_t
+        {
+        kVBat       = 1u << 0,
+        kVBus       = 1u << 1,
+        kBoot       = 1u << 2,
+        kTempC      = 1u << 3,  // also p, rh and tDewC
+        kLux        = 1u << 4,
+        kTWater     = 1u << 5,
+        kTSoil      = 1u << 6,  // also rhSoil and tSoilDew
+        kTProbes    = 1u << 7,
+        kDiag       = 1u << 8,
+        kTWaterStats = 1u << 9,
+        kAgeSeconds = 1u << 10,
+        kError      = 1u << 11, // "none", or see Decoded::pError
+        };
+
+    struct Sample
+        {
+        std::uint32_t   fields;
+        double          vBat;
+        double          vBus;
+        double          boot;
+        double          tempC;
+        double          p;
+        double          rh;
+        double          tDewC;
+        double          lux;
+        double          tWater;
+        double          tSoil;
+        double          rhSoil;
+        double          tSoilDew;
+        // tProbes[0] is tWater; a probe without a reading is NaN.
+        std::uint8_t    nProbes;
+        double          tProbes[kMaxProbes];
+        struct
+            {
+            double      awakeMs;
+            double      chargeMc;
+            double      transmitMs;
+            } diag;
+        struct
+            {
+            double      n;
+            double      min;
+            double      max;
+            double      mean;
+            double      stdDev;
+            } tWaterStats;
+        double          ageSeconds;
+        };
+
+    // bits of Decoded::extra: the properties outside Sample.
+    enum Extra : std::uint32_t
+        {
+        kSeq        = 1u << 0,
+        kAgeMinutes = 1u << 1,
+        kInterval   = 1u << 2,  // also nSamples and samples
+        kKeyframe   = 1u << 3,
+        kRefSeq     = 1u << 4,
+        kDelta      = 1u << 5,
+        };
+
+    struct Decoded : Sample
+        {
+        std::uint32_t   extra;
+        // port 2: the log sequence number; format 0x17: the frame's.
+        double          seq;
+        double          ageMinutes;
+        // format 0x16
+        double          interval;
+        std::uint8_t    nSamples;
+        Sample          samples[kMaxSamples];
+        // format 0x17
+        bool            keyframe;
+        double          refSeq;
+        Sample          delta;
+        // "none" (kError set by the TPH field) or the delta error.
+        const char      *pError;
+        };
+
+    cWeRadiateDecoder()
+        {
+        this->reset();
+        }
+
+    // forget the format 0x17 reference frames.
+    void reset();
+
+    // Decoder(bytes, port, refs); false if nothing was decoded.
+    bool decode(const std::uint8_t *pBytes, std::size_t nBytes, std::uint8_t port, Decoded &d);
+
+    static double dewpoint(double t, double rh);
+
+private:
+    typedef double Comp[kNumComp];
+
+    struct Fields
+        {
+        std::uint8_t    flags;
+        Comp            v;
+        std::size_t     i;
+        };
+
+    static void readFields(const std::uint8_t *pBytes, std::size_t nBytes, std::size_t i, const double *pRef, Fields &f);
+    static void updateRef(double *pRef, std::uint8_t flags, const double *pV);
+    static void valuesToSample(Sample &sample, std::uint8_t flags, const double *pV);
+    static void decodePort1(const std::uint8_t *pBytes, std::size_t nBytes, Decoded &d);
+    static void decodeBatch(const std::uint8_t *pBytes, std::size_t nBytes, Decoded &d);
+    void decodeDelta(const std::uint8_t *pBytes, std::size_t nBytes, Decoded &d, bool fRefs);
+    bool decodePort(const std::uint8_t *pBytes, std::size_t nBytes, std::uint8_t port, Decoded &d, bool fRefs);
+
+    // refs: the components of each frame received, by sequence number.
+    Comp            m_Refs[128];
+    bool            m_fRef[128];
+    };
+
+} // namespace McciCatena4610
+
+#endif /* _Catena4610_cWeRadiateDecoder_h_ */
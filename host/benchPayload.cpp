@@ -0,0 +1,481 @@
+/*
+
+Module: benchPayload.cpp
+
+Function:
+    Host benchmark: payload encoders, and the TTN decoder.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cHostSim.h"
+#include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_cWeRadiateDecoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace McciCatena4610;
+
+namespace {
+
+// each case is timed this many times, and the fastest is reported; the
+// others were interrupted or ran with cold caches.
+constexpr unsigned kRounds = 5;
+
+/****************************************************************************\
+|
+|   Report
+|
+\****************************************************************************/
+
+struct Row
+    {
+    std::string     name;
+    unsigned        nBytes;
+    unsigned        nIterations;
+    unsigned        cyclesPerOp;
+    bool            fOk;
+    };
+
+bool writeReport(std::FILE *pFile, std::vector<Row> const &rows)
+    {
+    std::fprintf(pFile, "case,bytes,iterations,cycles_per_op,ok\n");
+    for (auto const &r : rows)
+        {
+        std::fprintf(pFile, "%s,%u,%u,%u,%u\n",
+            r.name.c_str(),
+            r.nBytes,
+            r.nIterations,
+            r.cyclesPerOp,
+            r.fOk ? 1 : 0
+            );
+        }
+    return std::ferror(pFile) == 0;
+    }
+
+bool readReport(const char *pFileName, std::vector<Row> &rows)
+    {
+    std::FILE * const pFile = std::fopen(pFileName, "r");
+    char line[128];
+
+    if (pFile == nullptr)
+        {
+        std::perror(pFileName);
+        return false;
+        }
+
+    while (std::fgets(line, sizeof(line), pFile) != nullptr)
+        {
+        char name[64];
+        Row r;
+        unsigned ok;
+
+        if (std::sscanf(line, "%63[^,],%u,%u,%u,%u",
+                name, &r.nBytes, &r.nIterations, &r.cyclesPerOp, &ok) != 5)
+            continue;   // the header
+
+        r.name = name;
+        r.fOk = ok != 0;
+        rows.push_back(r);
+        }
+
+    std::fclose(pFile);
+    return ! rows.empty();
+    }
+
+// compare with a baseline report: frame sizes must be the same, and
+// costs no more than percent higher. Returns the number of regressions.
+unsigned compareReport(
+    std::vector<Row> const &rows,
+    std::vector<Row> const &baseline,
+    unsigned percent
+    )
+    {
+    unsigned nRegressions = 0;
+
+    for (auto const &b : baseline)
+        {
+        Row const *pRow = nullptr;
+
+        for (auto const &r : rows)
+            {
+            if (r.name == b.name)
+                pRow = &r;
+            }
+
+        if (pRow == nullptr)
+            {
+            std::printf("%s: missing\n", b.name.c_str());
+            ++nRegressions;
+            continue;
+            }
+
+        if (pRow->nBytes != b.nBytes)
+            {
+            std::printf("%s: %u bytes, was %u\n", b.name.c_str(), pRow->nBytes, b.nBytes);
+            ++nRegressions;
+            }
+
+        if (std::uint64_t(pRow->cyclesPerOp) * 100 > std::uint64_t(b.cyclesPerOp) * (100 + percent))
+            {
+            std::printf("%s: %u cycles, was %u\n", b.name.c_str(), pRow->cyclesPerOp, b.cyclesPerOp);
+            ++nRegressions;
+            }
+        }
+
+    return nRegressions;
+    }
+
+/****************************************************************************\
+|
+|   TTN decoder cases
+|
+\****************************************************************************/
+
+using Decoder = cWeRadiateDecoder;
+using Decoded = cWeRadiateDecoder::Decoded;
+
+// the test vectors in the comments of WeRadiate-decoder-ttn.js, and
+// a backfill message on port 2 carrying the first of them.
+const std::uint8_t kTtnUplink[] =
+    {
+    0x15, 0x7D, 0x44, 0x60, 0x0D, 0x15, 0x9D, 0x5F, 0xCD, 0xC3, 0x00, 0x00,
+    0x1C, 0x11, 0x14, 0x46, 0xE4
+    };
+
+const std::uint8_t kTtnProbes[] =
+    {
+    0x15, 0xA0, 0x1C, 0x11, 0x01, 0x03, 0x1B, 0x80, 0x1A, 0x40
+    };
+
+const std::uint8_t kTtnDiag[] =
+    {
+    0x15, 0xA0, 0x1C, 0x11, 0x02, 0x0B, 0xB8, 0x0F, 0xA0, 0x07, 0xD0
+    };
+
+const std::uint8_t kTtnStats[] =
+    {
+    0x15, 0xA0, 0x1C, 0x11, 0x04, 0x05, 0x1B, 0xF0, 0x1C, 0x80, 0x1C, 0x20,
+    0x00, 0x38
+    };
+
+const std::uint8_t kTtnBackfill[] =
+    {
+    0x00, 0x00, 0x01, 0x02, 0x00, 0x2D,
+    0x15, 0x7D, 0x44, 0x60, 0x0D, 0x15, 0x9D, 0x5F, 0xCD, 0xC3, 0x00, 0x00,
+    0x1C, 0x11, 0x14, 0x46, 0xE4
+    };
+
+const std::uint8_t kTtnBatch[] =
+    {
+    0x16, 0x02, 0x03, 0x84, 0x29, 0x44, 0x60, 0x15, 0x9D, 0x5F, 0xCD, 0xC3,
+    0x1C, 0x11, 0x29, 0x07, 0x0E, 0x09, 0x00, 0x1E
+    };
+
+const std::uint8_t kTtnKeyframe[] =
+    {
+    0x17, 0x80, 0x29, 0x44, 0x60, 0x15, 0x9D, 0x5F, 0xCD, 0xC3, 0x1C, 0x11
+    };
+
+const std::uint8_t kTtnDelta[] =
+    {
+    0x17, 0x01, 0x00, 0x29, 0x07, 0x0E, 0x09, 0x00, 0x1E
+    };
+
+bool near(double a, double b)
+    {
+    return std::fabs(a - b) < 1e-9;
+    }
+
+// the values the JavaScript gives for kTtnUplink.
+bool isTtnUplink(Decoded const &d)
+    {
+    return d.fields == (Decoder::kVBat | Decoder::kBoot | Decoder::kTempC | Decoder::kError |
+                        Decoder::kLux | Decoder::kTWater | Decoder::kTSoil) &&
+           near(d.vBat, 4.2734375) &&
+           near(d.boot, 13) &&
+           near(d.tempC, 21.61328125) &&
+           near(d.p, 981) &&
+           near(d.rh, 76.171875) &&
+           near(d.tDewC, 17.236466758309017) &&
+           near(d.lux, 0) &&
+           near(d.tWater, 28.06640625) &&
+           near(d.tSoil, 20.2734375) &&
+           near(d.rhSoil, 89.0625) &&
+           near(d.tSoilDew, 18.411840342527178);
+    }
+
+// the two samples of kTtnBatch, which are also kTtnKeyframe and kTtnDelta.
+bool isTtnSample(Decoder::Sample const &s, unsigned i)
+    {
+    return (s.fields & ~Decoder::kAgeSeconds) == (Decoder::kVBat | Decoder::kTempC | Decoder::kTWater) &&
+           near(s.vBat, i == 0 ? 4.2734375 : 4.2724609375) &&
+           near(s.tempC, i == 0 ? 21.61328125 : 21.640625) &&
+           near(s.p, i == 0 ? 981 : 980.8) &&
+           near(s.rh, 76.171875) &&
+           near(s.tWater, i == 0 ? 28.06640625 : 28.125);
+    }
+
+struct TtnCase
+    {
+    const char          *pName;
+    std::uint8_t        port;
+    const std::uint8_t  *pFrames[2];
+    std::size_t         nFrames[2];
+    bool                (*pCheck)(Decoded const *d);
+    };
+
+const TtnCase kTtnCases[] =
+    {
+        {
+        "ttn_0x15", 1,
+        { kTtnUplink }, { sizeof(kTtnUplink) },
+        [](Decoded const *d)
+            {
+            return isTtnUplink(d[0]);
+            }
+        },
+        {
+        "ttn_0x15_ext", 1,
+        { kTtnProbes, kTtnDiag }, { sizeof(kTtnProbes), sizeof(kTtnDiag) },
+        [](Decoded const *d)
+            {
+            return (d[0].fields & Decoder::kTProbes) && d[0].nProbes == 3 &&
+                   near(d[0].tProbes[0], 28.06640625) &&
+                   near(d[0].tProbes[1], 27.5) &&
+                   near(d[0].tProbes[2], 26.25) &&
+                   (d[1].fields & Decoder::kDiag) &&
+                   near(d[1].diag.awakeMs, 3000) &&
+                   near(d[1].diag.chargeMc, 40) &&
+                   near(d[1].diag.transmitMs, 2000);
+            }
+        },
+        {
+        "ttn_0x15_stats", 1,
+        { kTtnStats }, { sizeof(kTtnStats) },
+        [](Decoded const *d)
+            {
+            return (d[0].fields & Decoder::kTWaterStats) &&
+                   near(d[0].tWaterStats.n, 5) &&
+                   near(d[0].tWaterStats.min, 27.9375) &&
+                   near(d[0].tWaterStats.max, 28.5) &&
+                   near(d[0].tWaterStats.mean, 28.125) &&
+                   near(d[0].tWaterStats.stdDev, 0.21875);
+            }
+        },
+        {
+        "ttn_port2", 2,
+        { kTtnBackfill }, { sizeof(kTtnBackfill) },
+        [](Decoded const *d)
+            {
+            return isTtnUplink(d[0]) &&
+                   d[0].extra == (Decoder::kSeq | Decoder::kAgeMinutes) &&
+                   near(d[0].seq, 258) &&
+                   near(d[0].ageMinutes, 45);
+            }
+        },
+        {
+        "ttn_0x16", 1,
+        { kTtnBatch }, { sizeof(kTtnBatch) },
+        [](Decoded const *d)
+            {
+            return d[0].nSamples == 2 &&
+                   near(d[0].interval, 900) &&
+                   isTtnSample(d[0].samples[0], 0) && near(d[0].samples[0].ageSeconds, 900) &&
+                   isTtnSample(d[0].samples[1], 1) && near(d[0].samples[1].ageSeconds, 0);
+            }
+        },
+        {
+        "ttn_0x17_pair", 1,
+        { kTtnKeyframe, kTtnDelta }, { sizeof(kTtnKeyframe), sizeof(kTtnDelta) },
+        [](Decoded const *d)
+            {
+            return d[0].keyframe && near(d[0].seq, 0) && isTtnSample(d[0], 0) &&
+                   ! d[1].keyframe && near(d[1].seq, 1) && near(d[1].refSeq, 0) &&
+                   d[1].pError == nullptr && isTtnSample(d[1], 1);
+            }
+        },
+    };
+
+// time each TTN decoder case, checking the first result.
+void runTtnBenchmark(std::vector<Row> &rows, std::uint32_t nIterations)
+    {
+    // a Decoded is large, so not on the stack.
+    std::unique_ptr<Decoded[]> d(new Decoded[2]);
+    Decoder decoder;
+
+    for (auto const &c : kTtnCases)
+        {
+        Row r { c.pName, 0, nIterations, UINT32_MAX, false };
+        bool fDecoded = true;
+
+        for (unsigned iRound = 0; iRound < kRounds; ++iRound)
+            {
+            std::uint32_t const cStart = Hal::getCycleCount();
+
+            for (std::uint32_t i = 0; i < nIterations; ++i)
+                {
+                decoder.reset();
+                for (unsigned iFrame = 0; iFrame < 2 && c.pFrames[iFrame] != nullptr; ++iFrame)
+                    fDecoded &= decoder.decode(c.pFrames[iFrame], c.nFrames[iFrame], c.port, d[iFrame]);
+                }
+
+            r.cyclesPerOp = std::min(r.cyclesPerOp, (Hal::getCycleCount() - cStart) / nIterations);
+            }
+
+        r.nBytes = unsigned(c.nFrames[0] + c.nFrames[1]);
+        r.fOk = fDecoded && c.pCheck(d.get());
+        rows.push_back(r);
+        }
+    }
+
+} // namespace
+
+/*
+
+Name:   benchPayload
+
+Function:
+    Measure the cost and size of the uplink payloads.
+
+Definition:
+    benchPayload [-n iterations] [-o report.csv] [-b baseline.csv [-p percent]]
+
+Description:
+    Runs cMeasurementLoop::runPayloadBenchmark() (the cases of the
+    "bench" command: the encoders on the test vectors of
+    extra/thermosense-data-format.md, and cPayloadDecoder), then the
+    cases of cWeRadiateDecoder, the native port of the TTN decoder, on
+    the vectors of WeRadiate-decoder-ttn.js. Each case reports the
+    frame size, the host CPU cycles per run (Hal::getCycleCount(), the
+    best of five rounds), and whether the result matched the test
+    vector.
+
+    -n iterations
+        Runs per case; 1000 by default.
+
+    -o report.csv
+        Write the report there rather than to stdout. The format is
+        "case,bytes,iterations,cycles_per_op,ok".
+
+    -b baseline.csv
+        Compare with a report from an earlier build. A frame size
+        that differs, a case that's missing, or a cost more than the
+        allowed percentage above the baseline is a regression.
+
+    -p percent
+        Cost increase allowed over the baseline; 25 by default, as
+        cycle counts vary from run to run.
+
+Returns:
+    0 if every case matched its test vector and nothing regressed, 1
+    if not, 2 for a usage error.
+
+*/
+
+int main(int argc, char **argv)
+    {
+    std::uint32_t nIterations = 1000;
+    unsigned percent = 25;
+    const char *pReportName = nullptr;
+    const char *pBaselineName = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            nIterations = std::strtoul(argv[++i], nullptr, 0);
+        else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            pReportName = argv[++i];
+        else if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+            pBaselineName = argv[++i];
+        else if (std::strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+            percent = std::strtoul(argv[++i], nullptr, 0);
+        else
+            {
+            std::fprintf(stderr, "usage: benchPayload [-n iterations] [-o report.csv] [-b baseline.csv [-p percent]]\n");
+            return 2;
+            }
+        }
+
+    if (nIterations == 0)
+        nIterations = 1;
+
+    std::vector<Row> baseline;
+
+    if (pBaselineName != nullptr && ! readReport(pBaselineName, baseline))
+        {
+        std::fprintf(stderr, "%s: no benchmark results\n", pBaselineName);
+        return 2;
+        }
+
+    // the loop's encoders, as the "bench" command runs them.
+    gHostSim.reset();
+
+    std::unique_ptr<cMeasurementLoop> pLoop(new cMeasurementLoop());
+    cMeasurementLoop::BenchResult results[cMeasurementLoop::kNumBenchCases];
+    std::vector<Row> rows;
+
+    for (unsigned iRound = 0; iRound < kRounds; ++iRound)
+        {
+        pLoop->runPayloadBenchmark(results, nIterations);
+        for (std::uint8_t iCase = 0; iCase < cMeasurementLoop::kNumBenchCases; ++iCase)
+            {
+            auto const &r = results[iCase];
+            unsigned const cyclesPerOp = r.totalCycles / nIterations;
+
+            if (iRound == 0)
+                rows.push_back(Row { r.pName, r.nBytes, nIterations, cyclesPerOp, r.fOk });
+            else
+                rows[iCase].cyclesPerOp = std::min(rows[iCase].cyclesPerOp, cyclesPerOp);
+            }
+        }
+
+    runTtnBenchmark(rows, nIterations);
+
+    std::FILE * const pFile = pReportName ? std::fopen(pReportName, "w") : stdout;
+
+    if (pFile == nullptr)
+        {
+        std::perror(pReportName);
+        return 2;
+        }
+
+    bool const fWritten = writeReport(pFile, rows);
+
+    if (pFile != stdout)
+        std::fclose(pFile);
+
+    if (! fWritten)
+        {
+        std::fprintf(stderr, "%s: write failed\n", pReportName ? pReportName : "stdout");
+        return 2;
+        }
+
+    unsigned nFailed = 0;
+
+    for (auto const &r : rows)
+        {
+        if (! r.fOk)
+            {
+            std::printf("%s: doesn't match the test vector\n", r.name.c_str());
+            ++nFailed;
+            }
+        }
+
+    if (! baseline.empty())
+        nFailed += compareReport(rows, baseline, percent);
+
+    return nFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
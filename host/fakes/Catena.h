@@ -0,0 +1,53 @@
+/*
+
+Module: Catena.h
+
+Function:
+    Host stand-in for the parts of the Catena platform header that the
+    measurement loop uses.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena_h_
+# define _Catena_h_
+
+#pragma once
+
+#include <cstdint>
+
+namespace McciCatena {
+
+// the bitmap of format 0x15; same values as the platform.
+enum class FlagsSensor3 : std::uint8_t
+    {
+    FlagVbat = 1 << 0,
+    FlagVcc = 1 << 1,
+    FlagBoot = 1 << 2,
+    FlagTPH = 1 << 3,
+    FlagLux = 1 << 4,
+    FlagWater = 1 << 5,
+    FlagSoilTH = 1 << 6,
+    };
+
+constexpr FlagsSensor3 operator| (const FlagsSensor3 lhs, const FlagsSensor3 rhs)
+    {
+    return FlagsSensor3(std::uint8_t(lhs) | std::uint8_t(rhs));
+    }
+
+inline FlagsSensor3 operator|= (FlagsSensor3 &lhs, const FlagsSensor3 rhs)
+    {
+    lhs = lhs | rhs;
+    return lhs;
+    }
+
+constexpr std::uint8_t FormatSensor3 = 0x15;
+
+} // namespace McciCatena
+
+#endif /* _Catena_h_ */
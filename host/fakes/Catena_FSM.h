@@ -0,0 +1,112 @@
+/*
+
+Module: Catena_FSM.h
+
+Function:
+    Host stand-in for McciCatena::cFSM.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena_FSM_h_
+# define _Catena_FSM_h_
+
+#pragma once
+
+namespace McciCatena {
+
+/*
+
+Name:   McciCatena::cFSM
+
+Function:
+    Run a state machine whose states are handled by one dispatch method.
+
+Description:
+    Same contract as the platform class: the dispatch method is called
+    with fEntry true once when a state is entered, then with fEntry
+    false on each eval(), until it returns a state other than
+    TState::stNoChange. eval() may be called from inside the dispatch
+    method (for example, from a send-complete callback); the outer
+    eval() then runs the machine again before returning.
+
+*/
+
+template <class TParent, class TState>
+class cFSM
+    {
+public:
+    typedef TState (TParent::*Dispatch_t)(TState currentState, bool fEntry);
+
+    cFSM()
+        : m_pParent(nullptr)
+        , m_pDispatch(nullptr)
+        , m_State(TState::stInitial)
+        , m_fEntry(false)
+        , m_fEvaluating(false)
+        , m_fReEvaluate(false)
+        {}
+
+    void init(TParent &parent, Dispatch_t pDispatch)
+        {
+        this->m_pParent = &parent;
+        this->m_pDispatch = pDispatch;
+        this->m_State = TState::stInitial;
+        this->m_fEntry = true;
+        this->eval();
+        }
+
+    void eval()
+        {
+        if (this->m_pParent == nullptr)
+            return;
+
+        if (this->m_fEvaluating)
+            {
+            this->m_fReEvaluate = true;
+            return;
+            }
+
+        this->m_fEvaluating = true;
+        do  {
+            this->m_fReEvaluate = false;
+
+            for (;;)
+                {
+                bool const fEntry = this->m_fEntry;
+
+                this->m_fEntry = false;
+                TState const newState = (this->m_pParent->*this->m_pDispatch)(this->m_State, fEntry);
+
+                if (newState == TState::stNoChange)
+                    break;
+
+                this->m_State = newState;
+                this->m_fEntry = true;
+                }
+            } while (this->m_fReEvaluate);
+        this->m_fEvaluating = false;
+        }
+
+    TState getState() const
+        {
+        return this->m_State;
+        }
+
+private:
+    TParent     *m_pParent;
+    Dispatch_t  m_pDispatch;
+    TState      m_State;
+    bool        m_fEntry;
+    bool        m_fEvaluating;
+    bool        m_fReEvaluate;
+    };
+
+} // namespace McciCatena
+
+#endif /* _Catena_FSM_h_ */
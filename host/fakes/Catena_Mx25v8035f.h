@@ -0,0 +1,122 @@
+/*
+
+Module: Catena_Mx25v8035f.h
+
+Function:
+    Host stand-in for the MX25V8035F SPI flash.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena_Mx25v8035f_h_
+# define _Catena_Mx25v8035f_h_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace McciCatena {
+
+/*
+
+Name:   McciCatena::Catena_Mx25v8035f
+
+Function:
+    1 MiB of NOR flash in memory.
+
+Description:
+    The flash starts erased (all 0xFF). As on the part, programming can
+    only clear bits, and only erasing a 4 KiB sector sets them again,
+    so a log that relies on rewriting a byte will show up here. The
+    flash must be powered up to be read, programmed or erased.
+
+*/
+
+class Catena_Mx25v8035f
+    {
+public:
+    static constexpr std::uint32_t kSize = 1024 * 1024;
+    static constexpr std::uint32_t kSectorSize = 4 * 1024;
+
+    Catena_Mx25v8035f()
+        : m_Data(kSize, 0xFF)
+        , m_fPoweredUp(false)
+        , m_nErase(0)
+        , m_nProgram(0)
+        {}
+
+    void powerUp()
+        {
+        this->m_fPoweredUp = true;
+        }
+
+    void powerDown()
+        {
+        this->m_fPoweredUp = false;
+        }
+
+    bool read(std::uint32_t address, std::uint8_t *pBuffer, std::size_t nBuffer)
+        {
+        if (! this->isValid(address, nBuffer))
+            return false;
+
+        std::memcpy(pBuffer, &this->m_Data[address], nBuffer);
+        return true;
+        }
+
+    bool program(std::uint32_t address, const std::uint8_t *pBuffer, std::size_t nBuffer)
+        {
+        if (! this->isValid(address, nBuffer))
+            return false;
+
+        for (std::size_t i = 0; i < nBuffer; ++i)
+            this->m_Data[address + i] &= pBuffer[i];
+
+        ++this->m_nProgram;
+        return true;
+        }
+
+    bool eraseSector(std::uint32_t address)
+        {
+        address &= ~(kSectorSize - 1);
+        if (! this->isValid(address, kSectorSize))
+            return false;
+
+        std::memset(&this->m_Data[address], 0xFF, kSectorSize);
+        ++this->m_nErase;
+        return true;
+        }
+
+    // for tests.
+    std::uint32_t getEraseCount() const
+        {
+        return this->m_nErase;
+        }
+    std::uint32_t getProgramCount() const
+        {
+        return this->m_nProgram;
+        }
+
+private:
+    bool isValid(std::uint32_t address, std::size_t n) const
+        {
+        return this->m_fPoweredUp && address <= kSize && n <= kSize - address;
+        }
+
+    std::vector<std::uint8_t>   m_Data;
+    bool                        m_fPoweredUp;
+    std::uint32_t               m_nErase;
+    std::uint32_t               m_nProgram;
+    };
+
+} // namespace McciCatena
+
+#endif /* _Catena_Mx25v8035f_h_ */
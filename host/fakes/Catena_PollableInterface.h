@@ -0,0 +1,33 @@
+/*
+
+Module: Catena_PollableInterface.h
+
+Function:
+    Host stand-in for McciCatena::cPollableObject.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena_PollableInterface_h_
+# define _Catena_PollableInterface_h_
+
+#pragma once
+
+namespace McciCatena {
+
+// an object that is polled from loop(); see Hal::registerPollable().
+class cPollableObject
+    {
+public:
+    virtual ~cPollableObject() {}
+    virtual void poll() = 0;
+    };
+
+} // namespace McciCatena
+
+#endif /* _Catena_PollableInterface_h_ */
@@ -0,0 +1,111 @@
+/*
+
+Module: Catena_Timer.h
+
+Function:
+    Host stand-in for McciCatena::cTimer.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena_Timer_h_
+# define _Catena_Timer_h_
+
+#pragma once
+
+#include "Catena4610_hal.h"
+
+#include <cstdint>
+
+namespace McciCatena {
+
+/*
+
+Name:   McciCatena::cTimer
+
+Function:
+    Periodic timer on the virtual clock.
+
+Description:
+    The platform timer is polled, and counts the intervals that have
+    gone by. Here the count is worked out from Hal::millis() when it's
+    asked for, which gives the same answers without needing to be
+    registered. Ticks keep their phase: after a long sleep the timer is
+    ready once, and the next tick is still a multiple of the interval
+    from the last retrigger().
+
+*/
+
+class cTimer
+    {
+public:
+    cTimer()
+        : m_tBase(0)
+        , m_interval(0)
+        {}
+
+    bool begin(std::uint32_t interval)
+        {
+        this->m_interval = interval;
+        this->retrigger();
+        return true;
+        }
+
+    void setInterval(std::uint32_t interval)
+        {
+        this->m_interval = interval;
+        }
+
+    std::uint32_t getInterval() const
+        {
+        return this->m_interval;
+        }
+
+    void retrigger()
+        {
+        this->m_tBase = McciCatena4610::Hal::millis();
+        }
+
+    // the number of intervals that have ended and not been consumed.
+    std::uint32_t peekTicks() const
+        {
+        if (this->m_interval == 0)
+            return 0;
+
+        return (McciCatena4610::Hal::millis() - this->m_tBase) / this->m_interval;
+        }
+
+    // consume the ticks; true if there were any.
+    bool isready()
+        {
+        std::uint32_t const nTicks = this->peekTicks();
+
+        if (nTicks == 0)
+            return false;
+
+        this->m_tBase += nTicks * this->m_interval;
+        return true;
+        }
+
+    // milliseconds until the next tick; zero if one is waiting.
+    std::uint32_t getRemaining() const
+        {
+        if (this->m_interval == 0 || this->peekTicks() != 0)
+            return 0;
+
+        return this->m_interval - (McciCatena4610::Hal::millis() - this->m_tBase);
+        }
+
+private:
+    std::uint32_t   m_tBase;
+    std::uint32_t   m_interval;
+    };
+
+} // namespace McciCatena
+
+#endif /* _Catena_Timer_h_ */
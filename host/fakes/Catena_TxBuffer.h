@@ -0,0 +1,121 @@
+/*
+
+Module: Catena_TxBuffer.h
+
+Function:
+    Host stand-in for McciCatena::AbstractTxBuffer_t.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#ifndef _Catena_TxBuffer_h_
+# define _Catena_TxBuffer_h_
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatena {
+
+// an uplink message buffer; the put functions encode the same way as
+// the platform's, which is what the network-side decoders expect.
+template <std::size_t N>
+class AbstractTxBuffer_t
+    {
+public:
+    AbstractTxBuffer_t()
+        : m_n(0)
+        {}
+
+    void begin()
+        {
+        this->m_n = 0;
+        }
+
+    void put(std::uint8_t c)
+        {
+        if (this->m_n < N)
+            this->m_buf[this->m_n++] = c;
+        }
+
+    void put2(std::uint32_t v)
+        {
+        this->put(std::uint8_t(v >> 8));
+        this->put(std::uint8_t(v));
+        }
+
+    void put2u(std::uint32_t v)
+        {
+        if (v > 0xFFFF)
+            v = 0xFFFF;
+        this->put2(v);
+        }
+
+    void put2sf(float v)
+        {
+        std::int32_t i = std::lround(v);
+
+        if (i > 32767)
+            i = 32767;
+        else if (i < -32768)
+            i = -32768;
+        this->put2(std::uint32_t(i));
+        }
+
+    void putV(float v)
+        {
+        this->put2sf(v * 4096.0f);
+        }
+
+    void putT(float v)
+        {
+        this->put2sf(v * 256.0f);
+        }
+
+    void putP(float v)
+        {
+        this->put2u(std::uint32_t(std::lround(v / 4.0f)));
+        }
+
+    void putRH(float v)
+        {
+        long const i = std::lround(v * 2.56f);
+
+        this->put(std::uint8_t(i < 0 ? 0 : i > 255 ? 255 : i));
+        }
+
+    void putLux(std::uint16_t v)
+        {
+        this->put2u(v);
+        }
+
+    void putBootCountLsb(std::uint32_t v)
+        {
+        this->put(std::uint8_t(v));
+        }
+
+    const std::uint8_t *getbase() const
+        {
+        return this->m_buf;
+        }
+
+    std::size_t getn() const
+        {
+        return this->m_n;
+        }
+
+private:
+    std::uint8_t    m_buf[N];
+    std::size_t     m_n;
+    };
+
+} // namespace McciCatena
+
+#endif /* _Catena_TxBuffer_h_ */
@@ -0,0 +1,303 @@
+/*
+
+Module: test_traceReplay.cpp
+
+Function:
+    Host test: record a trace in the simulator, and replay it.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cHostSim.h"
+#include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_cTraceReplay.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+using namespace McciCatena4610;
+
+/****************************************************************************\
+|
+|   Test framework
+|
+\****************************************************************************/
+
+namespace {
+
+unsigned gnFailures;
+
+#define CHECK(e)    check((e), #e, __FILE__, __LINE__)
+
+bool check(bool fOk, const char *pExpr, const char *pFile, int line)
+    {
+    if (! fOk)
+        {
+        std::printf("%s:%d: check failed: %s\n", pFile, line, pExpr);
+        ++gnFailures;
+        }
+    return fOk;
+    }
+
+constexpr std::uint32_t kSecond = 1000;
+
+using Event = cTraceReplay::Event;
+using Type = cTraceReplay::Type;
+
+struct cDevice
+    {
+    McciCatena::Catena_Mx25v8035f   flash;
+    cFlashLog                       log;
+    cMeasurementLoop                loop;
+    };
+
+// the radio is out between these times.
+bool outageResult(void *, cHostSim::Uplink const &u)
+    {
+    return u.tMs < 90 * kSecond || u.tMs >= 150 * kSecond;
+    }
+
+/*
+
+Name:   recordTrace()
+
+Function:
+    Run the loop through a busy few minutes, and return its trace.
+
+Description:
+    The fast uplinks, with the readings changing, a probe that drops
+    out and comes back, a radio outage, USB power coming and going,
+    the battery going low, and finally the device losing its keys.
+
+*/
+
+std::vector<Event> recordTrace(void)
+    {
+    gHostSim.reset();
+    gHostSim.setVbat(3.9f);
+    gHostSim.setEnv(21.5f, 98765.0f, 62.0f);
+    gHostSim.setLux(432);
+    gHostSim.addProbe(18.5f);
+
+    std::unique_ptr<cDevice> pDevice(new cDevice());
+    auto &loop = pDevice->loop;
+
+    pDevice->log.begin(&pDevice->flash, cMeasurementLoop::kLogRecordLayout);
+    loop.registerFlashLog(&pDevice->log);
+    loop.begin();
+    loop.requestActive(true);
+
+    gHostSim.run(45 * kSecond);
+    gHostSim.setEnv(22.25f, 99012.0f, 55.5f);
+    gHostSim.setLux(1210);
+    gHostSim.getProbe(0).TempC = 19.0625f;
+
+    gHostSim.run(30 * kSecond);
+    gHostSim.setRadioResult(outageResult, nullptr);
+    gHostSim.getProbe(0).fConnected = false;
+
+    gHostSim.run(30 * kSecond);
+    gHostSim.getProbe(0).fConnected = true;
+    gHostSim.setVbus(4.9f);
+
+    gHostSim.run(60 * kSecond);
+    gHostSim.setVbus(0.0f);
+    gHostSim.setVbat(3.5f);
+    gHostSim.setEnv(20.75f, 99100.0f, 58.0f);
+
+    gHostSim.run(90 * kSecond);
+    gHostSim.setProvisioned(false);
+
+    gHostSim.run(45 * kSecond);
+
+    auto const &trace = loop.getEventTrace();
+    std::vector<Event> events;
+
+    CHECK(trace.getnLost() == 0);
+    for (std::uint16_t i = 0; i < trace.getn(); ++i)
+        events.push_back(trace.get(i));
+
+    return events;
+    }
+
+// the trace, as the "trace" command would print it.
+std::vector<std::string> formatTrace(std::vector<Event> const &events)
+    {
+    std::vector<std::string> lines;
+    char line[80];
+
+    for (auto const &e : events)
+        {
+        cMeasurementLoop::formatTraceEvent(line, sizeof(line), e);
+        lines.push_back(line);
+        }
+
+    return lines;
+    }
+
+std::size_t count(std::vector<Event> const &events, Type type)
+    {
+    std::size_t n = 0;
+
+    for (auto const &e : events)
+        n += e.type == type;
+
+    return n;
+    }
+
+/****************************************************************************\
+|
+|   Tests
+|
+\****************************************************************************/
+
+// every kind of event is in the trace, and survives being printed.
+void testFormat(void)
+    {
+    auto const events = recordTrace();
+    auto const lines = formatTrace(events);
+
+    CHECK(count(events, Type::kState) != 0);
+    CHECK(count(events, Type::kSensor) != 0);
+    CHECK(count(events, Type::kValue) != 0);
+    CHECK(count(events, Type::kTxStart) != 0);
+    CHECK(count(events, Type::kTxDone) != 0);
+    CHECK(count(events, Type::kPower) >= 2);
+    CHECK(count(events, Type::kProvisioned) == 2);
+
+    for (std::size_t i = 0; i < events.size(); ++i)
+        {
+        Event e;
+
+        if (! CHECK(cTraceReplay::parseLine(lines[i].c_str(), e)))
+            {
+            std::printf("  %s\n", lines[i].c_str());
+            continue;
+            }
+
+        CHECK(e.t == events[i].t);
+        CHECK(e.type == events[i].type);
+        CHECK(e.a == events[i].a);
+        CHECK(e.b == events[i].b);
+        CHECK(e.c == events[i].c);
+        }
+
+    Event e;
+    CHECK(! cTraceReplay::parseLine("trace: 3 events (0 lost), recording on", e));
+    }
+
+// the replay does exactly what the recording did.
+void testReplay(void)
+    {
+    auto const events = recordTrace();
+    auto const result = cTraceReplay::replay(events, cTraceReplay::Options());
+
+    CHECK(result.isOk());
+    CHECK(result.nChecked == events.size() - count(events, Type::kValue));
+    std::fputs(result.report.c_str(), stdout);
+    }
+
+// a different reading changes an uplink.
+void testValueChanged(void)
+    {
+    auto events = recordTrace();
+
+    // Vbat, since it's read whichever sensors are built in.
+    for (auto &e : events)
+        {
+        if (e.type == Type::kValue && e.a == std::uint8_t(cEventTrace::Value::kVbat))
+            {
+            float const vbat = cEventTrace::getValue(e) + 0.1f;
+
+            std::memcpy(&e.c, &vbat, sizeof(e.c));
+            }
+        }
+
+    auto const result = cTraceReplay::replay(events, cTraceReplay::Options());
+
+    CHECK(! result.isOk());
+    CHECK(std::strstr(result.report.c_str(), "tx port") != nullptr);
+    }
+
+// a state entered at a different time is caught, unless it's within
+// the tolerance.
+void testTiming(void)
+    {
+    auto events = recordTrace();
+    std::size_t nStates = 0;
+
+    for (auto &e : events)
+        {
+        if (e.type == Type::kState && ++nStates == 3)
+            {
+            e.t += 20;
+            break;
+            }
+        }
+
+    cTraceReplay::Options options;
+
+    CHECK(! cTraceReplay::replay(events, options).isOk());
+
+    options.toleranceMs = 20;
+    CHECK(cTraceReplay::replay(events, options).isOk());
+    }
+
+} // namespace
+
+/****************************************************************************\
+|
+|   Main
+|
+\****************************************************************************/
+
+// with "-w file", just write the recorded trace to file.
+int main(int argc, char **argv)
+    {
+    if (argc == 3 && std::strcmp(argv[1], "-w") == 0)
+        {
+        auto const events = recordTrace();
+        std::FILE * const pFile = std::fopen(argv[2], "w");
+
+        if (pFile == nullptr)
+            {
+            std::perror(argv[2]);
+            return EXIT_FAILURE;
+            }
+
+        std::fprintf(pFile, "trace: %u events (0 lost), recording on\n", unsigned(events.size()));
+        for (auto const &line : formatTrace(events))
+            std::fprintf(pFile, "%s\n", line.c_str());
+        std::fclose(pFile);
+        return EXIT_SUCCESS;
+        }
+
+    static const struct
+        {
+        const char  *pName;
+        void        (*pFn)(void);
+        } tests[] =
+        {
+        { "format", testFormat },
+        { "replay", testReplay },
+        { "value changed", testValueChanged },
+        { "timing", testTiming },
+        };
+
+    for (auto const &t : tests)
+        {
+        unsigned const nBefore = gnFailures;
+
+        t.pFn();
+        std::printf("%s: %s\n", t.pName, gnFailures == nBefore ? "ok" : "FAILED");
+        }
+
+    return gnFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
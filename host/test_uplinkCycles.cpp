@@ -0,0 +1,461 @@
+/*
+
+Module: test_uplinkCycles.cpp
+
+Function:
+    Host test: run the measurement loop through days of uplink cycles.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cHostSim.h"
+#include "Catena4610_cMeasurementLoop.h"
+#include "Catena4610_cPayloadDecoder.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+using namespace McciCatena4610;
+
+/****************************************************************************\
+|
+|   Test framework
+|
+\****************************************************************************/
+
+namespace {
+
+unsigned gnFailures;
+
+#define CHECK(e)    check((e), #e, __FILE__, __LINE__)
+
+bool check(bool fOk, const char *pExpr, const char *pFile, int line)
+    {
+    if (! fOk)
+        {
+        std::printf("%s:%d: check failed: %s\n", pFile, line, pExpr);
+        ++gnFailures;
+        }
+    return fOk;
+    }
+
+constexpr std::uint32_t kSecond = 1000;
+constexpr std::uint32_t kMinute = 60 * kSecond;
+constexpr std::uint32_t kHour = 60 * kMinute;
+
+using Flags = cMeasurementLoop::Flags;
+using Values = cPayloadDecoder::Values;
+using Uplink = cHostSim::Uplink;
+
+// a device as setup() builds it: the loop, with the flash log.
+struct cDevice
+    {
+    McciCatena::Catena_Mx25v8035f   flash;
+    cFlashLog                       log;
+    cMeasurementLoop                loop;
+
+    void begin()
+        {
+        CHECK(this->log.begin(&this->flash, cMeasurementLoop::kLogRecordLayout));
+        this->loop.registerFlashLog(&this->log);
+        this->loop.begin();
+        this->loop.requestActive(true);
+        }
+    };
+
+// a fresh simulator, with one compost probe.
+std::unique_ptr<cDevice> startDevice(void)
+    {
+    gHostSim.reset();
+    gHostSim.setVbat(3.7f);
+    gHostSim.setEnv(21.5f, 98765.0f, 62.0f);
+    gHostSim.setLux(432);
+    gHostSim.addProbe(18.5f);
+
+    // value-initialized, so it starts zeroed like the sketch's globals.
+    std::unique_ptr<cDevice> pDevice(new cDevice());
+
+    pDevice->begin();
+    return pDevice;
+    }
+
+std::vector<Uplink> getUplinks(std::uint8_t port, bool fSuccessOnly = true)
+    {
+    std::vector<Uplink> result;
+
+    for (auto const &u : gHostSim.getUplinks())
+        {
+        if (u.port == port && (u.fSuccess || ! fSuccessOnly))
+            result.push_back(u);
+        }
+
+    return result;
+    }
+
+bool isNear(std::int32_t v, std::int32_t expected, std::int32_t tolerance)
+    {
+    return v >= expected - tolerance && v <= expected + tolerance;
+    }
+
+// check the fields of a format 0x15 message against the simulated world;
+// only the sensors in this build's registry send theirs.
+void checkValues(Values const &v)
+    {
+    std::uint8_t const fields =
+        std::uint8_t(Flags::FlagVbat) | std::uint8_t(Flags::FlagVcc) |
+        std::uint8_t(Flags::FlagBoot) | Sensors::Registry::getFieldMask();
+
+    CHECK(v.flags == fields);
+    CHECK(v.v[cPayloadEncoder::kVbat] == std::int32_t(3.7f * 4096 + 0.5f));
+    CHECK(v.v[cPayloadEncoder::kVbus] == 0);
+    CHECK(v.v[cPayloadEncoder::kBoot] == 1);
+    if (Sensors::Bme280::kEnabled)
+        {
+        // the BME280 resolves 0.01 C, 1/256 Pa and 1/1024 %RH.
+        CHECK(isNear(v.v[cPayloadEncoder::kT], std::int32_t(21.5f * 256), 2));
+        CHECK(isNear(v.v[cPayloadEncoder::kP], 98765 / 4, 1));
+        CHECK(isNear(v.v[cPayloadEncoder::kRH], std::int32_t(62.0f * 2.56f + 0.5f), 1));
+        }
+    if (Sensors::Si1133::kEnabled)
+        CHECK(v.v[cPayloadEncoder::kLux] == 432);
+    if (Sensors::Compost::kEnabled)
+        CHECK(v.v[cPayloadEncoder::kCompostT] == std::int32_t(18.5f * 256));
+    }
+
+/****************************************************************************\
+|
+|   Scenarios
+|
+\****************************************************************************/
+
+// fast uplinks, then the permanent cycle, with deep sleep in between.
+void testFastThenPermanent(void)
+    {
+    auto const pDevice = startDevice();
+
+    gHostSim.run(25 * kHour);
+
+    auto const uplinks = getUplinks(cMeasurementLoop::kUplinkPort);
+
+    // ten fast uplinks, then one every 8 hours.
+    if (! CHECK(uplinks.size() == 10 + 3))
+        return;
+
+    for (std::size_t i = 1; i < uplinks.size(); ++i)
+        {
+        std::uint32_t const gap = uplinks[i].tMs - uplinks[i - 1].tMs;
+
+        if (i < 10)
+            CHECK(isNear(gap, 30 * kSecond, 2 * kSecond));
+        else
+            CHECK(isNear(gap, 8 * kHour, kMinute));
+        }
+
+    for (auto const &u : uplinks)
+        {
+        Values v;
+
+        CHECK(cPayloadDecoder::decodeUplink(u.data.data(), u.data.size(), v) ==
+              cPayloadDecoder::Status::kOk);
+        checkValues(v);
+        }
+
+    // nothing else was sent, and the device slept between cycles.
+    CHECK(gHostSim.getUplinks().size() == uplinks.size());
+    CHECK(gHostSim.getDeepSleepCount() >= 3);
+    CHECK(gHostSim.getDeepSleepMs() > 20ull * kHour);
+    CHECK(! pDevice->log.hasUnsent());
+
+    // the boost regulator is on only while the probe is measured.
+    CHECK(! gHostSim.isPinHigh(Hal::kPinBoost));
+    }
+
+// the network is lost for a day; the missed uplinks go out afterwards.
+struct Outage
+    {
+    std::uint32_t   tBegin;
+    std::uint32_t   tEnd;
+    };
+
+bool outageResult(void *pContext, Uplink const &u)
+    {
+    auto const pOutage = static_cast<Outage const *>(pContext);
+
+    return u.tMs < pOutage->tBegin || u.tMs >= pOutage->tEnd;
+    }
+
+void testOutage(void)
+    {
+    Outage outage { 1 * kHour, 25 * kHour };
+
+    auto const pDevice = startDevice();
+
+    gHostSim.setRadioResult(outageResult, &outage);
+    gHostSim.run(34 * kHour);
+
+    // the uplinks at 8, 16 and 24 hours failed, and were tried again.
+    std::size_t nFailed = 0;
+    for (auto const &u : gHostSim.getUplinks())
+        {
+        if (! u.fSuccess)
+            {
+            ++nFailed;
+            CHECK(u.tMs >= outage.tBegin && u.tMs < outage.tEnd);
+            }
+        }
+    CHECK(nFailed > 3);
+
+    // after the outage, each missed measurement got through, either as
+    // a retry on the uplink port or from the log on the backfill port.
+    std::size_t nRecovered = 0;
+    for (auto const &u : gHostSim.getUplinks())
+        {
+        if (u.fSuccess && u.tMs >= outage.tEnd)
+            ++nRecovered;
+        }
+    CHECK(nRecovered >= 3);
+    CHECK(! getUplinks(cMeasurementLoop::kBackfillPort).empty() ||
+          getUplinks(cMeasurementLoop::kUplinkPort).size() >= 10 + 4);
+
+    for (auto const &u : getUplinks(cMeasurementLoop::kBackfillPort))
+        {
+        Values v;
+
+        // sequence number and age, then the format 0x15 message.
+        if (! CHECK(u.data.size() > cMeasurementLoop::kBackfillHeaderSize))
+            continue;
+
+        CHECK(cPayloadDecoder::decodeUplink(
+                u.data.data() + cMeasurementLoop::kBackfillHeaderSize,
+                u.data.size() - cMeasurementLoop::kBackfillHeaderSize,
+                v
+                ) == cPayloadDecoder::Status::kOk);
+        checkValues(v);
+        }
+
+    CHECK(! pDevice->log.hasUnsent());
+    }
+
+// every uplink is confirmed and no ACK comes for a day: the data rate
+// steps down, but not to one too slow for a measurement uplink (in the
+// host build's EU868 table, DR3 is the slowest with more than 51 bytes).
+void testDataRateFloor(void)
+    {
+    Outage outage { 0, 25 * kHour };
+
+    auto const pDevice = startDevice();
+
+    pDevice->loop.setLinkConfirmInterval(1);
+    gHostSim.setDataRate(5);
+    gHostSim.setRadioResult(outageResult, &outage);
+    gHostSim.run(24 * kHour);
+
+    CHECK(gHostSim.getDataRate() == 3);
+    }
+
+// batches of four samples, 15 minutes apart.
+void testBatching(void)
+    {
+    auto const pDevice = startDevice();
+
+    pDevice->loop.setBatching(15 * 60, 4);
+
+    // stop just after a batch goes out, so no samples are waiting.
+    gHostSim.run(11 * kHour + 5 * kMinute);
+
+    std::size_t nBatches = 0;
+    std::uint32_t tLast = 0;
+
+    for (auto const &u : getUplinks(cMeasurementLoop::kUplinkPort))
+        {
+        if (u.data.empty() || u.data[0] != cMeasurementFormat::kBatchMessageFormat)
+            continue;
+
+        Values v[cMeasurementFormat::kMaxBatchSamples];
+        std::uint8_t nSamples;
+        std::uint16_t intervalSec;
+        bool fHeldBack;
+
+        CHECK(cPayloadDecoder::decodeBatch(
+                u.data.data(), u.data.size(),
+                v, cMeasurementFormat::kMaxBatchSamples,
+                nSamples, intervalSec, fHeldBack
+                ) == cPayloadDecoder::Status::kOk);
+        CHECK(nSamples == 4);
+        CHECK(intervalSec == 15 * 60);
+        for (std::uint8_t i = 0; i < nSamples && i < 4; ++i)
+            checkValues(v[i]);
+
+        if (nBatches != 0)
+            CHECK(isNear(u.tMs - tLast, kHour, kMinute));
+
+        tLast = u.tMs;
+        ++nBatches;
+        }
+
+    // the first batch starts after the fast uplinks.
+    CHECK(nBatches >= 10);
+    CHECK(! pDevice->log.hasUnsent());
+    }
+
+// the data rate drops while a batch is being collected: the batches that
+// follow are cut to fit, and the samples left out go in the next one.
+void testBatchDataRateDrop(void)
+    {
+    auto const pDevice = startDevice();
+
+    gHostSim.setDataRate(5);
+    pDevice->loop.setBatching(15 * 60, 16);
+    gHostSim.run(3 * kHour);
+
+    std::size_t const nBefore = gHostSim.getUplinks().size();
+
+    gHostSim.setDataRate(0);
+    gHostSim.run(12 * kHour + 5 * kMinute);
+
+    auto const &uplinks = gHostSim.getUplinks();
+    std::size_t nSamples = 0;
+
+    for (std::size_t i = nBefore; i < uplinks.size(); ++i)
+        {
+        auto const &u = uplinks[i];
+
+        // 51 bytes is the EU868 limit at DR0.
+        CHECK(u.data.size() <= 51);
+        if (u.port != cMeasurementLoop::kUplinkPort ||
+            u.data.empty() || u.data[0] != cMeasurementFormat::kBatchMessageFormat)
+            continue;
+
+        Values v[cMeasurementFormat::kMaxBatchSamples];
+        std::uint8_t n;
+        std::uint16_t intervalSec;
+        bool fHeldBack;
+
+        CHECK(cPayloadDecoder::decodeBatch(
+                u.data.data(), u.data.size(),
+                v, cMeasurementFormat::kMaxBatchSamples,
+                n, intervalSec, fHeldBack
+                ) == cPayloadDecoder::Status::kOk);
+        for (std::uint8_t j = 0; j < n; ++j)
+            checkValues(v[j]);
+        nSamples += n;
+        }
+
+    // a sample every 15 minutes since the drop, and the ones held over
+    // from before it; the newest may still be waiting for the next batch.
+    CHECK(nSamples >= 12 * 4);
+    }
+
+// on USB power there's no battery to save, so the loop doesn't deep sleep.
+void testUsbPower(void)
+    {
+    gHostSim.reset();
+    gHostSim.setVbus(5.0f);
+
+    std::unique_ptr<cDevice> pDevice(new cDevice());
+
+    pDevice->begin();
+    gHostSim.run(20 * kMinute);
+
+    CHECK(gHostSim.getDeepSleepCount() == 0);
+    CHECK(getUplinks(cMeasurementLoop::kUplinkPort).size() == 10);
+    }
+
+// a configuration downlink is applied whole or not at all; batching
+// below the shortest interval, or deeper than a message holds, is
+// refused.
+void testConfigBatch(void)
+    {
+    auto const pDevice = startDevice();
+    auto &loop = pDevice->loop;
+
+    static const std::uint8_t kTooFast[] = { 0x06, 0x00, 0x00, 0x00, 0x01, 0x04 };
+    static const std::uint8_t kTooDeep[] = { 0x06, 0x00, 0x00, 0x03, 0x84, 0x21 };
+    static const std::uint8_t kBoth[] =
+        {
+        0x01, 0x00, 0x00, 0x0E, 0x10,
+        0x06, 0x00, 0x00, 0x00, 0x3B, 0x04
+        };
+    static const std::uint8_t kGood[] = { 0x06, 0x00, 0x00, 0x03, 0x84, 0x20 };
+
+    std::uint32_t const cycleSec = loop.getPermanentCycleTime();
+
+    CHECK(! loop.processConfigDownlink(kTooFast, sizeof(kTooFast)));
+    CHECK(! loop.processConfigDownlink(kTooDeep, sizeof(kTooDeep)));
+    CHECK(! loop.processConfigDownlink(kBoth, sizeof(kBoth)));
+    CHECK(loop.getBatchDepth() == 0);
+    CHECK(loop.getPermanentCycleTime() == cycleSec);
+
+    CHECK(loop.processConfigDownlink(kGood, sizeof(kGood)));
+    CHECK(loop.getBatchDepth() == 32);
+    CHECK(loop.getBatchSampleTime() == 900);
+    }
+
+// without a probe no conversion starts, so no compost latency is
+// recorded; with one, each latency is a conversion's, not a cycle's.
+void testCompostLatency(void)
+    {
+    gHostSim.reset();
+
+    std::unique_ptr<cDevice> pDevice(new cDevice());
+
+    pDevice->begin();
+    gHostSim.run(2 * kHour);
+
+    CHECK(pDevice->loop.getProfiler().getSensor(
+            cMeasurementLoop::kProfileCompost
+            ).n == 0);
+
+    pDevice = startDevice();
+    gHostSim.run(2 * kHour);
+
+    auto const &compost = pDevice->loop.getProfiler().getSensor(
+            cMeasurementLoop::kProfileCompost
+            );
+
+    CHECK(compost.n != 0 || ! Sensors::Compost::kEnabled);
+    CHECK(compost.maxUs < 1000 * 1000);
+    }
+
+} // namespace
+
+/****************************************************************************\
+|
+|   Main
+|
+\****************************************************************************/
+
+int main(void)
+    {
+    static const struct
+        {
+        const char  *pName;
+        void        (*pFn)(void);
+        } tests[] =
+        {
+        { "fast then permanent", testFastThenPermanent },
+        { "outage", testOutage },
+        { "data rate floor", testDataRateFloor },
+        { "batching", testBatching },
+        { "batch data rate drop", testBatchDataRateDrop },
+        { "usb power", testUsbPower },
+        { "config batch", testConfigBatch },
+        { "compost latency", testCompostLatency },
+        };
+
+    for (auto const &t : tests)
+        {
+        unsigned const nBefore = gnFailures;
+
+        t.pFn();
+        std::printf("%s: %s\n", t.pName, gnFailures == nBefore ? "ok" : "FAILED");
+        }
+
+    return gnFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
@@ -0,0 +1,117 @@
+/*
+
+Module: traceReplay.cpp
+
+Function:
+    Host tool: replay a trace captured with the "trace" command.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Dhinesh Kumar Pitchai, MCCI Corporation   May 2022
+
+*/
+
+#include "Catena4610_cTraceReplay.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace McciCatena4610;
+
+/*
+
+Name:   traceReplay
+
+Function:
+    Run the measurement loop against a trace, and report differences.
+
+Definition:
+    traceReplay [-t ms] [-f flags] [file]
+
+Description:
+    Reads the trace from file (or stdin), replays it with
+    cTraceReplay::replay(), and prints the first mismatches.
+
+    -t ms
+        Allow times and latencies to differ by this much; 0 by
+        default. Use at least 10 for a trace taken on a device.
+
+    -f flags
+        The operating flags the device had; 1 (fUnattended) by
+        default. Accepts hex with a 0x prefix.
+
+Returns:
+    0 if every result matched, 1 if any didn't, 2 for a usage error,
+    and 77 (ctest's conventional skip code) if the trace was recorded
+    with a sensor that this build leaves out.
+
+*/
+
+namespace {
+
+constexpr int kExitSkipped = 77;
+
+} // namespace
+
+int main(int argc, char **argv)
+    {
+    cTraceReplay::Options options;
+    const char *pFileName = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+        {
+        if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            options.toleranceMs = std::strtoul(argv[++i], nullptr, 0);
+        else if (std::strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+            options.operatingFlags = std::strtoul(argv[++i], nullptr, 0);
+        else if (argv[i][0] != '-' && pFileName == nullptr)
+            pFileName = argv[i];
+        else
+            {
+            std::fprintf(stderr, "usage: traceReplay [-t ms] [-f flags] [file]\n");
+            return 2;
+            }
+        }
+
+    std::FILE *pFile = pFileName ? std::fopen(pFileName, "r") : stdin;
+
+    if (pFile == nullptr)
+        {
+        std::perror(pFileName);
+        return 2;
+        }
+
+    std::vector<cTraceReplay::Event> trace;
+    bool const fRead = cTraceReplay::read(pFile, trace);
+
+    if (pFile != stdin)
+        std::fclose(pFile);
+
+    if (! fRead)
+        {
+        std::fprintf(stderr, "%s: no trace events\n", pFileName ? pFileName : "stdin");
+        return 2;
+        }
+
+    if (! cTraceReplay::hasBuildSensors(trace))
+        {
+        std::printf("%s: recorded with sensors that this build leaves out\n",
+            pFileName ? pFileName : "stdin"
+            );
+        return kExitSkipped;
+        }
+
+    auto const result = cTraceReplay::replay(trace, options);
+
+    std::fputs(result.report.c_str(), stdout);
+    std::printf("%u events, %u results checked, %u mismatched\n",
+        unsigned(trace.size()),
+        unsigned(result.nChecked),
+        unsigned(result.nMismatched)
+        );
+
+    return result.isOk() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }